@@ -0,0 +1,599 @@
+#include <getopt.h>
+
+#include "file_system.h"
+
+/**
+ * Pourcentage d'implication :
+ * GOBALOUKICHENIN Bala : 33%
+ * DEHOUCHE Lisa : 33%
+ * GABITA William : 33%
+ *
+ * Banc d'essai du système de fichiers
+ *
+ * Chaque mesure appelle directement l'API (creer_fichier, lire_fichier...)
+ * sur une partition jetable et rapporte, au format JSON, le débit en
+ * opérations et en octets, les latences p50/p99 et les accès au fichier
+ * de partition. Avec un fichier de référence, le programme échoue si une
+ * mesure régresse au-delà d'un seuil.
+ */
+
+#define MAX_MESURES 16                      // Nombre maximal de mesures d'un passage
+#define FICHIERS_PAR_TOUR 12                // Fichiers créés par tour (un répertoire en contient 13)
+#define TAILLE_GROS_FICHIER (1024 * 1024)   // Fichier des mesures de lecture et d'écriture
+#define TAILLE_COPIE (64 * 1024)            // Fichier de la mesure de copie
+#define SEUIL_DEFAUT 10.0                   // Régression tolérée (en %)
+
+/**
+ * @brief Compteurs relevés à un instant donné
+ */
+typedef struct {
+    double temps;                  // Secondes (horloge monotone)
+    unsigned long lectures;
+    unsigned long ecritures;
+    unsigned long octets_lus;
+    unsigned long octets_ecrits;
+} Releve;
+
+/**
+ * @brief Résultat d'une mesure
+ */
+typedef struct {
+    char nom[32];
+    double* latences;              // Latence de chaque opération (µs)
+    int nb_operations;
+    int capacite;
+    double duree;                  // Temps passé dans les opérations mesurées (s)
+    unsigned long octets;          // Octets de données traités
+    unsigned long lectures;        // Accès au fichier de partition
+    unsigned long ecritures;
+    unsigned long octets_lus;
+    unsigned long octets_ecrits;
+    int erreurs;
+} Mesure;
+
+/**
+ * @brief Partition jetable d'une mesure
+ */
+typedef struct {
+    char chemin[MAX_CHEMIN + 32];
+    SystemeFichiers* fs;
+    Session* s;
+} Partition;
+
+static Mesure mesures[MAX_MESURES];
+static int nb_mesures = 0;
+static char repertoire_temporaire[MAX_CHEMIN] = "/tmp";
+
+/**
+ * Relève l'horloge et les compteurs d'accès de la partition
+ * @param fs La partition
+ * @return Le relevé
+ */
+static Releve relever(SystemeFichiers* fs) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    Releve r = {
+        .temps = t.tv_sec + t.tv_nsec / 1e9,
+        .lectures = fs->nb_lectures_disque,
+        .ecritures = fs->nb_ecritures_disque,
+        .octets_lus = fs->octets_lus,
+        .octets_ecrits = fs->octets_ecrits,
+    };
+    return r;
+}
+
+/**
+ * Commence une nouvelle mesure
+ * @param nom Le nom de la mesure (celui de la fonction mesurée)
+ * @return La mesure, ou NULL si le tableau est plein
+ */
+static Mesure* nouvelle_mesure(const char* nom) {
+    if (nb_mesures == MAX_MESURES) {
+        return NULL;
+    }
+    Mesure* m = &mesures[nb_mesures++];
+    memset(m, 0, sizeof(Mesure));
+    snprintf(m->nom, sizeof(m->nom), "%s", nom);
+    return m;
+}
+
+/**
+ * Ajoute à une mesure le temps et les accès écoulés depuis un relevé
+ * @param m La mesure
+ * @param fs La partition
+ * @param debut Le relevé pris avant l'opération
+ * @param operation 1 pour compter une opération (et sa latence), 0 pour
+ *                  un travail annexe qui en fait partie (vidage...)
+ * @param resultat La valeur rendue par l'opération (négative si erreur)
+ */
+static void enregistrer(Mesure* m, SystemeFichiers* fs, Releve debut, int operation, int resultat) {
+    Releve fin = relever(fs);
+    double duree = fin.temps - debut.temps;
+
+    m->duree += duree;
+    m->lectures += fin.lectures - debut.lectures;
+    m->ecritures += fin.ecritures - debut.ecritures;
+    m->octets_lus += fin.octets_lus - debut.octets_lus;
+    m->octets_ecrits += fin.octets_ecrits - debut.octets_ecrits;
+    if (resultat < 0) {
+        m->erreurs++;
+    }
+    if (!operation) {
+        return;
+    }
+
+    if (m->nb_operations == m->capacite) {
+        int capacite = m->capacite ? m->capacite * 2 : 1024;
+        double* agrandi = realloc(m->latences, capacite * sizeof(double));
+        if (!agrandi) {
+            return;
+        }
+        m->latences = agrandi;
+        m->capacite = capacite;
+    }
+    m->latences[m->nb_operations++] = duree * 1e6;
+}
+
+/**
+ * Crée une partition vide dans le répertoire temporaire
+ * @param p La partition à remplir
+ * @return 0 si succès, -1 si erreur
+ */
+static int ouvrir_jetable(Partition* p) {
+    snprintf(p->chemin, sizeof(p->chemin), "%s/bench_fs_%d.bin", repertoire_temporaire, (int)getpid());
+    p->fs = initialiser_partition(p->chemin);
+    if (p->fs == NULL) {
+        return -1;
+    }
+    p->s = ouvrir_session(p->fs);
+    if (p->s == NULL) {
+        fermer_partition(p->fs);
+        unlink(p->chemin);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Ferme et supprime une partition jetable
+ * @param p La partition
+ */
+static void fermer_jetable(Partition* p) {
+    fermer_session(p->s);
+    fermer_partition(p->fs);
+    unlink(p->chemin);
+}
+
+/**
+ * Crée un fichier et le remplit de données
+ * @param p La partition
+ * @param nom Le nom du fichier
+ * @param taille La taille du contenu
+ * @return L'inode du fichier, ou -1 si erreur
+ */
+static int creer_rempli(Partition* p, const char* nom, int taille) {
+    char bloc[TAILLE_BLOC];
+    int inode_id = creer_fichier(p->s, nom, TYPE_FICHIER);
+    if (inode_id == -1) {
+        return -1;
+    }
+    for (int offset = 0; offset < taille; offset += TAILLE_BLOC) {
+        int morceau = taille - offset < TAILLE_BLOC ? taille - offset : TAILLE_BLOC;
+        memset(bloc, 'a' + (offset / TAILLE_BLOC) % 26, morceau);
+        if (ecrire_fichier(p->s, inode_id, bloc, morceau, offset) != morceau) {
+            return -1;
+        }
+    }
+    return inode_id;
+}
+
+/**
+ * Mesure la création, la recherche et la suppression de fichiers vides
+ * @param iterations Le facteur de répétition
+ */
+static void mesurer_metadonnees(int iterations) {
+    Partition p;
+    if (ouvrir_jetable(&p) == -1) {
+        return;
+    }
+    Mesure* creation = nouvelle_mesure("creer_fichier");
+    Mesure* recherche = nouvelle_mesure("trouver_inode_par_nom");
+    Mesure* suppression = nouvelle_mesure("supprimer_fichier");
+    char nom[32];
+
+    for (int tour = 0; tour < 200 * iterations; tour++) {
+        for (int i = 0; i < FICHIERS_PAR_TOUR; i++) {
+            snprintf(nom, sizeof(nom), "fichier_%d", i);
+            Releve debut = relever(p.fs);
+            int resultat = creer_fichier(p.s, nom, TYPE_FICHIER);
+            enregistrer(creation, p.fs, debut, 1, resultat);
+        }
+        for (int repetition = 0; repetition < 4; repetition++) {
+            for (int i = 0; i < FICHIERS_PAR_TOUR; i++) {
+                snprintf(nom, sizeof(nom), "fichier_%d", i);
+                Releve debut = relever(p.fs);
+                int resultat = trouver_inode_par_nom(p.fs, p.s->inode_courant, nom);
+                enregistrer(recherche, p.fs, debut, 1, resultat);
+            }
+        }
+        for (int i = 0; i < FICHIERS_PAR_TOUR; i++) {
+            snprintf(nom, sizeof(nom), "fichier_%d", i);
+            Releve debut = relever(p.fs);
+            int resultat = supprimer_fichier(p.s, nom);
+            enregistrer(suppression, p.fs, debut, 1, resultat);
+        }
+    }
+
+    fermer_jetable(&p);
+}
+
+/**
+ * Mesure l'écriture séquentielle puis la lecture d'un gros fichier, par
+ * blocs ; l'écriture comprend le vidage des données en attente
+ * @param iterations Le facteur de répétition
+ */
+static void mesurer_lecture_ecriture(int iterations) {
+    Partition p;
+    if (ouvrir_jetable(&p) == -1) {
+        return;
+    }
+    Mesure* ecriture = nouvelle_mesure("ecrire_fichier");
+    Mesure* lecture = nouvelle_mesure("lire_fichier");
+    char bloc[TAILLE_BLOC];
+    memset(bloc, 'x', sizeof(bloc));
+
+    for (int tour = 0; tour < 5 * iterations; tour++) {
+        int inode_id = creer_fichier(p.s, "gros", TYPE_FICHIER);
+
+        for (int offset = 0; offset < TAILLE_GROS_FICHIER; offset += TAILLE_BLOC) {
+            Releve debut = relever(p.fs);
+            int resultat = ecrire_fichier(p.s, inode_id, bloc, TAILLE_BLOC, offset);
+            enregistrer(ecriture, p.fs, debut, 1, resultat);
+        }
+        Releve debut = relever(p.fs);
+        int resultat = synchroniser_tampons(p.fs);
+        enregistrer(ecriture, p.fs, debut, 0, resultat);
+        ecriture->octets += TAILLE_GROS_FICHIER;
+
+        for (int offset = 0; offset < TAILLE_GROS_FICHIER; offset += TAILLE_BLOC) {
+            debut = relever(p.fs);
+            resultat = lire_fichier(p.s, inode_id, bloc, TAILLE_BLOC, offset);
+            enregistrer(lecture, p.fs, debut, 1, resultat);
+        }
+        lecture->octets += TAILLE_GROS_FICHIER;
+
+        supprimer_fichier(p.s, "gros");
+    }
+
+    fermer_jetable(&p);
+}
+
+/**
+ * Mesure la copie d'un fichier ; la copie comprend le vidage des données
+ * en attente
+ * @param iterations Le facteur de répétition
+ */
+static void mesurer_copie(int iterations) {
+    Partition p;
+    if (ouvrir_jetable(&p) == -1) {
+        return;
+    }
+    Mesure* copie = nouvelle_mesure("copier_fichier");
+    creer_rempli(&p, "source", TAILLE_COPIE);
+    synchroniser_tampons(p.fs);
+
+    for (int tour = 0; tour < 50 * iterations; tour++) {
+        Releve debut = relever(p.fs);
+        int resultat = copier_fichier(p.s, "source", "copie");
+        enregistrer(copie, p.fs, debut, 1, resultat);
+        debut = relever(p.fs);
+        resultat = synchroniser_tampons(p.fs);
+        enregistrer(copie, p.fs, debut, 0, resultat);
+        copie->octets += TAILLE_COPIE;
+
+        supprimer_fichier(p.s, "copie");
+    }
+
+    fermer_jetable(&p);
+}
+
+/**
+ * Fragmente la partition : des fichiers sont supprimés un sur deux puis
+ * de plus gros fichiers occupent les trous
+ * @param p La partition
+ * @param tour Le numéro du tour (pour des noms distincts)
+ */
+static void fragmenter(Partition* p, int tour) {
+    char nom[32];
+    for (int i = 0; i < 8; i++) {
+        snprintf(nom, sizeof(nom), "petit_%d_%d", tour, i);
+        creer_rempli(p, nom, 6 * TAILLE_BLOC);
+        synchroniser_tampons(p->fs);
+    }
+    for (int i = 0; i < 8; i += 2) {
+        snprintf(nom, sizeof(nom), "petit_%d_%d", tour, i);
+        supprimer_fichier(p->s, nom);
+    }
+    for (int i = 0; i < 3; i++) {
+        snprintf(nom, sizeof(nom), "grand_%d_%d", tour, i);
+        creer_rempli(p, nom, 14 * TAILLE_BLOC);
+        synchroniser_tampons(p->fs);
+    }
+}
+
+/**
+ * Mesure la défragmentation d'une partition fragmentée
+ * @param iterations Le facteur de répétition
+ */
+static void mesurer_defragmentation(int iterations) {
+    Mesure* defragmentation = nouvelle_mesure("defragmenter");
+
+    for (int tour = 0; tour < 5 * iterations; tour++) {
+        Partition p;
+        if (ouvrir_jetable(&p) == -1) {
+            return;
+        }
+        fragmenter(&p, tour);
+
+        Releve debut = relever(p.fs);
+        int resultat = defragmenter(p.fs);
+        enregistrer(defragmentation, p.fs, debut, 1, resultat);
+
+        fermer_jetable(&p);
+    }
+}
+
+/**
+ * Mesure la sauvegarde de l'état complet de la partition dans un fichier
+ * @param iterations Le facteur de répétition
+ */
+static void mesurer_sauvegarde(int iterations) {
+    Partition p;
+    if (ouvrir_jetable(&p) == -1) {
+        return;
+    }
+    Mesure* sauvegarde = nouvelle_mesure("sauvegarder_etat");
+    fragmenter(&p, 0);
+
+    char chemin[MAX_CHEMIN + 64];
+    snprintf(chemin, sizeof(chemin), "%s.sauvegarde", p.chemin);
+    for (int tour = 0; tour < 5 * iterations; tour++) {
+        int erreurs = nb_erreurs();
+        Releve debut = relever(p.fs);
+        sauvegarder_etat(p.fs, chemin);
+        enregistrer(sauvegarde, p.fs, debut, 1, nb_erreurs() == erreurs ? 0 : -1);
+
+        struct stat infos;
+        if (stat(chemin, &infos) == 0) {
+            sauvegarde->octets += infos.st_size;
+        }
+    }
+    unlink(chemin);
+
+    fermer_jetable(&p);
+}
+
+/**
+ * Compare deux latences (pour qsort)
+ */
+static int comparer_latences(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Calcule un percentile des latences d'une mesure (triées)
+ * @param m La mesure
+ * @param rang Le percentile voulu (entre 0 et 1)
+ * @return La latence en microsecondes
+ */
+static double percentile(const Mesure* m, double rang) {
+    if (m->nb_operations == 0) {
+        return 0;
+    }
+    return m->latences[(int)((m->nb_operations - 1) * rang)];
+}
+
+/**
+ * Débit d'une mesure en opérations par seconde
+ */
+static double ops_par_seconde(const Mesure* m) {
+    return m->duree > 0 ? m->nb_operations / m->duree : 0;
+}
+
+/**
+ * Accès au fichier de partition par opération d'une mesure
+ */
+static double acces_par_operation(const Mesure* m) {
+    return m->nb_operations > 0 ? (double)(m->lectures + m->ecritures) / m->nb_operations : 0;
+}
+
+/**
+ * Écrit les résultats au format JSON, une mesure par ligne
+ * @param f Le flux de destination
+ * @param iterations Le facteur de répétition utilisé
+ */
+static void ecrire_json(FILE* f, int iterations) {
+    fprintf(f, "{\n  \"iterations\": %d,\n  \"resultats\": [\n", iterations);
+    for (int i = 0; i < nb_mesures; i++) {
+        const Mesure* m = &mesures[i];
+        fprintf(f, "    {\"nom\": \"%s\", \"operations\": %d, \"ops_par_seconde\": %.1f, "
+                   "\"mo_par_seconde\": %.2f, \"p50_us\": %.2f, \"p99_us\": %.2f, "
+                   "\"lectures\": %lu, \"ecritures\": %lu, \"octets_lus\": %lu, "
+                   "\"octets_ecrits\": %lu, \"acces_par_operation\": %.3f, \"erreurs\": %d}%s\n",
+                m->nom, m->nb_operations, ops_par_seconde(m),
+                m->duree > 0 ? m->octets / m->duree / (1024 * 1024) : 0,
+                percentile(m, 0.50), percentile(m, 0.99),
+                m->lectures, m->ecritures, m->octets_lus, m->octets_ecrits,
+                acces_par_operation(m), m->erreurs, i + 1 < nb_mesures ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+}
+
+/**
+ * Lit un champ numérique d'une ligne de résultat JSON
+ * @param ligne La ligne
+ * @param champ Le nom du champ
+ * @param valeur Reçoit la valeur
+ * @return 0 si le champ est présent, -1 sinon
+ */
+static int lire_champ(const char* ligne, const char* champ, double* valeur) {
+    char motif[64];
+    snprintf(motif, sizeof(motif), "\"%s\": ", champ);
+    const char* position = strstr(ligne, motif);
+    if (position == NULL) {
+        return -1;
+    }
+    return sscanf(position + strlen(motif), "%lf", valeur) == 1 ? 0 : -1;
+}
+
+/**
+ * Compare les résultats à ceux d'un passage de référence (fichier JSON
+ * produit par ce programme). Une mesure régresse si son débit baisse, ou
+ * si ses accès au fichier de partition par opération augmentent, de plus
+ * du seuil.
+ * @param chemin Le fichier de référence
+ * @param seuil La variation tolérée, en pourcentage
+ * @return Le nombre de régressions, ou -1 si la référence est illisible
+ */
+static int comparer_reference(const char* chemin, double seuil) {
+    FILE* f = fopen(chemin, "r");
+    if (!f) {
+        perror(chemin);
+        return -1;
+    }
+
+    int nb_regressions = 0;
+    char ligne[1024];
+    while (fgets(ligne, sizeof(ligne), f)) {
+        char nom[32];
+        const char* position = strstr(ligne, "\"nom\": \"");
+        if (position == NULL || sscanf(position + 8, "%31[^\"]", nom) != 1) {
+            continue;
+        }
+        double debit_reference, acces_reference;
+        if (lire_champ(ligne, "ops_par_seconde", &debit_reference) == -1
+                || lire_champ(ligne, "acces_par_operation", &acces_reference) == -1) {
+            continue;
+        }
+
+        const Mesure* m = NULL;
+        for (int i = 0; i < nb_mesures; i++) {
+            if (strcmp(mesures[i].nom, nom) == 0) {
+                m = &mesures[i];
+            }
+        }
+        if (m == NULL) {
+            fprintf(stderr, "%-24s absente de ce passage\n", nom);
+            continue;
+        }
+
+        double debit = ops_par_seconde(m);
+        double acces = acces_par_operation(m);
+        int regression_debit = debit < debit_reference * (1 - seuil / 100);
+        int regression_acces = acces > acces_reference * (1 + seuil / 100) + 1e-9;
+        fprintf(stderr, "%-24s %12.1f -> %12.1f ops/s (%+6.1f%%)  %8.3f -> %8.3f accès/op%s\n",
+                nom, debit_reference, debit,
+                debit_reference > 0 ? (debit / debit_reference - 1) * 100 : 0,
+                acces_reference, acces,
+                regression_debit || regression_acces ? "  RÉGRESSION" : "");
+        nb_regressions += regression_debit || regression_acces;
+    }
+
+    fclose(f);
+    return nb_regressions;
+}
+
+/**
+ * Affiche l'usage du programme
+ * @param programme Le nom du programme
+ */
+static void afficher_usage(const char* programme) {
+    fprintf(stderr, "Usage: %s [options]\n", programme);
+    fprintf(stderr, "  -n, --iterations <n>   Facteur de répétition des mesures (défaut: 1)\n");
+    fprintf(stderr, "  -o, --sortie <fichier> Écrire le JSON dans un fichier (défaut: sortie standard)\n");
+    fprintf(stderr, "  -r, --reference <json> Comparer à un passage de référence\n");
+    fprintf(stderr, "  -s, --seuil <pct>      Régression tolérée en %% (défaut: %.0f)\n", SEUIL_DEFAUT);
+    fprintf(stderr, "  -t, --temporaire <rep> Répertoire des partitions jetables (défaut: /tmp)\n");
+}
+
+int main(int argc, char* argv[]) {
+    int iterations = 1;
+    const char* sortie = NULL;
+    const char* reference = NULL;
+    double seuil = SEUIL_DEFAUT;
+
+    static const struct option options[] = {
+        { "iterations", required_argument, NULL, 'n' },
+        { "sortie",     required_argument, NULL, 'o' },
+        { "reference",  required_argument, NULL, 'r' },
+        { "seuil",      required_argument, NULL, 's' },
+        { "temporaire", required_argument, NULL, 't' },
+        { "help",       no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    int option;
+    while ((option = getopt_long(argc, argv, "n:o:r:s:t:h", options, NULL)) != -1) {
+        switch (option) {
+            case 'n': iterations = atoi(optarg); break;
+            case 'o': sortie = optarg; break;
+            case 'r': reference = optarg; break;
+            case 's': seuil = atof(optarg); break;
+            case 't': snprintf(repertoire_temporaire, sizeof(repertoire_temporaire), "%s", optarg); break;
+            case 'h': afficher_usage(argv[0]); return 0;
+            default: afficher_usage(argv[0]); return 2;
+        }
+    }
+    if (optind < argc || iterations < 1 || seuil < 0) {
+        afficher_usage(argv[0]);
+        return 2;
+    }
+
+    // Les messages du système de fichiers ne doivent pas se mêler au JSON
+    FILE* silence = fopen("/dev/null", "w");
+    rediriger_sortie(silence);
+
+    mesurer_metadonnees(iterations);
+    mesurer_lecture_ecriture(iterations);
+    mesurer_copie(iterations);
+    mesurer_defragmentation(iterations);
+    mesurer_sauvegarde(iterations);
+
+    rediriger_sortie(NULL);
+    if (silence) fclose(silence);
+
+    int erreurs = 0;
+    for (int i = 0; i < nb_mesures; i++) {
+        qsort(mesures[i].latences, mesures[i].nb_operations, sizeof(double), comparer_latences);
+        erreurs += mesures[i].erreurs;
+    }
+
+    FILE* f = sortie ? fopen(sortie, "w") : stdout;
+    if (!f) {
+        perror(sortie);
+        return 2;
+    }
+    ecrire_json(f, iterations);
+    if (f != stdout) fclose(f);
+
+    if (erreurs > 0) {
+        fprintf(stderr, "Attention : %d opérations ont échoué pendant les mesures\n", erreurs);
+    }
+
+    int resultat = 0;
+    if (reference) {
+        int nb_regressions = comparer_reference(reference, seuil);
+        if (nb_regressions != 0) {
+            fprintf(stderr, nb_regressions > 0 ? "%d régression(s) au-delà de %.0f%%\n" : "Référence illisible\n",
+                    nb_regressions, seuil);
+            resultat = 1;
+        }
+    }
+
+    for (int i = 0; i < nb_mesures; i++) {
+        free(mesures[i].latences);
+    }
+    return resultat;
+}
@@ -0,0 +1,836 @@
+#include <getopt.h>
+
+#include "file_system.h"
+
+/**
+ * Pourcentage d'implication :
+ * GOBALOUKICHENIN Bala : 33%
+ * DEHOUCHE Lisa : 33%
+ * GABITA William : 33%
+ *
+ * Générateur de charge du système de fichiers
+ *
+ * Enchaîne des opérations tirées au sort (graine fixée, donc rejouables)
+ * selon un mélange : petits fichiers créés et supprimés, gros fichiers
+ * séquentiels, journaux en ajout, arborescences profondes, copies et
+ * renommages. Le débit et la fragmentation sont relevés à intervalles
+ * réguliers, au format JSON (un objet par ligne). Le générateur peut
+ * aussi vieillir une partition jusqu'à un remplissage et une
+ * fragmentation donnés, pour mesurer ensuite defrag ou l'allocateur.
+ */
+
+#define MAX_REPERTOIRES 96                      // Répertoires suivis par le générateur
+#define MAX_FICHIERS NB_INODES                  // Fichiers suivis par le générateur
+#define PLACES_PAR_REPERTOIRE (MAX_ENTREES_DIR - 2)   // Entrées hors . et ..
+#define PROFONDEUR_MAX 8                        // Profondeur maximale des arborescences
+#define MARGE_INODES 8                          // Inodes laissés libres
+#define TAILLE_MORCEAU (64 * 1024)              // Taille des lectures et écritures
+#define TAILLE_MAX_JOURNAL (1024 * 1024)        // Un journal plus gros est remplacé
+#define NB_JOURNAUX 4                           // Journaux alimentés en parallèle
+#define REMPLISSAGE_DEFAUT 80                   // Remplissage visé par défaut (en %)
+
+/**
+ * @brief Types d'opérations tirées au sort
+ */
+typedef enum {
+    OP_CREER,          // Petit ou moyen fichier
+    OP_ECRIRE_GROS,    // Gros fichier écrit séquentiellement
+    OP_AJOUTER,        // Ajout en fin de journal
+    OP_LIRE,           // Lecture complète d'un fichier
+    OP_SUPPRIMER,      // Suppression d'un fichier
+    OP_MKDIR,          // Création d'un sous-répertoire
+    OP_RMDIR,          // Suppression d'un répertoire vide
+    OP_PARCOURIR,      // Résolution d'un chemin depuis la racine
+    OP_COPIER,         // Copie d'un fichier
+    OP_RENOMMER,       // Renommage d'un fichier
+    NB_TYPES_OPERATIONS
+} TypeOperation;
+
+/**
+ * @brief Mélange d'opérations : poids relatif de chaque type
+ */
+typedef struct {
+    const char* nom;
+    const char* description;
+    int poids[NB_TYPES_OPERATIONS];
+} Melange;
+
+static const Melange melanges[] = {
+    { "petits", "création et suppression de petits fichiers",
+      { [OP_CREER] = 45, [OP_SUPPRIMER] = 40, [OP_LIRE] = 15 } },
+    { "sequentiel", "gros fichiers écrits puis relus séquentiellement",
+      { [OP_ECRIRE_GROS] = 40, [OP_LIRE] = 40, [OP_SUPPRIMER] = 20 } },
+    { "journaux", "ajouts en fin de journaux entre d'autres écritures",
+      { [OP_AJOUTER] = 85, [OP_CREER] = 10, [OP_LIRE] = 5 } },
+    { "arborescence", "répertoires profonds et résolution de chemins",
+      { [OP_MKDIR] = 25, [OP_CREER] = 35, [OP_PARCOURIR] = 25, [OP_SUPPRIMER] = 10, [OP_RMDIR] = 5 } },
+    { "copies", "copies et renommages",
+      { [OP_COPIER] = 35, [OP_RENOMMER] = 35, [OP_CREER] = 15, [OP_SUPPRIMER] = 15 } },
+    { "mixte", "tous les mélanges à la fois",
+      { [OP_CREER] = 20, [OP_ECRIRE_GROS] = 5, [OP_AJOUTER] = 20, [OP_LIRE] = 15, [OP_SUPPRIMER] = 15,
+        [OP_MKDIR] = 4, [OP_RMDIR] = 1, [OP_PARCOURIR] = 8, [OP_COPIER] = 6, [OP_RENOMMER] = 6 } },
+};
+
+#define NB_MELANGES ((int)(sizeof(melanges) / sizeof(melanges[0])))
+
+/**
+ * @brief Répertoire connu du générateur
+ */
+typedef struct {
+    int inode;
+    int parent;                    // Indice du parent (-1 pour la racine)
+    int profondeur;
+    int nb_entrees;                // Entrées hors . et ..
+    char nom[32];
+} Repertoire;
+
+/**
+ * @brief Fichier connu du générateur
+ */
+typedef struct {
+    int inode;
+    int repertoire;                // Indice du répertoire qui le contient
+    int taille;
+    int journal;                   // 1 si le fichier reçoit des ajouts
+    char nom[32];
+} Fichier;
+
+/**
+ * @brief État du générateur
+ */
+typedef struct {
+    SystemeFichiers* fs;
+    Session* s;
+    const Melange* melange;
+    uint64_t aleatoire;            // État du générateur pseudo-aléatoire
+    int compteur_noms;
+    int marge_blocs;               // Blocs laissés libres
+
+    Repertoire repertoires[MAX_REPERTOIRES];
+    int nb_repertoires;
+    Fichier fichiers[MAX_FICHIERS];
+    int nb_fichiers;
+
+    // Totaux et compteurs de l'intervalle en cours
+    long operations;
+    long echecs;
+    unsigned long octets;
+    long operations_intervalle;
+    long echecs_intervalle;
+    unsigned long octets_intervalle;
+    double debut_intervalle;
+} Charge;
+
+static char motif[TAILLE_MORCEAU];
+
+/**
+ * Tire un nombre pseudo-aléatoire (xorshift64*)
+ * @param c Le générateur
+ * @return Le nombre tiré
+ */
+static uint64_t tirer(Charge* c) {
+    c->aleatoire ^= c->aleatoire >> 12;
+    c->aleatoire ^= c->aleatoire << 25;
+    c->aleatoire ^= c->aleatoire >> 27;
+    return c->aleatoire * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * Tire un entier entre deux bornes incluses
+ */
+static int tirer_entre(Charge* c, int min, int max) {
+    return min + (int)(tirer(c) % (uint64_t)(max - min + 1));
+}
+
+/**
+ * Donne l'heure de l'horloge monotone en secondes
+ */
+static double maintenant(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/**
+ * Compte le résultat d'un appel à l'API
+ * @param c Le générateur
+ * @param resultat La valeur rendue (négative si erreur)
+ * @return resultat
+ */
+static int compter(Charge* c, int resultat) {
+    if (resultat < 0) {
+        c->echecs++;
+        c->echecs_intervalle++;
+    }
+    return resultat;
+}
+
+/**
+ * Blocs encore disponibles, y compris ceux promis aux tampons d'écriture
+ */
+static int blocs_disponibles(Charge* c) {
+    return c->fs->superbloc.nb_blocs_libres - c->fs->nb_blocs_reserves;
+}
+
+/**
+ * Place la session dans un répertoire connu
+ */
+static void placer(Charge* c, int repertoire) {
+    c->s->inode_courant = c->repertoires[repertoire].inode;
+}
+
+/**
+ * Donne un nom encore jamais utilisé
+ * @param c Le générateur
+ * @param prefixe Le préfixe du nom
+ * @param nom Reçoit le nom (32 octets)
+ */
+static void nouveau_nom(Charge* c, const char* prefixe, char* nom) {
+    snprintf(nom, 32, "%s%06d", prefixe, c->compteur_noms++);
+}
+
+/**
+ * Écrit des données dans un fichier par morceaux
+ * @return Le nombre d'octets écrits, ou -1 si erreur
+ */
+static int ecrire_donnees(Charge* c, int inode_id, int taille, int offset) {
+    int ecrits = 0;
+    while (ecrits < taille) {
+        int morceau = taille - ecrits < TAILLE_MORCEAU ? taille - ecrits : TAILLE_MORCEAU;
+        int resultat = ecrire_fichier(c->s, inode_id, motif, morceau, offset + ecrits);
+        if (resultat <= 0) {
+            return ecrits > 0 ? ecrits : -1;
+        }
+        ecrits += resultat;
+    }
+    c->octets += ecrits;
+    c->octets_intervalle += ecrits;
+    return ecrits;
+}
+
+/**
+ * Retire un fichier du modèle
+ */
+static void oublier_fichier(Charge* c, int indice) {
+    c->repertoires[c->fichiers[indice].repertoire].nb_entrees--;
+    c->fichiers[indice] = c->fichiers[--c->nb_fichiers];
+}
+
+/**
+ * Supprime un fichier tiré au sort
+ * @return 0 si succès, -1 si erreur ou aucun fichier
+ */
+static int supprimer_au_hasard(Charge* c) {
+    if (c->nb_fichiers == 0) {
+        return -1;
+    }
+    int indice = tirer_entre(c, 0, c->nb_fichiers - 1);
+    placer(c, c->fichiers[indice].repertoire);
+    if (compter(c, supprimer_fichier(c->s, c->fichiers[indice].nom)) == -1) {
+        return -1;
+    }
+    oublier_fichier(c, indice);
+    return 0;
+}
+
+/**
+ * Libère de la place (blocs et inodes) en supprimant des fichiers
+ * @param c Le générateur
+ * @param nb_blocs Les blocs nécessaires à l'opération qui suit
+ * @return 0 si la place est disponible, -1 sinon
+ */
+static int faire_place(Charge* c, int nb_blocs) {
+    while (blocs_disponibles(c) < nb_blocs + c->marge_blocs
+            || c->nb_fichiers + c->nb_repertoires > NB_INODES - MARGE_INODES) {
+        if (supprimer_au_hasard(c) == -1) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Crée un sous-répertoire dans un répertoire tiré au sort
+ * @return L'indice du nouveau répertoire, ou -1 si erreur
+ */
+static int creer_repertoire(Charge* c) {
+    if (c->nb_repertoires == MAX_REPERTOIRES || faire_place(c, 1) == -1) {
+        return -1;
+    }
+    // Un parent qui a de la place et n'est pas trop profond
+    int parent = -1;
+    for (int essai = 0; essai < 16 && parent == -1; essai++) {
+        int r = tirer_entre(c, 0, c->nb_repertoires - 1);
+        if (c->repertoires[r].nb_entrees < PLACES_PAR_REPERTOIRE
+                && c->repertoires[r].profondeur < PROFONDEUR_MAX) {
+            parent = r;
+        }
+    }
+    if (parent == -1) {
+        return -1;
+    }
+
+    Repertoire* r = &c->repertoires[c->nb_repertoires];
+    nouveau_nom(c, "d", r->nom);
+    placer(c, parent);
+    r->inode = compter(c, creer_fichier(c->s, r->nom, TYPE_REPERTOIRE));
+    if (r->inode == -1) {
+        return -1;
+    }
+    r->parent = parent;
+    r->profondeur = c->repertoires[parent].profondeur + 1;
+    r->nb_entrees = 0;
+    c->repertoires[parent].nb_entrees++;
+    return c->nb_repertoires++;
+}
+
+/**
+ * Choisit un répertoire où ajouter une entrée, en créant un nouveau
+ * répertoire si tous sont pleins
+ * @return L'indice du répertoire, ou -1 si erreur
+ */
+static int repertoire_avec_place(Charge* c) {
+    // La dernière place d'un répertoire est gardée pour un sous-répertoire
+    for (int essai = 0; essai < 8; essai++) {
+        int r = tirer_entre(c, 0, c->nb_repertoires - 1);
+        if (c->repertoires[r].nb_entrees < PLACES_PAR_REPERTOIRE - 1) {
+            return r;
+        }
+    }
+    for (int r = 0; r < c->nb_repertoires; r++) {
+        if (c->repertoires[r].nb_entrees < PLACES_PAR_REPERTOIRE - 1) {
+            return r;
+        }
+    }
+    return creer_repertoire(c);
+}
+
+/**
+ * Crée un fichier d'une taille donnée dans un répertoire tiré au sort
+ * @param c Le générateur
+ * @param taille La taille du contenu
+ * @param journal 1 si le fichier est un journal
+ * @return L'indice du fichier, ou -1 si erreur
+ */
+static int creer_fichier_rempli(Charge* c, int taille, int journal) {
+    if (faire_place(c, taille / TAILLE_BLOC + 2) == -1) {
+        return -1;
+    }
+    int repertoire = repertoire_avec_place(c);
+    if (repertoire == -1 || c->nb_fichiers == MAX_FICHIERS) {
+        return -1;
+    }
+
+    Fichier* f = &c->fichiers[c->nb_fichiers];
+    nouveau_nom(c, journal ? "j" : "f", f->nom);
+    placer(c, repertoire);
+    f->inode = compter(c, creer_fichier(c->s, f->nom, TYPE_FICHIER));
+    if (f->inode == -1) {
+        return -1;
+    }
+    f->repertoire = repertoire;
+    f->journal = journal;
+    f->taille = 0;
+    c->repertoires[repertoire].nb_entrees++;
+    c->nb_fichiers++;
+
+    if (taille > 0) {
+        int ecrits = compter(c, ecrire_donnees(c, f->inode, taille, 0));
+        f->taille = ecrits > 0 ? ecrits : 0;
+    }
+    return c->nb_fichiers - 1;
+}
+
+/**
+ * Ajoute un enregistrement à la fin d'un journal ; un journal trop gros
+ * est supprimé et recommencé (rotation)
+ */
+static void ajouter_journal(Charge* c) {
+    int journaux[NB_JOURNAUX];
+    int nb_journaux = 0;
+    for (int i = 0; i < c->nb_fichiers && nb_journaux < NB_JOURNAUX; i++) {
+        if (c->fichiers[i].journal) {
+            journaux[nb_journaux++] = i;
+        }
+    }
+    if (nb_journaux < NB_JOURNAUX) {
+        creer_fichier_rempli(c, 0, 1);
+        return;
+    }
+
+    int indice = journaux[tirer_entre(c, 0, nb_journaux - 1)];
+    Fichier* f = &c->fichiers[indice];
+    if (f->taille >= TAILLE_MAX_JOURNAL) {
+        placer(c, f->repertoire);
+        if (compter(c, supprimer_fichier(c->s, f->nom)) == 0) {
+            oublier_fichier(c, indice);
+        }
+        return;
+    }
+
+    int taille = tirer_entre(c, 256, 4096);
+    int inode_id = f->inode;
+    if (faire_place(c, 2) == -1) {
+        return;
+    }
+    // faire_place a pu déplacer le journal dans le tableau, ou le supprimer
+    for (indice = 0; indice < c->nb_fichiers && c->fichiers[indice].inode != inode_id; indice++);
+    if (indice == c->nb_fichiers) {
+        return;
+    }
+    f = &c->fichiers[indice];
+    int ecrits = compter(c, ecrire_donnees(c, f->inode, taille, f->taille));
+    if (ecrits > 0) {
+        f->taille += ecrits;
+    }
+}
+
+/**
+ * Lit entièrement un fichier tiré au sort
+ */
+static void lire_au_hasard(Charge* c) {
+    if (c->nb_fichiers == 0) {
+        return;
+    }
+    static char tampon[TAILLE_MORCEAU];
+    Fichier* f = &c->fichiers[tirer_entre(c, 0, c->nb_fichiers - 1)];
+    for (int offset = 0; offset < f->taille; offset += TAILLE_MORCEAU) {
+        int lus = compter(c, lire_fichier(c->s, f->inode, tampon, TAILLE_MORCEAU, offset));
+        if (lus <= 0) {
+            break;
+        }
+        c->octets += lus;
+        c->octets_intervalle += lus;
+    }
+}
+
+/**
+ * Supprime un répertoire vide qui n'est pas la racine
+ */
+static void supprimer_repertoire(Charge* c) {
+    for (int essai = 0; essai < 8 && c->nb_repertoires > 1; essai++) {
+        int r = tirer_entre(c, 1, c->nb_repertoires - 1);
+        if (c->repertoires[r].nb_entrees > 0) {
+            continue;
+        }
+        placer(c, c->repertoires[r].parent);
+        if (compter(c, supprimer_fichier(c->s, c->repertoires[r].nom)) == -1) {
+            return;
+        }
+        c->repertoires[c->repertoires[r].parent].nb_entrees--;
+
+        // Le dernier répertoire prend la place du supprimé
+        int dernier = --c->nb_repertoires;
+        if (r != dernier) {
+            c->repertoires[r] = c->repertoires[dernier];
+            for (int i = 0; i < c->nb_repertoires; i++) {
+                if (c->repertoires[i].parent == dernier) c->repertoires[i].parent = r;
+            }
+            for (int i = 0; i < c->nb_fichiers; i++) {
+                if (c->fichiers[i].repertoire == dernier) c->fichiers[i].repertoire = r;
+            }
+        }
+        return;
+    }
+}
+
+/**
+ * Résout depuis la racine le chemin d'un répertoire tiré au sort, un
+ * composant à la fois
+ */
+static void parcourir(Charge* c) {
+    int chemin[PROFONDEUR_MAX + 1];
+    int profondeur = 0;
+    for (int r = tirer_entre(c, 0, c->nb_repertoires - 1); r > 0; r = c->repertoires[r].parent) {
+        chemin[profondeur++] = r;
+    }
+    int inode = c->repertoires[0].inode;
+    while (profondeur > 0 && inode != -1) {
+        inode = compter(c, trouver_inode_par_nom(c->fs, inode, c->repertoires[chemin[--profondeur]].nom));
+    }
+}
+
+/**
+ * Copie un fichier tiré au sort dans le même répertoire
+ */
+static void copier_au_hasard(Charge* c) {
+    if (c->nb_fichiers == 0 || c->nb_fichiers == MAX_FICHIERS) {
+        return;
+    }
+    int source = tirer_entre(c, 0, c->nb_fichiers - 1);
+    int inode_source = c->fichiers[source].inode;
+    if (faire_place(c, c->fichiers[source].taille / TAILLE_BLOC + 2) == -1) {
+        return;
+    }
+    // faire_place a pu déplacer la source dans le tableau, ou la supprimer
+    for (source = 0; source < c->nb_fichiers && c->fichiers[source].inode != inode_source; source++);
+    if (source == c->nb_fichiers) {
+        return;
+    }
+    int repertoire = c->fichiers[source].repertoire;
+    if (c->repertoires[repertoire].nb_entrees >= PLACES_PAR_REPERTOIRE - 1) {
+        return;
+    }
+
+    Fichier* f = &c->fichiers[c->nb_fichiers];
+    nouveau_nom(c, "c", f->nom);
+    placer(c, repertoire);
+    if (compter(c, copier_fichier(c->s, c->fichiers[source].nom, f->nom)) == -1) {
+        return;
+    }
+    f->inode = trouver_inode_par_nom(c->fs, c->repertoires[repertoire].inode, f->nom);
+    f->repertoire = repertoire;
+    f->taille = c->fichiers[source].taille;
+    f->journal = 0;
+    c->repertoires[repertoire].nb_entrees++;
+    c->nb_fichiers++;
+    c->octets += 2UL * f->taille;
+    c->octets_intervalle += 2UL * f->taille;
+}
+
+/**
+ * Renomme un fichier tiré au sort
+ */
+static void renommer_au_hasard(Charge* c) {
+    if (c->nb_fichiers == 0) {
+        return;
+    }
+    Fichier* f = &c->fichiers[tirer_entre(c, 0, c->nb_fichiers - 1)];
+    // Le nouveau nom est ajouté avant que l'ancien soit retiré
+    if (c->repertoires[f->repertoire].nb_entrees >= PLACES_PAR_REPERTOIRE) {
+        return;
+    }
+    char nom[32];
+    nouveau_nom(c, f->journal ? "j" : "r", nom);
+    placer(c, f->repertoire);
+    if (compter(c, deplacer_fichier(c->s, f->nom, nom)) == 0) {
+        memcpy(f->nom, nom, sizeof(nom));
+    }
+}
+
+/**
+ * Exécute une opération
+ * @param c Le générateur
+ * @param type Le type d'opération
+ */
+static void executer_operation(Charge* c, TypeOperation type) {
+    switch (type) {
+        case OP_CREER:
+            // Surtout de petits fichiers, parfois des moyens
+            creer_fichier_rempli(c, tirer_entre(c, 0, 4) ? tirer_entre(c, 64, 16 * 1024)
+                                                        : tirer_entre(c, 16 * 1024, 256 * 1024), 0);
+            break;
+        case OP_ECRIRE_GROS: creer_fichier_rempli(c, tirer_entre(c, 256 * 1024, 2 * 1024 * 1024), 0); break;
+        case OP_AJOUTER: ajouter_journal(c); break;
+        case OP_LIRE: lire_au_hasard(c); break;
+        case OP_SUPPRIMER: supprimer_au_hasard(c); break;
+        case OP_MKDIR: creer_repertoire(c); break;
+        case OP_RMDIR: supprimer_repertoire(c); break;
+        case OP_PARCOURIR: parcourir(c); break;
+        case OP_COPIER: copier_au_hasard(c); break;
+        case OP_RENOMMER: renommer_au_hasard(c); break;
+        default: break;
+    }
+    c->operations++;
+    c->operations_intervalle++;
+}
+
+/**
+ * Tire un type d'opération selon les poids du mélange
+ */
+static TypeOperation tirer_operation(Charge* c) {
+    int total = 0;
+    for (int i = 0; i < NB_TYPES_OPERATIONS; i++) {
+        total += c->melange->poids[i];
+    }
+    int tirage = tirer_entre(c, 0, total - 1);
+    for (int i = 0; i < NB_TYPES_OPERATIONS; i++) {
+        if (tirage < c->melange->poids[i]) {
+            return (TypeOperation)i;
+        }
+        tirage -= c->melange->poids[i];
+    }
+    return OP_LIRE;
+}
+
+/**
+ * Reconstitue le modèle à partir de l'arborescence d'une partition
+ * existante
+ * @param c Le générateur
+ * @param repertoire L'indice du répertoire à explorer
+ */
+static void explorer(Charge* c, int repertoire) {
+    Inode* inode = epingler_inode(c->fs, c->repertoires[repertoire].inode);
+    if (inode == NULL) {
+        return;
+    }
+    EntreeRepertoire entrees[MAX_ENTREES_DIR];
+    int lu = lire_entrees(c->fs, inode->blocs_directs[0], entrees);
+    desepingler_inode(c->fs, c->repertoires[repertoire].inode, 0);
+    if (lu == -1) {
+        return;
+    }
+
+    for (int i = 0; i < MAX_ENTREES_DIR; i++) {
+        if (entrees[i].nom[0] == '\0' || strcmp(entrees[i].nom, ".") == 0 || strcmp(entrees[i].nom, "..") == 0) {
+            continue;
+        }
+        c->repertoires[repertoire].nb_entrees++;
+        // Seuls les noms courts sont repris dans le modèle
+        if (strlen(entrees[i].nom) >= 32) {
+            continue;
+        }
+
+        Inode* fils = epingler_inode(c->fs, entrees[i].inode);
+        if (fils == NULL) {
+            continue;
+        }
+        int type = fils->type;
+        int taille = fils->taille;
+        desepingler_inode(c->fs, entrees[i].inode, 0);
+
+        if (type == TYPE_REPERTOIRE && c->nb_repertoires < MAX_REPERTOIRES
+                && c->repertoires[repertoire].profondeur < PROFONDEUR_MAX) {
+            Repertoire* r = &c->repertoires[c->nb_repertoires];
+            r->inode = entrees[i].inode;
+            r->parent = repertoire;
+            r->profondeur = c->repertoires[repertoire].profondeur + 1;
+            r->nb_entrees = 0;
+            strcpy(r->nom, entrees[i].nom);
+            explorer(c, c->nb_repertoires++);
+        } else if (type == TYPE_FICHIER && c->nb_fichiers < MAX_FICHIERS) {
+            Fichier* f = &c->fichiers[c->nb_fichiers++];
+            f->inode = entrees[i].inode;
+            f->repertoire = repertoire;
+            f->taille = taille;
+            f->journal = entrees[i].nom[0] == 'j';
+            strcpy(f->nom, entrees[i].nom);
+        }
+    }
+}
+
+/**
+ * Écrit un relevé du débit et de la fragmentation, puis commence un
+ * nouvel intervalle
+ * @param c Le générateur
+ * @param f Le flux de destination
+ * @param debut L'heure du début de la charge
+ * @param etat Reçoit la mesure de fragmentation
+ */
+static void relever(Charge* c, FILE* f, double debut, EtatFragmentation* etat) {
+    double instant = maintenant();
+    double duree = instant - c->debut_intervalle;
+    mesurer_fragmentation(c->fs, etat);
+
+    fprintf(f, "{\"operations\": %ld, \"temps_s\": %.3f, \"ops_par_seconde\": %.1f, \"mo_par_seconde\": %.2f, "
+               "\"remplissage_pct\": %.1f, \"fichiers\": %d, \"repertoires\": %d, "
+               "\"fichiers_fragmentes_pct\": %.1f, \"extensions_par_fichier\": %.2f, "
+               "\"zones_libres\": %d, \"plus_grande_zone_libre\": %d, \"echecs\": %ld}\n",
+            c->operations, instant - debut,
+            duree > 0 ? c->operations_intervalle / duree : 0,
+            duree > 0 ? c->octets_intervalle / duree / (1024 * 1024) : 0,
+            100.0 * (etat->nb_blocs_donnees - etat->nb_blocs_libres) / etat->nb_blocs_donnees,
+            c->nb_fichiers, c->nb_repertoires,
+            etat->nb_fichiers ? 100.0 * etat->nb_fichiers_fragmentes / etat->nb_fichiers : 0,
+            etat->nb_fichiers ? (double)etat->nb_extensions / etat->nb_fichiers : 0,
+            etat->nb_zones_libres, etat->plus_grande_zone_libre, c->echecs_intervalle);
+    fflush(f);
+
+    c->operations_intervalle = 0;
+    c->echecs_intervalle = 0;
+    c->octets_intervalle = 0;
+    c->debut_intervalle = maintenant();
+}
+
+/**
+ * Affiche l'usage du programme
+ * @param programme Le nom du programme
+ */
+static void afficher_usage(const char* programme) {
+    fprintf(stderr, "Usage: %s [options]\n", programme);
+    fprintf(stderr, "  -m, --melange <nom>         Mélange d'opérations (défaut: mixte, -l pour la liste)\n");
+    fprintf(stderr, "  -g, --graine <n>            Graine du tirage (défaut: 1)\n");
+    fprintf(stderr, "  -n, --operations <n>        Nombre d'opérations (défaut: 5000)\n");
+    fprintf(stderr, "  -i, --intervalle <n>        Opérations entre deux relevés (défaut: 500)\n");
+    fprintf(stderr, "  -v, --vidage <n>            Opérations entre deux sauvegardes de la partition (défaut: 16)\n");
+    fprintf(stderr, "  -p, --partition <fichier>   Partition à utiliser et conserver (défaut: jetable)\n");
+    fprintf(stderr, "  -o, --sortie <fichier>      Écrire les relevés dans un fichier\n");
+    fprintf(stderr, "  -r, --remplissage <pct>     Vieillir la partition jusqu'à ce remplissage (défaut: %d)...\n", REMPLISSAGE_DEFAUT);
+    fprintf(stderr, "  -f, --fragmentation <pct>   ... et cette part de fichiers fragmentés\n");
+    fprintf(stderr, "  -l, --liste                 Lister les mélanges\n");
+}
+
+int main(int argc, char* argv[]) {
+    const char* nom_melange = "mixte";
+    unsigned long graine = 1;
+    long nb_operations = 5000;
+    long intervalle = 500;
+    long vidage = 16;
+    const char* chemin_partition = NULL;
+    const char* sortie = NULL;
+    double cible_remplissage = -1;
+    double cible_fragmentation = -1;
+
+    static const struct option options[] = {
+        { "melange",       required_argument, NULL, 'm' },
+        { "graine",        required_argument, NULL, 'g' },
+        { "operations",    required_argument, NULL, 'n' },
+        { "intervalle",    required_argument, NULL, 'i' },
+        { "vidage",        required_argument, NULL, 'v' },
+        { "partition",     required_argument, NULL, 'p' },
+        { "sortie",        required_argument, NULL, 'o' },
+        { "remplissage",   required_argument, NULL, 'r' },
+        { "fragmentation", required_argument, NULL, 'f' },
+        { "liste",         no_argument,       NULL, 'l' },
+        { "help",          no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    int option;
+    while ((option = getopt_long(argc, argv, "m:g:n:i:v:p:o:r:f:lh", options, NULL)) != -1) {
+        switch (option) {
+            case 'm': nom_melange = optarg; break;
+            case 'g': graine = strtoul(optarg, NULL, 10); break;
+            case 'n': nb_operations = atol(optarg); break;
+            case 'i': intervalle = atol(optarg); break;
+            case 'v': vidage = atol(optarg); break;
+            case 'p': chemin_partition = optarg; break;
+            case 'o': sortie = optarg; break;
+            case 'r': cible_remplissage = atof(optarg); break;
+            case 'f': cible_fragmentation = atof(optarg); break;
+            case 'l':
+                for (int i = 0; i < NB_MELANGES; i++) {
+                    printf("%-14s %s\n", melanges[i].nom, melanges[i].description);
+                }
+                return 0;
+            case 'h': afficher_usage(argv[0]); return 0;
+            default: afficher_usage(argv[0]); return 2;
+        }
+    }
+    if (optind < argc || nb_operations < 1 || intervalle < 1 || vidage < 1
+            || cible_remplissage > 95 || cible_fragmentation > 100) {
+        afficher_usage(argv[0]);
+        return 2;
+    }
+    int vieillissement = cible_remplissage >= 0 || cible_fragmentation >= 0;
+    if (vieillissement && cible_remplissage < 0) {
+        cible_remplissage = REMPLISSAGE_DEFAUT;
+    }
+
+    static Charge charge;
+    Charge* c = &charge;
+    for (int i = 0; i < NB_MELANGES; i++) {
+        if (strcmp(melanges[i].nom, nom_melange) == 0) {
+            c->melange = &melanges[i];
+        }
+    }
+    if (c->melange == NULL) {
+        fprintf(stderr, "Mélange inconnu : %s\n", nom_melange);
+        return 2;
+    }
+    c->aleatoire = graine * 0x9E3779B97F4A7C15ULL + 1;
+    for (int i = 0; i < TAILLE_MORCEAU; i++) {
+        motif[i] = 'a' + tirer(c) % 26;
+    }
+
+    // Partition conservée (-p) ou jetable
+    char chemin[MAX_CHEMIN + 32];
+    if (chemin_partition) {
+        snprintf(chemin, sizeof(chemin), "%s", chemin_partition);
+    } else {
+        const char* temporaire = getenv("TMPDIR");
+        snprintf(chemin, sizeof(chemin), "%s/charge_fs_%d.bin", temporaire ? temporaire : "/tmp", (int)getpid());
+    }
+    FILE* silence = fopen("/dev/null", "w");
+    rediriger_sortie(silence);
+    c->fs = access(chemin, F_OK) == 0 ? charger_partition(chemin) : initialiser_partition(chemin);
+    c->s = c->fs ? ouvrir_session(c->fs) : NULL;
+    if (c->s == NULL) {
+        rediriger_sortie(NULL);
+        fprintf(stderr, "Impossible d'ouvrir la partition %s\n", chemin);
+        return 2;
+    }
+
+    c->repertoires[0].inode = ID_INODE_RACINE;
+    c->repertoires[0].parent = -1;
+    c->nb_repertoires = 1;
+    explorer(c, 0);
+    // Le vieillissement remplit la partition presque entièrement
+    c->marge_blocs = vieillissement ? 8 : NB_BLOCS / 10;
+
+    FILE* f = sortie ? fopen(sortie, "w") : stdout;
+    if (!f) {
+        perror(sortie);
+        return 2;
+    }
+
+    double debut = maintenant();
+    c->debut_intervalle = debut;
+    EtatFragmentation etat;
+    mesurer_fragmentation(c->fs, &etat);
+    int atteint = 0;
+
+    while (c->operations < nb_operations && !atteint) {
+        TypeOperation type = tirer_operation(c);
+
+        if (vieillissement) {
+            // Le vieillissement a sa propre recette, quel que soit le mélange
+            double remplissage = 100.0 * (etat.nb_blocs_donnees - blocs_disponibles(c)) / etat.nb_blocs_donnees;
+            if (remplissage < cible_remplissage) {
+                // Croissance, avec des suppressions qui laissent des trous
+                TypeOperation croissance[] = { OP_CREER, OP_CREER, OP_AJOUTER, OP_AJOUTER, OP_ECRIRE_GROS, OP_SUPPRIMER };
+                type = croissance[tirer_entre(c, 0, 5)];
+            } else if (remplissage > cible_remplissage + 2) {
+                type = OP_SUPPRIMER;
+            } else {
+                // Remplissage atteint : les fichiers remplacés et les
+                // journaux s'étendent dans des trous de plus en plus petits
+                TypeOperation remplacement[] = { OP_SUPPRIMER, OP_AJOUTER, OP_AJOUTER, OP_CREER, OP_ECRIRE_GROS };
+                type = remplacement[tirer_entre(c, 0, 4)];
+            }
+        }
+        executer_operation(c, type);
+
+        if (c->operations % vidage == 0) {
+            sauvegarder_partition(c->fs);
+        }
+        if (vieillissement && c->operations % 16 == 0) {
+            mesurer_fragmentation(c->fs, &etat);
+            double remplissage = 100.0 * (etat.nb_blocs_donnees - etat.nb_blocs_libres) / etat.nb_blocs_donnees;
+            double fragmentes = etat.nb_fichiers ? 100.0 * etat.nb_fichiers_fragmentes / etat.nb_fichiers : 0;
+            atteint = remplissage >= cible_remplissage && remplissage <= cible_remplissage + 5
+                && fragmentes >= cible_fragmentation;
+        }
+        if (c->operations % intervalle == 0 || atteint) {
+            sauvegarder_partition(c->fs);
+            relever(c, f, debut, &etat);
+        }
+    }
+    sauvegarder_partition(c->fs);
+    if (c->operations_intervalle > 0) {
+        relever(c, f, debut, &etat);
+    }
+
+    double duree = maintenant() - debut;
+    fprintf(f, "{\"resume\": true, \"melange\": \"%s\", \"graine\": %lu, \"operations\": %ld, \"temps_s\": %.3f, "
+               "\"ops_par_seconde\": %.1f, \"mo_par_seconde\": %.2f, \"echecs\": %ld%s}\n",
+            c->melange->nom, graine, c->operations, duree,
+            duree > 0 ? c->operations / duree : 0,
+            duree > 0 ? c->octets / duree / (1024 * 1024) : 0, c->echecs,
+            vieillissement ? (atteint ? ", \"cible_atteinte\": true" : ", \"cible_atteinte\": false") : "");
+    if (f != stdout) fclose(f);
+
+    fermer_session(c->s);
+    fermer_partition(c->fs);
+    rediriger_sortie(NULL);
+    if (silence) fclose(silence);
+    if (!chemin_partition) {
+        unlink(chemin);
+    }
+
+    if (vieillissement && !atteint) {
+        fprintf(stderr, "Cible non atteinte après %ld opérations\n", c->operations);
+        return 1;
+    }
+    return 0;
+}
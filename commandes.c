@@ -0,0 +1,898 @@
+#include "commandes.h"
+#include "trace.h"
+
+/**
+ * Pourcentage d'implication :
+ * GOBALOUKICHENIN Bala : 33%
+ * DEHOUCHE Lisa : 33%
+ * GABITA William : 33%
+ *
+ * Interpréteur des commandes, commun à l'interface en ligne de commande
+ * et au démon
+ */
+
+/**
+ * Affiche la liste des commandes disponibles
+ */
+void afficher_aide(void) {
+    FILE* sortie = flux_sortie();
+
+    fprintf(sortie, "================ COMMANDES DISPONIBLES ================\n\n");
+
+    // Navigation et affichage
+    fprintf(sortie, "NAVIGATION ET AFFICHAGE:\n");
+    fprintf(sortie, "  cd <rep>        - Changer de répertoire\n");
+    fprintf(sortie, "  ls              - Afficher le contenu du répertoire\n");
+    fprintf(sortie, "  tree [rep]      - Afficher l'arborescence d'un répertoire\n");
+    fprintf(sortie, "  du [rep]        - Taille et blocs occupés par un répertoire et ses sous-répertoires\n");
+    fprintf(sortie, "  find <motif>    - Chercher dans toute la partition les noms qui correspondent (*, ?, [...])\n\n");
+    fprintf(sortie, "  ls -i  <nom>         - Afficher le contenu d'un inode'\n\n");
+
+    // Gestion des fichiers et répertoires
+    fprintf(sortie, "CRÉATION ET SUPPRESSION:\n");
+    fprintf(sortie, "  mkdir <nom>     - Créer un répertoire\n");
+    fprintf(sortie, "  rm <nom>        - Supprimer un fichier ou répertoire\n");
+    fprintf(sortie, "  rm -r <rep>     - Supprimer un répertoire et tout son contenu\n");
+    fprintf(sortie, "  touch <nom>     - Créer un fichier vide\n\n");
+    fprintf(sortie, "  save <fichier>  - Sauvegarde de l'état actuel de la partition\n");
+    fprintf(sortie, "  load <fichier>  - Restauration d’une partition depuis un fichier de sauvegarde\n");
+    fprintf(sortie, "  snapshot <depot> [nom] - Instantané de la partition dans un dépôt dédupliqué\n");
+    fprintf(sortie, "  snapshots <depot>      - Lister les instantanés d'un dépôt\n");
+    fprintf(sortie, "  restore <depot> <nom>  - Restaurer un instantané (seuls les morceaux modifiés sont relus)\n");
+    fprintf(sortie, "  prune <depot> <n>      - Garder les n derniers instantanés et supprimer les morceaux orphelins\n");
+
+    // Manipulation et contenu
+    fprintf(sortie, "MANIPULATION DE CONTENU:\n");
+    fprintf(sortie, "  cat <nom>       - Afficher le contenu d'un fichier\n");
+    fprintf(sortie, "  cp <src> <dest> - Copier un fichier\n");
+    fprintf(sortie, "  cp -r <src> <dest> - Copier un répertoire et tout son contenu\n");
+    fprintf(sortie, "  mv <src> <dest> - Déplacer un fichier\n");
+    fprintf(sortie, "  write <nom>     - Écrire dans un fichier\n\n");
+    fprintf(sortie, "  defrag          - Défragmentation en réorganisant les blocs\n");
+    fprintf(sortie, "  sync            - Écrire sur la partition les données en attente\n");
+    fprintf(sortie, "  fsck [-r]       - Vérifier la cohérence de la partition (-r : réparer)\n");
+    fprintf(sortie, "  scrub           - Contrôler les sommes de contrôle de tous les blocs utilisés\n");
+    fprintf(sortie, "  dedup           - Partager les blocs de données identiques déjà écrits\n");
+    fprintf(sortie, "  begin           - Ouvrir une transaction\n");
+    fprintf(sortie, "  commit          - Valider la transaction (une seule écriture groupée)\n");
+    fprintf(sortie, "  abort           - Annuler la transaction\n");
+    fprintf(sortie, "  stats [reset | json [fichier]] - Mesures des opérations et des accès aux blocs\n");
+    fprintf(sortie, "  trace [<fichier> | stop] - Enregistrer les accès aux blocs (rejeu avec rejeu_fs)\n");
+
+    // Liens et attributs
+    fprintf(sortie, "LIENS ET ATTRIBUTS:\n");
+    fprintf(sortie, "  chmod <nom><droit> - Modifier les droits d'un fichier (notation symbolique)\n");
+    fprintf(sortie, "  chattr +c|-c <nom> - Compresser un fichier, ou le stocker tel quel\n");
+    fprintf(sortie, "  ln <src> <dest>    - Créer un lien physique\n");
+    fprintf(sortie, "  lns <src> <dest>   - Créer un lien symbolique\n\n");
+
+    // Commande de sortie
+    fprintf(sortie, "SYSTÈME:\n");
+    fprintf(sortie, "  quit            - Quitter le programme\n");
+    fprintf(sortie, "\n====================================================\n");
+}
+
+/**
+ * Indique si une commande réorganise toute la partition et doit donc
+ * s'exécuter seule (défragmentation, déduplication, vérification, contrôle
+ * des sommes, sauvegarde et restauration d'état, instantanés et élagage du
+ * dépôt, suppression et copie d'une arborescence, ouverture et fermeture
+ * des transactions, remise à zéro des mesures, début et fin d'une trace)
+ * @param commande La ligne de commande
+ * @return 1 si la commande est exclusive, 0 sinon
+ */
+int commande_exclusive(const char* commande) {
+    return strncmp(commande, "save ", 5) == 0 || strncmp(commande, "load ", 5) == 0
+           || strncmp(commande, "defrag", 6) == 0 || strncmp(commande, "fsck", 4) == 0
+           || strcmp(commande, "scrub") == 0 || strcmp(commande, "dedup") == 0
+           || strncmp(commande, "snapshot ", 9) == 0 || strncmp(commande, "restore ", 8) == 0
+           || strncmp(commande, "prune ", 6) == 0
+           || strncmp(commande, "rm -r ", 6) == 0 || strncmp(commande, "cp -r ", 6) == 0
+           || strcmp(commande, "begin") == 0
+           || strcmp(commande, "commit") == 0 || strcmp(commande, "abort") == 0
+           || strcmp(commande, "stats reset") == 0 || strncmp(commande, "trace ", 6) == 0;
+}
+
+/**
+ * Indique si une commande ne lit ni ne modifie la partition (aide,
+ * mesures, trace) : elle reste permise pendant la transaction d'une
+ * autre session
+ * @param commande La ligne de commande
+ * @return 1 si la commande ne touche pas la partition, 0 sinon
+ */
+static int commande_hors_partition(const char* commande) {
+    return strcmp(commande, "aide") == 0
+           || strcmp(commande, "stats") == 0 || strncmp(commande, "stats ", 6) == 0
+           || strcmp(commande, "trace") == 0 || strncmp(commande, "trace ", 6) == 0;
+}
+
+/**
+ * Vérifie qu'un fichier peut recevoir la commande write, avant de
+ * demander son contenu à l'utilisateur
+ * @param s La session
+ * @param nom Le nom du fichier dans le répertoire courant
+ * @return 0 si le fichier peut être écrit, -1 sinon
+ */
+int verifier_cible_ecriture(Session* s, const char* nom) {
+    SystemeFichiers* fs = s->fs;
+
+    debuter_operation(fs, 0);
+    int inode_id = trouver_inode_par_nom(fs, s->inode_courant, nom);
+    int type = -1;
+    if (inode_id != -1) {
+        Inode* inode = epingler_inode(fs, inode_id);
+        type = inode ? inode->type : -1;
+        if (inode) desepingler_inode(fs, inode_id, 0);
+    }
+    terminer_operation(fs);
+
+    if (inode_id == -1) {
+        erreur("Fichier non trouvé");
+        return -1;
+    }
+    // Vérifier que ce n'est pas un lien symbolique
+    if (type == TYPE_LIEN_SYMBOLIQUE) {
+        erreur("Impossible d'écrire dans un lien symbolique !");
+        return -1;
+    }
+    if (type == TYPE_REPERTOIRE) {
+        fprintf(flux_sortie(), "Impossible d'écrire dans un repertoire !");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Affiche le contenu d'un fichier du répertoire courant
+ * @param s La session
+ * @param fichier Le nom du fichier
+ * @return 0 si succès, -1 si erreur
+ */
+static int commande_cat(Session* s, const char* fichier) {
+    SystemeFichiers* fs = s->fs;
+    FILE* sortie = flux_sortie();
+
+    int inode_id = trouver_inode_par_nom(fs, s->inode_courant, fichier);
+    if (inode_id == -1) {
+        erreur("Fichier non trouvé");
+        return -1;
+    }
+
+    char buffer[1024];
+    Inode* inode = epingler_inode(fs, inode_id);
+    int taille = inode ? inode->taille : 0;
+    if (inode) desepingler_inode(fs, inode_id, 0);
+    int offset = 0;
+
+    if (taille == 0) {
+        fprintf(sortie, "(Fichier vide)\n");
+        return 0;
+    }
+
+    while (offset < taille) {
+        int bytes_to_read = sizeof(buffer) - 1;
+        if (offset + bytes_to_read > taille) {
+            bytes_to_read = taille - offset;
+        }
+
+        int bytes_read = lire_fichier(s, inode_id, buffer, bytes_to_read, offset);
+        if (bytes_read <= 0) {
+            break;
+        }
+
+        buffer[bytes_read] = '\0';
+        fprintf(sortie, "%s", buffer);
+        offset += bytes_read;
+    }
+    fprintf(sortie, "\n");
+    return offset < taille ? -1 : 0;
+}
+
+/**
+ * Affiche, exporte ou remet à zéro les mesures de la partition
+ * @param fs La partition
+ * @param arguments Ce qui suit « stats » : vide, « reset », « json » ou
+ *                  « json <fichier> »
+ * @return 0 si succès, -1 si erreur
+ */
+static int commande_stats(SystemeFichiers* fs, const char* arguments) {
+#ifdef METRIQUES
+    FILE* sortie = flux_sortie();
+    char fichier[MAX_CHEMIN];
+
+    if (arguments[0] == '\0') {
+        afficher_metriques(&fs->metriques, sortie);
+        fprintf(sortie, "Fichier de partition : %lu lectures (%lu octets), %lu écritures (%lu octets)\n",
+                __atomic_load_n(&fs->nb_lectures_disque, __ATOMIC_RELAXED),
+                __atomic_load_n(&fs->octets_lus, __ATOMIC_RELAXED),
+                __atomic_load_n(&fs->nb_ecritures_disque, __ATOMIC_RELAXED),
+                __atomic_load_n(&fs->octets_ecrits, __ATOMIC_RELAXED));
+        fprintf(sortie, "Cache de blocs : %lu lectures servies, %lu blocs lus par anticipation\n",
+                __atomic_load_n(&fs->nb_succes_cache_blocs, __ATOMIC_RELAXED),
+                __atomic_load_n(&fs->nb_blocs_anticipes, __ATOMIC_RELAXED));
+        unsigned long nb_lots = __atomic_load_n(&fs->nb_lots_es, __ATOMIC_RELAXED);
+        unsigned long nb_requetes = __atomic_load_n(&fs->nb_requetes_es, __ATOMIC_RELAXED);
+        fprintf(sortie, "Entrées-sorties (%s%s) : %lu lots, %lu requêtes (%.1f par lot)\n",
+                nom_moteur_es(fs->moteur_es), fs->descripteur_direct != -1 ? ", O_DIRECT" : "",
+                nb_lots, nb_requetes,
+                nb_lots ? (double)nb_requetes / nb_lots : 0.0);
+        if (fs->bloc_sommes != -1) {
+            fprintf(sortie, "Sommes de contrôle (crc32c %s, %s) : %lu blocs vérifiés, %lu corrompus\n",
+                    nom_calcul_crc32c(), fs->verification_donnees ? "toutes lectures" : "métadonnées",
+                    __atomic_load_n(&fs->nb_sommes_verifiees, __ATOMIC_RELAXED),
+                    __atomic_load_n(&fs->nb_blocs_corrompus, __ATOMIC_RELAXED));
+        }
+        if (fs->bloc_references != -1) {
+            EtatDeduplication dedup;
+            mesurer_deduplication(fs, &dedup);
+            int logiques = dedup.nb_blocs_donnees + dedup.nb_blocs_economises;
+            fprintf(sortie, "Déduplication (%s) : %d blocs partagés, %d blocs économisés (ratio %.2f), "
+                    "%lu doublons trouvés, %lu collisions\n",
+                    fs->deduplication ? "active" : "inactive", dedup.nb_blocs_partages,
+                    dedup.nb_blocs_economises,
+                    dedup.nb_blocs_donnees ? (double)logiques / dedup.nb_blocs_donnees : 1.0,
+                    __atomic_load_n(&fs->nb_blocs_dedupliques, __ATOMIC_RELAXED),
+                    __atomic_load_n(&fs->nb_collisions_dedup, __ATOMIC_RELAXED));
+            fprintf(sortie, "Index de déduplication : %d blocs indexés, %zu octets en mémoire\n",
+                    dedup.nb_blocs_indexes, dedup.octets_index);
+        }
+        unsigned long clusters_ecrits = __atomic_load_n(&fs->nb_clusters_ecrits, __ATOMIC_RELAXED);
+        unsigned long clusters_lus = __atomic_load_n(&fs->nb_clusters_decompresses, __ATOMIC_RELAXED);
+        if (clusters_ecrits > 0 || clusters_lus > 0) {
+            unsigned long avant = __atomic_load_n(&fs->octets_avant_compression, __ATOMIC_RELAXED);
+            unsigned long apres = __atomic_load_n(&fs->octets_apres_compression, __ATOMIC_RELAXED);
+            fprintf(sortie, "Compression (lz) : %lu clusters écrits dont %lu compressés (%lu -> %lu octets, "
+                    "ratio %.2f), %lu clusters décompressés\n",
+                    clusters_ecrits, __atomic_load_n(&fs->nb_clusters_compresses, __ATOMIC_RELAXED),
+                    avant, apres, apres ? (double)avant / apres : 1.0, clusters_lus);
+        }
+    } else if (strcmp(arguments, "reset") == 0) {
+        reinitialiser_metriques(&fs->metriques);
+        // Le thread de lecture anticipée peut compter ses lectures en même temps
+        __atomic_store_n(&fs->nb_lectures_disque, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&fs->nb_ecritures_disque, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&fs->octets_lus, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&fs->octets_ecrits, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&fs->nb_succes_cache_blocs, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&fs->nb_blocs_anticipes, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&fs->nb_lots_es, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&fs->nb_requetes_es, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&fs->nb_sommes_verifiees, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&fs->nb_blocs_corrompus, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&fs->nb_blocs_dedupliques, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&fs->nb_collisions_dedup, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&fs->nb_clusters_ecrits, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&fs->nb_clusters_compresses, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&fs->octets_avant_compression, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&fs->octets_apres_compression, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&fs->nb_clusters_decompresses, 0, __ATOMIC_RELAXED);
+        fprintf(sortie, "Mesures remises à zéro.\n");
+    } else if (strcmp(arguments, "json") == 0) {
+        ecrire_metriques_json(&fs->metriques, sortie);
+    } else if (sscanf(arguments, "json %1023s", fichier) == 1) {
+        FILE* f = fopen(fichier, "w");
+        if (!f) {
+            erreur("Impossible de créer le fichier des mesures");
+            return -1;
+        }
+        ecrire_metriques_json(&fs->metriques, f);
+        if (fclose(f) != 0) {
+            erreur("Erreur d'écriture du fichier des mesures");
+            return -1;
+        }
+        fprintf(sortie, "Mesures écrites dans '%s'.\n", fichier);
+    } else {
+        erreur("Usage: stats [reset | json [fichier]]");
+        return -1;
+    }
+    return 0;
+#else
+    (void)fs;
+    (void)arguments;
+    erreur("Mesures non compilées (make METRIQUES=1)");
+    return -1;
+#endif
+}
+
+/**
+ * Commande trace : démarre, arrête ou affiche l'enregistrement des accès
+ * aux blocs
+ * @param fs La partition
+ * @param arguments Ce qui suit « trace » : vide, « stop » ou un fichier
+ * @return 0 si succès, -1 si erreur
+ */
+static int commande_trace(SystemeFichiers* fs, const char* arguments) {
+    FILE* sortie = flux_sortie();
+    char fichier[MAX_CHEMIN];
+
+    if (arguments[0] == '\0') {
+#ifdef METRIQUES
+        if (fs->trace) {
+            fprintf(sortie, "Trace en cours dans '%s'.\n", chemin_trace(fs->trace));
+        } else {
+            fprintf(sortie, "Aucune trace en cours.\n");
+        }
+        return 0;
+#else
+        erreur("Mesures non compilées (make METRIQUES=1)");
+        return -1;
+#endif
+    } else if (strcmp(arguments, "stop") == 0) {
+        uint64_t nb_evenements, nb_perdus;
+        if (arreter_trace_partition(fs, &nb_evenements, &nb_perdus) != 0) {
+            return -1;
+        }
+        fprintf(sortie, "Trace arrêtée : %lu accès enregistrés, %lu perdus.\n",
+                (unsigned long)nb_evenements, (unsigned long)nb_perdus);
+    } else if (sscanf(arguments, "%1023s", fichier) == 1) {
+        if (demarrer_trace_partition(fs, fichier) != 0) {
+            return -1;
+        }
+        fprintf(sortie, "Trace des accès aux blocs dans '%s'.\n", fichier);
+    } else {
+        erreur("Usage: trace [<fichier> | stop]");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Remplace le contenu d'un fichier du répertoire courant
+ * @param s La session
+ * @param fichier Le nom du fichier
+ * @param donnees Le nouveau contenu
+ * @param taille La taille du contenu
+ * @return 0 si succès, -1 si erreur
+ */
+static int commande_write(Session* s, const char* fichier, const char* donnees, int taille) {
+    SystemeFichiers* fs = s->fs;
+
+    if (donnees == NULL) {
+        erreur("Aucun contenu à écrire");
+        return -1;
+    }
+
+    int inode_id = trouver_inode_par_nom(fs, s->inode_courant, fichier);
+    if (inode_id == -1) {
+        erreur("Fichier non trouvé");
+        return -1;
+    }
+
+    Inode* inode = epingler_inode(fs, inode_id);
+    int type = inode ? inode->type : -1;
+    if (inode) desepingler_inode(fs, inode_id, 0);
+    if (type == TYPE_LIEN_SYMBOLIQUE) {
+        erreur("Impossible d'écrire dans un lien symbolique !");
+        return -1;
+    }
+    if (type == TYPE_REPERTOIRE) {
+        fprintf(flux_sortie(), "Impossible d'écrire dans un repertoire !");
+        return -1;
+    }
+
+    // Écrire le contenu dans le fichier
+    int resultat = ecrire_fichier(s, inode_id, (void*)donnees, taille, 0);
+    if (resultat < 0) {
+        erreur("Erreur lors de l'écriture du fichier");
+        return -1;
+    }
+    fprintf(flux_sortie(), "Fichier écrit avec succès (%d octets).\n", taille);
+    return 0;
+}
+
+/**
+ * Exécute une commande pour une session
+ * La commande est encadrée par debuter_operation et terminer_operation ;
+ * ses résultats et ses erreurs sont écrits sur flux_sortie().
+ * @param s La session (répertoire courant)
+ * @param commande La ligne de commande, sans retour à la ligne
+ * @param donnees Le contenu à écrire pour la commande write (NULL sinon)
+ * @param taille_donnees La taille de ce contenu
+ * @return 0 si succès, -1 si erreur, COMMANDE_QUITTER pour quit
+ */
+int executer_commande(Session* s, const char* commande, const char* donnees, int taille_donnees) {
+    SystemeFichiers* fs = s->fs;
+    FILE* sortie = flux_sortie();
+    char param1[MAX_NOM_FICHIER + 1];
+    char param2[MAX_NOM_FICHIER + 1];
+    int resultat = 0;
+
+    if (strcmp(commande, "quit") == 0) {
+        return COMMANDE_QUITTER;
+    }
+
+    int erreurs_avant = nb_erreurs();
+    debuter_operation(fs, commande_exclusive(commande));
+
+    // Pendant une transaction, la partition appartient à la session qui
+    // l'a ouverte : son annulation ne doit rien emporter d'autre que son
+    // propre travail, et les autres sessions ne voient pas ses écritures
+    if (fs->session_transaction != NULL && fs->session_transaction != s
+            && !commande_hors_partition(commande)) {
+        erreur("Une transaction d'une autre session est en cours");
+        resultat = -1;
+
+    } else if (strcmp(commande, "aide") == 0) {
+        afficher_aide();
+
+    } else if (strcmp(commande, "ls") == 0) {
+        afficher_repertoire(fs, s->inode_courant);
+
+    } else if (strncmp(commande, "cd ", 3) == 0) {
+        if (sscanf(commande, "cd %255s", param1) == 1) {
+            resultat = changer_repertoire(s, param1);
+        } else {
+            erreur("Usage: cd <repertoire>");
+        }
+
+    } else if (strncmp(commande, "mkdir ", 6) == 0) {
+        if (sscanf(commande, "mkdir %255s", param1) == 1) {
+            resultat = creer_fichier(s, param1, TYPE_REPERTOIRE);
+        } else {
+            erreur("Usage: mkdir <nom>");
+        }
+
+    } else if (strncmp(commande, "touch ", 6) == 0) {
+        if (sscanf(commande, "touch %255s", param1) == 1 && strcmp(param1, ".") != 0 && strcmp(param1, "..") != 0) {
+            resultat = creer_fichier(s, param1, TYPE_FICHIER);
+        } else {
+            erreur("Usage: touch <nom>");
+        }
+
+    } else if (strcmp(commande, "tree") == 0 || strncmp(commande, "tree ", 5) == 0) {
+        if (sscanf(commande, "tree %255s", param1) == 1) {
+            resultat = afficher_arborescence(s, param1);
+        } else {
+            resultat = afficher_arborescence(s, NULL);
+        }
+
+    } else if (strncmp(commande, "find ", 5) == 0) {
+        if (sscanf(commande, "find %255s", param1) == 1) {
+            resultat = rechercher_noms(s, param1);
+        } else {
+            erreur("Usage: find <motif>");
+        }
+
+    } else if (strcmp(commande, "du") == 0 || strncmp(commande, "du ", 3) == 0) {
+        if (sscanf(commande, "du %255s", param1) == 1) {
+            resultat = afficher_occupation(s, param1);
+        } else {
+            resultat = afficher_occupation(s, NULL);
+        }
+
+    } else if (strncmp(commande, "rm -r ", 6) == 0) {
+        if (sscanf(commande, "rm -r %255s", param1) == 1) {
+            resultat = supprimer_arbre(s, param1);
+        } else {
+            erreur("Usage: rm -r <nom>");
+        }
+
+    } else if (strncmp(commande, "rm ", 3) == 0) {
+        if (sscanf(commande, "rm %255s", param1) == 1) {
+            resultat = supprimer_fichier(s, param1);
+        } else {
+            erreur("Usage: rm <nom>");
+        }
+
+    } else if (strncmp(commande, "cp -r ", 6) == 0) {
+        if (sscanf(commande, "cp -r %255s %255s", param1, param2) == 2) {
+            resultat = copier_arbre(s, param1, param2);
+        } else {
+            erreur("Usage: cp -r <source> <destination>");
+        }
+
+    } else if (strncmp(commande, "cp ", 3) == 0) {
+        if (sscanf(commande, "cp %255s %255s", param1, param2) == 2) {
+            resultat = copier_fichier(s, param1, param2);
+        } else {
+            erreur("Usage: cp <source> <destination>");
+        }
+
+    } else if (strncmp(commande, "chmod ", 6) == 0) {
+        if (sscanf(commande, "chmod %255s %255s", param1, param2) == 2) {
+            int inode_id = trouver_inode_par_nom(fs, s->inode_courant, param1);
+            // Convertir les droits en numéro pour pouvoir les modifier (ex rwx => 777)
+            int nouveaux_droits = convertir_droits_char(param2);
+            if (inode_id == -1) {
+                erreur("Fichier non trouvé");
+            } else if (nouveaux_droits == -1) {
+                erreur("Droits invalides (format rwxrwxrwx)");
+            } else if (modifier_droits(fs, inode_id, nouveaux_droits) == 0) {
+                fprintf(sortie, "Droits du fichier '%s' modifiés avec succès.\n", param1);
+            } else {
+                fprintf(sortie, "Erreur de modification des droits.\n");
+                resultat = -1;
+            }
+        } else {
+            erreur("Usage : chmod <nom_fichier> <droits>");
+        }
+
+    } else if (strncmp(commande, "chattr ", 7) == 0) {
+        if (sscanf(commande, "chattr %255s %255s", param1, param2) == 2
+            && (strcmp(param1, "+c") == 0 || strcmp(param1, "-c") == 0)) {
+            int inode_id = trouver_inode_par_nom(fs, s->inode_courant, param2);
+            int actif = param1[0] == '+';
+            if (inode_id == -1) {
+                erreur("Fichier non trouvé");
+            } else if ((resultat = modifier_compression(fs, inode_id, actif)) == 0) {
+                fprintf(sortie, "Compression du fichier '%s' %s.\n", param2, actif ? "activée" : "désactivée");
+            }
+        } else {
+            erreur("Usage : chattr +c|-c <nom_fichier>");
+        }
+
+    } else if (strncmp(commande, "mv ", 3) == 0) {
+        if (sscanf(commande, "mv %255s %255s", param1, param2) == 2) {
+            resultat = deplacer_fichier(s, param1, param2);
+        } else {
+            erreur("Usage: mv <source> <destination>");
+        }
+
+    } else if (strncmp(commande, "lns ", 4) == 0) {
+        if (sscanf(commande, "lns %255s %255s", param1, param2) == 2) {
+            resultat = creer_lien_symbolique(s, param1, param2);
+        } else {
+            erreur("Usage: lns <source> <destination>");
+        }
+
+    } else if (strncmp(commande, "ls -i", 5) == 0) {
+        // Récupérer le nom du fichier ou répertoire dans la commande
+        if (sscanf(commande, "ls -i %255s", param1) == 1) {
+            // Rechercher l'inode correspondant au fichier ou répertoire
+            int inode_id = trouver_ind(s, param1);
+            if (inode_id != -1) {
+                afficher_inode(fs, inode_id, param1);
+            } else {
+                fprintf(sortie, "Fichier ou répertoire '%s' non trouvé.\n", param1);
+                resultat = -1;
+            }
+        } else {
+            fprintf(sortie, "Usage: ls -i <fichier_ou_répertoire>\n");
+            resultat = -1;
+        }
+
+    } else if (strncmp(commande, "ln ", 3) == 0) {
+        if (sscanf(commande, "ln %255s %255s", param1, param2) == 2) {
+            resultat = creer_lien(s, param1, param2);
+        } else {
+            erreur("Usage: ln <source> <destination>");
+        }
+
+    } else if (strncmp(commande, "cat ", 4) == 0) {
+        char extra[10];
+        if (sscanf(commande, "cat %255s %9s", param1, extra) == 1) {
+            resultat = commande_cat(s, param1);
+        } else {
+            erreur("Usage: cat <nom_fichier>");
+        }
+
+    } else if (strncmp(commande, "save ", 5) == 0) {
+        if (sscanf(commande, "save %255s", param1) == 1) {
+            sauvegarder_etat(fs, param1);
+        } else {
+            erreur("Usage: save <nom_fichier>");
+        }
+
+    } else if (strncmp(commande, "load ", 5) == 0) {
+        if (sscanf(commande, "load %255s", param1) == 1) {
+            restaurer_etat(fs, param1);
+        } else {
+            erreur("Usage: load <nom_fichier>");
+        }
+
+    } else if (strncmp(commande, "snapshot ", 9) == 0) {
+        int nb = sscanf(commande, "snapshot %255s %255s", param1, param2);
+        if (nb >= 1) {
+            resultat = sauvegarder_instantane(fs, param1, nb == 2 ? param2 : NULL);
+        } else {
+            erreur("Usage: snapshot <depot> [nom]");
+        }
+
+    } else if (strncmp(commande, "snapshots ", 10) == 0) {
+        if (sscanf(commande, "snapshots %255s", param1) == 1) {
+            resultat = lister_instantanes(param1);
+        } else {
+            erreur("Usage: snapshots <depot>");
+        }
+
+    } else if (strncmp(commande, "restore ", 8) == 0) {
+        if (sscanf(commande, "restore %255s %255s", param1, param2) == 2) {
+            resultat = restaurer_instantane(fs, param1, param2);
+        } else {
+            erreur("Usage: restore <depot> <nom>");
+        }
+
+    } else if (strncmp(commande, "prune ", 6) == 0) {
+        int nb_gardes;
+        if (sscanf(commande, "prune %255s %d", param1, &nb_gardes) == 2) {
+            resultat = elaguer_depot(param1, nb_gardes);
+        } else {
+            erreur("Usage: prune <depot> <nombre_gardes>");
+        }
+
+    } else if (strncmp(commande, "defrag", 6) == 0) {
+        // Vérifier si la commande est suivie d'un espace
+        if (commande[6] == '\0' || commande[6] == ' ') {
+            fprintf(sortie, "Contenu du bitmap avant défragmentation :\n");
+            afficher_bitmap(fs->bitmap, NB_BLOCS);
+
+            resultat = defragmenter(fs);
+
+            fprintf(sortie, "Contenu du bitmap après défragmentation :\n");
+            afficher_bitmap(fs->bitmap, NB_BLOCS);
+        } else {
+            erreur("Usage: defrag");
+        }
+
+    } else if (strcmp(commande, "fsck") == 0 || strcmp(commande, "fsck -r") == 0) {
+        int reste = verifier_partition(fs, commande[4] ? VERIFIER_REPARER : 0);
+        resultat = reste == 0 ? 0 : -1;
+
+    } else if (strcmp(commande, "scrub") == 0) {
+        resultat = controler_sommes_partition(fs);
+
+    } else if (strcmp(commande, "dedup") == 0) {
+        resultat = dedupliquer_partition(fs);
+
+    } else if (strncmp(commande, "write ", 6) == 0) {
+        if (sscanf(commande, "write %255s", param1) == 1) {
+            resultat = commande_write(s, param1, donnees, taille_donnees);
+        } else {
+            erreur("Usage: write <nom_fichier>");
+        }
+
+    } else if (strcmp(commande, "sync") == 0) {
+        if (synchroniser_tampons(fs) == 0) {
+            fprintf(sortie, "Données en attente écrites sur la partition.\n");
+        } else {
+            erreur("Échec de l'écriture des données en attente");
+        }
+
+    } else if (strcmp(commande, "stats") == 0 || strncmp(commande, "stats ", 6) == 0) {
+        resultat = commande_stats(fs, commande[5] ? commande + 6 : "");
+
+    } else if (strcmp(commande, "trace") == 0 || strncmp(commande, "trace ", 6) == 0) {
+        resultat = commande_trace(fs, commande[5] ? commande + 6 : "");
+
+    } else if (strcmp(commande, "begin") == 0) {
+        resultat = debuter_transaction(s);
+
+    } else if (strcmp(commande, "commit") == 0) {
+        resultat = valider_transaction(s);
+
+    } else if (strcmp(commande, "abort") == 0) {
+        resultat = annuler_transaction(s);
+
+    } else {
+        fprintf(sortie, "Commande inconnue. Tapez 'aide' pour voir les commandes disponibles.\n");
+        resultat = -1;
+    }
+
+    terminer_operation(fs);
+
+    return (resultat < 0 || nb_erreurs() != erreurs_avant) ? -1 : 0;
+}
+
+/**
+ * @brief Avancement d'un lot de commandes
+ */
+typedef struct {
+    const OptionsLot* options;
+    int nb_commandes;      // Commandes exécutées
+    int nb_echecs;         // Commandes en échec
+    int arret;             // quit rencontré, ou échec avec arret_erreur
+} EtatLot;
+
+/**
+ * Supprime les blancs en tête et en fin d'une chaîne
+ * @param texte La chaîne, modifiée sur place
+ * @return Le début de la chaîne épurée
+ */
+static char* epurer(char* texte) {
+    while (isspace((unsigned char)*texte)) texte++;
+    size_t longueur = strlen(texte);
+    while (longueur > 0 && isspace((unsigned char)texte[longueur - 1])) {
+        texte[--longueur] = '\0';
+    }
+    return texte;
+}
+
+/**
+ * Sépare le contenu donné sur la ligne d'une commande write :
+ * « write <nom> <texte> ». La séquence \n du texte devient un retour à la
+ * ligne, et le contenu se termine par un retour à la ligne comme une
+ * saisie interactive.
+ * @param commande La commande, tronquée après le nom du fichier
+ * @param taille Reçoit la taille du contenu
+ * @return Le contenu (à libérer), ou NULL si la ligne n'en porte pas
+ */
+static char* extraire_contenu_en_ligne(char* commande, int* taille) {
+    char* nom = commande + 6;
+    while (*nom == ' ' || *nom == '\t') nom++;
+    char* fin_nom = nom + strcspn(nom, " \t");
+    if (*fin_nom == '\0') {
+        return NULL;
+    }
+    *fin_nom = '\0';
+
+    char* texte = fin_nom + 1;
+    while (*texte == ' ' || *texte == '\t') texte++;
+
+    char* contenu = malloc(strlen(texte) + 2);
+    if (!contenu) return NULL;
+    int n = 0;
+    for (char* c = texte; *c; c++) {
+        if (c[0] == '\\' && c[1] == 'n') {
+            contenu[n++] = '\n';
+            c++;
+        } else if (c[0] == '\\' && c[1] == '\\') {
+            contenu[n++] = '\\';
+            c++;
+        } else {
+            contenu[n++] = *c;
+        }
+    }
+    contenu[n++] = '\n';
+    *taille = n;
+    return contenu;
+}
+
+/**
+ * Lit le contenu d'une commande write dans un script : les lignes qui
+ * suivent la commande, jusqu'à une ligne vide
+ * @param flux Le script
+ * @param numero Le numéro de la ligne courante, mis à jour
+ * @param taille Reçoit la taille du contenu
+ * @return Le contenu (à libérer), ou NULL si erreur
+ */
+static char* lire_contenu_flux(FILE* flux, int* numero, int* taille) {
+    size_t capacite = 1024;
+    char* contenu = malloc(capacite);
+    char* ligne = NULL;
+    size_t taille_ligne = 0;
+    ssize_t lu;
+    *taille = 0;
+    if (!contenu) return NULL;
+
+    while ((lu = getline(&ligne, &taille_ligne, flux)) != -1) {
+        (*numero)++;
+
+        // Ligne vide termine la saisie
+        ligne[strcspn(ligne, "\r\n")] = '\0';
+        lu = strlen(ligne);
+        if (lu == 0) {
+            break;
+        }
+
+        if (*taille + lu + 1 > capacite) {
+            while (*taille + lu + 1 > capacite) capacite *= 2;
+            char* agrandi = realloc(contenu, capacite);
+            if (!agrandi) {
+                free(contenu);
+                free(ligne);
+                return NULL;
+            }
+            contenu = agrandi;
+        }
+        memcpy(contenu + *taille, ligne, lu);
+        contenu[*taille + lu] = '\n';
+        *taille += lu + 1;
+    }
+    free(ligne);
+    return contenu;
+}
+
+/**
+ * Exécute une commande d'un lot et tient les comptes du lot
+ * @param s La session
+ * @param etat L'avancement du lot
+ * @param source Le nom du script, pour les messages d'erreur
+ * @param numero Le numéro de la commande dans le script
+ * @param commande La commande
+ * @param donnees Le contenu de write (NULL sinon)
+ * @param taille La taille de ce contenu
+ */
+static void executer_dans_lot(Session* s, EtatLot* etat, const char* source, int numero,
+                              const char* commande, const char* donnees, int taille) {
+    int statut = executer_commande(s, commande, donnees, taille);
+    if (statut == COMMANDE_QUITTER) {
+        etat->arret = 1;
+        return;
+    }
+
+    etat->nb_commandes++;
+    if (statut < 0) {
+        etat->nb_echecs++;
+        fprintf(stderr, "%s:%d: échec de la commande « %s »\n", source, numero, commande);
+        if (etat->options->arret_erreur) {
+            etat->arret = 1;
+        }
+    }
+
+    // La sauvegarde complète ne se fait qu'à la fermeture, sauf demande
+    int periode = etat->options->sauvegarde_tous;
+    if (periode > 0 && etat->nb_commandes % periode == 0) {
+        debuter_operation(s->fs, 0);
+        sauvegarder_partition(s->fs);
+        terminer_operation(s->fs);
+    }
+}
+
+/**
+ * Exécute les commandes d'un script (une par ligne) sans invite
+ * Les lignes vides et celles qui commencent par # sont ignorées. Le
+ * contenu d'un write est soit la fin de sa ligne, soit les lignes qui le
+ * suivent jusqu'à une ligne vide.
+ * @param s La session
+ * @param flux Le script (fichier ou entrée standard)
+ * @param nom_source Le nom du script, pour les messages d'erreur
+ * @param options Les options du lot
+ * @return Le nombre de commandes en échec
+ */
+int executer_lot_flux(Session* s, FILE* flux, const char* nom_source, const OptionsLot* options) {
+    EtatLot etat = { .options = options };
+    char* ligne = NULL;
+    size_t capacite = 0;
+    int numero = 0;
+
+    while (!etat.arret && getline(&ligne, &capacite, flux) != -1) {
+        int numero_commande = ++numero;
+        char* commande = epurer(ligne);
+        if (commande[0] == '\0' || commande[0] == '#') {
+            continue;
+        }
+
+        char* contenu = NULL;
+        int taille = 0;
+        if (strncmp(commande, "write ", 6) == 0) {
+            contenu = extraire_contenu_en_ligne(commande, &taille);
+            if (!contenu) {
+                contenu = lire_contenu_flux(flux, &numero, &taille);
+            }
+        }
+        executer_dans_lot(s, &etat, nom_source, numero_commande, commande, contenu, taille);
+        free(contenu);
+    }
+
+    free(ligne);
+    return etat.nb_echecs;
+}
+
+/**
+ * Exécute une liste de commandes séparées par des points-virgules
+ * Le contenu d'un write est la fin de sa commande (vide sinon).
+ * @param s La session
+ * @param liste Les commandes, par exemple "mkdir d; cd d; touch f"
+ * @param options Les options du lot
+ * @return Le nombre de commandes en échec
+ */
+int executer_lot_liste(Session* s, const char* liste, const OptionsLot* options) {
+    EtatLot etat = { .options = options };
+    char* copie = strdup(liste);
+    if (!copie) {
+        erreur("Mémoire insuffisante");
+        return 1;
+    }
+
+    char* reste = NULL;
+    int numero = 0;
+    for (char* morceau = strtok_r(copie, ";", &reste); morceau && !etat.arret;
+         morceau = strtok_r(NULL, ";", &reste)) {
+        numero++;
+        char* commande = epurer(morceau);
+        if (commande[0] == '\0') {
+            continue;
+        }
+
+        char* contenu = NULL;
+        int taille = 0;
+        if (strncmp(commande, "write ", 6) == 0) {
+            contenu = extraire_contenu_en_ligne(commande, &taille);
+        }
+        executer_dans_lot(s, &etat, "-c", numero, commande, contenu ? contenu : "", taille);
+        free(contenu);
+    }
+
+    free(copie);
+    return etat.nb_echecs;
+}
@@ -0,0 +1,36 @@
+/**
+ * @file commandes.h
+ * @brief Interpréteur des commandes du gestionnaire de fichiers
+ *
+ * L'interpréteur est partagé par l'interface interactive et par le démon :
+ * il exécute une ligne de commande pour une session et écrit ses
+ * résultats sur flux_sortie().
+ */
+
+#ifndef COMMANDES_H
+#define COMMANDES_H
+
+#include "file_system.h"
+
+#define TAILLE_MAX_COMMANDE 4096   // Longueur maximale d'une ligne de commande
+#define COMMANDE_QUITTER 1         // Valeur rendue par la commande quit
+
+/**
+ * @brief Options d'exécution d'un lot de commandes (script, -c, stdin)
+ */
+typedef struct {
+    int sauvegarde_tous;   // Sauvegarder les métadonnées toutes les N commandes (0 : à la fin seulement)
+    int arret_erreur;      // Arrêter le lot à la première commande en échec
+} OptionsLot;
+
+/* Interpréteur */
+int executer_commande(Session* s, const char* commande, const char* donnees, int taille_donnees);
+int verifier_cible_ecriture(Session* s, const char* nom);
+int commande_exclusive(const char* commande);
+void afficher_aide(void);
+
+/* Exécution par lots */
+int executer_lot_flux(Session* s, FILE* flux, const char* nom_source, const OptionsLot* options);
+int executer_lot_liste(Session* s, const char* liste, const OptionsLot* options);
+
+#endif // COMMANDES_H
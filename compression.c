@@ -0,0 +1,239 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "compression.h"
+
+/**
+ * Pourcentage d'implication :
+ * GOBALOUKICHENIN Bala : 33%
+ * DEHOUCHE Lisa : 33%
+ * GABITA William : 33%
+ *
+ * Compression et décompression LZ (format des blocs LZ4)
+ */
+
+#define LONGUEUR_MIN 4                    // Copie la plus courte
+#define LITTERAUX_FIN 5                   // Les derniers octets sont toujours des littéraux
+#define DISTANCE_MAX 65535                // Distance sur 2 octets
+#define BITS_HACHAGE 12                   // Entrées de la table : 1 << BITS_HACHAGE
+
+/**
+ * Lit un mot de 4 octets, sans contrainte d'alignement
+ * @param p Les octets
+ * @return Le mot
+ */
+static uint32_t lire_mot(const uint8_t* p) {
+    uint32_t mot;
+    memcpy(&mot, p, sizeof(mot));
+    return mot;
+}
+
+/**
+ * Position d'un mot dans la table de hachage
+ * @param mot Le mot de 4 octets
+ * @return L'entrée de la table
+ */
+static int hacher(uint32_t mot) {
+    return (int)((mot * 2654435761u) >> (32 - BITS_HACHAGE));
+}
+
+/**
+ * Écrit la suite d'une longueur qui dépasse 14 : des octets 255 puis le reste
+ * @param sortie Le tampon de sortie
+ * @param position Position d'écriture, avancée
+ * @param capacite Taille du tampon
+ * @param reste Longueur moins 15
+ * @return 0 si succès, -1 si le tampon est plein
+ */
+static int ecrire_longueur(uint8_t* sortie, int* position, int capacite, int reste) {
+    for (; reste >= 255; reste -= 255) {
+        if (*position >= capacite) {
+            return -1;
+        }
+        sortie[(*position)++] = 255;
+    }
+    if (*position >= capacite) {
+        return -1;
+    }
+    sortie[(*position)++] = (uint8_t)reste;
+    return 0;
+}
+
+/**
+ * Écrit une séquence : littéraux puis, sauf pour la dernière, une copie
+ * @param sortie Le tampon de sortie
+ * @param position Position d'écriture, avancée
+ * @param capacite Taille du tampon
+ * @param litteraux Les littéraux
+ * @param nb_litteraux Leur nombre
+ * @param distance Distance de la copie (0 : dernière séquence)
+ * @param longueur Longueur de la copie
+ * @return 0 si succès, -1 si le tampon est plein
+ */
+static int ecrire_sequence(uint8_t* sortie, int* position, int capacite, const uint8_t* litteraux,
+                           int nb_litteraux, int distance, int longueur) {
+    if (*position >= capacite) {
+        return -1;
+    }
+    int jeton = *position;
+    (*position)++;
+    sortie[jeton] = (uint8_t)((nb_litteraux < 15 ? nb_litteraux : 15) << 4);
+    if (nb_litteraux >= 15 && ecrire_longueur(sortie, position, capacite, nb_litteraux - 15) == -1) {
+        return -1;
+    }
+    if (nb_litteraux > capacite - *position) {
+        return -1;
+    }
+    memcpy(sortie + *position, litteraux, nb_litteraux);
+    *position += nb_litteraux;
+    if (distance == 0) {
+        return 0;
+    }
+
+    if (capacite - *position < 2) {
+        return -1;
+    }
+    sortie[(*position)++] = (uint8_t)(distance & 0xFF);
+    sortie[(*position)++] = (uint8_t)(distance >> 8);
+    longueur -= LONGUEUR_MIN;
+    sortie[jeton] |= (uint8_t)(longueur < 15 ? longueur : 15);
+    if (longueur >= 15 && ecrire_longueur(sortie, position, capacite, longueur - 15) == -1) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Compresse une zone mémoire
+ * @param source Les données
+ * @param taille Nombre d'octets
+ * @param destination Reçoit les données compressées
+ * @param capacite Taille de la destination
+ * @return Taille compressée, ou 0 si elle dépasse la capacité
+ */
+int compresser_lz(const void* source, int taille, void* destination, int capacite) {
+    const uint8_t* entree = source;
+    uint8_t* sortie = destination;
+    int table[1 << BITS_HACHAGE];
+    memset(table, -1, sizeof(table));
+
+    int position = 0;
+    int ancre = 0;                        // Premier octet pas encore émis
+    int fin = taille - LITTERAUX_FIN;     // Aucune copie ne commence ni ne finit après
+    int i = 0;
+    while (i < fin) {
+        uint32_t mot = lire_mot(entree + i);
+        int h = hacher(mot);
+        int candidat = table[h];
+        table[h] = i;
+        if (candidat < 0 || i - candidat > DISTANCE_MAX || lire_mot(entree + candidat) != mot) {
+            // Données peu compressibles : le pas grandit avec la distance
+            // au dernier motif trouvé
+            i += 1 + ((i - ancre) >> 6);
+            continue;
+        }
+
+        // Extension de la copie vers l'arrière puis vers l'avant
+        while (i > ancre && candidat > 0 && entree[i - 1] == entree[candidat - 1]) {
+            i--;
+            candidat--;
+        }
+        int longueur = LONGUEUR_MIN;
+        while (i + longueur < fin && entree[i + longueur] == entree[candidat + longueur]) {
+            longueur++;
+        }
+
+        if (ecrire_sequence(sortie, &position, capacite, entree + ancre, i - ancre,
+                            i - candidat, longueur) == -1) {
+            return 0;
+        }
+        i += longueur;
+        ancre = i;
+        if (i - 2 < fin) {
+            table[hacher(lire_mot(entree + i - 2))] = i - 2;
+        }
+    }
+
+    if (ecrire_sequence(sortie, &position, capacite, entree + ancre, taille - ancre, 0, 0) == -1) {
+        return 0;
+    }
+    return position;
+}
+
+/**
+ * Lit la suite d'une longueur codée sur plusieurs octets
+ * @param entree Les données compressées
+ * @param taille Leur taille
+ * @param position Position de lecture, avancée
+ * @param longueur Longueur à compléter
+ * @return 0 si succès, -1 si les données sont tronquées
+ */
+static int lire_longueur(const uint8_t* entree, int taille, int* position, int* longueur) {
+    int octet;
+    do {
+        if (*position >= taille || *longueur > taille * 255) {
+            return -1;
+        }
+        octet = entree[(*position)++];
+        *longueur += octet;
+    } while (octet == 255);
+    return 0;
+}
+
+/**
+ * Décompresse une zone produite par compresser_lz. Les données sont
+ * contrôlées : une zone corrompue ne fait jamais lire ni écrire hors des
+ * tampons.
+ * @param source Les données compressées
+ * @param taille Leur taille
+ * @param destination Reçoit les données
+ * @param capacite Taille de la destination
+ * @return Nombre d'octets produits, ou -1 si les données sont invalides
+ */
+int decompresser_lz(const void* source, int taille, void* destination, int capacite) {
+    const uint8_t* entree = source;
+    uint8_t* sortie = destination;
+    int i = 0;
+    int position = 0;
+
+    while (i < taille) {
+        int jeton = entree[i++];
+        int nb_litteraux = jeton >> 4;
+        if (nb_litteraux == 15 && lire_longueur(entree, taille, &i, &nb_litteraux) == -1) {
+            return -1;
+        }
+        if (nb_litteraux > taille - i || nb_litteraux > capacite - position) {
+            return -1;
+        }
+        memcpy(sortie + position, entree + i, nb_litteraux);
+        i += nb_litteraux;
+        position += nb_litteraux;
+        if (i == taille) {
+            break;                        // Dernière séquence : pas de copie
+        }
+
+        if (taille - i < 2) {
+            return -1;
+        }
+        int distance = entree[i] | entree[i + 1] << 8;
+        i += 2;
+        int longueur = jeton & 15;
+        if (longueur == 15 && lire_longueur(entree, taille, &i, &longueur) == -1) {
+            return -1;
+        }
+        longueur += LONGUEUR_MIN;
+        if (distance == 0 || distance > position || longueur > capacite - position) {
+            return -1;
+        }
+        if (distance >= longueur) {
+            memcpy(sortie + position, sortie + position - distance, longueur);
+            position += longueur;
+        } else {
+            // La source chevauche la destination : copie octet par octet
+            for (int k = 0; k < longueur; k++, position++) {
+                sortie[position] = sortie[position - distance];
+            }
+        }
+    }
+    return position;
+}
@@ -0,0 +1,20 @@
+/**
+ * @file compression.h
+ * @brief Compression des clusters des fichiers compressés
+ *
+ * Codec de la famille LZ77, au format des blocs LZ4 : une suite de
+ * séquences, chacune formée d'un octet de jeton (longueurs des littéraux
+ * et de la copie sur 4 bits chacune), des littéraux, puis d'une distance
+ * sur 2 octets vers des données déjà produites. Les correspondances sont
+ * trouvées par une table de hachage de mots de 4 octets, sans recherche
+ * exhaustive : la compression reste rapide et la décompression ne fait
+ * que des copies.
+ */
+
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+int compresser_lz(const void* source, int taille, void* destination, int capacite);
+int decompresser_lz(const void* source, int taille, void* destination, int capacite);
+
+#endif // COMPRESSION_H
@@ -0,0 +1,838 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "depot.h"
+#include "file_system.h"
+
+/**
+ * Pourcentage d'implication :
+ * GOBALOUKICHENIN Bala : 33%
+ * DEHOUCHE Lisa : 33%
+ * GABITA William : 33%
+ *
+ * Dépôt de sauvegardes dédupliquées
+ */
+
+#define SIGNATURE_MANIFESTE "INSTANTANE-GFS 1"
+#define TAILLE_CHEMIN 1024
+#define TAILLE_HEXADECIMAL (2 * TAILLE_SHA256 + 1)
+
+/**
+ * @struct Morceau
+ * @brief Un morceau de l'image : sa place et l'empreinte de son contenu
+ */
+typedef struct {
+    long position;
+    int longueur;
+    uint8_t empreinte[TAILLE_SHA256];
+} Morceau;
+
+/**
+ * @struct TravailDepot
+ * @brief Morceaux à stocker ou à relire, partagés entre les threads
+ */
+typedef struct {
+    const char* depot;
+    char* image;
+    Morceau* morceaux;
+    int nb_morceaux;
+    int restauration;                     // 1 : relire les morceaux, 0 : les stocker
+    uint8_t* blocs_modifies;              // Restauration : un octet par bloc réécrit
+    int suivant;                          // Prochain morceau à traiter
+    int nb_transferes;
+    long octets_transferes;
+    long octets_stockes;
+    const char* message_erreur;           // Première erreur, signalée par le thread appelant
+} TravailDepot;
+
+/**
+ * @struct Instantane
+ * @brief En-tête d'un manifeste, pour la liste et l'élagage
+ */
+typedef struct {
+    char nom[MAX_NOM_FICHIER + 1];
+    long long date;
+    long taille;
+    int nb_morceaux;
+} Instantane;
+
+static uint64_t table_gear[256];          // Valeur pseudo-aléatoire de chaque octet
+static pthread_once_t initialisation_gear = PTHREAD_ONCE_INIT;
+
+/**
+ * Remplit la table du hachage gear (générateur splitmix64, graine fixe :
+ * les frontières doivent être les mêmes d'une exécution à l'autre)
+ */
+static void initialiser_gear(void) {
+    uint64_t graine = 0;
+    for (int i = 0; i < 256; i++) {
+        uint64_t z = (graine += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        table_gear[i] = z ^ (z >> 31);
+    }
+}
+
+/**
+ * Découpe une image en morceaux dont les frontières dépendent du contenu
+ * @param image L'image
+ * @param taille Sa taille
+ * @param morceaux Reçoit la liste des morceaux (à libérer), sans empreintes
+ * @return Nombre de morceaux, ou -1 en cas d'erreur
+ */
+static int decouper_image(const char* image, size_t taille, Morceau** morceaux) {
+    pthread_once(&initialisation_gear, initialiser_gear);
+    Morceau* liste = malloc((taille / TAILLE_MIN_MORCEAU + 1) * sizeof(Morceau));
+    if (!liste) {
+        erreur("Mémoire insuffisante");
+        return -1;
+    }
+
+    const uint8_t* octets = (const uint8_t*)image;
+    int nb = 0;
+    size_t debut = 0;
+    while (debut < taille) {
+        size_t reste = taille - debut;
+        size_t longueur = reste < TAILLE_MAX_MORCEAU ? reste : TAILLE_MAX_MORCEAU;
+        if (longueur > TAILLE_MIN_MORCEAU) {
+            // Le hachage ne dépend que des 64 derniers octets : il démarre
+            // 64 octets avant le premier point de coupe possible
+            uint64_t h = 0;
+            for (size_t i = TAILLE_MIN_MORCEAU - 64; i < longueur; i++) {
+                h = (h << 1) + table_gear[octets[debut + i]];
+                if (i >= TAILLE_MIN_MORCEAU && (h >> (64 - BITS_MORCEAU_MOYEN)) == 0) {
+                    longueur = i + 1;
+                    break;
+                }
+            }
+        }
+        liste[nb].position = (long)debut;
+        liste[nb].longueur = (int)longueur;
+        nb++;
+        debut += longueur;
+    }
+    *morceaux = liste;
+    return nb;
+}
+
+/**
+ * Écrit une empreinte en hexadécimal
+ * @param empreinte Les TAILLE_SHA256 octets
+ * @param texte Reçoit les TAILLE_HEXADECIMAL caractères, zéro final compris
+ */
+static void en_hexadecimal(const uint8_t* empreinte, char* texte) {
+    static const char chiffres[] = "0123456789abcdef";
+    for (int i = 0; i < TAILLE_SHA256; i++) {
+        texte[2 * i] = chiffres[empreinte[i] >> 4];
+        texte[2 * i + 1] = chiffres[empreinte[i] & 15];
+    }
+    texte[2 * TAILLE_SHA256] = '\0';
+}
+
+/**
+ * Lit une empreinte écrite en hexadécimal
+ * @param texte Le texte
+ * @param empreinte Reçoit les TAILLE_SHA256 octets
+ * @return 0 si succès, -1 si le texte n'est pas une empreinte
+ */
+static int depuis_hexadecimal(const char* texte, uint8_t* empreinte) {
+    if (strlen(texte) != 2 * TAILLE_SHA256) {
+        return -1;
+    }
+    for (int i = 0; i < 2 * TAILLE_SHA256; i++) {
+        char c = texte[i];
+        int valeur = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+        if (valeur < 0) {
+            return -1;
+        }
+        if (i % 2 == 0) {
+            empreinte[i / 2] = (uint8_t)(valeur << 4);
+        } else {
+            empreinte[i / 2] |= (uint8_t)valeur;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Compare deux empreintes, pour qsort et bsearch
+ */
+static int comparer_empreintes(const void* a, const void* b) {
+    return memcmp(a, b, TAILLE_SHA256);
+}
+
+/**
+ * Crée un répertoire s'il n'existe pas
+ * @param chemin Le chemin
+ * @return 0 si succès, -1 sinon
+ */
+static int creer_repertoire(const char* chemin) {
+    return mkdir(chemin, 0755) == 0 || errno == EEXIST ? 0 : -1;
+}
+
+/**
+ * Écrit un fichier complet sous un nom temporaire puis le lie à son nom
+ * final : un fichier du dépôt est toujours entier, et jamais remplacé
+ * @param temporaire Le nom temporaire
+ * @param chemin Le nom final
+ * @param donnees Le contenu
+ * @param taille Sa taille
+ * @return 1 si le fichier a été écrit, 0 s'il existait déjà, -1 si erreur
+ */
+static int ecrire_fichier_atomique(const char* temporaire, const char* chemin, const void* donnees, size_t taille) {
+    int fd = open(temporaire, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        return -1;
+    }
+    const char* octets = donnees;
+    size_t ecrits = 0;
+    while (ecrits < taille) {
+        ssize_t n = write(fd, octets + ecrits, taille - ecrits);
+        if (n <= 0) {
+            close(fd);
+            unlink(temporaire);
+            return -1;
+        }
+        ecrits += (size_t)n;
+    }
+    int resultat = 1;
+    int echec = fsync(fd) == -1;
+    if (close(fd) == -1 || echec) {
+        resultat = -1;
+    } else if (link(temporaire, chemin) == -1) {
+        resultat = errno == EEXIST ? 0 : -1;
+    }
+    unlink(temporaire);
+    return resultat;
+}
+
+/**
+ * Note la première erreur d'un thread de travail
+ * @param travail Le travail
+ * @param message Le message
+ * @return -1
+ */
+static int echouer(TravailDepot* travail, const char* message) {
+    const char* attendu = NULL;
+    __atomic_compare_exchange_n(&travail->message_erreur, &attendu, message, 0,
+                                __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+    return -1;
+}
+
+/**
+ * Calcule l'empreinte d'un morceau et le stocke s'il manque au dépôt
+ * @param travail Le travail
+ * @param morceau Le morceau
+ * @return 0 si succès, -1 sinon
+ */
+static int stocker_morceau(TravailDepot* travail, Morceau* morceau) {
+    const char* source = travail->image + morceau->position;
+    calculer_sha256(source, morceau->longueur, morceau->empreinte);
+
+    char hexadecimal[TAILLE_HEXADECIMAL];
+    char chemin[TAILLE_CHEMIN];
+    en_hexadecimal(morceau->empreinte, hexadecimal);
+    snprintf(chemin, sizeof(chemin), "%s/morceaux/%.2s/%s", travail->depot, hexadecimal, hexadecimal);
+    if (access(chemin, F_OK) == 0) {
+        return 0;                         // Déjà stocké par un autre instantané
+    }
+
+    char repertoire[TAILLE_CHEMIN];
+    snprintf(repertoire, sizeof(repertoire), "%s/morceaux/%.2s", travail->depot, hexadecimal);
+    if (creer_repertoire(repertoire) == -1) {
+        return echouer(travail, "Impossible de créer un répertoire du dépôt");
+    }
+
+    // Un morceau compressé est strictement plus court que l'original : la
+    // taille du fichier suffit à distinguer les deux formes
+    char compresse[TAILLE_MAX_MORCEAU];
+    int taille_compressee = compresser_lz(source, morceau->longueur, compresse, morceau->longueur - 1);
+    const char* contenu = taille_compressee > 0 ? compresse : source;
+    int taille_stockee = taille_compressee > 0 ? taille_compressee : morceau->longueur;
+
+    char temporaire[TAILLE_CHEMIN];
+    snprintf(temporaire, sizeof(temporaire), "%s/morceaux/%.2s/.%s.%lu", travail->depot, hexadecimal,
+             hexadecimal, (unsigned long)pthread_self());
+    int ecrit = ecrire_fichier_atomique(temporaire, chemin, contenu, taille_stockee);
+    if (ecrit == -1) {
+        return echouer(travail, "Impossible d'écrire un morceau dans le dépôt");
+    }
+    if (ecrit == 0) {
+        return 0;                         // Même contenu stocké entre-temps par un autre thread
+    }
+
+    __atomic_fetch_add(&travail->nb_transferes, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&travail->octets_transferes, morceau->longueur, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&travail->octets_stockes, taille_stockee, __ATOMIC_RELAXED);
+    return 0;
+}
+
+/**
+ * Replace un morceau dans l'image s'il diffère de celui de l'instantané
+ * @param travail Le travail
+ * @param morceau Le morceau
+ * @return 0 si succès, -1 sinon
+ */
+static int recuperer_morceau(TravailDepot* travail, Morceau* morceau) {
+    char* destination = travail->image + morceau->position;
+    uint8_t empreinte[TAILLE_SHA256];
+    calculer_sha256(destination, morceau->longueur, empreinte);
+    if (memcmp(empreinte, morceau->empreinte, TAILLE_SHA256) == 0) {
+        return 0;                         // Déjà à jour
+    }
+
+    char hexadecimal[TAILLE_HEXADECIMAL];
+    char chemin[TAILLE_CHEMIN];
+    en_hexadecimal(morceau->empreinte, hexadecimal);
+    snprintf(chemin, sizeof(chemin), "%s/morceaux/%.2s/%s", travail->depot, hexadecimal, hexadecimal);
+    int fd = open(chemin, O_RDONLY);
+    if (fd == -1) {
+        return echouer(travail, "Morceau absent du dépôt");
+    }
+    char stocke[TAILLE_MAX_MORCEAU];
+    int taille_stockee = 0;
+    ssize_t n;
+    while (taille_stockee < morceau->longueur
+           && (n = read(fd, stocke + taille_stockee, morceau->longueur - taille_stockee)) > 0) {
+        taille_stockee += (int)n;
+    }
+    close(fd);
+
+    char contenu[TAILLE_MAX_MORCEAU];
+    if (taille_stockee == morceau->longueur) {
+        memcpy(contenu, stocke, taille_stockee);
+    } else if (decompresser_lz(stocke, taille_stockee, contenu, morceau->longueur) != morceau->longueur) {
+        return echouer(travail, "Morceau corrompu dans le dépôt");
+    }
+    calculer_sha256(contenu, morceau->longueur, empreinte);
+    if (memcmp(empreinte, morceau->empreinte, TAILLE_SHA256) != 0) {
+        return echouer(travail, "Morceau corrompu dans le dépôt");
+    }
+
+    memcpy(destination, contenu, morceau->longueur);
+    long dernier = (morceau->position + morceau->longueur - 1) / TAILLE_BLOC;
+    for (long b = morceau->position / TAILLE_BLOC; b <= dernier; b++) {
+        __atomic_store_n(&travail->blocs_modifies[b], 1, __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_add(&travail->nb_transferes, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&travail->octets_transferes, morceau->longueur, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&travail->octets_stockes, taille_stockee, __ATOMIC_RELAXED);
+    return 0;
+}
+
+/**
+ * Boucle d'un thread : prend les morceaux un par un jusqu'au dernier
+ * @param argument Le TravailDepot partagé
+ * @return NULL
+ */
+static void* traiter_morceaux(void* argument) {
+    TravailDepot* travail = argument;
+    int i;
+    while ((i = __atomic_fetch_add(&travail->suivant, 1, __ATOMIC_RELAXED)) < travail->nb_morceaux
+           && __atomic_load_n(&travail->message_erreur, __ATOMIC_RELAXED) == NULL) {
+        if (travail->restauration) {
+            recuperer_morceau(travail, &travail->morceaux[i]);
+        } else {
+            stocker_morceau(travail, &travail->morceaux[i]);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Répartit les morceaux entre NB_FILS_DEPOT threads et signale la
+ * première erreur rencontrée
+ * @param travail Le travail
+ * @return 0 si succès, -1 sinon
+ */
+static int executer_travail(TravailDepot* travail) {
+    pthread_t fils[NB_FILS_DEPOT];
+    int lance[NB_FILS_DEPOT];
+    for (int f = 0; f < NB_FILS_DEPOT; f++) {
+        lance[f] = pthread_create(&fils[f], NULL, traiter_morceaux, travail) == 0;
+    }
+    for (int f = 0; f < NB_FILS_DEPOT; f++) {
+        if (lance[f]) {
+            pthread_join(fils[f], NULL);
+        }
+    }
+    traiter_morceaux(travail);            // Au cas où aucun thread n'a pu démarrer
+    if (travail->message_erreur) {
+        erreur(travail->message_erreur);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Vérifie le chemin du dépôt et le nom d'un instantané
+ * @param depot Le répertoire du dépôt
+ * @param nom Le nom de l'instantané
+ * @return 0 si valides, -1 sinon
+ */
+static int valider_instantane(const char* depot, const char* nom) {
+    if (strlen(depot) > TAILLE_CHEMIN - 2 * TAILLE_HEXADECIMAL - MAX_NOM_FICHIER) {
+        erreur("Chemin du dépôt trop long");
+        return -1;
+    }
+    if (!valider_nom_fichier(nom) || nom[0] == '.') {
+        erreur("Nom d'instantané invalide");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Lit le manifeste d'un instantané
+ * @param depot Le répertoire du dépôt
+ * @param nom Le nom de l'instantané
+ * @param entete Reçoit l'en-tête
+ * @param morceaux Reçoit la liste des morceaux (à libérer), ou NULL pour l'en-tête seul
+ * @return 0 si succès, -1 sinon
+ */
+static int lire_manifeste(const char* depot, const char* nom, Instantane* entete, Morceau** morceaux) {
+    char chemin[TAILLE_CHEMIN];
+    snprintf(chemin, sizeof(chemin), "%s/instantanes/%s", depot, nom);
+    FILE* f = fopen(chemin, "r");
+    if (!f) {
+        erreur("Instantané introuvable");
+        return -1;
+    }
+
+    char signature[64] = "";
+    memset(entete, 0, sizeof(*entete));
+    snprintf(entete->nom, sizeof(entete->nom), "%s", nom);
+    if (!fgets(signature, sizeof(signature), f) || strncmp(signature, SIGNATURE_MANIFESTE, strlen(SIGNATURE_MANIFESTE)) != 0
+        || fscanf(f, " date %lld taille %ld morceaux %d", &entete->date, &entete->taille, &entete->nb_morceaux) != 3
+        || entete->taille < 0 || entete->nb_morceaux < 0
+        || entete->nb_morceaux > entete->taille / TAILLE_MIN_MORCEAU + 1) {
+        fclose(f);
+        erreur("Manifeste invalide");
+        return -1;
+    }
+    if (!morceaux) {
+        fclose(f);
+        return 0;
+    }
+
+    Morceau* liste = malloc((entete->nb_morceaux + 1) * sizeof(Morceau));
+    if (!liste) {
+        fclose(f);
+        erreur("Mémoire insuffisante");
+        return -1;
+    }
+    // Les morceaux doivent se suivre et couvrir exactement l'image
+    long position = 0;
+    for (int i = 0; i < entete->nb_morceaux; i++) {
+        char hexadecimal[TAILLE_HEXADECIMAL + 1];
+        if (fscanf(f, "%ld %d %65s", &liste[i].position, &liste[i].longueur, hexadecimal) != 3
+            || liste[i].position != position || liste[i].longueur <= 0
+            || liste[i].longueur > TAILLE_MAX_MORCEAU
+            || depuis_hexadecimal(hexadecimal, liste[i].empreinte) == -1) {
+            free(liste);
+            fclose(f);
+            erreur("Manifeste invalide");
+            return -1;
+        }
+        position += liste[i].longueur;
+    }
+    fclose(f);
+    if (position != entete->taille) {
+        free(liste);
+        erreur("Manifeste invalide");
+        return -1;
+    }
+    *morceaux = liste;
+    return 0;
+}
+
+/**
+ * Écrit le manifeste d'un instantané, sans jamais remplacer un manifeste existant
+ * @param depot Le répertoire du dépôt
+ * @param nom Le nom de l'instantané
+ * @param taille Taille de l'image
+ * @param morceaux Les morceaux
+ * @param nb_morceaux Leur nombre
+ * @return 0 si succès, -1 sinon
+ */
+static int ecrire_manifeste(const char* depot, const char* nom, size_t taille,
+                            const Morceau* morceaux, int nb_morceaux) {
+    char temporaire[TAILLE_CHEMIN];
+    char chemin[TAILLE_CHEMIN];
+    snprintf(temporaire, sizeof(temporaire), "%s/instantanes/.%s.%ld", depot, nom, (long)getpid());
+    snprintf(chemin, sizeof(chemin), "%s/instantanes/%s", depot, nom);
+    FILE* f = fopen(temporaire, "w");
+    if (!f) {
+        erreur("Impossible d'écrire le manifeste");
+        return -1;
+    }
+    fprintf(f, "%s\ndate %lld\ntaille %zu\nmorceaux %d\n", SIGNATURE_MANIFESTE,
+            (long long)time(NULL), taille, nb_morceaux);
+    for (int i = 0; i < nb_morceaux; i++) {
+        char hexadecimal[TAILLE_HEXADECIMAL];
+        en_hexadecimal(morceaux[i].empreinte, hexadecimal);
+        fprintf(f, "%ld %d %s\n", morceaux[i].position, morceaux[i].longueur, hexadecimal);
+    }
+    int echec = fflush(f) != 0 || fsync(fileno(f)) == -1;
+    echec |= fclose(f) != 0;
+
+    // link échoue si le nom est déjà pris, contrairement à rename
+    if (!echec && link(temporaire, chemin) == -1) {
+        unlink(temporaire);
+        erreur(errno == EEXIST ? "Un instantané de ce nom existe déjà" : "Impossible d'écrire le manifeste");
+        return -1;
+    }
+    unlink(temporaire);
+    if (echec) {
+        erreur("Impossible d'écrire le manifeste");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Enregistre une image dans le dépôt. Seuls les morceaux absents du dépôt
+ * sont écrits ; le dépôt est créé au besoin.
+ * @param depot Le répertoire du dépôt
+ * @param nom Le nom de l'instantané
+ * @param image L'image
+ * @param taille Sa taille
+ * @param bilan Reçoit le bilan de la sauvegarde
+ * @return 0 si succès, -1 sinon
+ */
+int ecrire_instantane(const char* depot, const char* nom, const char* image, size_t taille, BilanDepot* bilan) {
+    if (valider_instantane(depot, nom) == -1) {
+        return -1;
+    }
+    char chemin[TAILLE_CHEMIN];
+    int echec = creer_repertoire(depot) == -1;
+    snprintf(chemin, sizeof(chemin), "%s/morceaux", depot);
+    echec |= creer_repertoire(chemin) == -1;
+    snprintf(chemin, sizeof(chemin), "%s/instantanes", depot);
+    echec |= creer_repertoire(chemin) == -1;
+    if (echec) {
+        erreur("Impossible de créer le dépôt");
+        return -1;
+    }
+    snprintf(chemin, sizeof(chemin), "%s/instantanes/%s", depot, nom);
+    if (access(chemin, F_OK) == 0) {
+        erreur("Un instantané de ce nom existe déjà");
+        return -1;
+    }
+
+    Morceau* morceaux;
+    int nb_morceaux = decouper_image(image, taille, &morceaux);
+    if (nb_morceaux == -1) {
+        return -1;
+    }
+    TravailDepot travail = { .depot = depot, .image = (char*)image, .morceaux = morceaux,
+                             .nb_morceaux = nb_morceaux };
+    int resultat = executer_travail(&travail);
+    if (resultat == 0) {
+        resultat = ecrire_manifeste(depot, nom, taille, morceaux, nb_morceaux);
+    }
+    free(morceaux);
+
+    *bilan = (BilanDepot){ nb_morceaux, travail.nb_transferes, travail.octets_transferes, travail.octets_stockes };
+    return resultat;
+}
+
+/**
+ * Ramène une image à l'état d'un instantané. Seuls les morceaux dont le
+ * contenu diffère sont relus du dépôt.
+ * @param depot Le répertoire du dépôt
+ * @param nom Le nom de l'instantané
+ * @param image L'image actuelle, modifiée sur place
+ * @param taille Sa taille
+ * @param blocs_modifies Reçoit 1 pour chaque bloc de TAILLE_BLOC octets réécrit
+ * @param bilan Reçoit le bilan de la restauration
+ * @return 0 si succès, -1 sinon (l'image peut être partiellement restaurée)
+ */
+int relire_instantane(const char* depot, const char* nom, char* image, size_t taille,
+                      uint8_t* blocs_modifies, BilanDepot* bilan) {
+    if (valider_instantane(depot, nom) == -1) {
+        return -1;
+    }
+    Instantane entete;
+    Morceau* morceaux;
+    if (lire_manifeste(depot, nom, &entete, &morceaux) == -1) {
+        return -1;
+    }
+    if ((size_t)entete.taille != taille) {
+        free(morceaux);
+        erreur("L'instantané ne correspond pas à la taille de la partition");
+        return -1;
+    }
+
+    memset(blocs_modifies, 0, (taille + TAILLE_BLOC - 1) / TAILLE_BLOC);
+    TravailDepot travail = { .depot = depot, .image = image, .morceaux = morceaux,
+                             .nb_morceaux = entete.nb_morceaux, .restauration = 1,
+                             .blocs_modifies = blocs_modifies };
+    int resultat = executer_travail(&travail);
+    free(morceaux);
+
+    *bilan = (BilanDepot){ entete.nb_morceaux, travail.nb_transferes, travail.octets_transferes,
+                           travail.octets_stockes };
+    return resultat;
+}
+
+/**
+ * Compare deux instantanés par date puis par nom, pour qsort
+ */
+static int comparer_instantanes(const void* a, const void* b) {
+    const Instantane* x = a;
+    const Instantane* y = b;
+    if (x->date != y->date) {
+        return x->date < y->date ? -1 : 1;
+    }
+    return strcmp(x->nom, y->nom);
+}
+
+/**
+ * Charge les en-têtes de tous les instantanés du dépôt, du plus ancien au plus récent
+ * @param depot Le répertoire du dépôt
+ * @param instantanes Reçoit la liste (à libérer)
+ * @return Nombre d'instantanés, ou -1 en cas d'erreur
+ */
+static int charger_instantanes(const char* depot, Instantane** instantanes) {
+    if (strlen(depot) > TAILLE_CHEMIN - 2 * TAILLE_HEXADECIMAL - MAX_NOM_FICHIER) {
+        erreur("Chemin du dépôt trop long");
+        return -1;
+    }
+    char chemin[TAILLE_CHEMIN];
+    snprintf(chemin, sizeof(chemin), "%s/instantanes", depot);
+    DIR* repertoire = opendir(chemin);
+    if (!repertoire) {
+        erreur("Dépôt introuvable");
+        return -1;
+    }
+
+    Instantane* liste = NULL;
+    int nb = 0;
+    int capacite = 0;
+    struct dirent* entree;
+    while ((entree = readdir(repertoire)) != NULL) {
+        if (entree->d_name[0] == '.' || !valider_nom_fichier(entree->d_name)) {
+            continue;                     // Fichiers temporaires et noms étrangers
+        }
+        if (nb == capacite) {
+            capacite = capacite ? 2 * capacite : 16;
+            Instantane* agrandie = realloc(liste, capacite * sizeof(Instantane));
+            if (!agrandie) {
+                free(liste);
+                closedir(repertoire);
+                erreur("Mémoire insuffisante");
+                return -1;
+            }
+            liste = agrandie;
+        }
+        if (lire_manifeste(depot, entree->d_name, &liste[nb], NULL) == 0) {
+            nb++;
+        }
+    }
+    closedir(repertoire);
+    qsort(liste, nb, sizeof(Instantane), comparer_instantanes);
+    *instantanes = liste;
+    return nb;
+}
+
+/**
+ * Parcourt les morceaux stockés du dépôt
+ * @param depot Le répertoire du dépôt
+ * @param action Appelée pour chaque morceau : chemin, empreinte, taille stockée
+ * @param contexte Passé à action
+ * @return 0 si succès, -1 sinon
+ */
+static int parcourir_morceaux(const char* depot,
+                              void (*action)(const char*, const uint8_t*, long, void*), void* contexte) {
+    char chemin[TAILLE_CHEMIN];
+    snprintf(chemin, sizeof(chemin), "%s/morceaux", depot);
+    DIR* racine = opendir(chemin);
+    if (!racine) {
+        erreur("Dépôt introuvable");
+        return -1;
+    }
+    struct dirent* sous_repertoire;
+    while ((sous_repertoire = readdir(racine)) != NULL) {
+        if (strlen(sous_repertoire->d_name) != 2 || sous_repertoire->d_name[0] == '.') {
+            continue;
+        }
+        char chemin_sous_repertoire[TAILLE_CHEMIN];
+        snprintf(chemin_sous_repertoire, sizeof(chemin_sous_repertoire), "%s/morceaux/%s", depot,
+                 sous_repertoire->d_name);
+        DIR* repertoire = opendir(chemin_sous_repertoire);
+        if (!repertoire) {
+            continue;
+        }
+        struct dirent* entree;
+        while ((entree = readdir(repertoire)) != NULL) {
+            uint8_t empreinte[TAILLE_SHA256];
+            struct stat etat;
+            char chemin_morceau[TAILLE_CHEMIN];
+            if (depuis_hexadecimal(entree->d_name, empreinte) == -1) {
+                continue;                 // Fichiers temporaires
+            }
+            snprintf(chemin_morceau, sizeof(chemin_morceau), "%s/morceaux/%s/%s", depot,
+                     sous_repertoire->d_name, entree->d_name);
+            if (stat(chemin_morceau, &etat) == 0) {
+                action(chemin_morceau, empreinte, (long)etat.st_size, contexte);
+            }
+        }
+        closedir(repertoire);
+    }
+    closedir(racine);
+    return 0;
+}
+
+/**
+ * @struct ComptageMorceaux
+ * @brief Totaux du parcours des morceaux
+ */
+typedef struct {
+    int nb;
+    long octets;
+    const uint8_t* gardees;               // Élagage : empreintes référencées, triées
+    int nb_gardees;
+} ComptageMorceaux;
+
+/**
+ * Compte un morceau stocké
+ */
+static void compter_morceau(const char* chemin, const uint8_t* empreinte, long taille, void* contexte) {
+    (void)chemin;
+    (void)empreinte;
+    ComptageMorceaux* comptage = contexte;
+    comptage->nb++;
+    comptage->octets += taille;
+}
+
+/**
+ * Supprime un morceau qu'aucun instantané ne référence plus
+ */
+static void supprimer_morceau_orphelin(const char* chemin, const uint8_t* empreinte, long taille, void* contexte) {
+    ComptageMorceaux* comptage = contexte;
+    if (bsearch(empreinte, comptage->gardees, comptage->nb_gardees, TAILLE_SHA256, comparer_empreintes)) {
+        return;
+    }
+    if (unlink(chemin) == 0) {
+        comptage->nb++;
+        comptage->octets += taille;
+    }
+}
+
+/**
+ * Affiche les instantanés du dépôt et l'occupation des morceaux
+ * @param depot Le répertoire du dépôt
+ * @return 0 si succès, -1 sinon
+ */
+int lister_instantanes(const char* depot) {
+    Instantane* instantanes;
+    int nb = charger_instantanes(depot, &instantanes);
+    if (nb == -1) {
+        return -1;
+    }
+    ComptageMorceaux comptage = {0};
+    if (parcourir_morceaux(depot, compter_morceau, &comptage) == -1) {
+        free(instantanes);
+        return -1;
+    }
+
+    FILE* sortie = flux_sortie();
+    long octets_images = 0;
+    fprintf(sortie, "%-32s %-19s %12s %9s\n", "Instantané", "Date", "Taille", "Morceaux");
+    for (int i = 0; i < nb; i++) {
+        char date[32];
+        time_t t = (time_t)instantanes[i].date;
+        struct tm tm_info;
+        strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", localtime_r(&t, &tm_info));
+        fprintf(sortie, "%-32s %-19s %12ld %9d\n", instantanes[i].nom, date,
+                instantanes[i].taille, instantanes[i].nb_morceaux);
+        octets_images += instantanes[i].taille;
+    }
+    fprintf(sortie, "%d instantané(s), %d morceau(x) stocké(s) : %ld octets pour %ld octets d'images",
+            nb, comptage.nb, comptage.octets, octets_images);
+    if (comptage.octets > 0) {
+        fprintf(sortie, " (rapport %.1f)", (double)octets_images / comptage.octets);
+    }
+    fprintf(sortie, "\n");
+    free(instantanes);
+    return 0;
+}
+
+/**
+ * Supprime les instantanés les plus anciens puis les morceaux que plus
+ * aucun instantané ne référence
+ * @param depot Le répertoire du dépôt
+ * @param nb_gardes Nombre d'instantanés récents à garder
+ * @return 0 si succès, -1 sinon
+ */
+int elaguer_depot(const char* depot, int nb_gardes) {
+    if (nb_gardes < 0) {
+        erreur("Nombre d'instantanés à garder invalide");
+        return -1;
+    }
+    Instantane* instantanes;
+    int nb = charger_instantanes(depot, &instantanes);
+    if (nb == -1) {
+        return -1;
+    }
+
+    int nb_supprimes = 0;
+    char chemin[TAILLE_CHEMIN];
+    for (int i = 0; i < nb - nb_gardes; i++) {
+        snprintf(chemin, sizeof(chemin), "%s/instantanes/%s", depot, instantanes[i].nom);
+        if (unlink(chemin) == 0) {
+            nb_supprimes++;
+        }
+    }
+
+    // Empreintes des instantanés restants
+    uint8_t* gardees = NULL;
+    int nb_gardees = 0;
+    int echec = 0;
+    for (int i = nb > nb_gardes ? nb - nb_gardes : 0; i < nb && !echec; i++) {
+        Instantane entete;
+        Morceau* morceaux;
+        if (lire_manifeste(depot, instantanes[i].nom, &entete, &morceaux) == -1) {
+            echec = 1;                    // Sans ses empreintes, rien ne peut être supprimé
+            break;
+        }
+        uint8_t* agrandie = realloc(gardees, (size_t)(nb_gardees + entete.nb_morceaux) * TAILLE_SHA256 + 1);
+        if (!agrandie) {
+            free(morceaux);
+            erreur("Mémoire insuffisante");
+            echec = 1;
+            break;
+        }
+        gardees = agrandie;
+        for (int m = 0; m < entete.nb_morceaux; m++) {
+            memcpy(gardees + (size_t)(nb_gardees + m) * TAILLE_SHA256, morceaux[m].empreinte, TAILLE_SHA256);
+        }
+        nb_gardees += entete.nb_morceaux;
+        free(morceaux);
+    }
+    free(instantanes);
+    if (echec) {
+        free(gardees);
+        return -1;
+    }
+
+    qsort(gardees, nb_gardees, TAILLE_SHA256, comparer_empreintes);
+    ComptageMorceaux comptage = { .gardees = gardees, .nb_gardees = nb_gardees };
+    int resultat = parcourir_morceaux(depot, supprimer_morceau_orphelin, &comptage);
+    free(gardees);
+    if (resultat == 0) {
+        fprintf(flux_sortie(), "%d instantané(s) supprimé(s), %d gardé(s) ; %d morceau(x) supprimé(s), %ld octets libérés\n",
+                nb_supprimes, nb - nb_supprimes, comptage.nb, comptage.octets);
+    }
+    return resultat;
+}
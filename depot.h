@@ -0,0 +1,49 @@
+/**
+ * @file depot.h
+ * @brief Dépôt de sauvegardes dédupliquées : instantanés de la partition
+ *
+ * Un dépôt est un répertoire local :
+ *   - morceaux/xx/<empreinte> : un fichier par morceau distinct, nommé par
+ *     le SHA-256 de son contenu (xx : ses deux premiers chiffres) ;
+ *   - instantanes/<nom> : le manifeste d'un instantané, qui liste ses
+ *     morceaux (position, longueur, empreinte).
+ *
+ * L'image de la partition est découpée en morceaux de taille variable
+ * dont les frontières dépendent du contenu (hachage « gear » glissant sur
+ * les 64 derniers octets) : une modification ne déplace que les
+ * frontières voisines, et les morceaux inchangés d'un instantané à
+ * l'autre ne sont stockés qu'une fois. Un morceau est compressé (codec
+ * LZ de compression.h) quand il y gagne. Le hachage et les transferts
+ * sont répartis entre NB_FILS_DEPOT threads ; une restauration ne relit
+ * que les morceaux qui diffèrent de la partition.
+ */
+
+#ifndef DEPOT_H
+#define DEPOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TAILLE_MIN_MORCEAU 2048           // Aucune frontière avant
+#define BITS_MORCEAU_MOYEN 13             // Taille moyenne visée : 2^13 octets après le minimum
+#define TAILLE_MAX_MORCEAU 65536          // Frontière imposée
+#define NB_FILS_DEPOT 4                   // Threads de hachage et de transfert
+
+/**
+ * @struct BilanDepot
+ * @brief Résultat d'une sauvegarde ou d'une restauration
+ */
+typedef struct {
+    int nb_morceaux;                      // Morceaux de l'instantané
+    int nb_transferes;                    // Morceaux écrits dans le dépôt, ou relus
+    long octets_transferes;               // Octets de ces morceaux (avant compression)
+    long octets_stockes;                  // Octets écrits dans le dépôt (après compression)
+} BilanDepot;
+
+int ecrire_instantane(const char* depot, const char* nom, const char* image, size_t taille, BilanDepot* bilan);
+int relire_instantane(const char* depot, const char* nom, char* image, size_t taille,
+                      uint8_t* blocs_modifies, BilanDepot* bilan);
+int lister_instantanes(const char* depot);
+int elaguer_depot(const char* depot, int nb_gardes);
+
+#endif // DEPOT_H
@@ -1,4 +1,9 @@
+#define _GNU_SOURCE                       // O_DIRECT
+
+#include <fnmatch.h>
+
 #include "file_system.h"
+#include "trace.h"
 
 /**
  * Pourcentage d'implication : 
@@ -9,14 +14,6 @@
  * Implementation des fonctions utilisées
  */
 
-// Définitions des variables globales
-uint8_t bitmap[TAILLE_BITMAP];
-Inode inodes[NB_INODES];
-Superbloc superbloc;
-FILE* partition_file = NULL;
-int inode_courant = ID_INODE_RACINE;
-EntreeRepertoire entrees[MAX_ENTREES_DIR];
-
 /**
  * Valide un nom de fichier selon les règles du système
  * @param nom Le nom à valider
@@ -41,1769 +38,8066 @@ int valider_nom_fichier(const char* nom) {
     
     return 1;
 }
+
+/* Accès direct (O_DIRECT) pour les partitions ouvertes par la suite */
+static int acces_direct = 1;
+
 /**
- * Déplace le pointeur dans le fichier partition
- * @param f Le fichier
- * @param offset Décalage par rapport à 'base'
- * @param base Position de référence (SEEK_SET, SEEK_CUR, SEEK_END)
+ * Active ou désactive l'accès direct (O_DIRECT) des partitions ouvertes
+ * par la suite. Activé, il est abandonné de lui-même si le système de
+ * fichiers qui contient la partition le refuse.
+ * @param actif 1 pour l'activer, 0 pour passer par le cache du noyau
  */
-void mySeek(FILE *f, long offset, int base) {
-    if (fseek(f, offset, base) != 0) {
-        perror("Erreur de déplacement du pointeur");
-        exit(EXIT_FAILURE);
-    }
+void utiliser_acces_direct(int actif) {
+    acces_direct = actif;
 }
 
+/* Vérification des sommes des blocs de données pour les partitions
+   ouvertes par la suite (celles des métadonnées le sont toujours) */
+static int verification_donnees = 0;
+
 /**
- * Trouve et réserve un bloc libre dans le bitmap
- * @return Le numéro du bloc trouvé, ou -1 si aucun bloc libre
+ * Active ou désactive la vérification des sommes de contrôle des blocs
+ * de données lus, pour les partitions ouvertes par la suite
+ * @param actif 1 pour vérifier aussi les données, 0 pour les métadonnées seulement
  */
-int trouver_bloc_libre() {
-    for (int i = 0; i < NB_BLOCS; i++) {
-        if (!(bitmap[i / BITS_PAR_OCTET] & (1 << (i % BITS_PAR_OCTET)))) {
-            // Marquer le bloc comme utilisé
-            bitmap[i / BITS_PAR_OCTET] |= (1 << (i % BITS_PAR_OCTET));
-            superbloc.nb_blocs_libres--;
-            return i;
-        }
-    }
-    return -1; // Aucun bloc libre
+void utiliser_verification_donnees(int actif) {
+    verification_donnees = actif;
 }
 
+/* Déduplication au vidage pour les partitions ouvertes par la suite */
+static int deduplication = 0;
+
 /**
- * Libère un bloc et le marque comme libre dans le bitmap
- * @param num_bloc Le numéro du bloc à libérer
+ * Active ou désactive la déduplication des blocs écrits, pour les
+ * partitions ouvertes par la suite
+ * @param actif 1 pour partager les blocs identiques, 0 pour écrire chaque copie
  */
-void liberer_bloc(int num_bloc) {
-    if (num_bloc < 0 || num_bloc >= NB_BLOCS) {
-        erreur("Numéro de bloc invalide");
-        return;
-    }
-    
-    // Marquer le bloc comme libre
-    bitmap[num_bloc / BITS_PAR_OCTET] &= ~(1 << (num_bloc % BITS_PAR_OCTET));
-    superbloc.nb_blocs_libres++;
-    
-    // Effacer le contenu du bloc (optionnel)
-    char buffer[TAILLE_BLOC] = {0};
-    ecrire_bloc(num_bloc, buffer);
+void utiliser_deduplication(int actif) {
+    deduplication = actif;
 }
 
 /**
- * Trouve un inode libre dans la table
- * @return L'index de l'inode libre, ou -1 si aucun disponible
+ * Alloue une zone alignée pour l'accès direct
+ * @param taille Nombre d'octets
+ * @return La zone (à libérer par free), ou NULL si erreur
  */
-int trouver_inode_libre() {
-    for (int i = 0; i < NB_INODES; i++) {
-        if (inodes[i].taille == 0 && inodes[i].nb_liens == 0) {
-            superbloc.nb_inodes_libres--;
-            return i;
-        }
+static void* allouer_aligne(size_t taille) {
+    void* zone;
+    if (posix_memalign(&zone, ALIGNEMENT_DIRECT, taille) != 0) {
+        return NULL;
     }
-    return -1; // Aucun inode libre
+    return zone;
 }
 
 /**
- * Libère un inode en réinitialisant sa structure
- * @param num_inode Le numéro de l'inode à libérer
+ * Indique si un buffer peut être lu ou écrit en accès direct
+ * @param p Le buffer
+ * @return 1 s'il est aligné, 0 sinon
  */
-void liberer_inode(int num_inode) {
-    if (num_inode < 0 || num_inode >= NB_INODES) {
-        erreur("Numéro d'inode invalide");
-        return;
+static int est_aligne(const void* p) {
+    return (uintptr_t)p % ALIGNEMENT_DIRECT == 0;
+}
+
+/**
+ * Prête un buffer aligné de TAILLE_BLOC octets
+ * @param fs La partition
+ * @return Le buffer, ou NULL s'ils sont tous prêtés
+ */
+static char* prendre_tampon_aligne(SystemeFichiers* fs) {
+    char* tampon = NULL;
+    pthread_mutex_lock(&fs->verrou_tampons_alignes);
+    if (fs->nb_tampons_libres > 0) {
+        int n = fs->tampons_libres[--fs->nb_tampons_libres];
+        tampon = fs->tampons_alignes + (size_t)n * TAILLE_BLOC;
     }
+    pthread_mutex_unlock(&fs->verrou_tampons_alignes);
+    return tampon;
+}
 
-    
-    memset(&inodes[num_inode], 0, sizeof(Inode));
-    superbloc.nb_inodes_libres++;
+/**
+ * Rend un buffer prêté par prendre_tampon_aligne
+ * @param fs La partition
+ * @param tampon Le buffer
+ */
+static void rendre_tampon_aligne(SystemeFichiers* fs, char* tampon) {
+    pthread_mutex_lock(&fs->verrou_tampons_alignes);
+    fs->tampons_libres[fs->nb_tampons_libres++] = (tampon - fs->tampons_alignes) / TAILLE_BLOC;
+    pthread_mutex_unlock(&fs->verrou_tampons_alignes);
 }
 
 /**
- * Écrit des données dans un bloc de la partition
- * @param num_bloc Le numéro du bloc à écrire
- * @param donnees Les données à écrire (doivent faire TAILLE_BLOC octets)
+ * Lit ou écrit une zone en accès direct, sans passer par le cache du
+ * noyau. Un buffer non aligné passe bloc par bloc par un buffer aligné
+ * prêté.
+ * @param fs La partition
+ * @param ecriture 1 pour écrire la zone, 0 pour la lire
+ * @param donnees Les données
+ * @param taille Nombre d'octets
+ * @param offset Position dans la partition
+ * @return 0 si succès, -1 si l'accès direct n'a pas pu servir (zone non
+ *         alignée, refus du système de fichiers, aucun buffer aligné
+ *         libre) : la zone est alors à transférer par le cache du noyau
  */
-void ecrire_bloc(int num_bloc, void* donnees) {
-    if (num_bloc < 0 || num_bloc >= NB_BLOCS) {
-        erreur("Numéro de bloc invalide");
-        return;
+static int transferer_direct(SystemeFichiers* fs, int ecriture, void* donnees, size_t taille, off_t offset) {
+    if (fs->descripteur_direct == -1 || taille % ALIGNEMENT_DIRECT != 0 || offset % ALIGNEMENT_DIRECT != 0) {
+        return -1;
+    }
+    char* tampon = NULL;
+    if (!est_aligne(donnees) && (tampon = prendre_tampon_aligne(fs)) == NULL) {
+        return -1;
     }
-    long offset = TAILLE_BLOC * num_bloc;
-    mySeek(partition_file, offset, SEEK_SET);
 
-    if (fwrite(donnees, TAILLE_BLOC, 1, partition_file) != 1) {
-        erreur("Erreur d'écriture du bloc");
+    char* position = donnees;
+    int resultat = 0;
+    while (taille > 0 && resultat == 0) {
+        size_t morceau = tampon ? TAILLE_BLOC : taille;
+        char* buffer = tampon ? tampon : position;
+        if (ecriture && tampon) {
+            memcpy(tampon, position, morceau);
+        }
+        size_t fait = 0;
+        while (fait < morceau) {
+            ssize_t n = ecriture ? pwrite(fs->descripteur_direct, buffer + fait, morceau - fait, offset + fait)
+                                 : pread(fs->descripteur_direct, buffer + fait, morceau - fait, offset + fait);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            // Un transfert partiel non aligné ne peut pas être poursuivi
+            if (n <= 0 || n % ALIGNEMENT_DIRECT != 0) {
+                resultat = -1;
+                break;
+            }
+            fait += n;
+        }
+        if (resultat == 0 && !ecriture && tampon) {
+            memcpy(position, tampon, morceau);
+        }
+        position += morceau;
+        offset += morceau;
+        taille -= morceau;
     }
+    if (tampon) {
+        rendre_tampon_aligne(fs, tampon);
+    }
+    return resultat;
+}
 
-    // Mettre à jour la date de dernière modification du système
-    superbloc.derniere_modification = time(NULL);
+/**
+ * Lit une zone du fichier de partition. pread n'utilise pas de position
+ * partagée : plusieurs threads peuvent lire et écrire en même temps.
+ * @param fs La partition
+ * @param donnees Buffer de destination
+ * @param taille Nombre d'octets à lire
+ * @param offset Position dans la partition
+ * @return 0 si succès, -1 si erreur
+ */
+static int lire_disque(SystemeFichiers* fs, void* donnees, size_t taille, off_t offset) {
+    char* position = donnees;
+    __atomic_add_fetch(&fs->nb_lectures_disque, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&fs->octets_lus, taille, __ATOMIC_RELAXED);
+    if (transferer_direct(fs, 0, donnees, taille, offset) == 0) {
+        return 0;
+    }
+    while (taille > 0) {
+        ssize_t lus = pread(fs->descripteur, position, taille, offset);
+        if (lus < 0 && errno == EINTR) {
+            continue;
+        }
+        if (lus <= 0) {
+            return -1;
+        }
+        position += lus;
+        taille -= lus;
+        offset += lus;
+    }
+    return 0;
 }
 
+/**
+ * Cherche un bloc dans le cache de blocs. Si le thread de lecture
+ * anticipée doit le charger, attend qu'il l'ait fait plutôt que de le
+ * lire une seconde fois.
+ * @param fs La partition
+ * @param num_bloc Le bloc
+ * @param donnees Reçoit le contenu du bloc s'il est présent
+ * @return 1 si le bloc était dans le cache, 0 sinon
+ */
+static int chercher_bloc_cache(SystemeFichiers* fs, int num_bloc, void* donnees) {
+    pthread_mutex_lock(&fs->verrou_blocs);
+    while (fs->demandes_bloc[num_bloc] > 0) {
+        pthread_cond_wait(&fs->blocs_charges, &fs->verrou_blocs);
+    }
+    int c = fs->case_du_bloc[num_bloc];
+    if (c != -1) {
+        memcpy(donnees, fs->cache_blocs[c].donnees, TAILLE_BLOC);
+        fs->cache_blocs[c].reference = 1;
+        __atomic_add_fetch(&fs->nb_succes_cache_blocs, 1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&fs->verrou_blocs);
+    return c != -1;
+}
 
+/**
+ * Donne la génération d'un bloc, à relever avant de le lire sur le disque
+ * @param fs La partition
+ * @param num_bloc Le bloc
+ * @return La génération (voir ranger_bloc_cache)
+ */
+static uint32_t generation_bloc(SystemeFichiers* fs, int num_bloc) {
+    pthread_mutex_lock(&fs->verrou_blocs);
+    uint32_t generation = fs->generation_bloc[num_bloc];
+    pthread_mutex_unlock(&fs->verrou_blocs);
+    return generation;
+}
 
 /**
- * Lit des données depuis un bloc de la partition
- * @param num_bloc Le numéro du bloc à lire
- * @param donnees Buffer pour stocker les données lues
- * @return 0 en cas de succès, -1 en cas d'erreur
+ * Libère un emplacement du cache de blocs par l'algorithme de l'horloge
+ * (seconde chance), sans toucher aux emplacements en cours de chargement.
+ * L'appelant tient verrou_blocs.
+ * @param fs La partition
+ * @return L'emplacement (vide), ou -1 si tous sont en cours de chargement
  */
- int lire_bloc(int num_bloc, void* donnees) {
-    if (num_bloc < 0 || num_bloc >= NB_BLOCS) {
-        erreur("Numéro de bloc invalide");
-        return -1;
+static int liberer_case_bloc(SystemeFichiers* fs) {
+    for (int tour = 0; tour < 2 * NB_BLOCS_CACHE; tour++) {
+        int c = fs->aiguille_blocs;
+        fs->aiguille_blocs = (fs->aiguille_blocs + 1) % NB_BLOCS_CACHE;
+        CaseBloc* emplacement = &fs->cache_blocs[c];
+        if (emplacement->en_chargement) {
+            continue;
+        }
+        if (emplacement->reference) {
+            emplacement->reference = 0;
+            continue;
+        }
+        if (emplacement->bloc != -1) {
+            fs->case_du_bloc[emplacement->bloc] = -1;
+            emplacement->bloc = -1;
+        }
+        return c;
     }
+    return -1;
+}
 
-    long offset = TAILLE_BLOC * num_bloc;
-    fseek(partition_file, offset, SEEK_SET);
-    
-    if (fread(donnees, TAILLE_BLOC, 1, partition_file) != 1) {
-        erreur("Erreur de lecture du bloc");
-        return -1;
+/**
+ * Range dans le cache un bloc lu sur le disque. Si le bloc a été écrit
+ * depuis que sa génération a été relevée, la copie lue est peut-être
+ * périmée et n'est pas conservée.
+ * @param fs La partition
+ * @param num_bloc Le bloc
+ * @param donnees Le contenu lu
+ * @param generation La génération relevée avant la lecture
+ */
+static void ranger_bloc_cache(SystemeFichiers* fs, int num_bloc, const void* donnees, uint32_t generation) {
+    pthread_mutex_lock(&fs->verrou_blocs);
+    if (fs->generation_bloc[num_bloc] != generation) {
+        pthread_mutex_unlock(&fs->verrou_blocs);
+        return;
+    }
+    int c = fs->case_du_bloc[num_bloc];
+    if (c == -1) {
+        c = liberer_case_bloc(fs);
+        if (c == -1) {
+            pthread_mutex_unlock(&fs->verrou_blocs);
+            return;
+        }
+        fs->cache_blocs[c].bloc = num_bloc;
+        fs->case_du_bloc[num_bloc] = c;
     }
+    memcpy(fs->cache_blocs[c].donnees, donnees, TAILLE_BLOC);
+    fs->cache_blocs[c].reference = 1;
+    pthread_mutex_unlock(&fs->verrou_blocs);
+}
 
-    return 0;  // Succès
+/**
+ * Retire du cache les blocs d'une zone qui vient d'être écrite sur le
+ * disque, et change leur génération pour écarter les lectures en cours
+ * @param fs La partition
+ * @param offset Début de la zone écrite
+ * @param taille Taille de la zone écrite
+ */
+static void invalider_blocs_cache(SystemeFichiers* fs, off_t offset, size_t taille) {
+    if (taille == 0) {
+        return;
+    }
+    long premier = offset / TAILLE_BLOC;
+    long dernier = (offset + taille - 1) / TAILLE_BLOC;
+    pthread_mutex_lock(&fs->verrou_blocs);
+    for (long bloc = premier; bloc <= dernier && bloc < NB_BLOCS; bloc++) {
+        fs->generation_bloc[bloc]++;
+        int c = fs->case_du_bloc[bloc];
+        if (c != -1) {
+            fs->cache_blocs[c].bloc = -1;
+            fs->cache_blocs[c].reference = 0;
+            fs->case_du_bloc[bloc] = -1;
+        }
+    }
+    pthread_mutex_unlock(&fs->verrou_blocs);
 }
 
+/* Relectures d'un bloc dont la somme ne correspond pas avant de le
+   déclarer corrompu */
+#define NB_RELECTURES_SOMME 3
 
 /**
- * Affiche un message d'erreur sur stderr
- * @param message Le message d'erreur à afficher
+ * Indique si un bloc appartient à la table des sommes (qui n'a pas de somme)
+ * @param fs La partition
+ * @param bloc Le bloc
+ * @return 1 si oui, 0 sinon
  */
-void erreur(const char* message) {
-    fprintf(stderr, "Erreur: %s\n", message);
+static int bloc_table_sommes(const SystemeFichiers* fs, long bloc) {
+    return fs->bloc_sommes != -1 && bloc >= fs->bloc_sommes && bloc < fs->bloc_sommes + NB_BLOCS_SOMMES;
 }
 
 /**
- * Crée un nouveau fichier ou répertoire
- * @param nom Le nom du nouveau fichier
- * @param type TYPE_FICHIER ou TYPE_REPERTOIRE
- * @return L'identifiant de l'inode créé, ou -1 en cas d'erreur
+ * Met à jour les sommes des blocs d'une zone qui vient d'être écrite sur
+ * le disque. Un bloc écrit en entier reçoit la somme de son nouveau
+ * contenu ; un bloc écrit en partie (superbloc, bitmap) est noté périmé
+ * et sa somme est recalculée à la sauvegarde suivante.
+ * @param fs La partition
+ * @param donnees Les données écrites
+ * @param taille Taille de la zone
+ * @param offset Début de la zone
  */
-int creer_fichier(const char* nom, int type) {
-    // Vérifier la longueur du nom
-    if (strlen(nom) > MAX_NOM_FICHIER) {
-        erreur("Nom de fichier trop long");
-        return -1;
+static void noter_ecriture(SystemeFichiers* fs, const void* donnees, size_t taille, off_t offset) {
+    if (fs->bloc_sommes == -1 || taille == 0) {
+        return;
     }
-    
-    // Vérifier si un fichier du même nom existe déjà
-    if (trouver_inode_par_nom(inode_courant, nom) != -1) {
-        erreur("Un fichier avec ce nom existe déjà");
-        return -1;
+    long premier = offset / TAILLE_BLOC;
+    long dernier = (offset + taille - 1) / TAILLE_BLOC;
+    for (long bloc = premier; bloc <= dernier && bloc < NB_BLOCS; bloc++) {
+        off_t debut = (off_t)bloc * TAILLE_BLOC;
+        if (bloc_table_sommes(fs, bloc)) {
+            continue;
+        }
+        if (debut >= offset && debut + TAILLE_BLOC <= offset + (off_t)taille) {
+            uint32_t somme = calculer_crc32c((const char*)donnees + (debut - offset), TAILLE_BLOC);
+            __atomic_store_n(&fs->sommes[bloc], somme, __ATOMIC_RELAXED);
+            __atomic_store_n(&fs->somme_perimee[bloc], 0, __ATOMIC_RELAXED);
+        } else {
+            __atomic_store_n(&fs->somme_perimee[bloc], 1, __ATOMIC_RELAXED);
+        }
     }
-    
-    // Trouver un inode libre
-    int inode_id = trouver_inode_libre();
-    if (inode_id == -1) {
-        erreur("Aucun inode libre");
-        return -1;
+}
+
+/**
+ * Indique si le contenu d'un bloc correspond à sa somme. Un bloc sans
+ * somme à jour (table des sommes, bloc écrit en partie) est accepté.
+ * @param fs La partition
+ * @param num_bloc Le bloc
+ * @param donnees Le contenu lu
+ * @return 1 si le contenu est intact, 0 sinon
+ */
+static int somme_correcte(SystemeFichiers* fs, int num_bloc, const void* donnees) {
+    if (fs->bloc_sommes == -1 || bloc_table_sommes(fs, num_bloc)
+            || __atomic_load_n(&fs->somme_perimee[num_bloc], __ATOMIC_RELAXED)) {
+        return 1;
     }
-    
-    // Initialiser l'inode
-    Inode* new_inode = &inodes[inode_id];
-    memset(new_inode, 0, sizeof(Inode));
-    
-    new_inode->type = type;
-    new_inode->date_creation = time(NULL);
-    new_inode->date_modification = time(NULL);
-    new_inode->date_acces = time(NULL);
-    new_inode->nb_liens = 1;
-    new_inode->proprietaire = getuid();
-    new_inode->groupe = getgid();
-    
-    // Définir les droits par défaut
-    if (type == TYPE_REPERTOIRE) {
-        new_inode->droits = 0755;  // rwxr-xr-x
-        new_inode->taille = TAILLE_BLOC; // Taille initiale d'un répertoire
-        
-        // Allouer un bloc pour le répertoire
-        int bloc = trouver_bloc_libre();
-        if (bloc == -1) {
-            liberer_inode(inode_id);
-            erreur("Aucun bloc libre");
+    __atomic_add_fetch(&fs->nb_sommes_verifiees, 1, __ATOMIC_RELAXED);
+    return calculer_crc32c(donnees, TAILLE_BLOC) == __atomic_load_n(&fs->sommes[num_bloc], __ATOMIC_RELAXED);
+}
+
+/**
+ * Vérifie la somme d'un bloc qui vient d'être lu sur le disque. Une
+ * écriture concurrente du même bloc (bloc de fragments partagé) peut
+ * séparer un instant le contenu de sa somme : le bloc est relu quelques
+ * fois avant d'être déclaré corrompu.
+ * @param fs La partition
+ * @param num_bloc Le bloc
+ * @param donnees Le contenu lu (relu en place au besoin)
+ * @return 0 si le bloc est intact, -1 s'il est corrompu ou illisible
+ */
+static int controler_bloc_lu(SystemeFichiers* fs, int num_bloc, void* donnees) {
+    for (int essai = 0; !somme_correcte(fs, num_bloc, donnees); essai++) {
+        if (essai == NB_RELECTURES_SOMME) {
+            __atomic_add_fetch(&fs->nb_blocs_corrompus, 1, __ATOMIC_RELAXED);
+            char message[96];
+            snprintf(message, sizeof(message), "Bloc %d corrompu (somme de contrôle incorrecte)", num_bloc);
+            erreur(message);
             return -1;
         }
-        new_inode->blocs_directs[0] = bloc;
-        
-        // Initialiser le contenu du répertoire
-        EntreeRepertoire entrees[MAX_ENTREES_DIR] = {0};
-        
-        // Ajouter les entrées "." et ".."
-        strcpy(entrees[0].nom, ".");
-        entrees[0].inode = inode_id;
-        
-        strcpy(entrees[1].nom, "..");
-        entrees[1].inode = inode_courant;
-        
-        // Écrire les entrées dans le bloc
-        ecrire_bloc(bloc, entrees);
-    } else {
-        new_inode->droits = 0644;  // rw-r--r--
-        new_inode->taille = 0;     // Taille initiale d'un fichier
-    }
-    
-    // Copier le nom
-    strncpy(new_inode->nom, nom, MAX_NOM_FICHIER);
-    
-    // Ajouter l'entrée au répertoire courant
-    if (ajouter_entree_repertoire(inode_courant, nom, inode_id) == -1) {
-        // Libérer les ressources en cas d'échec
-        if (type == TYPE_REPERTOIRE) {
-            liberer_bloc(new_inode->blocs_directs[0]);
+        if (lire_disque(fs, donnees, TAILLE_BLOC, (off_t)num_bloc * TAILLE_BLOC) == -1) {
+            erreur("Erreur de lecture du bloc");
+            return -1;
         }
-        liberer_inode(inode_id);
-        return -1;
     }
-    
-    // Mettre à jour la dernière modification du répertoire parent
-    inodes[inode_courant].date_modification = time(NULL);
-    
-    return inode_id;
+    return 0;
 }
 
 /**
- * Ajoute une entrée dans un répertoire
- * @param inode_dir L'inode du répertoire parent
- * @param nom Le nom de la nouvelle entrée
- * @param inode L'inode à associer
- * @return 0 en cas de succès, -1 sinon
+ * Écrit une zone du fichier de partition (pwrite)
+ * @param fs La partition
+ * @param donnees Les données à écrire
+ * @param taille Nombre d'octets à écrire
+ * @param offset Position dans la partition
+ * @return 0 si succès, -1 si erreur
  */
-int ajouter_entree_repertoire(int inode_dir, const char* nom, int inode) {
-    // Vérifier que l'inode du répertoire est valide
-    if (inode_dir < 0 || inode_dir >= NB_INODES || inodes[inode_dir].type != TYPE_REPERTOIRE) {
-        erreur("L'inode n'est pas un répertoire ou l'inode est invalide");
-        return -1;
+static int ecrire_disque(SystemeFichiers* fs, const void* donnees, size_t taille, off_t offset) {
+    const char* position = donnees;
+    int resultat = 0;
+    __atomic_add_fetch(&fs->nb_ecritures_disque, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&fs->octets_ecrits, taille, __ATOMIC_RELAXED);
+    off_t debut = offset;
+    size_t total = taille;
+    if (transferer_direct(fs, 1, (void*)donnees, taille, offset) == 0) {
+        taille = 0;
     }
-
-    // Vérifier que le nom n'est pas trop long
-    if (strlen(nom) > MAX_NOM_FICHIER) {
-        erreur("Nom de fichier trop long");
-        return -1;
+    while (taille > 0) {
+        ssize_t ecrits = pwrite(fs->descripteur, position, taille, offset);
+        if (ecrits < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ecrits <= 0) {
+            resultat = -1;
+            break;
+        }
+        position += ecrits;
+        taille -= ecrits;
+        offset += ecrits;
     }
+    // Même en cas d'échec, une partie de la zone a pu changer
+    noter_ecriture(fs, donnees, total, debut);
+    invalider_blocs_cache(fs, debut, total);
+    return resultat;
+}
 
-    // Vérifier que l'inode à ajouter est valide
-    if (inode < 0 || inode >= NB_INODES) {
-        erreur("Numéro d'inode invalide");
-        return -1;
+/**
+ * Exécute un lot de requêtes sur la partition avec le moteur
+ * d'entrées-sorties, puis termine une par une les requêtes qui n'ont
+ * transféré qu'une partie de leur zone. Les zones écrites sont retirées
+ * du cache de blocs.
+ * @param fs La partition
+ * @param requetes Les requêtes
+ * @param nb Nombre de requêtes
+ * @return 0 si succès, -1 si erreur
+ */
+static int executer_lot_es(SystemeFichiers* fs, RequeteES* requetes, int nb) {
+    if (nb == 0) {
+        return 0;
     }
+    __atomic_add_fetch(&fs->nb_lots_es, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&fs->nb_requetes_es, nb, __ATOMIC_RELAXED);
+    executer_requetes(fs->moteur_es, requetes, nb);
 
-    // Vérifier si un bloc existe déjà pour le répertoire
-    if (inodes[inode_dir].blocs_directs[0] == 0) {
-        // Allouer un premier bloc uniquement pour les répertoires
-        if (inodes[inode_dir].type == TYPE_REPERTOIRE) {
-            int nouveau_bloc = trouver_bloc_libre();
-            if (nouveau_bloc == -1) {
-                erreur("Impossible d'allouer un bloc pour le répertoire");
-                return -1;
+    int resultat = 0;
+    for (int i = 0; i < nb; i++) {
+        RequeteES* r = &requetes[i];
+        size_t fait = r->resultat > 0 ? r->resultat : 0;
+        size_t transferes = fait;
+        size_t total = 0;
+        for (int v = 0; v < r->nb_vecteurs; v++) {
+            char* base = r->vecteurs[v].iov_base;
+            size_t longueur = r->vecteurs[v].iov_len;
+            off_t offset = r->offset + total;
+            total += longueur;
+            if (fait >= longueur) {
+                if (r->ecriture) {
+                    noter_ecriture(fs, base, longueur, offset);
+                }
+                fait -= longueur;
+                continue;
             }
-            inodes[inode_dir].blocs_directs[0] = nouveau_bloc;
+            // Requête incomplète : terminer ce buffer et les suivants
+            if (r->ecriture) {
+                noter_ecriture(fs, base, fait, offset);
+            }
+            if ((r->ecriture ? ecrire_disque(fs, base + fait, longueur - fait, offset + fait)
+                             : lire_disque(fs, base + fait, longueur - fait, offset + fait)) == -1) {
+                resultat = -1;
+            }
+            fait = 0;
+        }
+        // Seuls les octets transférés par le moteur : la fin d'une requête
+        // incomplète est déjà comptée par lire_disque ou ecrire_disque
+        if (r->ecriture) {
+            __atomic_add_fetch(&fs->nb_ecritures_disque, 1, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&fs->octets_ecrits, transferes, __ATOMIC_RELAXED);
+            invalider_blocs_cache(fs, r->offset, total);
         } else {
-            // Pour les fichiers (y compris les liens), ne pas allouer de bloc
-            erreur("Impossible d'ajouter une entrée à un fichier sans bloc");
-            return -1;
+            __atomic_add_fetch(&fs->nb_lectures_disque, 1, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&fs->octets_lus, transferes, __ATOMIC_RELAXED);
         }
     }
+    return resultat;
+}
 
-    // Lire le contenu du répertoire
-    EntreeRepertoire entrees[MAX_ENTREES_DIR];
-    lire_bloc(inodes[inode_dir].blocs_directs[0], entrees);
-
-    // Vérifier si le nom existe déjà
-    for (int i = 0; i < MAX_ENTREES_DIR; i++) {
-        if (strcmp(entrees[i].nom, nom) == 0) {
-            erreur("Une entrée avec ce nom existe déjà");
-            return -1;
-        }
+/**
+ * Lit ou écrit une zone contiguë de la partition. Une grande zone est
+ * découpée en requêtes de TAILLE_REQUETE_ES octets exécutées en même temps.
+ * @param fs La partition
+ * @param ecriture 1 pour écrire la zone, 0 pour la lire
+ * @param donnees Les données
+ * @param taille Nombre d'octets
+ * @param offset Position dans la partition
+ * @return 0 si succès, -1 si erreur
+ */
+static int transferer_zone(SystemeFichiers* fs, int ecriture, void* donnees, size_t taille, off_t offset) {
+    if (taille <= TAILLE_REQUETE_ES) {
+        return ecriture ? ecrire_disque(fs, donnees, taille, offset)
+                        : lire_disque(fs, donnees, taille, offset);
     }
 
-    // Trouver une entrée libre
-    int index = -1;
-    for (int i = 0; i < MAX_ENTREES_DIR; i++) {
-        if (entrees[i].nom[0] == '\0') {
-            index = i;
-            break;
+    struct iovec vecteurs[PROFONDEUR_ES];
+    RequeteES requetes[PROFONDEUR_ES];
+    char* position = donnees;
+    int resultat = 0;
+    while (taille > 0) {
+        int nb = 0;
+        while (taille > 0 && nb < PROFONDEUR_ES) {
+            size_t morceau = taille < TAILLE_REQUETE_ES ? taille : TAILLE_REQUETE_ES;
+            vecteurs[nb].iov_base = position;
+            vecteurs[nb].iov_len = morceau;
+            requetes[nb] = (RequeteES){ ecriture, &vecteurs[nb], 1, offset, 0 };
+            position += morceau;
+            offset += morceau;
+            taille -= morceau;
+            nb++;
+        }
+        if (executer_lot_es(fs, requetes, nb) == -1) {
+            resultat = -1;
         }
     }
+    return resultat;
+}
 
-    if (index == -1) {
-        erreur("Répertoire plein");
-        return -1;
-    }
-
-    // Ajouter la nouvelle entrée
-    strncpy(entrees[index].nom, nom, MAX_NOM_FICHIER);
-    entrees[index].nom[MAX_NOM_FICHIER] = '\0';  // Assurer la terminaison
-    entrees[index].inode = inode;
+/**
+ * Lit une zone de la partition pendant une transaction : les blocs déjà
+ * modifiés par la transaction sont lus dans leur copie en mémoire
+ * @param fs La partition
+ * @param donnees Buffer de destination
+ * @param taille Nombre d'octets à lire
+ * @param offset Position dans la partition
+ * @return 0 si succès, -1 si erreur
+ */
+static int lire_ombre(SystemeFichiers* fs, void* donnees, size_t taille, off_t offset) {
+    char* position = donnees;
+    int resultat = 0;
 
-    // Écrire les modifications uniquement pour les répertoires
-    if (inodes[inode_dir].type == TYPE_REPERTOIRE) {
-        ecrire_bloc(inodes[inode_dir].blocs_directs[0], entrees);
-    }
+    pthread_mutex_lock(&fs->verrou_transaction);
+    while (taille > 0 && resultat == 0) {
+        long bloc = offset / TAILLE_BLOC;
+        size_t decalage = offset % TAILLE_BLOC;
+        size_t morceau = TAILLE_BLOC - decalage < taille ? TAILLE_BLOC - decalage : taille;
 
-    // Mise à jour de l'inode du répertoire
-    if (inodes[inode_dir].type == TYPE_REPERTOIRE) {
-        //inodes[inode_dir].taille = (index + 1) * sizeof(EntreeRepertoire);
-        inodes[inode_dir].date_modification = time(NULL);
+        if (bloc < NB_BLOCS && fs->blocs_ombre[bloc] != NULL) {
+            memcpy(position, fs->blocs_ombre[bloc] + decalage, morceau);
+        } else {
+            resultat = lire_disque(fs, position, morceau, offset);
+        }
+        position += morceau;
+        taille -= morceau;
+        offset += morceau;
     }
+    pthread_mutex_unlock(&fs->verrou_transaction);
 
-    return 0;
+    return resultat;
 }
 
 /**
- * Cherche un inode par son nom dans un répertoire
- * @param inode_dir L'inode du répertoire où chercher
- * @param nom Le nom du fichier/dossier à trouver
- * @return L'identifiant de l'inode trouvé ou -1 si non trouvé/erreur
+ * Écrit une zone de la partition pendant une transaction : les blocs
+ * touchés sont copiés en mémoire et ne seront écrits qu'à la validation
+ * @param fs La partition
+ * @param donnees Les données à écrire
+ * @param taille Nombre d'octets à écrire
+ * @param offset Position dans la partition
+ * @return 0 si succès, -1 si erreur
  */
-int trouver_inode_par_nom(int inode_dir, const char* nom) {
-    // Vérification de la validité de l'inode
-    if (inode_dir < 0 || inode_dir >= NB_INODES) {
-        erreur("Inode invalide");
-        return -1;
-    }
-    
-    // Vérification que l'inode est bien un répertoire
-    if (inodes[inode_dir].type != TYPE_REPERTOIRE) {
-        erreur("L'inode n'est pas un répertoire");
-        return -1;
-    }
-    
-    // Lecture du contenu du répertoire depuis le premier bloc direct
-    EntreeRepertoire entrees[MAX_ENTREES_DIR];
-    lire_bloc(inodes[inode_dir].blocs_directs[0], entrees);
-    
-    // Parcours des entrées du répertoire
-    for (int i = 0; i < MAX_ENTREES_DIR; i++) {
-        // Comparaison des noms et vérification que l'entrée est utilisée
-        if (strcmp(entrees[i].nom, nom) == 0 && entrees[i].inode != 0) {
-            return entrees[i].inode; // Retourne l'inode si trouvé
+static int ecrire_ombre(SystemeFichiers* fs, const void* donnees, size_t taille, off_t offset) {
+    const char* position = donnees;
+
+    pthread_mutex_lock(&fs->verrou_transaction);
+    while (taille > 0) {
+        long bloc = offset / TAILLE_BLOC;
+        size_t decalage = offset % TAILLE_BLOC;
+        size_t morceau = TAILLE_BLOC - decalage < taille ? TAILLE_BLOC - decalage : taille;
+        if (bloc >= NB_BLOCS) {
+            pthread_mutex_unlock(&fs->verrou_transaction);
+            return -1;
+        }
+
+        char* copie = fs->blocs_ombre[bloc];
+        if (copie == NULL) {
+            // Un bloc écrit en partie garde le reste de son contenu
+            copie = allouer_aligne(TAILLE_BLOC);
+            if (copie == NULL || (morceau < TAILLE_BLOC
+                    && lire_disque(fs, copie, TAILLE_BLOC, (off_t)bloc * TAILLE_BLOC) == -1)) {
+                free(copie);
+                pthread_mutex_unlock(&fs->verrou_transaction);
+                return -1;
+            }
+            fs->blocs_ombre[bloc] = copie;
+            fs->nb_blocs_ombre++;
         }
+        memcpy(copie + decalage, position, morceau);
+        position += morceau;
+        taille -= morceau;
+        offset += morceau;
     }
-    
-    return -1; // Retourne -1 si non trouvé
+    pthread_mutex_unlock(&fs->verrou_transaction);
+
+    return 0;
 }
 
 /**
- * Supprime une entrée dans un répertoire
- * @param inode_dir L'inode du répertoire
- * @param nom Le nom de l'entrée à supprimer
+ * Lit une zone de la partition
+ * @param fs La partition
+ * @param donnees Buffer de destination
+ * @param taille Nombre d'octets à lire
+ * @param offset Position dans la partition
  * @return 0 si succès, -1 si erreur
  */
-int supprimer_entree_repertoire(int inode_dir, const char* nom) {
-    // Vérification que l'inode est bien un répertoire
-    if (inodes[inode_dir].type != TYPE_REPERTOIRE) {
-        erreur("L'inode n'est pas un répertoire");
-        return -1;
+int lire_partition(SystemeFichiers* fs, void* donnees, size_t taille, off_t offset) {
+    // La transaction ne s'ouvre et ne se ferme que sous le verrou global
+    // exclusif : aucune lecture n'est en cours quand l'indicateur change
+    if (fs->session_transaction != NULL) {
+        return lire_ombre(fs, donnees, taille, offset);
     }
-    
-    // Lecture du contenu du répertoire
-    EntreeRepertoire entrees[MAX_ENTREES_DIR];
-    lire_bloc(inodes[inode_dir].blocs_directs[0], entrees);
-    
-    // Recherche de l'entrée à supprimer
-    for (int i = 0; i < MAX_ENTREES_DIR; i++) {
-        if (strcmp(entrees[i].nom, nom) == 0) {
-            // Effacement de l'entrée
-            memset(&entrees[i], 0, sizeof(EntreeRepertoire));
-            
-            // Réécriture du bloc modifié
-            ecrire_bloc(inodes[inode_dir].blocs_directs[0], entrees);
-            
-            // Mise à jour de la date de modification
-            inodes[inode_dir].date_modification = time(NULL);
-            
-            return 0; // Succès
+    return transferer_zone(fs, 0, donnees, taille, offset);
+}
+
+/**
+ * Écrit une zone de la partition
+ * @param fs La partition
+ * @param donnees Les données à écrire
+ * @param taille Nombre d'octets à écrire
+ * @param offset Position dans la partition
+ * @return 0 si succès, -1 si erreur
+ */
+int ecrire_partition(SystemeFichiers* fs, const void* donnees, size_t taille, off_t offset) {
+    if (fs->session_transaction != NULL) {
+        return ecrire_ombre(fs, donnees, taille, offset);
+    }
+    return transferer_zone(fs, 1, (void*)donnees, taille, offset);
+}
+
+/**
+ * Trouve et réserve un bloc libre dans le bitmap
+ * @return Le numéro du bloc trouvé, ou -1 si aucun bloc libre
+ */
+int trouver_bloc_libre(SystemeFichiers* fs) {
+    pthread_mutex_lock(&fs->verrou_allocation);
+    for (int i = 0; i < NB_BLOCS; i++) {
+        if (!(fs->bitmap[i / BITS_PAR_OCTET] & (1 << (i % BITS_PAR_OCTET)))) {
+            // Marquer le bloc comme utilisé
+            fs->bitmap[i / BITS_PAR_OCTET] |= (1 << (i % BITS_PAR_OCTET));
+            fs->superbloc.nb_blocs_libres--;
+            pthread_mutex_unlock(&fs->verrou_allocation);
+            return i;
         }
     }
-    
-    erreur("Entrée non trouvée");
-    return -1; // Erreur si entrée non trouvée
+    pthread_mutex_unlock(&fs->verrou_allocation);
+    return -1; // Aucun bloc libre
 }
 
 /**
- * Supprime un fichier ou un répertoire vide
- * @param nom Le nom du fichier/dossier à supprimer
- * @return 0 si succès, -1 si erreur
+ * Vide l'index des blocs dédupliqués
+ * @param fs La partition
  */
-int supprimer_fichier(const char* nom) {
-    // Validation du nom de fichier
-    if (!valider_nom_fichier(nom)) {
-        erreur("Nom de fichier invalide");
-        return -1;
+static void vider_index_dedup(SystemeFichiers* fs) {
+    for (int i = 0; i < NB_SEAUX_DEDUP; i++) {
+        fs->index_dedup.seaux[i] = -1;
     }
-    
-    // Recherche de l'inode correspondant au nom
-    int inode_id = trouver_inode_par_nom(inode_courant, nom);
-    if (inode_id == -1) {
-        erreur("Fichier non trouvé");
-        return -1;
+    fs->index_dedup.nb_entrees = 0;
+}
+
+/**
+ * Ajoute un bloc à l'index des blocs dédupliqués.
+ * L'appelant tient le verrou d'allocation.
+ * @param num_bloc Le bloc
+ * @param somme Le CRC32C de son contenu
+ */
+static void indexer_bloc(SystemeFichiers* fs, int num_bloc, uint32_t somme) {
+    IndexDedup* index = &fs->index_dedup;
+    int seau = somme & (NB_SEAUX_DEDUP - 1);
+    index->cles[num_bloc] = somme;
+    index->suivants[num_bloc] = index->seaux[seau];
+    index->seaux[seau] = num_bloc;
+    index->nb_entrees++;
+}
+
+/**
+ * Retire un bloc de l'index des blocs dédupliqués.
+ * L'appelant tient le verrou d'allocation.
+ * @param num_bloc Le bloc
+ */
+static void desindexer_bloc(SystemeFichiers* fs, int num_bloc) {
+    IndexDedup* index = &fs->index_dedup;
+    int* lien = &index->seaux[index->cles[num_bloc] & (NB_SEAUX_DEDUP - 1)];
+    while (*lien != -1 && *lien != num_bloc) {
+        lien = &index->suivants[*lien];
+    }
+    if (*lien == num_bloc) {
+        *lien = index->suivants[num_bloc];
+        index->nb_entrees--;
+    }
+}
+
+/**
+ * Libère un bloc et le marque comme libre dans le bitmap. Un bloc
+ * dédupliqué perd seulement une référence, sauf la dernière.
+ * @param num_bloc Le numéro du bloc à libérer
+ */
+void liberer_bloc(SystemeFichiers* fs, int num_bloc) {
+    if (num_bloc < 0 || num_bloc >= NB_BLOCS) {
+        erreur("Numéro de bloc invalide");
+        return;
     }
     
-    // Vérification des droits d'écriture
-    if (!verifier_droits(inode_id, DROIT_ECRITURE)) {
-        erreur("Permission refusée");
-        return -1;
+    pthread_mutex_lock(&fs->verrou_allocation);
+    if (fs->references[num_bloc] > 1) {
+        fs->references[num_bloc]--;
+        pthread_mutex_unlock(&fs->verrou_allocation);
+        return;
     }
+    if (fs->references[num_bloc] == 1) {
+        fs->references[num_bloc] = 0;
+        desindexer_bloc(fs, num_bloc);
+    }
+    pthread_mutex_unlock(&fs->verrou_allocation);
     
-    Inode* inode = &inodes[inode_id];
+    // Effacer le contenu du bloc avant de le rendre : une fois libre, il
+    // peut être alloué et écrit par un autre thread
+    char buffer[TAILLE_BLOC] = {0};
+    ecrire_bloc(fs, num_bloc, buffer);
     
-    // Traitement spécial pour les répertoires
-    if (inode->type == TYPE_REPERTOIRE) {
-        EntreeRepertoire entrees[MAX_ENTREES_DIR];
-        lire_bloc(inode->blocs_directs[0], entrees);
-        
-        // Comptage des entrées non vides (hors . et ..)
-        int nb_entrees = 0;
-        for (int i = 0; i < MAX_ENTREES_DIR; i++) {
-            if (entrees[i].nom[0] != '\0' && 
-                strcmp(entrees[i].nom, ".") != 0 && 
-                strcmp(entrees[i].nom, "..") != 0) {
-                nb_entrees++;
-            }
+    // Marquer le bloc comme libre
+    pthread_mutex_lock(&fs->verrou_allocation);
+    fs->bitmap[num_bloc / BITS_PAR_OCTET] &= ~(1 << (num_bloc % BITS_PAR_OCTET));
+    fs->superbloc.nb_blocs_libres++;
+    pthread_mutex_unlock(&fs->verrou_allocation);
+}
+
+/**
+ * Libère un lot de blocs en une seule mise à jour de l'allocateur : les
+ * références sont décomptées sous un même verrou, les blocs rendus sont
+ * effacés par une écriture vectorielle puis marqués libres ensemble.
+ * @param blocs Les blocs (un bloc dédupliqué peut y figurer plusieurs fois)
+ * @param nb Nombre de blocs
+ */
+static void liberer_blocs(SystemeFichiers* fs, const int* blocs, int nb) {
+    if (nb <= 0) {
+        return;
+    }
+    int* rendus = malloc((size_t)nb * sizeof(int));
+    const void** sources = malloc((size_t)nb * sizeof(void*));
+    char* zeros = allouer_aligne(TAILLE_BLOC);
+    if (!rendus || !sources || !zeros) {
+        free(rendus);
+        free(sources);
+        free(zeros);
+        for (int i = 0; i < nb; i++) {
+            liberer_bloc(fs, blocs[i]);
         }
-        
-        // Vérification que le répertoire est vide
-        if (nb_entrees > 0) {
-            erreur("Le répertoire n'est pas vide");
-            return -1;
+        return;
+    }
+    memset(zeros, 0, TAILLE_BLOC);
+
+    int nb_rendus = 0, nb_invalides = 0;
+    pthread_mutex_lock(&fs->verrou_allocation);
+    for (int i = 0; i < nb; i++) {
+        int bloc = blocs[i];
+        if (bloc < 0 || bloc >= NB_BLOCS) {
+            nb_invalides++;
+            continue;
+        }
+        if (fs->references[bloc] > 1) {
+            fs->references[bloc]--;
+            continue;
         }
+        if (fs->references[bloc] == 1) {
+            fs->references[bloc] = 0;
+            desindexer_bloc(fs, bloc);
+        }
+        rendus[nb_rendus] = bloc;
+        sources[nb_rendus++] = zeros;
     }
-    
-    // Décrémentation du compteur de liens
-    inode->nb_liens--;
-    
-    // Si c'était le dernier lien, libération des ressources
-    if (inode->nb_liens == 0) {
-        // Libération des blocs directs
-        int nb_blocs = (inode->taille + TAILLE_BLOC - 1) / TAILLE_BLOC;
-        for (int i = 0; i < nb_blocs && i < 10; i++) {
-            if (inode->blocs_directs[i] != 0) {
-                liberer_bloc(inode->blocs_directs[i]);
-                inode->blocs_directs[i] = 0;
-            }
+    pthread_mutex_unlock(&fs->verrou_allocation);
+    if (nb_invalides > 0) {
+        erreur("Numéro de bloc invalide");
+    }
+
+    // Comme dans liberer_bloc, les blocs sont effacés avant d'être rendus
+    ecrire_blocs(fs, rendus, (const void* const*)sources, nb_rendus);
+
+    pthread_mutex_lock(&fs->verrou_allocation);
+    for (int i = 0; i < nb_rendus; i++) {
+        fs->bitmap[rendus[i] / BITS_PAR_OCTET] &= ~(1 << (rendus[i] % BITS_PAR_OCTET));
+    }
+    fs->superbloc.nb_blocs_libres += nb_rendus;
+    pthread_mutex_unlock(&fs->verrou_allocation);
+
+    free(rendus);
+    free(sources);
+    free(zeros);
+}
+
+/**
+ * Trouve un inode libre dans la table et le réserve (nb_liens passe à 1,
+ * ce qui empêche un autre thread de le choisir)
+ * La recherche reprend là où la précédente s'est arrêtée, afin de ne pas
+ * recharger à chaque création les pages d'inodes déjà occupées.
+ * Un inode verrouillé par un autre thread est en cours d'utilisation (ou
+ * d'initialisation) : il est sauté sans attendre.
+ * @return L'index de l'inode libre, ou -1 si aucun disponible
+ */
+int trouver_inode_libre(SystemeFichiers* fs) {
+    pthread_mutex_lock(&fs->verrou_allocation);
+    for (int n = 0; n < fs->superbloc.nb_inodes; n++) {
+        int i = (fs->prochain_inode_libre + n) % fs->superbloc.nb_inodes;
+        if (pthread_rwlock_trywrlock(&fs->verrous_inodes[i]) != 0) {
+            continue;
         }
-        
-        // Libération des blocs indirects si existants
-        if (inode->bloc_indirect != 0) {
-            int blocs_indirects[TAILLE_BLOC / sizeof(int)];
-            lire_bloc(inode->bloc_indirect, blocs_indirects);
-            
-            for (int i = 0; i < TAILLE_BLOC / sizeof(int); i++) {
-                if (blocs_indirects[i] != 0) {
-                    liberer_bloc(blocs_indirects[i]);
-                }
-            }
-            
-            liberer_bloc(inode->bloc_indirect);
-            inode->bloc_indirect = 0;
+        Inode* inode = epingler_inode(fs, i);
+        if (inode == NULL) {
+            deverrouiller_inode(fs, i);
+            break;
+        }
+        int libre = inode->taille == 0 && inode->nb_liens == 0;
+        if (libre) {
+            inode->nb_liens = 1;
         }
+        desepingler_inode(fs, i, libre);
+        deverrouiller_inode(fs, i);
         
-        // Libération de l'inode
-        liberer_inode(inode_id);
+        if (libre) {
+            fs->prochain_inode_libre = i;
+            fs->superbloc.nb_inodes_libres--;
+            pthread_mutex_unlock(&fs->verrou_allocation);
+            return i;
+        }
+    }
+    pthread_mutex_unlock(&fs->verrou_allocation);
+    return -1; // Aucun inode libre
+}
+
+/**
+ * Libère un inode en réinitialisant sa structure
+ * @param num_inode Le numéro de l'inode à libérer
+ */
+void liberer_inode(SystemeFichiers* fs, int num_inode) {
+    Inode* inode = epingler_inode(fs, num_inode);
+    if (inode == NULL) {
+        erreur("Numéro d'inode invalide");
+        return;
     }
+
+    // Les données jamais vidées n'ont pas à toucher le disque
+    abandonner_tampon_inode(fs, num_inode);
     
-    // Suppression de l'entrée dans le répertoire parent
-    int result = supprimer_entree_repertoire(inode_courant, nom);
+    pthread_mutex_lock(&fs->verrou_allocation);
+    memset(inode, 0, sizeof(Inode));
+    desepingler_inode(fs, num_inode, 1);
+    fs->superbloc.nb_inodes_libres++;
     
-    return result;
+    if (num_inode < fs->prochain_inode_libre) {
+        fs->prochain_inode_libre = num_inode;
+    }
+    pthread_mutex_unlock(&fs->verrou_allocation);
 }
 
 /**
- * Lit le contenu d'un fichier
- * @param inode_id L'inode du fichier à lire
- * @param buffer Le buffer où stocker les données lues
- * @param taille Le nombre d'octets à lire
- * @param offset La position de départ dans le fichier
- * @return Le nombre d'octets lus ou -1 en cas d'erreur
+ * Libère un lot d'inodes en une seule mise à jour de l'allocateur
+ * @param inodes Les numéros des inodes, dont les blocs sont déjà libérés
+ * @param nb Nombre d'inodes
  */
-int lire_fichier(int inode_id, void* buffer, int taille, int offset) {
-    // Vérification de l'identifiant d'inode
-    if (inode_id < 0 || inode_id >= NB_INODES) {
-        erreur("Numéro d'inode invalide");
+static void liberer_inodes(SystemeFichiers* fs, const int* inodes, int nb) {
+    for (int i = 0; i < nb; i++) {
+        abandonner_tampon_inode(fs, inodes[i]);
+    }
+
+    pthread_mutex_lock(&fs->verrou_allocation);
+    for (int i = 0; i < nb; i++) {
+        Inode* inode = epingler_inode(fs, inodes[i]);
+        if (inode == NULL) {
+            continue;
+        }
+        memset(inode, 0, sizeof(Inode));
+        desepingler_inode(fs, inodes[i], 1);
+        fs->superbloc.nb_inodes_libres++;
+        if (inodes[i] < fs->prochain_inode_libre) {
+            fs->prochain_inode_libre = inodes[i];
+        }
+    }
+    pthread_mutex_unlock(&fs->verrou_allocation);
+}
+
+/**
+ * Vérifie qu'un numéro d'inode existe dans la partition
+ * @param inode_id Le numéro d'inode
+ * @return 1 si valide, 0 sinon
+ */
+int inode_valide(SystemeFichiers* fs, int inode_id) {
+    return inode_id >= 0 && inode_id < fs->superbloc.nb_inodes;
+}
+
+/**
+ * Nombre de blocs réservés en tête de partition (superbloc, bitmap et
+ * table des inodes)
+ * @return Le nombre de blocs réservés
+ */
+int nb_blocs_metadonnees(SystemeFichiers* fs) {
+    return 1 + NB_BLOCS_BITMAP + (fs->superbloc.nb_inodes * sizeof(Inode) + TAILLE_BLOC - 1) / TAILLE_BLOC;
+}
+
+/**
+ * Réécrit une page d'inodes dans la partition
+ * @param page La page à écrire
+ * @return 0 si succès, -1 si erreur
+ */
+static int ecrire_page_inodes(SystemeFichiers* fs, PageInodes* page) {
+    int premier = page->num_page * INODES_PAR_PAGE;
+    int nb = fs->superbloc.nb_inodes - premier;
+    if (nb > INODES_PAR_PAGE) {
+        nb = INODES_PAR_PAGE;
+    }
+    
+    if (ecrire_partition(fs, page->inodes, nb * sizeof(Inode), OFFSET_TABLE_INODES + (long)premier * sizeof(Inode)) == -1) {
+        erreur("Erreur d'écriture de la table des inodes");
         return -1;
     }
     
-    Inode* inode = &inodes[inode_id];
+    page->modifiee = 0;
+    return 0;
+}
+
+/**
+ * Donne une page d'inodes du cache, en la chargeant au besoin.
+ * Lorsque le cache est plein, une page non épinglée est évincée selon
+ * l'algorithme de l'horloge (seconde chance).
+ * @param num_page Le numéro de la page
+ * @return La page, ou NULL si elle ne peut pas être chargée
+ */
+static PageInodes* charger_page_inodes(SystemeFichiers* fs, int num_page) {
+    PageInodes* victime = NULL;
     
-    // Gestion des liens symboliques
-    if (inode->type == TYPE_LIEN_SYMBOLIQUE) {
-        // Lecture du chemin cible
-        char chemin_source[TAILLE_BLOC];
-        lire_bloc(inode->blocs_directs[0], chemin_source);
-        
-        // Recherche de l'inode cible
-        int inode_source = trouver_inode_par_nom(inode_courant, chemin_source);
-        
-        if (inode_source == -1) {
-            erreur("Fichier source du lien symbolique non trouvé");
-            return -1;
+    for (int i = 0; i < NB_PAGES_CACHE_INODES; i++) {
+        if (fs->cache_inodes[i].num_page == num_page) {
+            fs->cache_inodes[i].reference = 1;
+            return &fs->cache_inodes[i];
+        }
+        if (victime == NULL && fs->cache_inodes[i].num_page == -1) {
+            victime = &fs->cache_inodes[i];
         }
+    }
+    
+    // Aucun emplacement libre : recherche d'une page à évincer
+    for (int n = 0; n < 2 * NB_PAGES_CACHE_INODES && victime == NULL; n++) {
+        PageInodes* page = &fs->cache_inodes[fs->aiguille_cache];
+        fs->aiguille_cache = (fs->aiguille_cache + 1) % NB_PAGES_CACHE_INODES;
         
-        // Lecture récursive du fichier cible
-        return lire_fichier(inode_source, buffer, taille, 0);
+        if (page->epinglages > 0) {
+            continue;
+        }
+        if (page->reference) {
+            page->reference = 0;
+        } else {
+            victime = page;
+        }
     }
     
-    // Vérification des droits de lecture
-    if (!verifier_droits(inode_id, DROIT_LECTURE)) {
-        erreur("Permission refusée");
-        return -1;
+    if (victime == NULL) {
+        erreur("Cache d'inodes saturé (toutes les pages sont épinglées)");
+        return NULL;
+    }
+    if (victime->num_page != -1 && victime->modifiee && ecrire_page_inodes(fs, victime) == -1) {
+        return NULL;
     }
     
-    // Vérification que c'est bien un fichier
-    if (inode->type == TYPE_REPERTOIRE)  {
-        erreur("L'inode n'est pas un fichier");
-        return -1;
+    // Lecture de la page depuis la partition
+    int premier = num_page * INODES_PAR_PAGE;
+    int nb = fs->superbloc.nb_inodes - premier;
+    if (nb > INODES_PAR_PAGE) {
+        nb = INODES_PAR_PAGE;
     }
     
-    // Vérification de l'offset
-    if (offset < 0 || offset >= inode->taille) {
-        erreur("Offset invalide");
-        return -1;
+    memset(victime->inodes, 0, sizeof(victime->inodes));
+    if (lire_partition(fs, victime->inodes, nb * sizeof(Inode), OFFSET_TABLE_INODES + (long)premier * sizeof(Inode)) == -1) {
+        erreur("Erreur de lecture de la table des inodes");
+        victime->num_page = -1;
+        return NULL;
+    }
+    // Une page entière est un bloc de la partition, vérifié par sa somme
+    if (nb == INODES_PAR_PAGE && fs->session_transaction == NULL
+            && controler_bloc_lu(fs, OFFSET_TABLE_INODES / TAILLE_BLOC + num_page, victime->inodes) == -1) {
+        victime->num_page = -1;
+        return NULL;
     }
     
-    // Ajustement de la taille à lire si nécessaire
-    if (offset + taille > inode->taille) {
-        taille = inode->taille - offset;
+    victime->num_page = num_page;
+    victime->epinglages = 0;
+    victime->modifiee = 0;
+    victime->reference = 1;
+    return victime;
+}
+
+/**
+ * Épingle un inode en mémoire : le pointeur rendu reste valide jusqu'à
+ * l'appel correspondant à desepingler_inode
+ * @param inode_id Le numéro de l'inode
+ * @return Pointeur vers l'inode, ou NULL si invalide ou non chargeable
+ */
+Inode* epingler_inode(SystemeFichiers* fs, int inode_id) {
+    if (!inode_valide(fs, inode_id)) {
+        return NULL;
     }
     
-    // Lecture des données
-    int bytes_read = 0;
-    char block_buffer[TAILLE_BLOC];
-    
-    while (bytes_read < taille) {
-        // Calcul du bloc et de l'offset dans le bloc
-        int bloc_index = (offset + bytes_read) / TAILLE_BLOC;
-        int bloc_offset = (offset + bytes_read) % TAILLE_BLOC;
-        int bytes_to_read = TAILLE_BLOC - bloc_offset;
-        
-        if (bytes_to_read > taille - bytes_read) {
-            bytes_to_read = taille - bytes_read;
-        }
-        
-        // Détermination du numéro de bloc
-        int num_bloc = -1;
-        if (bloc_index < 10) {
-            num_bloc = inode->blocs_directs[bloc_index];
-        } else if (inode->bloc_indirect != 0) {
-            int blocs_indirects[TAILLE_BLOC / sizeof(int)];
-            lire_bloc(inode->bloc_indirect, blocs_indirects);
-            num_bloc = blocs_indirects[bloc_index - 10];
-        }
-        
-        if (num_bloc == 0 || num_bloc == -1) {
-            // Bloc non alloué, remplissage avec des zéros
-            memset((char*)buffer + bytes_read, 0, bytes_to_read);
-        } else {
-            // Lecture effective du bloc
-            lire_bloc(num_bloc, block_buffer);
-            memcpy((char*)buffer + bytes_read, block_buffer + bloc_offset, bytes_to_read);
-        }
-        
-        bytes_read += bytes_to_read;
+    pthread_mutex_lock(&fs->verrou_cache);
+    PageInodes* page = charger_page_inodes(fs, inode_id / INODES_PAR_PAGE);
+    if (page == NULL) {
+        pthread_mutex_unlock(&fs->verrou_cache);
+        return NULL;
     }
     
-    // Mise à jour de la date d'accès
-    inode->date_acces = time(NULL);
-    
-    return bytes_read;
+    page->epinglages++;
+    pthread_mutex_unlock(&fs->verrou_cache);
+    return &page->inodes[inode_id % INODES_PAR_PAGE];
 }
 
 /**
- * Écrit dans un fichier
- * @param inode_id L'inode du fichier à modifier
- * @param buffer Les données à écrire
- * @param taille Le nombre d'octets à écrire
- * @param offset La position de départ dans le fichier
- * @return Le nombre d'octets écrits ou -1 en cas d'erreur
+ * Relâche un inode épinglé
+ * @param inode_id Le numéro de l'inode
+ * @param modifie 1 si l'inode a été modifié et doit être réécrit
  */
-int ecrire_fichier(int inode_id, void* buffer, int taille, int offset) {
-    // Vérification de l'identifiant d'inode
-    if (inode_id < 0 || inode_id >= NB_INODES) {
-        erreur("Numéro d'inode invalide");
-        return -1;
-    }
-    
-    Inode* inode = &inodes[inode_id];
-    
-    // Vérification des droits d'écriture
-    if (!verifier_droits(inode_id, DROIT_ECRITURE)) {
-        erreur("Permission refusée");
-        return -1;
-    }
-    
-    // Vérification que c'est bien un fichier
-    if (inode->type != TYPE_FICHIER) {
-        erreur("L'inode n'est pas un fichier");
-        return -1;
-    }
-    
-    // Vérification de l'offset
-    if (offset < 0) {
-        erreur("Offset invalide");
-        return -1;
-    }
-    
-    // Si on écrit au début d'un fichier non vide, libération des blocs existants
-    if (inode->taille > 0 && offset == 0) {
-        // Libération des blocs directs
-        for (int i = 0; i < 10; i++) {
-            if (inode->blocs_directs[i] != 0) {
-                liberer_bloc(inode->blocs_directs[i]);
-                inode->blocs_directs[i] = 0;
-            }
-        }
-        
-        // Libération des blocs indirects si existants
-        if (inode->bloc_indirect != 0) {
-            int blocs_indirects[TAILLE_BLOC / sizeof(int)];
-            lire_bloc(inode->bloc_indirect, blocs_indirects);
-            for (int i = 0; i < TAILLE_BLOC / sizeof(int); i++) {
-                if (blocs_indirects[i] != 0) {
-                    liberer_bloc(blocs_indirects[i]);
-                }
+void desepingler_inode(SystemeFichiers* fs, int inode_id, int modifie) {
+    int num_page = inode_id / INODES_PAR_PAGE;
+    
+    pthread_mutex_lock(&fs->verrou_cache);
+    for (int i = 0; i < NB_PAGES_CACHE_INODES; i++) {
+        if (fs->cache_inodes[i].num_page == num_page && fs->cache_inodes[i].epinglages > 0) {
+            fs->cache_inodes[i].epinglages--;
+            if (modifie) {
+                fs->cache_inodes[i].modifiee = 1;
             }
-            liberer_bloc(inode->bloc_indirect);
-            inode->bloc_indirect = 0;
+            pthread_mutex_unlock(&fs->verrou_cache);
+            return;
         }
-        
-        // Réinitialisation de la taille
-        inode->taille = 0;
     }
+    pthread_mutex_unlock(&fs->verrou_cache);
     
-    // Écriture des données
-    int bytes_written = 0;
-    char block_buffer[TAILLE_BLOC];
-
-    while (bytes_written < taille) {
-        // Calcul du bloc et de l'offset dans le bloc
-        int bloc_index = (offset + bytes_written) / TAILLE_BLOC;
-        int bloc_offset = (offset + bytes_written) % TAILLE_BLOC;
-        int bytes_to_write = TAILLE_BLOC - bloc_offset;
-        
-        if (bytes_to_write > taille - bytes_written) {
-            bytes_to_write = taille - bytes_written;
-        }
+    erreur("Désépinglage d'un inode non épinglé");
+}
 
-        // Gestion de l'allocation des blocs
-        int num_bloc = -1;
-        if (bloc_index < 10) {
-            if (inode->blocs_directs[bloc_index] == 0) {
-                inode->blocs_directs[bloc_index] = trouver_bloc_libre();
-            }
-            num_bloc = inode->blocs_directs[bloc_index];
-        } else {
-            if (inode->bloc_indirect == 0) {
-                inode->bloc_indirect = trouver_bloc_libre();
-                int zero_init[TAILLE_BLOC / sizeof(int)] = {0};
-                ecrire_bloc(inode->bloc_indirect, zero_init);
-            }
-            int blocs_indirects[TAILLE_BLOC / sizeof(int)];
-            lire_bloc(inode->bloc_indirect, blocs_indirects);
-            if (blocs_indirects[bloc_index - 10] == 0) {
-                blocs_indirects[bloc_index - 10] = trouver_bloc_libre();
-                ecrire_bloc(inode->bloc_indirect, blocs_indirects);
+/**
+ * Réécrit dans la partition toutes les pages d'inodes modifiées
+ * @return 0 si succès, -1 si erreur
+ */
+int vider_cache_inodes(SystemeFichiers* fs) {
+    int resultat = 0;
+    
+    pthread_mutex_lock(&fs->verrou_cache);
+    for (int i = 0; i < NB_PAGES_CACHE_INODES; i++) {
+        if (fs->cache_inodes[i].num_page != -1 && fs->cache_inodes[i].modifiee) {
+            if (ecrire_page_inodes(fs, &fs->cache_inodes[i]) == -1) {
+                resultat = -1;
             }
-            num_bloc = blocs_indirects[bloc_index - 10];
-        }
-        
-        if (num_bloc == -1) {
-            erreur("Aucun bloc libre");
-            return -1;
         }
-
-        // Lecture-modification-écriture du bloc
-        lire_bloc(num_bloc, block_buffer);
-        memcpy(block_buffer + bloc_offset, (char*)buffer + bytes_written, bytes_to_write);
-        ecrire_bloc(num_bloc, block_buffer);
-
-        bytes_written += bytes_to_write;
-    }
-
-    // Mise à jour de la taille si nécessaire
-    if (offset + taille > inode->taille) {
-        inode->taille = offset + taille;
     }
+    pthread_mutex_unlock(&fs->verrou_cache);
     
-    // Mise à jour des dates
-    inode->date_modification = time(NULL);
-    inode->date_acces = time(NULL);
-
-    return bytes_written;
+    return resultat;
 }
 
 /**
- * Vérifie les droits d'accès
- * @param num_inode L'inode à vérifier
- * @param droits_requis Les droits nécessaires (DROIT_LECTURE/ECRITURE/EXECUTION)
- * @return 1 si les droits sont accordés, 0 sinon
+ * Oublie toutes les pages d'inodes en mémoire (sans les écrire)
  */
-int verifier_droits(int num_inode, int droits_requis) {
-    // Vérification de l'identifiant d'inode
-    if (num_inode < 0 || num_inode >= NB_INODES) {
-        return 0;
+void invalider_cache_inodes(SystemeFichiers* fs) {
+    pthread_mutex_lock(&fs->verrou_cache);
+    for (int i = 0; i < NB_PAGES_CACHE_INODES; i++) {
+        fs->cache_inodes[i].num_page = -1;
+        fs->cache_inodes[i].epinglages = 0;
+        fs->cache_inodes[i].modifiee = 0;
+        fs->cache_inodes[i].reference = 0;
     }
-    
-    Inode* inode = &inodes[num_inode];
-    
-    // L'utilisateur root a tous les droits
-    if (getuid() == 0) {
-        return 1;
-    }
-    
-    // Détermination du masque de droits selon l'utilisateur
-    int mask = 0;
-    
-    if (inode->proprietaire == getuid()) {
-        // Droits du propriétaire (bits 6-8)
-        mask = (inode->droits >> 6) & 0x7;
-    } else if (inode->groupe == getgid()) {
-        // Droits du groupe (bits 3-5)
-        mask = (inode->droits >> 3) & 0x7;
-    } else {
-        // Droits des autres (bits 0-2)
-        mask = inode->droits & 0x7;
-    }
-   
-    // Vérification que le masque contient tous les droits requis
-    return (droits_requis & mask) == droits_requis;
+    fs->aiguille_cache = 0;
+    fs->prochain_inode_libre = 0;
+    pthread_mutex_unlock(&fs->verrou_cache);
 }
 
 /**
- * Crée un lien physique entre deux fichiers
- * @param source Le fichier source
- * @param nom_lien Le nom du lien à créer
- * @return 0 si succès, -1 si erreur
+ * Écrit des données dans un bloc de la partition
+ * @param num_bloc Le numéro du bloc à écrire
+ * @param donnees Les données à écrire (doivent faire TAILLE_BLOC octets)
  */
-int creer_lien(const char* source, const char* nom_lien) {
-    // Recherche de l'inode source
-    int inode_source = trouver_inode_par_nom(inode_courant, source);
-    if (inode_source == -1) {
-        erreur("Fichier source non trouvé");
-        return -1;
-    }
-
-    // Vérification que la source n'est pas un répertoire
-    if (inodes[inode_source].type == TYPE_REPERTOIRE) {
-        erreur("Impossible de créer un lien physique vers un répertoire");
-        return -1;
-    }
-
-    // Vérification que le lien n'existe pas déjà
-    int inode_lien = trouver_inode_par_nom(inode_courant, nom_lien);
-    if (inode_lien != -1) {
-        erreur("Un fichier avec ce nom de lien existe déjà");
-        return -1;
-    }
-
-    // Allocation d'un nouvel inode
-    int nouvel_inode = trouver_inode_libre();
-    if (nouvel_inode == -1) {
-        erreur("Impossible de créer un nouvel inode pour le lien physique");
-        return -1;
+void ecrire_bloc(SystemeFichiers* fs, int num_bloc, const void* donnees) {
+    if (num_bloc < 0 || num_bloc >= NB_BLOCS) {
+        erreur("Numéro de bloc invalide");
+        return;
     }
+    long offset = (long)TAILLE_BLOC * num_bloc;
+    MESURER_ACCES_BLOC(fs, ACCES_ECRITURE, num_bloc, TAILLE_BLOC);
 
-    // Copie des métadonnées de l'inode source
-    memcpy(&inodes[nouvel_inode], &inodes[inode_source], sizeof(Inode));
-    
-    // Modification des attributs spécifiques
-    inodes[nouvel_inode].type = TYPE_LIEN_PHYSIQUE;
-    strncpy(inodes[nouvel_inode].nom, nom_lien, MAX_NOM_FICHIER);
-    inodes[nouvel_inode].date_creation = time(NULL);
-    inodes[nouvel_inode].date_modification = time(NULL);
-
-    // Ajout de l'entrée dans le répertoire
-    if (ajouter_entree_repertoire(inode_courant, nom_lien, nouvel_inode) == -1) {
-        liberer_inode(nouvel_inode);
-        return -1;
+    if (ecrire_partition(fs, donnees, TAILLE_BLOC, offset) == -1) {
+        erreur("Erreur d'écriture du bloc");
     }
+}
 
-    // Incrémentation du compteur de liens de la source
-    inodes[inode_source].nb_liens++;
 
-    return 0;
-}
 
 /**
- * Crée un lien symbolique
- * @param source Le chemin cible du lien
- * @param destination Le nom du lien symbolique
- * @return L'identifiant de l'inode créé ou -1 si erreur
+ * Lit un bloc de la partition, depuis le cache ou le disque
+ * @param num_bloc Le numéro du bloc à lire
+ * @param donnees Buffer pour stocker les données lues
+ * @param controler 1 pour vérifier la somme d'un bloc lu sur le disque
+ * @return 0 en cas de succès, -1 en cas d'erreur
  */
-int creer_lien_symbolique(const char* source, const char* destination) {
-    // Vérifier le nom du lien symbolique
-    if (!valider_nom_fichier(destination)) {
-        erreur("Nom de lien symbolique invalide");
+static int lire_bloc_controle(SystemeFichiers* fs, int num_bloc, void* donnees, int controler) {
+    if (num_bloc < 0 || num_bloc >= NB_BLOCS) {
+        erreur("Numéro de bloc invalide");
         return -1;
     }
 
-    // Vérifier s'il existe déjà un fichier du même nom
-    if (trouver_inode_par_nom(inode_courant, destination) != -1) {
-        erreur("Un fichier avec ce nom existe déjà");
-        return -1;
-    }
+    long offset = (long)TAILLE_BLOC * num_bloc;
+    MESURER_ACCES_BLOC(fs, ACCES_LECTURE, num_bloc, TAILLE_BLOC);
 
-    // Trouver un inode libre pour le lien symbolique
-    int inode_lien = trouver_inode_libre();
-    if (inode_lien == -1) {
-        erreur("Aucun inode libre pour le lien symbolique");
-        return -1;
+    // Pendant une transaction, les blocs modifiés ne sont qu'en mémoire :
+    // le cache, qui reflète le disque, n'est pas utilisé
+    if (fs->session_transaction != NULL) {
+        if (lire_partition(fs, donnees, TAILLE_BLOC, offset) == -1) {
+            erreur("Erreur de lecture du bloc");
+            return -1;
+        }
+        return 0;
     }
 
-    Inode* inode = &inodes[inode_lien];
-    memset(inode, 0, sizeof(Inode));
-    
-    inode->type = TYPE_LIEN_SYMBOLIQUE;
-    inode->date_creation = time(NULL);
-    inode->date_modification = time(NULL);
-    inode->date_acces = time(NULL);
-    inode->nb_liens = 1;
-    inode->proprietaire = getuid();
-    inode->groupe = getgid();
-    inode->droits = 0777;  // Accès total au lien
-
-    // Stocker le chemin source comme contenu du lien
-    size_t longueur = strlen(source);
-    if (longueur >= sizeof(inode->blocs_directs)) {
-        erreur("Chemin source trop long pour le lien symbolique");
-        liberer_inode(inode_lien);
-        return -1;
+    if (chercher_bloc_cache(fs, num_bloc, donnees)) {
+        return 0;
     }
-
-    // On stocke le chemin dans les blocs du fichier comme si c’était le contenu
-    int bloc = trouver_bloc_libre();
-    if (bloc == -1) {
-        erreur("Aucun bloc libre pour le lien symbolique");
-        liberer_inode(inode_lien);
+    uint32_t generation = generation_bloc(fs, num_bloc);
+    if (lire_disque(fs, donnees, TAILLE_BLOC, offset) == -1) {
+        erreur("Erreur de lecture du bloc");
         return -1;
     }
-
-    inode->blocs_directs[0] = bloc;
-    inode->taille = longueur + 1;
-
-    char buffer[TAILLE_BLOC] = {0};
-    strncpy(buffer, source, TAILLE_BLOC - 1);
-    ecrire_bloc(bloc, buffer);
-
-    // Nom du lien symbolique
-    strncpy(inode->nom, destination, MAX_NOM_FICHIER);
-
-    // Ajouter l'entrée dans le répertoire courant
-    if (ajouter_entree_repertoire(inode_courant, destination, inode_lien) != 0) {
-        liberer_bloc(bloc);
-        liberer_inode(inode_lien);
-        erreur("Échec de l'ajout du lien symbolique dans le répertoire");
+    if (controler && controler_bloc_lu(fs, num_bloc, donnees) == -1) {
         return -1;
     }
+    ranger_bloc_cache(fs, num_bloc, donnees, generation);
 
     return 0;  // Succès
 }
 
 /**
- * Affiche le contenu d'un répertoire
- * @param inode_dir L'inode du répertoire à afficher
+ * Lit des données depuis un bloc de la partition. Un bloc lu sur le
+ * disque est toujours vérifié par sa somme de contrôle : lire_bloc sert
+ * aux métadonnées (répertoires, tables indirectes, fragments, liens).
+ * @param num_bloc Le numéro du bloc à lire
+ * @param donnees Buffer pour stocker les données lues
+ * @return 0 en cas de succès, -1 en cas d'erreur (ou bloc corrompu)
  */
-void afficher_repertoire(int inode_dir) {
-    // Vérification de l'inode
-    if (inode_dir < 0 || inode_dir >= NB_INODES) {
-        erreur("Indice d'inode invalide !");
-        return;
-    }
+int lire_bloc(SystemeFichiers* fs, int num_bloc, void* donnees) {
+    return lire_bloc_controle(fs, num_bloc, donnees, 1);
+}
 
-    Inode* inode_repertoire = &inodes[inode_dir];
+/**
+ * Lit un bloc de données d'un fichier. Sa somme de contrôle n'est
+ * vérifiée que si la vérification des données est activée.
+ * @param num_bloc Le numéro du bloc à lire
+ * @param donnees Buffer pour stocker les données lues
+ * @return 0 en cas de succès, -1 en cas d'erreur (ou bloc corrompu)
+ */
+int lire_bloc_donnees(SystemeFichiers* fs, int num_bloc, void* donnees) {
+    return lire_bloc_controle(fs, num_bloc, donnees, fs->verification_donnees);
+}
 
-    // Vérification du type
-    if (inode_repertoire->type != TYPE_REPERTOIRE) {
-        erreur("L'inode n'est pas un répertoire");
-        return;
+/**
+ * Range les indices 0..nb-1 dans l'ordre croissant des blocs qu'ils
+ * désignent (tri par insertion stable : les accès à un même bloc gardent
+ * leur ordre)
+ * @param blocs Les blocs
+ * @param ordre Reçoit les indices triés
+ * @param nb Nombre de blocs
+ */
+static void trier_par_bloc(const int* blocs, int* ordre, int nb) {
+    for (int i = 0; i < nb; i++) {
+        int j = i;
+        while (j > 0 && blocs[ordre[j - 1]] > blocs[i]) {
+            ordre[j] = ordre[j - 1];
+            j--;
+        }
+        ordre[j] = i;
     }
+}
 
-    // Lecture du bloc de répertoire
-    int bloc_repertoire = inode_repertoire->blocs_directs[0];
-    if (bloc_repertoire < 0) {
-        erreur("Bloc de répertoire invalide !");
-        return;
+/**
+ * Lit plusieurs blocs de données de la partition, chacun dans son propre
+ * buffer. Les blocs sont lus dans l'ordre du disque et chaque suite de
+ * blocs consécutifs absente du cache l'est en une seule lecture
+ * vectorielle. Les blocs lus ainsi ne sont pas rangés dans le cache : une
+ * grande lecture n'en chasse pas les blocs utiles. Leurs sommes ne sont
+ * vérifiées que si la vérification des données est activée.
+ * @param fs La partition
+ * @param blocs Les numéros des blocs à lire
+ * @param destinations Un buffer de TAILLE_BLOC octets par bloc
+ * @param nb Nombre de blocs
+ * @return 0 en cas de succès, -1 en cas d'erreur
+ */
+int lire_blocs(SystemeFichiers* fs, const int* blocs, void* const* destinations, int nb) {
+    for (int i = 0; i < nb; i++) {
+        if (blocs[i] < 0 || blocs[i] >= NB_BLOCS) {
+            erreur("Numéro de bloc invalide");
+            return -1;
+        }
     }
 
-    if (lire_bloc(bloc_repertoire, entrees) == -1) {
-        erreur("Erreur lors de la lecture du répertoire !");
-        return;
+    // Pendant une transaction, les blocs modifiés ne sont qu'en mémoire
+    if (fs->session_transaction != NULL || nb == 1) {
+        for (int i = 0; i < nb; i++) {
+            if (lire_bloc_donnees(fs, blocs[i], destinations[i]) == -1) {
+                return -1;
+            }
+        }
+        return 0;
     }
 
-    // Affichage de l'en-tête
-    printf("Contenu du répertoire :\n");
-    printf("%-20s %-10s %-10s %-10s %-20s\n", "Nom", "Type", "Taille", "Droits", "Modification");
-    printf("----------------------------------------------------------------\n");
-
-    // Parcours des entrées
-    for (int i = 0; i < MAX_ENTREES_DIR; i++) {
-        if (entrees[i].nom[0] != '\0') {  // Entrée valide
-            int inode_id = entrees[i].inode;
+    int ordre[NB_VECTEURS_BLOCS];
+    struct iovec vecteurs[NB_VECTEURS_BLOCS];
+    RequeteES requetes[NB_VECTEURS_BLOCS];
+    char* rebonds[NB_VECTEURS_BLOCS];
+    char lus[NB_VECTEURS_BLOCS];
+    int resultat = 0;
+    for (int debut = 0; debut < nb; debut += NB_VECTEURS_BLOCS) {
+        int n = nb - debut < NB_VECTEURS_BLOCS ? nb - debut : NB_VECTEURS_BLOCS;
+        trier_par_bloc(blocs + debut, ordre, n);
 
-            // Vérification de l'inode
-            if (inode_id < 0 || inode_id >= NB_INODES) {
-                erreur("ID d'inode invalide dans le répertoire !");
+        // Une requête par suite de blocs consécutifs, toutes soumises ensemble
+        int nb_requetes = 0, suivant = -1;
+        for (int k = 0; k < n; k++) {
+            int i = debut + ordre[k];
+            rebonds[k] = NULL;
+            lus[k] = 0;
+            MESURER_ACCES_BLOC(fs, ACCES_LECTURE, blocs[i], TAILLE_BLOC);
+            if (chercher_bloc_cache(fs, blocs[i], destinations[i])) {
                 continue;
             }
+            lus[k] = 1;
+            if (nb_requetes == 0 || blocs[i] != suivant) {
+                requetes[nb_requetes++] = (RequeteES){ 0, &vecteurs[k], 0, (off_t)blocs[i] * TAILLE_BLOC, 0 };
+            }
+            // En accès direct, un buffer non aligné est lu dans un buffer prêté
+            if (fs->descripteur_direct != -1 && !est_aligne(destinations[i])) {
+                rebonds[k] = prendre_tampon_aligne(fs);
+            }
+            vecteurs[k].iov_base = rebonds[k] ? rebonds[k] : destinations[i];
+            vecteurs[k].iov_len = TAILLE_BLOC;
+            requetes[nb_requetes - 1].nb_vecteurs++;
+            suivant = blocs[i] + 1;
+        }
+        if (executer_lot_es(fs, requetes, nb_requetes) == -1) {
+            resultat = -1;
+        }
+        for (int k = 0; k < n; k++) {
+            if (rebonds[k]) {
+                memcpy(destinations[debut + ordre[k]], rebonds[k], TAILLE_BLOC);
+                rendre_tampon_aligne(fs, rebonds[k]);
+            }
+        }
+        if (resultat == -1 || !fs->verification_donnees) {
+            continue;
+        }
+        for (int k = 0; k < n; k++) {
+            int i = debut + ordre[k];
+            if (lus[k] && controler_bloc_lu(fs, blocs[i], destinations[i]) == -1) {
+                return -1;
+            }
+        }
+    }
 
-            Inode* inode = &inodes[inode_id];
+    if (resultat == -1) {
+        erreur("Erreur de lecture du bloc");
+    }
+    return resultat;
+}
 
-            // Détermination du type
-            char type_char = '-';
-            if (inode->type == TYPE_FICHIER) {
-                type_char = 'f';
-            } else if(inode->type == TYPE_REPERTOIRE) {
-                type_char = 'd';
-            } else if (inode->type == TYPE_LIEN_SYMBOLIQUE) {
-                type_char = 'l';
-            }else if(inode->type == TYPE_LIEN_PHYSIQUE){
-                type_char = 'p';
-            }
+/**
+ * Écrit plusieurs blocs de la partition. Les blocs sont écrits dans
+ * l'ordre du disque, chaque suite de blocs consécutifs en une seule
+ * écriture vectorielle.
+ * @param fs La partition
+ * @param blocs Les numéros des blocs à écrire
+ * @param sources Un buffer de TAILLE_BLOC octets par bloc
+ * @param nb Nombre de blocs
+ * @return 0 en cas de succès, -1 en cas d'erreur
+ */
+int ecrire_blocs(SystemeFichiers* fs, const int* blocs, const void* const* sources, int nb) {
+    for (int i = 0; i < nb; i++) {
+        if (blocs[i] < 0 || blocs[i] >= NB_BLOCS) {
+            erreur("Numéro de bloc invalide");
+            return -1;
+        }
+    }
 
-            // Construction des permissions
-            char droits[11] = { type_char, 
-                (inode->droits & 0400) ? 'r' : '-',
-                (inode->droits & 0200) ? 'w' : '-',
-                (inode->droits & 0100) ? 'x' : '-',
-                (inode->droits & 0040) ? 'r' : '-',
-                (inode->droits & 0020) ? 'w' : '-',
-                (inode->droits & 0010) ? 'x' : '-',
-                (inode->droits & 0004) ? 'r' : '-',
-                (inode->droits & 0002) ? 'w' : '-',
-                (inode->droits & 0001) ? 'x' : '-',
-                '\0' };
+    // Pendant une transaction, les blocs ne sont copiés qu'en mémoire
+    if (fs->session_transaction != NULL || nb == 1) {
+        int erreurs = nb_erreurs();
+        for (int i = 0; i < nb; i++) {
+            ecrire_bloc(fs, blocs[i], sources[i]);
+        }
+        return nb_erreurs() > erreurs ? -1 : 0;
+    }
 
-            // Formatage de la date
-            char date_buf[20] = "Date inconnue";
-            if (inode->date_modification > 0) {
-                struct tm* tm_info = localtime(&inode->date_modification);
-                if (tm_info) {
-                    strftime(date_buf, sizeof(date_buf), "%Y-%m-%d %H:%M", tm_info);
+    int ordre[NB_VECTEURS_BLOCS];
+    struct iovec vecteurs[NB_VECTEURS_BLOCS];
+    RequeteES requetes[NB_VECTEURS_BLOCS];
+    char* rebonds[NB_VECTEURS_BLOCS];
+    int resultat = 0;
+    for (int debut = 0; debut < nb; debut += NB_VECTEURS_BLOCS) {
+        int n = nb - debut < NB_VECTEURS_BLOCS ? nb - debut : NB_VECTEURS_BLOCS;
+        trier_par_bloc(blocs + debut, ordre, n);
+
+        // Une requête par suite de blocs consécutifs, toutes soumises ensemble
+        // (deux écritures d'un même bloc vont dans deux lots successifs)
+        int nb_requetes = 0, suivant = -1;
+        for (int k = 0; k < n; k++) {
+            int i = debut + ordre[k];
+            MESURER_ACCES_BLOC(fs, ACCES_ECRITURE, blocs[i], TAILLE_BLOC);
+            if (nb_requetes > 0 && blocs[i] == suivant - 1) {
+                if (executer_lot_es(fs, requetes, nb_requetes) == -1) {
+                    resultat = -1;
                 }
+                nb_requetes = 0;
             }
-
-            // Texte du type
-            char type_str[20];
-            if (inode->type == TYPE_REPERTOIRE) {
-                strcpy(type_str, "Répertoire");
-            } else if (inode->type == TYPE_LIEN_SYMBOLIQUE) {
-                strcpy(type_str, "Lien symb.");
-            } else if(inode->type == TYPE_LIEN_PHYSIQUE) {
-                strcpy(type_str, "Lien ph.");
-            } else{
-                strcpy(type_str, "Fichier");
+            if (nb_requetes == 0 || blocs[i] != suivant) {
+                requetes[nb_requetes++] = (RequeteES){ 1, &vecteurs[k], 0, (off_t)blocs[i] * TAILLE_BLOC, 0 };
+            }
+            // En accès direct, un buffer non aligné est d'abord recopié
+            rebonds[k] = NULL;
+            if (fs->descripteur_direct != -1 && !est_aligne(sources[i])
+                    && (rebonds[k] = prendre_tampon_aligne(fs)) != NULL) {
+                memcpy(rebonds[k], sources[i], TAILLE_BLOC);
+            }
+            vecteurs[k].iov_base = rebonds[k] ? rebonds[k] : (void*)sources[i];
+            vecteurs[k].iov_len = TAILLE_BLOC;
+            requetes[nb_requetes - 1].nb_vecteurs++;
+            suivant = blocs[i] + 1;
+        }
+        if (executer_lot_es(fs, requetes, nb_requetes) == -1) {
+            resultat = -1;
+        }
+        for (int k = 0; k < n; k++) {
+            if (rebonds[k]) {
+                rendre_tampon_aligne(fs, rebonds[k]);
             }
-
-            // Affichage des informations
-            printf("%-20s %-10s %-10d %-10s %-20s\n", 
-                   entrees[i].nom, type_str, inode->taille, droits, date_buf);
         }
     }
+
+    if (resultat == -1) {
+        erreur("Erreur d'écriture du bloc");
+    }
+    return resultat;
 }
 
 /**
- * Change le répertoire courant
- * @param chemin Le chemin du répertoire cible
- * @return 0 si succès, -1 si erreur
+ * Charge dans le cache des suites de blocs consécutifs, une lecture
+ * vectorielle par suite, directement dans les emplacements du cache ;
+ * les lectures des différentes suites sont soumises ensemble. Les blocs
+ * déjà présents au début et à la fin d'une suite ne sont pas relus.
+ * @param fs La partition
+ * @param demandes Les suites de blocs (au plus FENETRE_ANTICIPATION_MAX blocs chacune)
+ * @param nb_demandes Nombre de suites (au plus NB_DEMANDES_PAR_LOT)
  */
-int changer_repertoire(const char* chemin) {
-    // Cas particulier pour remonter au parent
-    if (strcmp(chemin, "..") == 0) {
-        EntreeRepertoire entrees[MAX_ENTREES_DIR];
-        lire_bloc(inodes[inode_courant].blocs_directs[0], entrees);
-        
-        // Recherche de l'entrée ".."
-        for (int i = 0; i < MAX_ENTREES_DIR; i++) {
-            if (strcmp(entrees[i].nom, "..") == 0) {
-                inode_courant = entrees[i].inode;
-                return 0;
+static void charger_blocs_cache(SystemeFichiers* fs, const DemandeAnticipation* demandes, int nb_demandes) {
+    uint32_t generations[NB_DEMANDES_PAR_LOT][FENETRE_ANTICIPATION_MAX];
+    int cases[NB_DEMANDES_PAR_LOT][FENETRE_ANTICIPATION_MAX];
+    struct iovec vecteurs[NB_DEMANDES_PAR_LOT][FENETRE_ANTICIPATION_MAX];
+    RequeteES requetes[NB_DEMANDES_PAR_LOT];
+    int premiers[NB_DEMANDES_PAR_LOT];
+    int nb_requetes = 0;
+
+    pthread_mutex_lock(&fs->verrou_blocs);
+    for (int d = 0; d < nb_demandes; d++) {
+        int premier = demandes[d].premier;
+        int nb = demandes[d].nb;
+        while (nb > 0 && fs->case_du_bloc[premier] != -1) {
+            premier++;
+            nb--;
+        }
+        while (nb > 0 && fs->case_du_bloc[premier + nb - 1] != -1) {
+            nb--;
+        }
+        // Réserver un emplacement par bloc ; un bloc déjà présent au milieu
+        // de la suite est relu (la copie du disque est la même)
+        int reserves = 0;
+        while (reserves < nb) {
+            int c = liberer_case_bloc(fs);
+            if (c == -1) {
+                break;
             }
+            fs->cache_blocs[c].en_chargement = 1;
+            cases[nb_requetes][reserves] = c;
+            generations[nb_requetes][reserves] = fs->generation_bloc[premier + reserves];
+            vecteurs[nb_requetes][reserves].iov_base = fs->cache_blocs[c].donnees;
+            vecteurs[nb_requetes][reserves].iov_len = TAILLE_BLOC;
+            reserves++;
         }
-        
-        return -1;
-    } 
-    // Cas particulier pour le répertoire courant
-    else if (strcmp(chemin, ".") == 0) {
-        return 0;
-    } 
-    // Cas général
-    else {
-        // Recherche du répertoire
-        int inode_id = trouver_inode_par_nom(inode_courant, chemin);
-        if (inode_id == -1) {
-            erreur("Répertoire non trouvé");
-            return -1;
+        if (reserves > 0) {
+            premiers[nb_requetes] = premier;
+            requetes[nb_requetes] = (RequeteES){ 0, vecteurs[nb_requetes], reserves, (off_t)premier * TAILLE_BLOC, 0 };
+            nb_requetes++;
         }
-        
-        // Vérification du type
-        if (inodes[inode_id].type != TYPE_REPERTOIRE) {
-            erreur("Ce n'est pas un répertoire");
-            return -1;
+    }
+    pthread_mutex_unlock(&fs->verrou_blocs);
+    if (nb_requetes == 0) {
+        return;
+    }
+
+    // Une lecture incomplète n'est pas terminée : seuls les blocs lus en
+    // entier sont gardés
+    __atomic_add_fetch(&fs->nb_lots_es, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&fs->nb_requetes_es, nb_requetes, __ATOMIC_RELAXED);
+    executer_requetes(fs->moteur_es, requetes, nb_requetes);
+
+    // Un bloc anticipé peut être une table indirecte : les sommes sont
+    // vérifiées avant de le proposer aux lecteurs, hors du verrou
+    char intacts[NB_DEMANDES_PAR_LOT][FENETRE_ANTICIPATION_MAX];
+    for (int r = 0; r < nb_requetes; r++) {
+        ssize_t lus = requetes[r].resultat > 0 ? requetes[r].resultat : 0;
+        for (int i = 0; i < requetes[r].nb_vecteurs && i < lus / TAILLE_BLOC; i++) {
+            intacts[r][i] = somme_correcte(fs, premiers[r] + i, vecteurs[r][i].iov_base);
         }
-        
-        // Vérification des droits
-        if (!verifier_droits(inode_id, DROIT_EXECUTION)) {
-            erreur("Permission refusée");
-            return -1;
+    }
+
+    pthread_mutex_lock(&fs->verrou_blocs);
+    for (int r = 0; r < nb_requetes; r++) {
+        ssize_t lus = requetes[r].resultat > 0 ? requetes[r].resultat : 0;
+        int complets = lus / TAILLE_BLOC;
+        __atomic_add_fetch(&fs->nb_lectures_disque, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&fs->octets_lus, lus, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&fs->nb_blocs_anticipes, complets, __ATOMIC_RELAXED);
+
+        // Ne garder que les blocs non réécrits entre-temps
+        for (int i = 0; i < requetes[r].nb_vecteurs; i++) {
+            CaseBloc* emplacement = &fs->cache_blocs[cases[r][i]];
+            int bloc = premiers[r] + i;
+            emplacement->en_chargement = 0;
+            if (i >= complets || fs->generation_bloc[bloc] != generations[r][i] || !intacts[r][i]) {
+                continue;
+            }
+            if (fs->case_du_bloc[bloc] != -1) {
+                // Chargé par un autre lecteur pendant la lecture : garder sa copie
+                continue;
+            }
+            emplacement->bloc = bloc;
+            emplacement->reference = 1;
+            fs->case_du_bloc[bloc] = cases[r][i];
         }
-        
-        // Changement de répertoire
-        inode_courant = inode_id;
-        
-        // Mise à jour de la date d'accès
-        inodes[inode_id].date_acces = time(NULL);
-        
-        return 0;
     }
+    pthread_mutex_unlock(&fs->verrou_blocs);
 }
 
 /**
- * Copie un fichier
- * @param source Le fichier source
- * @param destination Le fichier destination
- * @return 0 si succès, -1 si erreur
+ * Termine une demande du thread de lecture anticipée : ses blocs ne sont
+ * plus attendus, les lecteurs qui les attendaient reprennent
+ * @param fs La partition
+ * @param demande La demande traitée
  */
-int copier_fichier(const char* source, const char* destination) {
-    // Recherche de l'inode source
-    int inode_source = trouver_inode_par_nom(inode_courant, source);
-    if (inode_source == -1) {
-        erreur("Fichier source non trouvé");
-        return -1;
-    }
-    
-    // Vérification des droits
-    if (!verifier_droits(inode_source, DROIT_LECTURE)) {
-        erreur("Permission refusée sur le fichier source");
-        return -1;
-    }
-    
-    // Vérification que la destination n'existe pas
-    int inode_dest = trouver_inode_par_nom(inode_courant, destination);
-    if (inode_dest != -1) {
-        erreur("La destination existe déjà");
-        return -1;
-    }
-    
-    // Création du fichier destination
-    inode_dest = creer_fichier(destination, TYPE_FICHIER);
-    if (inode_dest == -1) {
-        return -1;
+static void terminer_demande(SystemeFichiers* fs, DemandeAnticipation demande) {
+    pthread_mutex_lock(&fs->verrou_blocs);
+    for (int i = 0; i < demande.nb; i++) {
+        fs->demandes_bloc[demande.premier + i]--;
     }
-    
-    // Copie des données par blocs
-    char buffer[TAILLE_BLOC];
-    int taille = inodes[inode_source].taille;
-    int offset = 0;
-    
-    while (offset < taille) {
-        int bytes_to_read = TAILLE_BLOC;
-        if (offset + bytes_to_read > taille) {
-            bytes_to_read = taille - offset;
+    pthread_cond_broadcast(&fs->blocs_charges);
+    pthread_mutex_unlock(&fs->verrou_blocs);
+}
+
+/**
+ * Thread de lecture anticipée : charge dans le cache les suites de blocs
+ * demandées par les lectures séquentielles, jusqu'à la demande d'arrêt
+ * @param argument La partition
+ */
+static void* lire_par_anticipation(void* argument) {
+    SystemeFichiers* fs = argument;
+
+    pthread_mutex_lock(&fs->verrou_blocs);
+    while (1) {
+        while (fs->nb_demandes == 0 && !fs->arret_anticipation) {
+            pthread_cond_wait(&fs->demande_anticipation, &fs->verrou_blocs);
         }
-        
-        // Lecture depuis la source
-        if (lire_fichier(inode_source, buffer, bytes_to_read, offset) != bytes_to_read) {
-            supprimer_fichier(destination);
-            return -1;
+        if (fs->arret_anticipation) {
+            break;
         }
-        
-        // Écriture vers la destination
-        if (ecrire_fichier(inode_dest, buffer, bytes_to_read, offset) != bytes_to_read) {
-            supprimer_fichier(destination);
-            return -1;
+        // Prendre plusieurs demandes pour garder plusieurs lectures en cours
+        DemandeAnticipation lot[NB_DEMANDES_PAR_LOT];
+        int nb = 0;
+        while (fs->nb_demandes > 0 && nb < NB_DEMANDES_PAR_LOT) {
+            lot[nb++] = fs->demandes[fs->premiere_demande];
+            fs->premiere_demande = (fs->premiere_demande + 1) % NB_DEMANDES_ANTICIPATION;
+            fs->nb_demandes--;
         }
-        
-        offset += bytes_to_read;
+        pthread_mutex_unlock(&fs->verrou_blocs);
+
+        charger_blocs_cache(fs, lot, nb);
+        for (int i = 0; i < nb; i++) {
+            terminer_demande(fs, lot[i]);
+        }
+
+        pthread_mutex_lock(&fs->verrou_blocs);
     }
-    
-    return 0;
+    pthread_mutex_unlock(&fs->verrou_blocs);
+    return NULL;
 }
 
 /**
- * Déplace un fichier ou répertoire
- * @param source Le fichier/répertoire source
- * @param destination La nouvelle destination
- * @return 0 si succès, -1 si erreur
+ * Demande le chargement d'une suite de blocs consécutifs : au thread de
+ * lecture anticipée s'il tourne, sinon tout de suite. Une demande qui ne
+ * trouve pas de place dans la file est abandonnée.
+ * @param fs La partition
+ * @param premier Premier bloc
+ * @param nb Nombre de blocs
  */
-int deplacer_fichier(const char* source, const char* destination) {
-    // Recherche de l'inode source
-    int inode_source = trouver_inode_par_nom(inode_courant, source);
-    if (inode_source == -1) {
-        erreur("Fichier source non trouvé");
-        return -1;
+static void demander_blocs(SystemeFichiers* fs, int premier, int nb) {
+    if (!fs->anticipation_asynchrone) {
+        DemandeAnticipation demande = { premier, nb };
+        charger_blocs_cache(fs, &demande, 1);
+        return;
     }
-    
-    // Vérification que la destination n'existe pas
-    if (trouver_inode_par_nom(inode_courant, destination) != -1) {
-        erreur("La destination existe déjà");
-        return -1;
+    pthread_mutex_lock(&fs->verrou_blocs);
+    if (fs->nb_demandes < NB_DEMANDES_ANTICIPATION) {
+        int position = (fs->premiere_demande + fs->nb_demandes) % NB_DEMANDES_ANTICIPATION;
+        fs->demandes[position].premier = premier;
+        fs->demandes[position].nb = nb;
+        fs->nb_demandes++;
+        for (int i = 0; i < nb; i++) {
+            fs->demandes_bloc[premier + i]++;
+        }
+        pthread_cond_signal(&fs->demande_anticipation);
     }
-    
-    // Vérification des droits
-    if (!verifier_droits(inode_source, DROIT_ECRITURE)) {
-        erreur("Permission refusée");
-        return -1;
+    pthread_mutex_unlock(&fs->verrou_blocs);
+}
+
+/**
+ * Note la lecture d'une suite de blocs logiques d'un fichier et, si les
+ * lectures sont séquentielles, fait charger les blocs suivants de la
+ * fenêtre. L'appelant tient le verrou de l'inode (en lecture au moins) et
+ * l'a épinglé.
+ * @param fs La partition
+ * @param inode_id L'inode du fichier
+ * @param inode Le fichier
+ * @param premier_index Le premier bloc logique lu
+ * @param dernier_index Le dernier bloc logique lu
+ */
+static void anticiper_lecture(SystemeFichiers* fs, int inode_id, const Inode* inode, int premier_index, int dernier_index) {
+    int debut, fin;
+
+    pthread_mutex_lock(&fs->verrou_blocs);
+    LectureSequentielle* l = &fs->lectures[inode_id];
+    int suite = premier_index == l->prochain_index || premier_index == l->prochain_index - 1;
+    if (premier_index == l->prochain_index - 1 && dernier_index == premier_index) {
+        // Suite de la lecture du même bloc : rien ne change
+    } else if (suite && l->fenetre > 0) {
+        l->fenetre = l->fenetre * 2 > FENETRE_ANTICIPATION_MAX ? FENETRE_ANTICIPATION_MAX : l->fenetre * 2;
+    } else if (suite || premier_index == 0) {
+        // Deuxième bloc consécutif, ou lecture depuis le début du fichier
+        l->fenetre = FENETRE_ANTICIPATION_MIN;
+        l->anticipe_jusqua = 0;
+    } else {
+        // Accès ailleurs : plus rien n'est anticipé
+        l->fenetre = 0;
+        l->anticipe_jusqua = 0;
     }
-    
-    // Ajout de la nouvelle entrée
-    if (ajouter_entree_repertoire(inode_courant, destination, inode_source) == -1) {
-        return -1;
+    l->prochain_index = dernier_index + 1;
+
+    // Anticiper dès que la moitié de la fenêtre précédente a été consommée
+    debut = l->anticipe_jusqua > dernier_index + 1 ? l->anticipe_jusqua : dernier_index + 1;
+    fin = dernier_index + 1 + l->fenetre;
+    int nb_blocs_fichier = (inode->taille + TAILLE_BLOC - 1) / TAILLE_BLOC;
+    if (fin > nb_blocs_fichier) {
+        fin = nb_blocs_fichier;
+    }
+    if (l->fenetre == 0 || debut >= fin || debut - dernier_index - 1 > l->fenetre / 2) {
+        pthread_mutex_unlock(&fs->verrou_blocs);
+        return;
+    }
+    pthread_mutex_unlock(&fs->verrou_blocs);
+
+    // Table indirecte : lue depuis le cache, ou demandée d'abord si elle
+    // n'y est pas encore (les blocs qu'elle désigne le seront au tour suivant)
+    int blocs_indirects[TAILLE_BLOC / sizeof(int)];
+    int indirecte_connue = 0;
+    if (fin > 10 && inode->bloc_indirect != 0) {
+        if (chercher_bloc_cache(fs, inode->bloc_indirect, blocs_indirects)) {
+            indirecte_connue = 1;
+        } else {
+            demander_blocs(fs, inode->bloc_indirect, 1);
+            fin = debut > 10 ? debut : 10;
+        }
+    }
+    pthread_mutex_lock(&fs->verrou_blocs);
+    l->anticipe_jusqua = fin;
+    pthread_mutex_unlock(&fs->verrou_blocs);
+
+    // Regrouper les blocs physiques consécutifs en une seule demande
+    int premier = 0, nb = 0;
+    for (int i = debut; i < fin; i++) {
+        int bloc = i < 10 ? inode->blocs_directs[i]
+                 : indirecte_connue ? blocs_indirects[i - 10] : 0;
+        if (bloc > 0 && bloc < NB_BLOCS && nb > 0 && bloc == premier + nb && nb < FENETRE_ANTICIPATION_MAX) {
+            nb++;
+            continue;
+        }
+        if (nb > 0) {
+            demander_blocs(fs, premier, nb);
+            nb = 0;
+        }
+        if (bloc > 0 && bloc < NB_BLOCS) {
+            premier = bloc;
+            nb = 1;
+        }
+    }
+    if (nb > 0) {
+        demander_blocs(fs, premier, nb);
     }
-    
-    // Suppression de l'ancienne entrée
-    supprimer_entree_repertoire(inode_courant, source);
-    
-    // Mise à jour de la date de modification
-    inodes[inode_courant].date_modification = time(NULL);
-    
-    return 0;
 }
 
 /**
- * Modifie les droits d'un fichier
- * @param inode_id L'inode à modifier
- * @param nouveaux_droits Les nouveaux droits (en octal)
- * @return 0 si succès, -1 si erreur
+ * Lit le bloc d'entrées d'un répertoire
+ * Un bloc ne contient qu'un nombre entier d'entrées : le reliquat final
+ * est ignoré, si bien que le tableau n'a besoin que de MAX_ENTREES_DIR cases.
+ * @param num_bloc Le numéro du bloc du répertoire
+ * @param entrees Tableau de MAX_ENTREES_DIR entrées à remplir
+ * @return 0 en cas de succès, -1 en cas d'erreur
  */
-int modifier_droits(int inode_id, int nouveaux_droits) {
-    if (inode_id < 0 || inode_id >= NB_INODES) {
-        printf("Erreur: Numéro d'inode invalide.\n");
+int lire_entrees(SystemeFichiers* fs, int num_bloc, EntreeRepertoire* entrees) {
+    char tampon[TAILLE_BLOC];
+    if (lire_bloc(fs, num_bloc, tampon) == -1) {
         return -1;
     }
+    memcpy(entrees, tampon, MAX_ENTREES_DIR * sizeof(EntreeRepertoire));
+    return 0;
+}
 
-    Inode* inode = &inodes[inode_id];
+/**
+ * Écrit le bloc d'entrées d'un répertoire (le reliquat du bloc est mis à zéro)
+ * @param num_bloc Le numéro du bloc du répertoire
+ * @param entrees Tableau de MAX_ENTREES_DIR entrées à écrire
+ */
+void ecrire_entrees(SystemeFichiers* fs, int num_bloc, const EntreeRepertoire* entrees) {
+    char tampon[TAILLE_BLOC];
+    memset(tampon, 0, TAILLE_BLOC);
+    memcpy(tampon, entrees, MAX_ENTREES_DIR * sizeof(EntreeRepertoire));
+    ecrire_bloc(fs, num_bloc, tampon);
+}
 
-    inode->droits = nouveaux_droits; 
-    inode->date_modification = time(NULL);
 
-    printf("Les droits du fichier '%s' ont été modifiés avec succès.\n", inode->nom);
-    return 0;
+/**
+ * Donne le masque des unités d'un bloc de fragments couvertes par un fragment
+ * @param offset Position du fragment dans le bloc
+ * @param longueur Longueur du fragment en octets
+ * @return Le masque d'occupation correspondant
+ */
+static uint32_t masque_fragment(int offset, int longueur) {
+    int premiere = offset / TAILLE_UNITE_FRAGMENT;
+    int nb = (longueur + TAILLE_UNITE_FRAGMENT - 1) / TAILLE_UNITE_FRAGMENT;
+    return (uint32_t)(((1ULL << nb) - 1) << premiere);
 }
 
 /**
- * Convertit une chaîne de droits (rwxrwxrwx) en valeur octale
- * @param droits La chaîne de droits
- * @return La valeur octale ou -1 si format invalide
+ * Réserve la place d'un fragment dans un bloc de fragments.
+ * Les blocs déjà entamés sont remplis avant d'en allouer un nouveau.
+ * @param longueur Longueur du fragment (au plus TAILLE_MAX_FRAGMENT)
+ * @param bloc Reçoit le bloc de fragments choisi
+ * @param offset Reçoit la position du fragment dans ce bloc
+ * @return 0 si succès, -1 si aucune place (l'appelant utilise alors un bloc entier)
  */
-int convertir_droits_char(const char* droits) {
-    int result = 0;
+int allouer_fragment(SystemeFichiers* fs, int longueur, int* bloc, int* offset) {
+    if (longueur <= 0 || longueur > TAILLE_MAX_FRAGMENT) {
+        return -1;
+    }
+    int nb_unites = (longueur + TAILLE_UNITE_FRAGMENT - 1) / TAILLE_UNITE_FRAGMENT;
+    
+    pthread_mutex_lock(&fs->verrou_allocation);
+    for (int i = 0; i < fs->table_fragments.nb_blocs; i++) {
+        BlocFragments* bf = &fs->table_fragments.blocs[i];
+        for (int u = 0; u + nb_unites <= UNITES_PAR_BLOC_FRAGMENTS; u++) {
+            uint32_t masque = masque_fragment(u * TAILLE_UNITE_FRAGMENT, longueur);
+            if (!(bf->occupation & masque)) {
+                bf->occupation |= masque;
+                *bloc = bf->bloc;
+                *offset = u * TAILLE_UNITE_FRAGMENT;
+                pthread_mutex_unlock(&fs->verrou_allocation);
+                return 0;
+            }
+        }
+    }
     
-    // Vérifier que les droits sont bien sous la forme de 9 caractères
-    if (strlen(droits) == 9) {
-        // Les trois premiers caractères sont pour le propriétaire
-        if (droits[0] == 'r') result |= 0400; 
-        if (droits[1] == 'w') result |= 0200; 
-        if (droits[2] == 'x') result |= 0100;
+    // Aucun bloc entamé ne convient : nouveau bloc de fragments
+    int nouveau = -1;
+    if (fs->table_fragments.nb_blocs < MAX_BLOCS_FRAGMENTS) {
+        nouveau = trouver_bloc_libre(fs);
+    }
+    if (nouveau != -1) {
+        BlocFragments* bf = &fs->table_fragments.blocs[fs->table_fragments.nb_blocs++];
+        bf->bloc = nouveau;
+        bf->occupation = masque_fragment(0, longueur);
+        *bloc = nouveau;
+        *offset = 0;
+    }
+    pthread_mutex_unlock(&fs->verrou_allocation);
+    return nouveau == -1 ? -1 : 0;
+}
 
-        // Les trois suivants sont pour le groupe
-        if (droits[3] == 'r') result |= 0040;
-        if (droits[4] == 'w') result |= 0020; 
-        if (droits[5] == 'x') result |= 0010; 
+/**
+ * Libère la place d'un fragment ; le bloc de fragments est rendu au
+ * bitmap quand il ne contient plus aucun fragment
+ * @param bloc Le bloc de fragments
+ * @param offset La position du fragment dans le bloc
+ * @param longueur La longueur du fragment
+ */
+void liberer_fragment(SystemeFichiers* fs, int bloc, int offset, int longueur) {
+    pthread_mutex_lock(&fs->verrou_allocation);
+    for (int i = 0; i < fs->table_fragments.nb_blocs; i++) {
+        BlocFragments* bf = &fs->table_fragments.blocs[i];
+        if (bf->bloc != bloc) {
+            continue;
+        }
+        bf->occupation &= ~masque_fragment(offset, longueur);
+        if (bf->occupation == 0) {
+            liberer_bloc(fs, bloc);
+            *bf = fs->table_fragments.blocs[--fs->table_fragments.nb_blocs];
+        }
+        pthread_mutex_unlock(&fs->verrou_allocation);
+        return;
+    }
+    pthread_mutex_unlock(&fs->verrou_allocation);
+    erreur("Bloc de fragments inconnu");
+}
 
-        // Les trois derniers sont pour les autres
-        if (droits[6] == 'r') result |= 0004;
-        if (droits[7] == 'w') result |= 0002; 
-        if (droits[8] == 'x') result |= 0001;
+/**
+ * Libère le fragment d'un inode et efface sa référence
+ * @param inode L'inode dont les données sont dans un fragment
+ */
+static void detacher_fragment(SystemeFichiers* fs, Inode* inode) {
+    liberer_fragment(fs, inode->bloc_fragment, inode->offset_fragment, inode->longueur_fragment);
+    inode->bloc_fragment = 0;
+    inode->offset_fragment = 0;
+    inode->longueur_fragment = 0;
+    inode->drapeaux &= ~INODE_FRAGMENT;
+}
 
-        return result;
+/**
+ * Lit les données d'un fichier rangé dans un fragment
+ * @param inode L'inode (INODE_FRAGMENT positionné)
+ * @param donnees Buffer d'au moins TAILLE_BLOC octets ; le reste est mis à zéro
+ * @return 0 si succès, -1 si erreur
+ */
+static int lire_fragment(SystemeFichiers* fs, const Inode* inode, char* donnees) {
+    char bloc[TAILLE_BLOC];
+    if (lire_bloc(fs, inode->bloc_fragment, bloc) == -1) {
+        return -1;
     }
-    
-    return -1; // Format invalide
+    memset(donnees, 0, TAILLE_BLOC);
+    memcpy(donnees, bloc + inode->offset_fragment, inode->longueur_fragment);
+    return 0;
 }
 
+/**
+ * Écrit un fragment dans son bloc (lecture-modification-écriture, sous le
+ * verrou du bloc car il est partagé avec d'autres fichiers)
+ * @param bloc Le bloc de fragments
+ * @param offset La position du fragment dans le bloc
+ * @param donnees Les données à écrire
+ * @param longueur La longueur des données
+ */
+static void ecrire_fragment(SystemeFichiers* fs, int bloc, int offset, const char* donnees, int longueur) {
+    char contenu[TAILLE_BLOC];
+    pthread_mutex_t* verrou = &fs->verrous_fragments[bloc % NB_VERROUS_FRAGMENTS];
+    pthread_mutex_lock(verrou);
+    if (lire_bloc(fs, bloc, contenu) == 0) {
+        memcpy(contenu + offset, donnees, longueur);
+        ecrire_bloc(fs, bloc, contenu);
+    }
+    pthread_mutex_unlock(verrou);
+}
 
 /**
- * Sauvegarde l'état actuel de la partition dans un fichier.
- * 
- * @param fichier_sauvegarde Le chemin du fichier où sauvegarder l'état.
- * @return void
+ * Charge la table des fragments depuis le bloc 0 (vide si absente)
  */
-void sauvegarder_etat(const char* fichier_sauvegarde) {
-    FILE* f = fopen(fichier_sauvegarde, "wb");
-    if (!f) {
-        erreur("Impossible d'ouvrir le fichier de sauvegarde");
-        return;
+static void charger_table_fragments(SystemeFichiers* fs) {
+    if (lire_partition(fs, &fs->table_fragments, sizeof(TableFragments), OFFSET_TABLE_FRAGMENTS) == -1
+        || strcmp(fs->table_fragments.signature, SIGNATURE_FRAGMENTS) != 0
+        || fs->table_fragments.nb_blocs < 0 || fs->table_fragments.nb_blocs > MAX_BLOCS_FRAGMENTS) {
+        memset(&fs->table_fragments, 0, sizeof(TableFragments));
     }
+}
+
+/**
+ * Écrit la table des fragments dans le bloc 0
+ */
+static void ecrire_table_fragments(SystemeFichiers* fs) {
+    strcpy(fs->table_fragments.signature, SIGNATURE_FRAGMENTS);
+    ecrire_partition(fs, &fs->table_fragments, sizeof(TableFragments), OFFSET_TABLE_FRAGMENTS);
+}
 
-    fwrite(&superbloc, sizeof(Superbloc), 1, f);
-    fwrite(bitmap, sizeof(bitmap), 1, f);
-    fwrite(inodes, sizeof(inodes), 1, f);
+/**
+ * Alloue les blocs consécutifs de la table des sommes
+ * @param fs La partition
+ * @return Le premier bloc de la table, ou -1 faute de place
+ */
+static int allouer_table_sommes(SystemeFichiers* fs) {
+    int nb_obtenus = 0;
+    int premier = allouer_blocs_contigus(fs, NB_BLOCS_SOMMES, nb_blocs_metadonnees(fs), &nb_obtenus);
+    if (premier != -1 && nb_obtenus < NB_BLOCS_SOMMES) {
+        for (int i = 0; i < nb_obtenus; i++) {
+            liberer_bloc(fs, premier + i);
+        }
+        premier = -1;
+    }
+    return premier;
+}
 
-    void* buffer = malloc(TAILLE_BLOC);
+/**
+ * Recalcule les sommes de tous les blocs d'après leur contenu
+ * @param fs La partition
+ * @return 0 si succès, -1 si erreur
+ */
+static int calculer_toutes_sommes(SystemeFichiers* fs) {
+    char* buffer = allouer_aligne((size_t)NB_BLOCS_COPIE * TAILLE_BLOC);
     if (!buffer) {
-        fclose(f);
         erreur("Mémoire insuffisante");
-        return;
+        return -1;
     }
-
-    for (int i = 0; i < NB_BLOCS; i++) {
-        fseek(partition_file, i * TAILLE_BLOC, SEEK_SET);
-        fread(buffer, TAILLE_BLOC, 1, partition_file);
-        fwrite(buffer, TAILLE_BLOC, 1, f);
+    int resultat = 0;
+    for (int i = 0; i < NB_BLOCS && resultat == 0; i += NB_BLOCS_COPIE) {
+        int nb = NB_BLOCS - i < NB_BLOCS_COPIE ? NB_BLOCS - i : NB_BLOCS_COPIE;
+        resultat = lire_partition(fs, buffer, (size_t)nb * TAILLE_BLOC, (off_t)i * TAILLE_BLOC);
+        for (int j = 0; j < nb && resultat == 0; j++) {
+            fs->sommes[i + j] = calculer_crc32c(buffer + (size_t)j * TAILLE_BLOC, TAILLE_BLOC);
+            fs->somme_perimee[i + j] = 0;
+        }
     }
-
     free(buffer);
-    fclose(f);
-    printf("Partition sauvegardée dans '%s'\n", fichier_sauvegarde);
+    return resultat;
 }
 
 /**
- * Restaure l'état de la partition à partir d'un fichier de sauvegarde.
- * 
- * @param fichier_sauvegarde Le chemin du fichier de sauvegarde.
- * @return void
+ * Prépare les sommes de contrôle d'une partition qui vient d'être lue.
+ * La table enregistrée n'est reprise que si la partition a été fermée
+ * proprement ; sinon, ou si la partition n'en a pas encore, les sommes
+ * sont recalculées d'après le contenu des blocs. Faute de NB_BLOCS_SOMMES
+ * blocs libres consécutifs, la partition reste sans sommes.
+ * @param fs La partition
+ * @param reprendre 1 pour reprendre la table enregistrée si elle est à jour
  */
-void restaurer_etat(const char* fichier_sauvegarde) {
-    FILE* f = fopen(fichier_sauvegarde, "rb");
-    if (!f) {
-        erreur("Impossible d'ouvrir le fichier de restauration");
+static void charger_sommes_controle(SystemeFichiers* fs, int reprendre) {
+    EnTeteSommes en_tete;
+    int existante = lire_partition(fs, &en_tete, sizeof(en_tete), OFFSET_EN_TETE_SOMMES) == 0
+                    && memcmp(en_tete.signature, SIGNATURE_SOMMES, sizeof(SIGNATURE_SOMMES)) == 0
+                    && en_tete.premier_bloc >= nb_blocs_metadonnees(fs)
+                    && en_tete.premier_bloc <= NB_BLOCS - NB_BLOCS_SOMMES;
+
+    fs->bloc_sommes = -1;
+    if (existante && reprendre && !fs->superbloc.verifier_integrite
+            && lire_partition(fs, fs->sommes, sizeof(fs->sommes), (off_t)en_tete.premier_bloc * TAILLE_BLOC) == 0) {
+        memset(fs->somme_perimee, 0, sizeof(fs->somme_perimee));
+        fs->bloc_sommes = en_tete.premier_bloc;
         return;
     }
+    int premier = existante ? en_tete.premier_bloc : allouer_table_sommes(fs);
+    if (premier != -1 && calculer_toutes_sommes(fs) == 0) {
+        fs->bloc_sommes = premier;
+    }
+}
 
-    fread(&superbloc, sizeof(Superbloc), 1, f);
-    fread(bitmap, sizeof(bitmap), 1, f);
-    fread(inodes, sizeof(inodes), 1, f);
+/**
+ * Recalcule d'après le disque les sommes des blocs écrits en partie,
+ * sauf pendant une transaction (ses blocs ne sont pas encore sur le
+ * disque). Ces écritures (superbloc, bitmap, fragments) se font sous le
+ * verrou d'allocation, que l'appelant tient.
+ * @param fs La partition
+ */
+static void rafraichir_sommes_perimees(SystemeFichiers* fs) {
+    if (fs->session_transaction != NULL) {
+        return;
+    }
+    char* bloc = NULL;
+    for (int b = 0; b < NB_BLOCS; b++) {
+        if (!__atomic_load_n(&fs->somme_perimee[b], __ATOMIC_RELAXED)) {
+            continue;
+        }
+        if (bloc == NULL && (bloc = allouer_aligne(TAILLE_BLOC)) == NULL) {
+            return;
+        }
+        if (lire_disque(fs, bloc, TAILLE_BLOC, (off_t)b * TAILLE_BLOC) == 0) {
+            __atomic_store_n(&fs->sommes[b], calculer_crc32c(bloc, TAILLE_BLOC), __ATOMIC_RELAXED);
+            __atomic_store_n(&fs->somme_perimee[b], 0, __ATOMIC_RELAXED);
+        }
+    }
+    free(bloc);
+}
 
-    void* buffer = malloc(TAILLE_BLOC);
-    if (!buffer) {
-        fclose(f);
+/**
+ * Écrit la table des sommes et son en-tête, après avoir recalculé les
+ * sommes des blocs écrits en partie. La table sur le disque n'est à jour
+ * qu'à la fermeture : elle n'est reprise au chargement que si la
+ * partition a été fermée proprement.
+ * @param fs La partition
+ */
+static void ecrire_sommes_controle(SystemeFichiers* fs) {
+    if (fs->bloc_sommes == -1) {
+        return;
+    }
+    uint32_t* copie = (uint32_t*)allouer_aligne((size_t)NB_BLOCS_SOMMES * TAILLE_BLOC);
+    if (!copie) {
         erreur("Mémoire insuffisante");
         return;
     }
 
-    for (int i = 0; i < NB_BLOCS; i++) {
-        fread(buffer, TAILLE_BLOC, 1, f);
-        fseek(partition_file, i * TAILLE_BLOC, SEEK_SET);
-        fwrite(buffer, TAILLE_BLOC, 1, partition_file);
+    pthread_mutex_lock(&fs->verrou_allocation);
+    EnTeteSommes en_tete = { SIGNATURE_SOMMES, fs->bloc_sommes };
+    ecrire_partition(fs, &en_tete, sizeof(en_tete), OFFSET_EN_TETE_SOMMES);
+    rafraichir_sommes_perimees(fs);
+    // Copie : les autres threads continuent de mettre les sommes à jour
+    memset(copie, 0, (size_t)NB_BLOCS_SOMMES * TAILLE_BLOC);
+    for (int b = 0; b < NB_BLOCS; b++) {
+        copie[b] = __atomic_load_n(&fs->sommes[b], __ATOMIC_RELAXED);
     }
+    ecrire_partition(fs, copie, (size_t)NB_BLOCS_SOMMES * TAILLE_BLOC, (off_t)fs->bloc_sommes * TAILLE_BLOC);
+    pthread_mutex_unlock(&fs->verrou_allocation);
+    free(copie);
+}
 
-    free(buffer);
-    fclose(f);
-    printf("Partition restaurée depuis '%s'\n", fichier_sauvegarde);
+/**
+ * Reconstruit l'index des blocs dédupliqués d'après la table des
+ * références. La clé d'un bloc est sa somme de contrôle, relue sur le
+ * disque si elle n'est pas à jour.
+ * @param fs La partition
+ */
+static void reconstruire_index_dedup(SystemeFichiers* fs) {
+    char* bloc = NULL;
+    vider_index_dedup(fs);
+    for (int b = 0; b < NB_BLOCS; b++) {
+        if (fs->references[b] == 0) {
+            continue;
+        }
+        uint32_t somme = fs->sommes[b];
+        if (fs->bloc_sommes == -1 || fs->somme_perimee[b]) {
+            if (bloc == NULL && (bloc = allouer_aligne(TAILLE_BLOC)) == NULL) {
+                break;
+            }
+            if (lire_partition(fs, bloc, TAILLE_BLOC, (off_t)b * TAILLE_BLOC) == 0) {
+                somme = calculer_crc32c(bloc, TAILLE_BLOC);
+            }
+        }
+        indexer_bloc(fs, b, somme);
+    }
+    free(bloc);
 }
 
 /**
- * Recherche un inode par son nom dans la table des inodes
- * @param nom Nom du fichier/répertoire à rechercher
- * @return Pointeur vers l'inode trouvé, ou NULL si non trouvé
+ * Alloue le bloc de la table des références, au début de la zone de données
+ * @param fs La partition
+ * @return Le bloc de la table, ou -1 faute de place
  */
-Inode* trouver_ind(char* nom) {
-    for (int i = 0; i < NB_INODES; i++) {
-        // Vérification si le nom de l'inode correspond à celui recherché
-        if (strcmp(inodes[i].nom, nom) == 0) {
-            return &inodes[i];  // Retourne l'inode correspondant
+static int allouer_table_references(SystemeFichiers* fs) {
+    int nb_obtenus = 0;
+    fs->bloc_references = allouer_blocs_contigus(fs, 1, nb_blocs_metadonnees(fs), &nb_obtenus);
+    return fs->bloc_references;
+}
+
+/**
+ * Lit la table des références d'une partition qui vient d'être lue et
+ * reconstruit l'index des blocs dédupliqués. Une partition qui n'a pas
+ * encore de table en reçoit une si la déduplication est active.
+ * @param fs La partition
+ */
+static void charger_references(SystemeFichiers* fs) {
+    EnTeteReferences en_tete;
+    fs->bloc_references = -1;
+    if (lire_partition(fs, &en_tete, sizeof(en_tete), OFFSET_EN_TETE_REFERENCES) == 0
+            && memcmp(en_tete.signature, SIGNATURE_REFERENCES, sizeof(SIGNATURE_REFERENCES)) == 0
+            && en_tete.bloc >= nb_blocs_metadonnees(fs) && en_tete.bloc < NB_BLOCS
+            && lire_partition(fs, fs->references, sizeof(fs->references), (off_t)en_tete.bloc * TAILLE_BLOC) == 0) {
+        fs->bloc_references = en_tete.bloc;
+    } else {
+        memset(fs->references, 0, sizeof(fs->references));
+        if (fs->deduplication) {
+            allouer_table_references(fs);
         }
     }
-    // Si le fichier ou répertoire n'est pas trouvé, afficher un message d'erreur.
-    printf("Inode non trouvé pour %s\n", nom);
-    return NULL;
+    reconstruire_index_dedup(fs);
 }
 
 /**
- * Affiche les informations détaillées d'un inode (métadonnées d'un fichier/répertoire)
- * @param inode Pointeur vers la structure Inode à afficher
+ * Relit depuis le disque le superbloc, le bitmap, les tables des
+ * fragments et des références, et oublie les pages d'inodes en mémoire
+ * @param fs La partition
+ * @return 0 si succès, -1 si erreur
  */
-void afficher_inode(const Inode *inode) {
-    // Affichage des informations de l'inode
-    printf("Nom: %s\n", inode->nom);
-    printf("Taille: %d octets\n", inode->taille);
-    
-    // Affichage du type (fichier, répertoire, lien)
-    const char *type_str;
-    switch (inode->type) {
-        case TYPE_FICHIER:
-            type_str = "Fichier";
-            break;
-        case TYPE_REPERTOIRE:
-            type_str = "Répertoire";
-            break;
-        case TYPE_LIEN_SYMBOLIQUE:
-            type_str = "Lien symbolique";
-            break;
-        case TYPE_LIEN_PHYSIQUE:
-            type_str = "Lien physique";
-            break;
-        default:
-            type_str = "Type inconnu";
-            break;
+static int recharger_metadonnees(SystemeFichiers* fs) {
+    int resultat = 0;
+    pthread_mutex_lock(&fs->verrou_allocation);
+    if (lire_partition(fs, &fs->superbloc, sizeof(Superbloc), 0) == -1
+            || lire_partition(fs, fs->bitmap, TAILLE_BITMAP, OFFSET_BITMAP) == -1) {
+        resultat = -1;
+    }
+    charger_table_fragments(fs);
+    pthread_mutex_unlock(&fs->verrou_allocation);
+    charger_references(fs);
+    invalider_cache_inodes(fs);
+    return resultat;
+}
+
+/**
+ * Écrit la table des références et son en-tête.
+ * L'appelant tient le verrou d'allocation.
+ * @param fs La partition
+ */
+static void ecrire_table_references(SystemeFichiers* fs) {
+    if (fs->bloc_references == -1) {
+        return;
+    }
+    EnTeteReferences en_tete = { SIGNATURE_REFERENCES, fs->bloc_references };
+    ecrire_partition(fs, &en_tete, sizeof(en_tete), OFFSET_EN_TETE_REFERENCES);
+    char bloc[TAILLE_BLOC] = { 0 };
+    memcpy(bloc, fs->references, sizeof(fs->references));
+    ecrire_partition(fs, bloc, TAILLE_BLOC, (off_t)fs->bloc_references * TAILLE_BLOC);
+}
+
+/* Flux de sortie du thread courant (NULL : stdout et stderr) et nombre
+ * d'erreurs signalées depuis la dernière redirection */
+static __thread FILE* sortie_thread = NULL;
+static __thread int nb_erreurs_thread = 0;
+
+/**
+ * Redirige les affichages du thread courant (résultats et erreurs),
+ * par exemple vers la réponse destinée à un client du démon
+ * @param flux Le flux de destination, ou NULL pour revenir à stdout/stderr
+ */
+void rediriger_sortie(FILE* flux) {
+    sortie_thread = flux;
+    nb_erreurs_thread = 0;
+}
+
+/**
+ * Donne le flux où le thread courant doit écrire ses résultats
+ * @return Le flux redirigé, ou stdout
+ */
+FILE* flux_sortie(void) {
+    return sortie_thread ? sortie_thread : stdout;
+}
+
+/**
+ * Nombre d'erreurs signalées par le thread courant depuis le dernier
+ * appel à rediriger_sortie
+ * @return Le nombre d'erreurs
+ */
+int nb_erreurs(void) {
+    return nb_erreurs_thread;
+}
+
+/**
+ * Affiche un message d'erreur sur stderr (ou sur le flux redirigé)
+ * @param message Le message d'erreur à afficher
+ */
+void erreur(const char* message) {
+    nb_erreurs_thread++;
+    fprintf(sortie_thread ? sortie_thread : stderr, "Erreur: %s\n", message);
+}
+
+/**
+ * Crée un nouveau fichier ou répertoire
+ * @param nom Le nom du nouveau fichier
+ * @param type TYPE_FICHIER ou TYPE_REPERTOIRE
+ * @return L'identifiant de l'inode créé, ou -1 en cas d'erreur
+ */
+static int creer_fichier_interne(Session* s, const char* nom, int type) {
+    SystemeFichiers* fs = s->fs;
+    // Vérifier la longueur du nom
+    if (strlen(nom) > MAX_NOM_FICHIER) {
+        erreur("Nom de fichier trop long");
+        return -1;
     }
-    printf("Type: %s\n", type_str);
-    
-    // Affichage du propriétaire et du groupe
-    printf("Propriétaire (UID): %d\n", inode->proprietaire);
-    printf("Groupe (GID): %d\n", inode->groupe);
     
-    // Affichage des droits d'accès (format Unix)
-    printf("Droits: %o\n", inode->droits);
+    // Vérifier si un fichier du même nom existe déjà
+    if (trouver_inode_par_nom(fs, s->inode_courant, nom) != -1) {
+        erreur("Un fichier avec ce nom existe déjà");
+        return -1;
+    }
     
-    // Affichage des dates de création, modification, et accès
-    char date_creation[20], date_modification[20], date_acces[20];
-    strftime(date_creation, sizeof(date_creation), "%Y-%m-%d %H:%M:%S", localtime(&inode->date_creation));
-    strftime(date_modification, sizeof(date_modification), "%Y-%m-%d %H:%M:%S", localtime(&inode->date_modification));
-    strftime(date_acces, sizeof(date_acces), "%Y-%m-%d %H:%M:%S", localtime(&inode->date_acces));
+    // Trouver un inode libre
+    int inode_id = trouver_inode_libre(fs);
+    if (inode_id == -1) {
+        erreur("Aucun inode libre");
+        return -1;
+    }
     
-    printf("Date de création: %s\n", date_creation);
-    printf("Date de dernière modification: %s\n", date_modification);
-    printf("Date de dernier accès: %s\n", date_acces);
+    // Initialiser l'inode (verrouillé : trouver_inode_libre ne doit pas le
+    // voir à moitié rempli)
+    verrouiller_inode(fs, inode_id, 1);
+    Inode* new_inode = epingler_inode(fs, inode_id);
+    if (new_inode == NULL) {
+        liberer_inode(fs, inode_id);
+        deverrouiller_inode(fs, inode_id);
+        erreur("Impossible de charger l'inode");
+        return -1;
+    }
+    memset(new_inode, 0, sizeof(Inode));
     
-    // Affichage du nombre de liens
-    printf("Nombre de liens: %d\n", inode->nb_liens);
+    new_inode->type = type;
+    new_inode->date_creation = time(NULL);
+    new_inode->date_modification = time(NULL);
+    new_inode->date_acces = time(NULL);
+    new_inode->nb_liens = 1;
+    new_inode->proprietaire = getuid();
+    new_inode->groupe = getgid();
     
-    // Créer un buffer suffisamment grand pour le contenu complet
-    // Calculer d'abord combien d'espace nous avons besoin
-    int max_taille_fichier = TAILLE_BLOC * 10;  // Pour blocs directs
-    if (inode->bloc_indirect != 0) {
-        max_taille_fichier += TAILLE_BLOC * (TAILLE_BLOC / sizeof(int));  // Pour blocs indirects
+    // Définir les droits par défaut
+    if (type == TYPE_REPERTOIRE) {
+        new_inode->droits = 0755;  // rwxr-xr-x
+        new_inode->taille = TAILLE_BLOC; // Taille initiale d'un répertoire
+        
+        // Allouer un bloc pour le répertoire
+        int bloc = trouver_bloc_libre(fs);
+        if (bloc == -1) {
+            desepingler_inode(fs, inode_id, 1);
+            liberer_inode(fs, inode_id);
+            deverrouiller_inode(fs, inode_id);
+            erreur("Aucun bloc libre");
+            return -1;
+        }
+        new_inode->blocs_directs[0] = bloc;
+        
+        // Initialiser le contenu du répertoire
+        EntreeRepertoire entrees[MAX_ENTREES_DIR] = {0};
+        
+        // Ajouter les entrées "." et ".."
+        strcpy(entrees[0].nom, ".");
+        entrees[0].inode = inode_id;
+        
+        strcpy(entrees[1].nom, "..");
+        entrees[1].inode = s->inode_courant;
+        
+        // Écrire les entrées dans le bloc
+        ecrire_entrees(fs, bloc, entrees);
+    } else {
+        new_inode->droits = 0644;  // rw-r--r--
+        new_inode->taille = 0;     // Taille initiale d'un fichier
     }
     
-    // Allouer dynamiquement la mémoire nécessaire
-    unsigned char *buffer_complet = NULL;
-    if (inode->type == TYPE_FICHIER && inode->taille > 0) {
-        buffer_complet = (unsigned char *)malloc(inode->taille + 1);  // +1 pour le '\0' terminal
-        if (!buffer_complet) {
-            printf("Erreur: Impossible d'allouer de la mémoire pour le contenu du fichier\n");
-            return;
+    int bloc_repertoire = new_inode->blocs_directs[0];
+    desepingler_inode(fs, inode_id, 1);
+    deverrouiller_inode(fs, inode_id);
+    
+    // Ajouter l'entrée au répertoire courant
+    if (ajouter_entree_repertoire(fs, s->inode_courant, nom, inode_id) == -1) {
+        // Libérer les ressources en cas d'échec
+        if (type == TYPE_REPERTOIRE) {
+            liberer_bloc(fs, bloc_repertoire);
         }
-        memset(buffer_complet, 0, inode->taille + 1);  // Initialiser à zéro
+        liberer_inode(fs, inode_id);
+        return -1;
     }
     
-    int octets_lus = 0;
-    int taille_restante = inode->taille;
-    
-    // Affichage des blocs directs
-    printf("\n=== Blocs directs ===\n");
-    for (int i = 0; i < 10 && taille_restante > 0; i++) {
-        if (inode->blocs_directs[i] != 0) {
-            printf("Bloc direct %d: Numéro de bloc = %d (offset physique = %ld octets)\n", 
-                i, inode->blocs_directs[i], (long)inode->blocs_directs[i] * TAILLE_BLOC);
-            
-            // Lire le contenu du bloc
-            unsigned char buffer[TAILLE_BLOC];
-            if (lire_bloc(inode->blocs_directs[i], buffer) == 0) {
-                int taille_bloc = taille_restante < TAILLE_BLOC ? taille_restante : TAILLE_BLOC;
-                
-                printf("  Contenu du bloc (octets %d à %d du fichier):\n  ", 
-                       octets_lus, octets_lus + taille_bloc - 1);
-                
-                // Afficher le contenu en texte (si possible)
-                printf("Texte: ");
-                for (int j = 0; j < taille_bloc; j++) {
-                    if (isprint(buffer[j])) {
-                        printf("%c", buffer[j]);
-                    } else {
-                        printf(".");
+    // La date de modification du répertoire parent a été mise à jour par
+    // ajouter_entree_repertoire, sous le verrou du répertoire
+    return inode_id;
+}
+
+/**
+ * Vide l'index des noms
+ * @param fs La partition
+ */
+static void vider_index_noms(SystemeFichiers* fs) {
+    IndexNoms* index = &fs->index_noms;
+    for (int i = 0; i < MAX_NOMS_INDEX; i++) {
+        free(index->noms[i].nom);
+        index->noms[i].nom = NULL;
+        index->noms[i].suivant = i + 1 < MAX_NOMS_INDEX ? i + 1 : -1;
+    }
+    for (int i = 0; i < NB_SEAUX_NOMS; i++) {
+        index->seaux[i] = -1;
+    }
+    for (int i = 0; i < NB_SEAUX_TRIGRAMMES; i++) {
+        index->trigrammes[i].nb = 0;
+    }
+    for (int i = 0; i < NB_INODES; i++) {
+        index->nom_repertoire[i] = -1;
+    }
+    index->premiere_libre = 0;
+    index->nb_noms = 0;
+    index->etat = INDEX_NOMS_VIDE;
+}
+
+/**
+ * Hachage FNV-1a d'un nom
+ * @param nom Le nom
+ * @return Son seau dans l'index des noms
+ */
+static int seau_du_nom(const char* nom) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char* c = (const unsigned char*)nom; *c; c++) {
+        h = (h ^ *c) * 16777619u;
+    }
+    return (int)(h & (NB_SEAUX_NOMS - 1));
+}
+
+/**
+ * Seau d'un trigramme
+ * @param t Ses trois octets
+ * @return Son seau dans l'index des noms
+ */
+static int seau_du_trigramme(const char* t) {
+    uint32_t mot = (uint32_t)(unsigned char)t[0] << 16 | (uint32_t)(unsigned char)t[1] << 8
+                   | (unsigned char)t[2];
+    return (int)((mot * 2654435761u) >> 20) & (NB_SEAUX_TRIGRAMMES - 1);
+}
+
+/**
+ * Ajoute un nom dans l'index : dans le seau de son hachage et dans le
+ * seau de chacun de ses trigrammes (une seule fois par seau). Rien n'est
+ * fait tant que l'index n'est pas construit, ni pour un nom déjà indexé
+ * (relevé par la construction après son ajout).
+ * L'appelant tient le verrou du répertoire.
+ * @param parent Le répertoire qui contient l'entrée
+ * @param nom Le nom de l'entrée
+ * @param inode L'inode qu'elle désigne
+ */
+static void indexer_nom(SystemeFichiers* fs, int parent, const char* nom, int inode) {
+    if (nom[0] == '\0' || strcmp(nom, ".") == 0 || strcmp(nom, "..") == 0) {
+        return;
+    }
+    pthread_mutex_lock(&fs->verrou_noms);
+    IndexNoms* index = &fs->index_noms;
+    int seau = seau_du_nom(nom);
+    int k = index->seaux[seau];
+    while (k != -1 && (index->noms[k].parent != parent || strcmp(index->noms[k].nom, nom) != 0)) {
+        k = index->noms[k].suivant;
+    }
+    if (index->etat == INDEX_NOMS_VIDE || k != -1) {
+        pthread_mutex_unlock(&fs->verrou_noms);
+        return;
+    }
+    k = index->premiere_libre;
+    char* copie = k != -1 ? strdup(nom) : NULL;
+    if (copie == NULL) {
+        pthread_mutex_unlock(&fs->verrou_noms);
+        return;                           // Introuvable par find, sans autre conséquence
+    }
+    NomIndexe* entree = &index->noms[k];
+    index->premiere_libre = entree->suivant;
+    *entree = (NomIndexe){ copie, parent, inode, index->seaux[seau] };
+    index->seaux[seau] = k;
+    index->nb_noms++;
+    // Un répertoire renommé reçoit son nouveau nom avant de perdre l'ancien
+    if (inode >= 0 && inode < NB_INODES) {
+        index->nom_repertoire[inode] = k;
+    }
+
+    for (size_t i = 0; i + 3 <= strlen(nom); i++) {
+        ListeTrigrammes* liste = &index->trigrammes[seau_du_trigramme(nom + i)];
+        if (liste->nb > 0 && liste->cases[liste->nb - 1] == k) {
+            continue;
+        }
+        if (liste->nb == liste->capacite) {
+            int capacite = liste->capacite ? 2 * liste->capacite : 8;
+            int* cases = realloc(liste->cases, (size_t)capacite * sizeof(int));
+            if (cases == NULL) {
+                continue;
+            }
+            liste->cases = cases;
+            liste->capacite = capacite;
+        }
+        liste->cases[liste->nb++] = k;
+    }
+    pthread_mutex_unlock(&fs->verrou_noms);
+}
+
+/**
+ * Retire un nom de l'index.
+ * L'appelant tient le verrou du répertoire.
+ * @param parent Le répertoire qui contenait l'entrée
+ * @param nom Le nom de l'entrée
+ */
+static void desindexer_nom(SystemeFichiers* fs, int parent, const char* nom) {
+    pthread_mutex_lock(&fs->verrou_noms);
+    IndexNoms* index = &fs->index_noms;
+    int* lien = &index->seaux[seau_du_nom(nom)];
+    while (*lien != -1 && (index->noms[*lien].parent != parent || strcmp(index->noms[*lien].nom, nom) != 0)) {
+        lien = &index->noms[*lien].suivant;
+    }
+    int k = *lien;
+    if (k == -1) {
+        pthread_mutex_unlock(&fs->verrou_noms);
+        return;
+    }
+    NomIndexe* entree = &index->noms[k];
+    *lien = entree->suivant;
+
+    // Retrait des listes de trigrammes : la dernière case prend sa place
+    for (size_t i = 0; i + 3 <= strlen(nom); i++) {
+        ListeTrigrammes* liste = &index->trigrammes[seau_du_trigramme(nom + i)];
+        for (int j = 0; j < liste->nb; j++) {
+            if (liste->cases[j] == k) {
+                liste->cases[j] = liste->cases[--liste->nb];
+                break;
+            }
+        }
+    }
+    if (entree->inode >= 0 && entree->inode < NB_INODES && index->nom_repertoire[entree->inode] == k) {
+        index->nom_repertoire[entree->inode] = -1;
+    }
+    free(entree->nom);
+    entree->nom = NULL;
+    entree->suivant = index->premiere_libre;
+    index->premiere_libre = k;
+    index->nb_noms--;
+    pthread_mutex_unlock(&fs->verrou_noms);
+}
+
+/**
+ * Remonte de l'entrée d'un nom jusqu'à la racine, par les noms des
+ * répertoires parents. L'appelant tient le verrou de l'index.
+ * @param k La case du nom
+ * @param composantes Reçoit au plus NB_INODES cases, du nom vers la racine
+ * @return Le nombre de composantes du chemin, -1 s'il ne mène pas à la racine
+ */
+static int remonter_nom(const IndexNoms* index, int k, int* composantes) {
+    for (int nb = 0; nb < NB_INODES;) {
+        composantes[nb++] = k;
+        int parent = index->noms[k].parent;
+        if (parent == ID_INODE_RACINE) {
+            return nb;
+        }
+        if (parent < 0 || parent >= NB_INODES || (k = index->nom_repertoire[parent]) == -1) {
+            return -1;
+        }
+    }
+    return -1;                            // Boucle de répertoires
+}
+
+/**
+ * Construit l'index des noms à partir des entrées de tous les
+ * répertoires de la table des inodes. Les créations et suppressions
+ * concurrentes sont appliquées à l'index pendant la construction ; chaque
+ * répertoire est indexé sous son verrou, si bien qu'une entrée relevée ne
+ * peut pas avoir été retirée avant d'être indexée. Un répertoire
+ * inaccessible depuis la racine est indexé, mais ses noms n'ont pas de
+ * chemin et ne sont jamais rendus.
+ * L'appelant tient verrou_construction_noms.
+ * @param fs La partition
+ */
+static void construire_index_noms(SystemeFichiers* fs) {
+    pthread_mutex_lock(&fs->verrou_noms);
+    vider_index_noms(fs);
+    fs->index_noms.etat = INDEX_NOMS_EN_CONSTRUCTION;
+    pthread_mutex_unlock(&fs->verrou_noms);
+
+    for (int i = 0; i < fs->superbloc.nb_inodes; i++) {
+        verrouiller_inode(fs, i, 0);
+        Inode* inode = epingler_inode(fs, i);
+        if (inode == NULL) {
+            deverrouiller_inode(fs, i);
+            continue;
+        }
+        int bloc = inode->type == TYPE_REPERTOIRE && inode->nb_liens > 0 ? inode->blocs_directs[0] : 0;
+        desepingler_inode(fs, i, 0);
+        EntreeRepertoire entrees[MAX_ENTREES_DIR];
+        if (bloc != 0 && lire_entrees(fs, bloc, entrees) == 0) {
+            for (int k = 0; k < MAX_ENTREES_DIR; k++) {
+                if (entrees[k].inode > 0) {
+                    indexer_nom(fs, i, entrees[k].nom, entrees[k].inode);
+                }
+            }
+        }
+        deverrouiller_inode(fs, i);
+    }
+
+    pthread_mutex_lock(&fs->verrou_noms);
+    fs->index_noms.etat = INDEX_NOMS_PRET;
+    pthread_mutex_unlock(&fs->verrou_noms);
+}
+
+/**
+ * Construit l'index des noms s'il ne l'est pas encore : la première
+ * recherche paie le relevé des répertoires, pas le chargement
+ * @param fs La partition
+ */
+static void preparer_index_noms(SystemeFichiers* fs) {
+    pthread_mutex_lock(&fs->verrou_construction_noms);
+    pthread_mutex_lock(&fs->verrou_noms);
+    int pret = fs->index_noms.etat == INDEX_NOMS_PRET;
+    pthread_mutex_unlock(&fs->verrou_noms);
+    if (!pret) {
+        construire_index_noms(fs);
+    }
+    pthread_mutex_unlock(&fs->verrou_construction_noms);
+}
+
+/**
+ * Vide l'index des noms, reconstruit à la prochaine recherche. Appelée
+ * quand les répertoires ont changé sans passer par ajouter_entree et
+ * retirer_entree : restauration, annulation d'une transaction,
+ * réparation, conversion des liens de l'ancien format.
+ * @param fs La partition
+ */
+static void invalider_index_noms(SystemeFichiers* fs) {
+    pthread_mutex_lock(&fs->verrou_noms);
+    vider_index_noms(fs);
+    pthread_mutex_unlock(&fs->verrou_noms);
+}
+
+/**
+ * Ajoute une entrée dans un répertoire verrouillé en écriture par l'appelant
+ * @param inode_dir L'inode du répertoire parent
+ * @param nom Le nom de la nouvelle entrée
+ * @param inode L'inode à associer
+ * @return 0 en cas de succès, -1 sinon
+ */
+static int ajouter_entree(SystemeFichiers* fs, int inode_dir, const char* nom, int inode) {
+    // Vérifier que l'inode du répertoire est valide
+    Inode* repertoire = epingler_inode(fs, inode_dir);
+    if (repertoire == NULL || repertoire->type != TYPE_REPERTOIRE) {
+        if (repertoire != NULL) {
+            desepingler_inode(fs, inode_dir, 0);
+        }
+        erreur("L'inode n'est pas un répertoire ou l'inode est invalide");
+        return -1;
+    }
+
+    // Vérifier que le nom n'est pas trop long
+    if (strlen(nom) > MAX_NOM_FICHIER) {
+        desepingler_inode(fs, inode_dir, 0);
+        erreur("Nom de fichier trop long");
+        return -1;
+    }
+
+    // Vérifier que l'inode à ajouter est valide
+    if (!inode_valide(fs, inode)) {
+        desepingler_inode(fs, inode_dir, 0);
+        erreur("Numéro d'inode invalide");
+        return -1;
+    }
+
+    // Vérifier si un bloc existe déjà pour le répertoire
+    if (repertoire->blocs_directs[0] == 0) {
+        int nouveau_bloc = trouver_bloc_libre(fs);
+        if (nouveau_bloc == -1) {
+            desepingler_inode(fs, inode_dir, 0);
+            erreur("Impossible d'allouer un bloc pour le répertoire");
+            return -1;
+        }
+        repertoire->blocs_directs[0] = nouveau_bloc;
+    }
+
+    // Lire le contenu du répertoire
+    EntreeRepertoire entrees[MAX_ENTREES_DIR];
+    lire_entrees(fs, repertoire->blocs_directs[0], entrees);
+
+    // Vérifier si le nom existe déjà
+    for (int i = 0; i < MAX_ENTREES_DIR; i++) {
+        if (strcmp(entrees[i].nom, nom) == 0) {
+            desepingler_inode(fs, inode_dir, 1);
+            erreur("Une entrée avec ce nom existe déjà");
+            return -1;
+        }
+    }
+
+    // Trouver une entrée libre
+    int index = -1;
+    for (int i = 0; i < MAX_ENTREES_DIR; i++) {
+        if (entrees[i].nom[0] == '\0') {
+            index = i;
+            break;
+        }
+    }
+
+    if (index == -1) {
+        desepingler_inode(fs, inode_dir, 1);
+        erreur("Répertoire plein");
+        return -1;
+    }
+
+    // Ajouter la nouvelle entrée
+    strncpy(entrees[index].nom, nom, MAX_NOM_FICHIER);
+    entrees[index].nom[MAX_NOM_FICHIER] = '\0';  // Assurer la terminaison
+    entrees[index].inode = inode;
+
+    // Écrire les modifications
+    ecrire_entrees(fs, repertoire->blocs_directs[0], entrees);
+
+    // Mise à jour de l'inode du répertoire
+    repertoire->date_modification = time(NULL);
+    desepingler_inode(fs, inode_dir, 1);
+    indexer_nom(fs, inode_dir, nom, inode);
+
+    return 0;
+}
+
+/**
+ * Ajoute une entrée dans un répertoire
+ * @param inode_dir L'inode du répertoire parent
+ * @param nom Le nom de la nouvelle entrée
+ * @param inode L'inode à associer
+ * @return 0 en cas de succès, -1 sinon
+ */
+int ajouter_entree_repertoire(SystemeFichiers* fs, int inode_dir, const char* nom, int inode) {
+    if (!inode_valide(fs, inode_dir)) {
+        erreur("L'inode n'est pas un répertoire ou l'inode est invalide");
+        return -1;
+    }
+    verrouiller_inode(fs, inode_dir, 1);
+    int resultat = ajouter_entree(fs, inode_dir, nom, inode);
+    deverrouiller_inode(fs, inode_dir);
+    return resultat;
+}
+
+/**
+ * Cherche un nom dans un répertoire verrouillé par l'appelant
+ * @param inode_dir L'inode du répertoire où chercher
+ * @param nom Le nom du fichier/dossier à trouver
+ * @return L'identifiant de l'inode trouvé ou -1 si non trouvé/erreur
+ */
+static int chercher_entree(SystemeFichiers* fs, int inode_dir, const char* nom) {
+    // Vérification de la validité de l'inode
+    Inode* repertoire = epingler_inode(fs, inode_dir);
+    if (repertoire == NULL) {
+        erreur("Inode invalide");
+        return -1;
+    }
+    
+    // Vérification que l'inode est bien un répertoire
+    int type = repertoire->type;
+    int bloc = repertoire->blocs_directs[0];
+    desepingler_inode(fs, inode_dir, 0);
+    if (type != TYPE_REPERTOIRE) {
+        erreur("L'inode n'est pas un répertoire");
+        return -1;
+    }
+    
+    // Lecture du contenu du répertoire depuis le premier bloc direct
+    EntreeRepertoire entrees[MAX_ENTREES_DIR];
+    lire_entrees(fs, bloc, entrees);
+    
+    // Parcours des entrées du répertoire
+    for (int i = 0; i < MAX_ENTREES_DIR; i++) {
+        // Comparaison des noms et vérification que l'entrée est utilisée
+        if (strcmp(entrees[i].nom, nom) == 0 && entrees[i].inode != 0) {
+            return entrees[i].inode; // Retourne l'inode si trouvé
+        }
+    }
+    
+    return -1; // Retourne -1 si non trouvé
+}
+
+/**
+ * Cherche un inode par son nom dans un répertoire
+ * @param inode_dir L'inode du répertoire où chercher
+ * @param nom Le nom du fichier/dossier à trouver
+ * @return L'identifiant de l'inode trouvé ou -1 si non trouvé/erreur
+ */
+int trouver_inode_par_nom(SystemeFichiers* fs, int inode_dir, const char* nom) {
+    if (!inode_valide(fs, inode_dir)) {
+        erreur("Inode invalide");
+        return -1;
+    }
+    DEBUT_MESURE(fs, MESURE_CHERCHER, debut);
+    verrouiller_inode(fs, inode_dir, 0);
+    int resultat = chercher_entree(fs, inode_dir, nom);
+    deverrouiller_inode(fs, inode_dir);
+    // Un nom absent n'est pas un échec de la recherche
+    FIN_MESURE(fs, MESURE_CHERCHER, debut, 0, 0);
+    return resultat;
+}
+
+/**
+ * Supprime une entrée dans un répertoire verrouillé en écriture par l'appelant
+ * @param inode_dir L'inode du répertoire
+ * @param nom Le nom de l'entrée à supprimer
+ * @return 0 si succès, -1 si erreur
+ */
+static int retirer_entree(SystemeFichiers* fs, int inode_dir, const char* nom) {
+    // Vérification que l'inode est bien un répertoire
+    Inode* repertoire = epingler_inode(fs, inode_dir);
+    if (repertoire == NULL || repertoire->type != TYPE_REPERTOIRE) {
+        if (repertoire != NULL) {
+            desepingler_inode(fs, inode_dir, 0);
+        }
+        erreur("L'inode n'est pas un répertoire");
+        return -1;
+    }
+    
+    // Lecture du contenu du répertoire
+    EntreeRepertoire entrees[MAX_ENTREES_DIR];
+    lire_entrees(fs, repertoire->blocs_directs[0], entrees);
+    
+    // Recherche de l'entrée à supprimer
+    for (int i = 0; i < MAX_ENTREES_DIR; i++) {
+        if (strcmp(entrees[i].nom, nom) == 0) {
+            // Effacement de l'entrée
+            memset(&entrees[i], 0, sizeof(EntreeRepertoire));
+            
+            // Réécriture du bloc modifié
+            ecrire_entrees(fs, repertoire->blocs_directs[0], entrees);
+            
+            // Mise à jour de la date de modification
+            repertoire->date_modification = time(NULL);
+            desepingler_inode(fs, inode_dir, 1);
+            desindexer_nom(fs, inode_dir, nom);
+            
+            return 0; // Succès
+        }
+    }
+    
+    desepingler_inode(fs, inode_dir, 0);
+    erreur("Entrée non trouvée");
+    return -1; // Erreur si entrée non trouvée
+}
+
+/**
+ * Supprime une entrée dans un répertoire
+ * @param inode_dir L'inode du répertoire
+ * @param nom Le nom de l'entrée à supprimer
+ * @return 0 si succès, -1 si erreur
+ */
+int supprimer_entree_repertoire(SystemeFichiers* fs, int inode_dir, const char* nom) {
+    if (!inode_valide(fs, inode_dir)) {
+        erreur("L'inode n'est pas un répertoire");
+        return -1;
+    }
+    verrouiller_inode(fs, inode_dir, 1);
+    int resultat = retirer_entree(fs, inode_dir, nom);
+    deverrouiller_inode(fs, inode_dir);
+    return resultat;
+}
+
+/**
+ * Relève les blocs d'un inode dont on libère le contenu et efface ses
+ * pointeurs : blocs directs, blocs désignés par le bloc indirect et ce
+ * bloc lui-même, carte des clusters d'un fichier compressé. L'inode n'est
+ * ni en ligne ni dans un fragment.
+ * @param inode L'inode, épinglé et verrouillé en écriture par l'appelant
+ * @param blocs Reçoit au plus MAX_BLOCS_INODE numéros de blocs
+ * @return Le nombre de blocs relevés
+ */
+static int detacher_blocs_inode(SystemeFichiers* fs, Inode* inode, int* blocs) {
+    int nb = 0;
+    int nb_blocs = (inode->taille + TAILLE_BLOC - 1) / TAILLE_BLOC;
+    for (int i = 0; i < nb_blocs && i < NB_BLOCS_DIRECTS; i++) {
+        if (inode->blocs_directs[i] != 0) {
+            blocs[nb++] = inode->blocs_directs[i];
+            inode->blocs_directs[i] = 0;
+        }
+    }
+
+    if (inode->bloc_indirect != 0) {
+        int blocs_indirects[NB_POINTEURS_INDIRECTS];
+        if (lire_bloc(fs, inode->bloc_indirect, blocs_indirects) == 0) {
+            for (int i = 0; i < NB_POINTEURS_INDIRECTS; i++) {
+                if (blocs_indirects[i] != 0) {
+                    blocs[nb++] = blocs_indirects[i];
+                }
+            }
+        }
+        blocs[nb++] = inode->bloc_indirect;
+        inode->bloc_indirect = 0;
+    }
+
+    if ((inode->drapeaux & INODE_COMPRESSE) && inode->bloc_carte != 0) {
+        blocs[nb++] = inode->bloc_carte;
+        inode->bloc_carte = 0;
+    }
+    return nb;
+}
+
+/**
+ * Supprime un fichier ou un répertoire vide. Pour un fichier qui a
+ * plusieurs liens physiques, seul ce nom disparaît : l'inode et ses
+ * blocs ne sont libérés qu'avec son dernier nom.
+ * @param nom Le nom du fichier/dossier à supprimer
+ * @return 0 si succès, -1 si erreur
+ */
+static int supprimer_fichier_interne(Session* s, const char* nom) {
+    SystemeFichiers* fs = s->fs;
+    // Validation du nom de fichier
+    if (!valider_nom_fichier(nom)) {
+        erreur("Nom de fichier invalide");
+        return -1;
+    }
+    if (strcmp(nom, ".") == 0 || strcmp(nom, "..") == 0) {
+        erreur("Impossible de supprimer . ou ..");
+        return -1;
+    }
+    
+    // Le répertoire reste verrouillé jusqu'au retrait de l'entrée : le nom
+    // ne peut pas désigner un autre inode entre-temps
+    int parent = s->inode_courant;
+    if (!inode_valide(fs, parent)) {
+        erreur("Répertoire courant invalide");
+        return -1;
+    }
+    verrouiller_inode(fs, parent, 1);
+    
+    // Recherche de l'inode correspondant au nom
+    int inode_id = chercher_entree(fs, parent, nom);
+    if (inode_id == -1) {
+        deverrouiller_inode(fs, parent);
+        erreur("Fichier non trouvé");
+        return -1;
+    }
+    
+    verrouiller_inode(fs, inode_id, 1);
+    
+    // Vérification des droits d'écriture
+    if (!verifier_droits(fs, inode_id, DROIT_ECRITURE)) {
+        deverrouiller_inode(fs, inode_id);
+        deverrouiller_inode(fs, parent);
+        erreur("Permission refusée");
+        return -1;
+    }
+    
+    Inode* inode = epingler_inode(fs, inode_id);
+    if (inode == NULL) {
+        deverrouiller_inode(fs, inode_id);
+        deverrouiller_inode(fs, parent);
+        erreur("Numéro d'inode invalide");
+        return -1;
+    }
+    
+    // Traitement spécial pour les répertoires
+    if (inode->type == TYPE_REPERTOIRE) {
+        EntreeRepertoire entrees[MAX_ENTREES_DIR];
+        lire_entrees(fs, inode->blocs_directs[0], entrees);
+        
+        // Comptage des entrées non vides (hors . et ..)
+        int nb_entrees = 0;
+        for (int i = 0; i < MAX_ENTREES_DIR; i++) {
+            if (entrees[i].nom[0] != '\0' && 
+                strcmp(entrees[i].nom, ".") != 0 && 
+                strcmp(entrees[i].nom, "..") != 0) {
+                nb_entrees++;
+            }
+        }
+        
+        // Vérification que le répertoire est vide
+        if (nb_entrees > 0) {
+            desepingler_inode(fs, inode_id, 0);
+            deverrouiller_inode(fs, inode_id);
+            deverrouiller_inode(fs, parent);
+            erreur("Le répertoire n'est pas vide");
+            return -1;
+        }
+    }
+    
+    // Décrémentation du compteur de liens : les autres noms du fichier
+    // gardent l'inode et ses blocs
+    inode->nb_liens--;
+    
+    // Si c'était le dernier lien, libération des ressources
+    // (un contenu en ligne n'occupe aucun bloc)
+    if (inode->nb_liens == 0 && (inode->drapeaux & INODE_EN_LIGNE)) {
+        desepingler_inode(fs, inode_id, 1);
+        liberer_inode(fs, inode_id);
+    } else if (inode->nb_liens == 0 && (inode->drapeaux & INODE_FRAGMENT)) {
+        // Seule la place du fragment est rendue : le bloc reste aux autres
+        detacher_fragment(fs, inode);
+        desepingler_inode(fs, inode_id, 1);
+        liberer_inode(fs, inode_id);
+    } else if (inode->nb_liens == 0) {
+        // Libération des blocs en un seul lot
+        int blocs[MAX_BLOCS_INODE];
+        liberer_blocs(fs, blocs, detacher_blocs_inode(fs, inode, blocs));
+        
+        // Libération de l'inode
+        desepingler_inode(fs, inode_id, 1);
+        liberer_inode(fs, inode_id);
+    } else {
+        desepingler_inode(fs, inode_id, 1);
+    }
+    
+    deverrouiller_inode(fs, inode_id);
+    
+    // Suppression de l'entrée dans le répertoire parent
+    int result = retirer_entree(fs, parent, nom);
+    deverrouiller_inode(fs, parent);
+    
+    return result;
+}
+
+/**
+ * Charge la carte des clusters d'un fichier compressé
+ * @param inode L'inode
+ * @param carte Reçoit une longueur par cluster (toutes nulles sans carte)
+ * @return 0 si succès, -1 si erreur de lecture
+ */
+static int lire_carte_clusters(SystemeFichiers* fs, const Inode* inode, uint16_t* carte) {
+    if (inode->bloc_carte == 0) {
+        memset(carte, 0, TAILLE_BLOC);
+        return 0;
+    }
+    return lire_bloc(fs, inode->bloc_carte, carte);
+}
+
+/**
+ * Lit un cluster d'un fichier compressé et le décompresse s'il y a lieu.
+ * Les blocs absents d'un cluster stocké tel quel sont lus comme des zéros.
+ * @param inode L'inode
+ * @param blocs_indirects Sa table indirecte (des zéros s'il n'en a pas)
+ * @param carte Sa carte des clusters
+ * @param cluster Le numéro du cluster
+ * @param donnees Reçoit TAILLE_CLUSTER octets
+ * @return 0 si succès, -1 si un bloc est illisible ou les données invalides
+ */
+static int lire_cluster(SystemeFichiers* fs, const Inode* inode, const int* blocs_indirects,
+                        const uint16_t* carte, int cluster, char* donnees) {
+    int longueur = carte[cluster];
+    char compresse[TAILLE_CLUSTER];
+    char* zone = longueur > 0 ? compresse : donnees;
+    int nb = longueur > 0 ? (longueur + TAILLE_BLOC - 1) / TAILLE_BLOC : BLOCS_PAR_CLUSTER;
+    int blocs[BLOCS_PAR_CLUSTER];
+    void* destinations[BLOCS_PAR_CLUSTER];
+    int nb_lus = 0;
+    
+    memset(donnees, 0, TAILLE_CLUSTER);
+    for (int k = 0; k < nb; k++) {
+        int index = cluster * BLOCS_PAR_CLUSTER + k;
+        int bloc = 0;
+        if (index < NB_BLOCS_DIRECTS) {
+            bloc = inode->blocs_directs[index];
+        } else if (index < MAX_BLOCS_FICHIER) {
+            bloc = blocs_indirects[index - NB_BLOCS_DIRECTS];
+        }
+        if (bloc == 0) {
+            if (longueur > 0) {
+                erreur("Cluster compressé incomplet");
+                return -1;
+            }
+            continue;
+        }
+        blocs[nb_lus] = bloc;
+        destinations[nb_lus] = zone + k * TAILLE_BLOC;
+        nb_lus++;
+    }
+    if (nb_lus > 0 && lire_blocs(fs, blocs, destinations, nb_lus) == -1) {
+        return -1;
+    }
+    if (longueur == 0) {
+        return 0;
+    }
+    
+    if (decompresser_lz(compresse, longueur, donnees, TAILLE_CLUSTER) == -1) {
+        erreur("Cluster compressé invalide");
+        return -1;
+    }
+    __atomic_add_fetch(&fs->nb_clusters_decompresses, 1, __ATOMIC_RELAXED);
+    return 0;
+}
+
+/**
+ * Lit des données d'un fichier compressé (inode verrouillé et épinglé).
+ * Seuls les clusters que la lecture couvre sont lus, et chacun n'est
+ * décompressé qu'une fois ; les pages en attente sont prioritaires.
+ * @param inode L'inode
+ * @param tampon Ses pages en attente, ou NULL
+ * @param buffer Reçoit les données
+ * @param taille Le nombre d'octets à lire (dans les limites du fichier)
+ * @param offset La position de départ dans le fichier
+ * @return 0 si succès, -1 si une partie n'a pas pu être lue
+ */
+static int lire_clusters(SystemeFichiers* fs, const Inode* inode, TamponInode* tampon,
+                         char* buffer, int taille, int offset) {
+    uint16_t carte[TAILLE_BLOC / sizeof(uint16_t)];
+    int blocs_indirects[NB_POINTEURS_INDIRECTS] = {0};
+    if (lire_carte_clusters(fs, inode, carte) == -1
+        || (inode->bloc_indirect != 0 && lire_bloc(fs, inode->bloc_indirect, blocs_indirects) == -1)) {
+        return -1;
+    }
+    
+    char cluster[TAILLE_CLUSTER];
+    int cluster_charge = -1;
+    int echec = 0;
+    for (int lus = 0; lus < taille; ) {
+        int index = (offset + lus) / TAILLE_BLOC;
+        int decalage = (offset + lus) % TAILLE_BLOC;
+        int nb = TAILLE_BLOC - decalage;
+        if (nb > taille - lus) {
+            nb = taille - lus;
+        }
+        
+        const char* source;
+        PageTampon* page = tampon ? chercher_page(tampon, index) : NULL;
+        if (page) {
+            source = page->donnees;
+        } else {
+            int c = index / BLOCS_PAR_CLUSTER;
+            if (c != cluster_charge) {
+                if (lire_cluster(fs, inode, blocs_indirects, carte, c, cluster) == -1) {
+                    memset(cluster, 0, TAILLE_CLUSTER);
+                    echec = 1;
+                }
+                cluster_charge = c;
+            }
+            source = cluster + (index % BLOCS_PAR_CLUSTER) * TAILLE_BLOC;
+        }
+        memcpy(buffer + lus, source + decalage, nb);
+        lus += nb;
+    }
+    return echec ? -1 : 0;
+}
+
+/**
+ * Donne le contenu d'un bloc logique d'un fichier compressé, s'il fait
+ * partie d'un cluster compressé
+ * @param inode L'inode (ni en ligne ni en fragment)
+ * @param index L'index logique du bloc
+ * @param donnees Reçoit le bloc
+ * @return 1 si le bloc a été décompressé, 0 si son cluster n'est pas
+ *         compressé (rien n'est lu), -1 si erreur
+ */
+static int lire_page_compressee(SystemeFichiers* fs, const Inode* inode, int index, char* donnees) {
+    uint16_t carte[TAILLE_BLOC / sizeof(uint16_t)];
+    int blocs_indirects[NB_POINTEURS_INDIRECTS] = {0};
+    if (inode->bloc_carte == 0) {
+        return 0;
+    }
+    if (lire_bloc(fs, inode->bloc_carte, carte) == -1) {
+        return -1;
+    }
+    if (carte[index / BLOCS_PAR_CLUSTER] == 0) {
+        return 0;
+    }
+    
+    char cluster[TAILLE_CLUSTER];
+    if ((inode->bloc_indirect != 0 && lire_bloc(fs, inode->bloc_indirect, blocs_indirects) == -1)
+        || lire_cluster(fs, inode, blocs_indirects, carte, index / BLOCS_PAR_CLUSTER, cluster) == -1) {
+        return -1;
+    }
+    memcpy(donnees, cluster + (index % BLOCS_PAR_CLUSTER) * TAILLE_BLOC, TAILLE_BLOC);
+    return 1;
+}
+
+/**
+ * Lit le contenu d'un fichier
+ * @param inode_id L'inode du fichier à lire
+ * @param buffer Le buffer où stocker les données lues
+ * @param taille Le nombre d'octets à lire
+ * @param offset La position de départ dans le fichier
+ * @return Le nombre d'octets lus ou -1 en cas d'erreur
+ */
+static int lire_fichier_interne(Session* s, int inode_id, void* buffer, int taille, int offset) {
+    SystemeFichiers* fs = s->fs;
+    // Vérification de l'identifiant d'inode
+    if (!inode_valide(fs, inode_id)) {
+        erreur("Numéro d'inode invalide");
+        return -1;
+    }
+    
+    // Les lectures d'un même fichier peuvent se faire en parallèle
+    verrouiller_inode(fs, inode_id, 0);
+    Inode* inode = epingler_inode(fs, inode_id);
+    if (inode == NULL) {
+        deverrouiller_inode(fs, inode_id);
+        erreur("Numéro d'inode invalide");
+        return -1;
+    }
+    
+    // Gestion des liens symboliques
+    if (inode->type == TYPE_LIEN_SYMBOLIQUE) {
+        // Lecture du chemin cible (sans accès disque s'il est en ligne)
+        char chemin_source[TAILLE_BLOC];
+        if (inode->drapeaux & INODE_EN_LIGNE) {
+            memcpy(chemin_source, inode->donnees_en_ligne, TAILLE_EN_LIGNE);
+            chemin_source[TAILLE_EN_LIGNE] = '\0';
+        } else if (lire_bloc(fs, inode->blocs_directs[0], chemin_source) == -1) {
+            chemin_source[0] = '\0';
+        }
+        desepingler_inode(fs, inode_id, 0);
+        deverrouiller_inode(fs, inode_id);
+        
+        // Recherche de l'inode cible
+        int inode_source = trouver_inode_par_nom(fs, s->inode_courant, chemin_source);
+        
+        if (inode_source == -1) {
+            erreur("Fichier source du lien symbolique non trouvé");
+            return -1;
+        }
+        
+        // Lecture récursive du fichier cible
+        return lire_fichier(s, inode_source, buffer, taille, 0);
+    }
+    
+    // Vérification des droits de lecture
+    if (!verifier_droits(fs, inode_id, DROIT_LECTURE)) {
+        desepingler_inode(fs, inode_id, 0);
+        deverrouiller_inode(fs, inode_id);
+        erreur("Permission refusée");
+        return -1;
+    }
+    
+    // Vérification que c'est bien un fichier
+    if (inode->type == TYPE_REPERTOIRE)  {
+        desepingler_inode(fs, inode_id, 0);
+        deverrouiller_inode(fs, inode_id);
+        erreur("L'inode n'est pas un fichier");
+        return -1;
+    }
+    
+    // Vérification de l'offset
+    if (offset < 0 || offset >= inode->taille) {
+        desepingler_inode(fs, inode_id, 0);
+        deverrouiller_inode(fs, inode_id);
+        erreur("Offset invalide");
+        return -1;
+    }
+    
+    // Ajustement de la taille à lire si nécessaire
+    if (offset + taille > inode->taille) {
+        taille = inode->taille - offset;
+    }
+    
+    // Contenu stocké dans l'inode : aucun bloc à lire
+    if (inode->drapeaux & INODE_EN_LIGNE) {
+        memcpy(buffer, inode->donnees_en_ligne + offset, taille);
+        __atomic_store_n(&inode->date_acces, (int64_t)time(NULL), __ATOMIC_RELAXED);
+        desepingler_inode(fs, inode_id, 1);
+        deverrouiller_inode(fs, inode_id);
+        return taille;
+    }
+    
+    // Fichier compressé : lecture par clusters
+    if ((inode->drapeaux & (INODE_COMPRESSE | INODE_FRAGMENT)) == INODE_COMPRESSE) {
+        int echec = lire_clusters(fs, inode, chercher_tampon(fs, inode_id, 0), buffer, taille, offset) == -1;
+        __atomic_store_n(&inode->date_acces, (int64_t)time(NULL), __ATOMIC_RELAXED);
+        desepingler_inode(fs, inode_id, 1);
+        deverrouiller_inode(fs, inode_id);
+        return echec ? -1 : taille;
+    }
+    
+    // Lecture des données (les pages en attente sont prioritaires sur le disque)
+    int bytes_read = 0;
+    char block_buffer[TAILLE_BLOC];
+    int blocs_indirects[TAILLE_BLOC / sizeof(int)];
+    int indirecte_lue = 0;
+    int echec = 0;
+    TamponInode* tampon = chercher_tampon(fs, inode_id, 0);
+    // Blocs entiers à lire ensemble, directement dans le buffer de l'appelant
+    int blocs_groupes[NB_VECTEURS_BLOCS];
+    void* destinations[NB_VECTEURS_BLOCS];
+    int nb_groupes = 0;
+    
+    // Pas d'anticipation pendant une transaction : le cache n'y sert pas
+    if (fs->session_transaction == NULL && !(inode->drapeaux & INODE_FRAGMENT)) {
+        anticiper_lecture(fs, inode_id, inode, offset / TAILLE_BLOC, (offset + taille - 1) / TAILLE_BLOC);
+    }
+    
+    while (bytes_read < taille) {
+        // Calcul du bloc et de l'offset dans le bloc
+        int bloc_index = (offset + bytes_read) / TAILLE_BLOC;
+        int bloc_offset = (offset + bytes_read) % TAILLE_BLOC;
+        int bytes_to_read = TAILLE_BLOC - bloc_offset;
+        
+        if (bytes_to_read > taille - bytes_read) {
+            bytes_to_read = taille - bytes_read;
+        }
+        
+        // Données encore en tampon
+        PageTampon* page = tampon ? chercher_page(tampon, bloc_index) : NULL;
+        if (page) {
+            memcpy((char*)buffer + bytes_read, page->donnees + bloc_offset, bytes_to_read);
+            bytes_read += bytes_to_read;
+            continue;
+        }
+        
+        // Fichier rangé dans un fragment (un seul bloc logique)
+        if (inode->drapeaux & INODE_FRAGMENT) {
+            echec |= lire_fragment(fs, inode, block_buffer) == -1;
+            memcpy((char*)buffer + bytes_read, block_buffer + bloc_offset, bytes_to_read);
+            bytes_read += bytes_to_read;
+            continue;
+        }
+        
+        // Détermination du numéro de bloc
+        int num_bloc = -1;
+        if (bloc_index < 10) {
+            num_bloc = inode->blocs_directs[bloc_index];
+        } else if (inode->bloc_indirect != 0) {
+            // La table indirecte n'est lue qu'une fois par appel
+            if (!indirecte_lue) {
+                if (lire_bloc(fs, inode->bloc_indirect, blocs_indirects) == -1) {
+                    echec = 1;
+                    break;
+                }
+                indirecte_lue = 1;
+            }
+            num_bloc = blocs_indirects[bloc_index - 10];
+        }
+        
+        if (num_bloc == 0 || num_bloc == -1) {
+            // Bloc non alloué, remplissage avec des zéros
+            memset((char*)buffer + bytes_read, 0, bytes_to_read);
+        } else if (bytes_to_read == TAILLE_BLOC) {
+            // Bloc entier : lu plus tard avec les autres
+            if (nb_groupes == NB_VECTEURS_BLOCS) {
+                echec |= lire_blocs(fs, blocs_groupes, destinations, nb_groupes) == -1;
+                nb_groupes = 0;
+            }
+            blocs_groupes[nb_groupes] = num_bloc;
+            destinations[nb_groupes] = (char*)buffer + bytes_read;
+            nb_groupes++;
+        } else {
+            // Lecture effective du bloc
+            echec |= lire_bloc_donnees(fs, num_bloc, block_buffer) == -1;
+            memcpy((char*)buffer + bytes_read, block_buffer + bloc_offset, bytes_to_read);
+        }
+        
+        bytes_read += bytes_to_read;
+    }
+    if (nb_groupes > 0) {
+        echec |= lire_blocs(fs, blocs_groupes, destinations, nb_groupes) == -1;
+    }
+    
+    // Mise à jour de la date d'accès (d'autres lecteurs peuvent l'écrire
+    // en même temps)
+    __atomic_store_n(&inode->date_acces, (int64_t)time(NULL), __ATOMIC_RELAXED);
+    desepingler_inode(fs, inode_id, 1);
+    deverrouiller_inode(fs, inode_id);
+    
+    // Un bloc illisible ou corrompu n'est pas rendu comme s'il était bon
+    return echec ? -1 : bytes_read;
+}
+
+/**
+ * Écrit dans un fichier
+ * @param inode_id L'inode du fichier à modifier
+ * @param buffer Les données à écrire
+ * @param taille Le nombre d'octets à écrire
+ * @param offset La position de départ dans le fichier
+ * @return Le nombre d'octets écrits ou -1 en cas d'erreur
+ */
+static int ecrire_fichier_interne(Session* s, int inode_id, void* buffer, int taille, int offset) {
+    SystemeFichiers* fs = s->fs;
+    // Vérification de l'identifiant d'inode
+    if (!inode_valide(fs, inode_id)) {
+        erreur("Numéro d'inode invalide");
+        return -1;
+    }
+    
+    verrouiller_inode(fs, inode_id, 1);
+    Inode* inode = epingler_inode(fs, inode_id);
+    if (inode == NULL) {
+        deverrouiller_inode(fs, inode_id);
+        erreur("Numéro d'inode invalide");
+        return -1;
+    }
+    
+    // Vérification des droits d'écriture
+    if (!verifier_droits(fs, inode_id, DROIT_ECRITURE)) {
+        desepingler_inode(fs, inode_id, 0);
+        deverrouiller_inode(fs, inode_id);
+        erreur("Permission refusée");
+        return -1;
+    }
+    
+    // Vérification que c'est bien un fichier
+    if (inode->type != TYPE_FICHIER) {
+        desepingler_inode(fs, inode_id, 0);
+        deverrouiller_inode(fs, inode_id);
+        erreur("L'inode n'est pas un fichier");
+        return -1;
+    }
+    
+    // Vérification de l'offset
+    if (offset < 0) {
+        desepingler_inode(fs, inode_id, 0);
+        deverrouiller_inode(fs, inode_id);
+        erreur("Offset invalide");
+        return -1;
+    }
+    
+    // Vérification de la taille maximale d'un fichier
+    if ((long)offset + taille > (long)MAX_BLOCS_FICHIER * TAILLE_BLOC) {
+        desepingler_inode(fs, inode_id, 0);
+        deverrouiller_inode(fs, inode_id);
+        erreur("Taille maximale de fichier dépassée");
+        return -1;
+    }
+    
+    // Si on écrit au début d'un fichier non vide, libération des blocs existants
+    if (inode->taille > 0 && offset == 0 && (inode->drapeaux & INODE_EN_LIGNE)) {
+        memset(inode->donnees_en_ligne, 0, TAILLE_EN_LIGNE);
+        inode->drapeaux &= ~INODE_EN_LIGNE;
+        inode->taille = 0;
+    } else if (inode->taille > 0 && offset == 0 && (inode->drapeaux & INODE_FRAGMENT)) {
+        abandonner_tampon_inode(fs, inode_id);
+        detacher_fragment(fs, inode);
+        inode->taille = 0;
+    } else if (inode->taille > 0 && offset == 0) {
+        // Les pages en attente sont obsolètes
+        abandonner_tampon_inode(fs, inode_id);
+        
+        // Libération des blocs directs
+        for (int i = 0; i < 10; i++) {
+            if (inode->blocs_directs[i] != 0) {
+                liberer_bloc(fs, inode->blocs_directs[i]);
+                inode->blocs_directs[i] = 0;
+            }
+        }
+        
+        // Libération des blocs indirects si existants
+        if (inode->bloc_indirect != 0) {
+            int blocs_indirects[TAILLE_BLOC / sizeof(int)];
+            lire_bloc(fs, inode->bloc_indirect, blocs_indirects);
+            for (int i = 0; i < TAILLE_BLOC / sizeof(int); i++) {
+                if (blocs_indirects[i] != 0) {
+                    liberer_bloc(fs, blocs_indirects[i]);
+                }
+            }
+            liberer_bloc(fs, inode->bloc_indirect);
+            inode->bloc_indirect = 0;
+        }
+        
+        // Libération de la carte des clusters d'un fichier compressé
+        if ((inode->drapeaux & INODE_COMPRESSE) && inode->bloc_carte != 0) {
+            liberer_bloc(fs, inode->bloc_carte);
+            inode->bloc_carte = 0;
+        }
+        
+        // Réinitialisation de la taille
+        inode->taille = 0;
+    }
+    
+    // Un petit contenu est écrit directement dans l'inode, tant que le
+    // fichier est vide ou déjà stocké en ligne
+    int en_ligne = inode->drapeaux & INODE_EN_LIGNE;
+    if (offset + taille <= TAILLE_EN_LIGNE
+        && (en_ligne || (inode->taille == 0 && chercher_tampon(fs, inode_id, 0) == NULL))) {
+        if (!en_ligne) {
+            memset(inode->donnees_en_ligne, 0, TAILLE_EN_LIGNE);
+            inode->drapeaux |= INODE_EN_LIGNE;
+        }
+        memcpy(inode->donnees_en_ligne + offset, buffer, taille);
+        if (offset + taille > inode->taille) {
+            inode->taille = offset + taille;
+        }
+        inode->date_modification = time(NULL);
+        inode->date_acces = time(NULL);
+        desepingler_inode(fs, inode_id, 1);
+        deverrouiller_inode(fs, inode_id);
+        return taille;
+    }
+    
+    // Écriture des données dans les pages en attente : l'allocation des
+    // blocs physiques est différée jusqu'au vidage du tampon
+    TamponInode* tampon = chercher_tampon(fs, inode_id, 1);
+    if (!tampon) {
+        desepingler_inode(fs, inode_id, 1);
+        deverrouiller_inode(fs, inode_id);
+        return -1;
+    }
+    
+    // Le fichier dépasse la taille en ligne : son contenu passe dans la
+    // première page, comme un bloc ordinaire
+    if (en_ligne) {
+        char contenu[TAILLE_EN_LIGNE];
+        memcpy(contenu, inode->donnees_en_ligne, TAILLE_EN_LIGNE);
+        memset(inode->donnees_en_ligne, 0, TAILLE_EN_LIGNE);
+        inode->drapeaux &= ~INODE_EN_LIGNE;
+        
+        PageTampon* page = obtenir_page(fs, tampon, inode, 0);
+        if (page == NULL) {
+            memcpy(inode->donnees_en_ligne, contenu, TAILLE_EN_LIGNE);
+            inode->drapeaux |= INODE_EN_LIGNE;
+            abandonner_tampon_inode(fs, inode_id);
+            desepingler_inode(fs, inode_id, 1);
+            deverrouiller_inode(fs, inode_id);
+            return -1;
+        }
+        memcpy(page->donnees, contenu, inode->taille);
+    }
+    
+    // Un fichier rangé dans un fragment est repris dans la première page :
+    // le vidage choisira entre un nouveau fragment et un bloc entier
+    if ((inode->drapeaux & INODE_FRAGMENT) && obtenir_page(fs, tampon, inode, 0) == NULL) {
+        if (tampon->nb_pages == 0) {
+            abandonner_tampon_inode(fs, inode_id);
+        }
+        desepingler_inode(fs, inode_id, 1);
+        deverrouiller_inode(fs, inode_id);
+        return -1;
+    }
+    
+    int bytes_written = 0;
+
+    while (bytes_written < taille) {
+        // Calcul du bloc et de l'offset dans le bloc
+        int bloc_index = (offset + bytes_written) / TAILLE_BLOC;
+        int bloc_offset = (offset + bytes_written) % TAILLE_BLOC;
+        int bytes_to_write = TAILLE_BLOC - bloc_offset;
+        
+        if (bytes_to_write > taille - bytes_written) {
+            bytes_to_write = taille - bytes_written;
+        }
+
+        PageTampon* page = obtenir_page(fs, tampon, inode, bloc_index);
+        if (page == NULL) {
+            break;
+        }
+        memcpy(page->donnees + bloc_offset, (char*)buffer + bytes_written, bytes_to_write);
+
+        bytes_written += bytes_to_write;
+    }
+
+    // Un tampon resté vide n'a pas lieu d'être conservé
+    if (tampon->nb_pages == 0) {
+        abandonner_tampon_inode(fs, inode_id);
+    }
+
+    if (bytes_written < taille) {
+        taille = bytes_written;
+        if (taille == 0) {
+            desepingler_inode(fs, inode_id, 1);
+            deverrouiller_inode(fs, inode_id);
+            return -1;
+        }
+    }
+
+    // Mise à jour de la taille si nécessaire
+    if (offset + taille > inode->taille) {
+        inode->taille = offset + taille;
+    }
+    
+    // Mise à jour des dates
+    inode->date_modification = time(NULL);
+    inode->date_acces = time(NULL);
+    desepingler_inode(fs, inode_id, 1);
+    deverrouiller_inode(fs, inode_id);
+
+    // Vidage lorsque trop de données sont en attente (le verrou de
+    // l'inode est relâché : le vidage le reprend)
+    pthread_mutex_lock(&fs->verrou_tampons);
+    int trop_plein = fs->nb_pages_tampon * TAILLE_BLOC >= SEUIL_TAMPON_ECRITURE;
+    pthread_mutex_unlock(&fs->verrou_tampons);
+    if (trop_plein) {
+        synchroniser_tampons(fs);
+    }
+
+    return bytes_written;
+}
+
+/**
+ * Cherche le tampon d'écriture d'un inode
+ * @param inode_id L'inode concerné
+ * @param creer 1 pour créer le tampon s'il n'existe pas
+ * @return Le tampon, ou NULL s'il n'existe pas (ou en cas d'erreur)
+ */
+TamponInode* chercher_tampon(SystemeFichiers* fs, int inode_id, int creer) {
+    pthread_mutex_lock(&fs->verrou_tampons);
+    for (TamponInode* t = fs->tampons_ecriture; t != NULL; t = t->suivant) {
+        if (t->inode == inode_id) {
+            pthread_mutex_unlock(&fs->verrou_tampons);
+            return t;
+        }
+    }
+    
+    TamponInode* t = NULL;
+    if (creer) {
+        t = calloc(1, sizeof(TamponInode));
+        if (!t) {
+            erreur("Mémoire insuffisante");
+        } else {
+            t->inode = inode_id;
+            t->suivant = fs->tampons_ecriture;
+            fs->tampons_ecriture = t;
+        }
+    }
+    pthread_mutex_unlock(&fs->verrou_tampons);
+    return t;
+}
+
+/**
+ * Cherche la page en attente d'un bloc logique
+ * @param tampon Le tampon de l'inode
+ * @param index L'index logique du bloc
+ * @return La page, ou NULL si le bloc n'est pas en tampon
+ */
+PageTampon* chercher_page(TamponInode* tampon, int index) {
+    for (PageTampon* p = tampon->pages; p != NULL && p->index <= index; p = p->suivante) {
+        if (p->index == index) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Donne la page en attente d'un bloc logique, en la créant au besoin.
+ * Une nouvelle page reprend le contenu du bloc physique s'il existe ;
+ * sinon un bloc est seulement réservé (il sera alloué au vidage).
+ * @param tampon Le tampon de l'inode
+ * @param inode L'inode propriétaire
+ * @param index L'index logique du bloc
+ * @return La page, ou NULL en cas d'erreur
+ */
+PageTampon* obtenir_page(SystemeFichiers* fs, TamponInode* tampon, const Inode* inode, int index) {
+    // Recherche de la position d'insertion (liste triée)
+    PageTampon** lien = &tampon->pages;
+    while (*lien != NULL && (*lien)->index < index) {
+        lien = &(*lien)->suivante;
+    }
+    if (*lien != NULL && (*lien)->index == index) {
+        return *lien;
+    }
+    
+    PageTampon* page = allouer_aligne(sizeof(PageTampon));
+    if (!page) {
+        erreur("Mémoire insuffisante");
+        return NULL;
+    }
+    page->index = index;
+    page->dedupliquee = 0;
+    
+    // Dans un fichier compressé, le bloc est pris dans son cluster décompressé
+    int decompresse = 0;
+    if ((inode->drapeaux & (INODE_COMPRESSE | INODE_FRAGMENT)) == INODE_COMPRESSE) {
+        decompresse = lire_page_compressee(fs, inode, index, page->donnees);
+        if (decompresse == -1) {
+            free(page);
+            return NULL;
+        }
+    }
+    
+    int num_bloc = bloc_physique(fs, inode, index);
+    if (num_bloc != 0) {
+        // Lecture-modification-écriture différée d'un bloc existant
+        page->bloc_reserve = 0;
+        if (!decompresse) {
+            lire_bloc_donnees(fs, num_bloc, page->donnees);
+        }
+    } else {
+        // Réservation : garantit que le vidage trouvera de la place
+        pthread_mutex_lock(&fs->verrou_allocation);
+        int disponible = fs->superbloc.nb_blocs_libres - fs->nb_blocs_reserves > 0;
+        if (disponible) {
+            fs->nb_blocs_reserves++;
+        }
+        pthread_mutex_unlock(&fs->verrou_allocation);
+        if (!disponible) {
+            free(page);
+            erreur("Aucun bloc libre");
+            return NULL;
+        }
+        page->bloc_reserve = 1;
+        if (index == 0 && (inode->drapeaux & INODE_FRAGMENT)) {
+            // Le fragment reste en place jusqu'au vidage de la page
+            lire_fragment(fs, inode, page->donnees);
+        } else if (!decompresse) {
+            memset(page->donnees, 0, TAILLE_BLOC);
+        }
+    }
+    
+    page->suivante = *lien;
+    *lien = page;
+    tampon->nb_pages++;
+    pthread_mutex_lock(&fs->verrou_tampons);
+    fs->nb_pages_tampon++;
+    pthread_mutex_unlock(&fs->verrou_tampons);
+    return page;
+}
+
+/**
+ * Donne le bloc physique associé à un bloc logique d'un inode
+ * @param inode L'inode concerné
+ * @param index L'index logique du bloc dans le fichier
+ * @return Le numéro du bloc physique, ou 0 si aucun bloc n'est associé
+ */
+int bloc_physique(SystemeFichiers* fs, const Inode* inode, int index) {
+    if (inode->drapeaux & INODE_EN_LIGNE) {
+        return 0;
+    }
+    if (index < NB_BLOCS_DIRECTS) {
+        return inode->blocs_directs[index];
+    }
+    if (index >= MAX_BLOCS_FICHIER || inode->bloc_indirect == 0) {
+        return 0;
+    }
+    
+    int blocs_indirects[NB_POINTEURS_INDIRECTS];
+    if (lire_bloc(fs, inode->bloc_indirect, blocs_indirects) == -1) {
+        return 0;
+    }
+    return blocs_indirects[index - NB_BLOCS_DIRECTS];
+}
+
+/**
+ * Alloue une suite de blocs physiquement contigus.
+ * La recherche part du bloc 'but' (par exemple le bloc qui suit la fin
+ * actuelle du fichier) et retient la première zone libre assez grande ;
+ * à défaut, la plus grande zone libre rencontrée.
+ * @param nb_voulus Le nombre de blocs souhaités
+ * @param but Le bloc à partir duquel chercher
+ * @param nb_obtenus Reçoit le nombre de blocs effectivement alloués
+ * @return Le premier bloc de la zone allouée, ou -1 si aucun bloc libre
+ */
+int allouer_blocs_contigus(SystemeFichiers* fs, int nb_voulus, int but, int* nb_obtenus) {
+    if (but < 0 || but >= NB_BLOCS) {
+        but = 0;
+    }
+    
+    int meilleur_debut = -1, meilleure_longueur = 0;
+    int debut = -1, longueur = 0;
+    
+    pthread_mutex_lock(&fs->verrou_allocation);
+    for (int n = 0; n < NB_BLOCS && meilleure_longueur < nb_voulus; n++) {
+        int i = (but + n) % NB_BLOCS;
+        
+        // Une zone ne peut pas déborder de la fin de la partition
+        if (i == 0) {
+            longueur = 0;
+        }
+        
+        if (!(fs->bitmap[i / BITS_PAR_OCTET] & (1 << (i % BITS_PAR_OCTET)))) {
+            if (longueur == 0) {
+                debut = i;
+            }
+            longueur++;
+            if (longueur > meilleure_longueur) {
+                meilleure_longueur = longueur;
+                meilleur_debut = debut;
+            }
+        } else {
+            longueur = 0;
+        }
+    }
+    
+    if (meilleure_longueur == 0) {
+        pthread_mutex_unlock(&fs->verrou_allocation);
+        return -1;
+    }
+    if (meilleure_longueur > nb_voulus) {
+        meilleure_longueur = nb_voulus;
+    }
+    
+    // Marquer la zone comme utilisée
+    for (int i = meilleur_debut; i < meilleur_debut + meilleure_longueur; i++) {
+        fs->bitmap[i / BITS_PAR_OCTET] |= (1 << (i % BITS_PAR_OCTET));
+    }
+    fs->superbloc.nb_blocs_libres -= meilleure_longueur;
+    pthread_mutex_unlock(&fs->verrou_allocation);
+    
+    *nb_obtenus = meilleure_longueur;
+    return meilleur_debut;
+}
+
+/**
+ * Cherche dans l'index un bloc de même contenu et y prend une référence.
+ * La référence est prise sous le verrou, avant la comparaison : pendant
+ * la relecture, le bloc est partagé, donc ni réécrit sur place ni libéré.
+ * @param donnees Le contenu d'un bloc
+ * @param somme Son CRC32C
+ * @return Le bloc identique (une référence de plus), ou -1 si aucun
+ */
+static int trouver_doublon(SystemeFichiers* fs, const char* donnees, uint32_t somme) {
+    IndexDedup* index = &fs->index_dedup;
+    int candidat = -1;
+    pthread_mutex_lock(&fs->verrou_allocation);
+    for (int b = index->seaux[somme & (NB_SEAUX_DEDUP - 1)]; b != -1; b = index->suivants[b]) {
+        if (index->cles[b] == somme && fs->references[b] < MAX_REFERENCES) {
+            fs->references[b]++;
+            candidat = b;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&fs->verrou_allocation);
+    if (candidat == -1) {
+        return -1;
+    }
+    
+    // Même somme : le contenu est comparé octet par octet
+    char contenu[TAILLE_BLOC];
+    if (lire_bloc_donnees(fs, candidat, contenu) == 0 && memcmp(contenu, donnees, TAILLE_BLOC) == 0) {
+        return candidat;
+    }
+    __atomic_add_fetch(&fs->nb_collisions_dedup, 1, __ATOMIC_RELAXED);
+    liberer_bloc(fs, candidat);
+    return -1;
+}
+
+/**
+ * Prépare les pages d'un vidage pour la déduplication et la copie sur
+ * écriture. Une page identique à un bloc indexé pointe vers ce bloc et
+ * n'est pas écrite. Une page dont le bloc est partagé en reçoit un autre
+ * au vidage ; un bloc indexé réécrit sur place quitte l'index.
+ * @param tampon Les pages de l'inode, verrouillé en écriture
+ * @param inode L'inode (épinglé)
+ * @param blocs_indirects Sa table indirecte, si des pages en dépendent
+ * @param indirect_modifie Mis à 1 si la table indirecte change
+ * @return 0 si succès, -1 si un bloc partagé ne peut pas être recopié
+ */
+static int preparer_pages_partagees(SystemeFichiers* fs, TamponInode* tampon, Inode* inode,
+                                    int* blocs_indirects, int* indirect_modifie) {
+    for (PageTampon* page = tampon->pages; page != NULL; page = page->suivante) {
+        int* pointeur = page->index < NB_BLOCS_DIRECTS
+            ? &inode->blocs_directs[page->index]
+            : &blocs_indirects[page->index - NB_BLOCS_DIRECTS];
+        int ancien = page->bloc_reserve ? 0 : *pointeur;
+        
+        page->dedupliquee = 0;
+        if (fs->deduplication) {
+            page->somme = calculer_crc32c(page->donnees, TAILLE_BLOC);
+            int doublon = trouver_doublon(fs, page->donnees, page->somme);
+            if (doublon != -1) {
+                if (doublon == ancien) {
+                    // Contenu inchangé : la référence prise est rendue
+                    liberer_bloc(fs, doublon);
+                } else {
+                    if (ancien != 0) {
+                        liberer_bloc(fs, ancien);
+                    } else {
+                        page->bloc_reserve = 0;
+                        pthread_mutex_lock(&fs->verrou_allocation);
+                        fs->nb_blocs_reserves--;
+                        pthread_mutex_unlock(&fs->verrou_allocation);
+                    }
+                    *pointeur = doublon;
+                    *indirect_modifie |= page->index >= NB_BLOCS_DIRECTS;
+                    __atomic_add_fetch(&fs->nb_blocs_dedupliques, 1, __ATOMIC_RELAXED);
+                }
+                page->dedupliquee = 1;
+                continue;
+            }
+        }
+        if (ancien == 0) {
+            continue;
+        }
+        
+        pthread_mutex_lock(&fs->verrou_allocation);
+        if (fs->references[ancien] > 1) {
+            // Copie sur écriture : la page sera allouée comme une neuve
+            if (fs->superbloc.nb_blocs_libres - fs->nb_blocs_reserves <= 0) {
+                pthread_mutex_unlock(&fs->verrou_allocation);
+                erreur("Aucun bloc libre");
+                return -1;
+            }
+            fs->references[ancien]--;
+            fs->nb_blocs_reserves++;
+            page->bloc_reserve = 1;
+            *pointeur = 0;
+            *indirect_modifie |= page->index >= NB_BLOCS_DIRECTS;
+        } else if (fs->references[ancien] == 1) {
+            fs->references[ancien] = 0;
+            desindexer_bloc(fs, ancien);
+        }
+        pthread_mutex_unlock(&fs->verrou_allocation);
+    }
+    return 0;
+}
+
+/**
+ * Indexe les blocs que le vidage vient d'écrire, pour que les écritures
+ * suivantes d'un contenu identique les partagent
+ * @param tampon Les pages écrites
+ * @param inode L'inode
+ * @param blocs_indirects Sa table indirecte
+ */
+static void indexer_pages(SystemeFichiers* fs, TamponInode* tampon, const Inode* inode,
+                          const int* blocs_indirects) {
+    pthread_mutex_lock(&fs->verrou_allocation);
+    for (PageTampon* page = tampon->pages; page != NULL; page = page->suivante) {
+        int bloc = page->index < NB_BLOCS_DIRECTS
+            ? inode->blocs_directs[page->index]
+            : blocs_indirects[page->index - NB_BLOCS_DIRECTS];
+        if (!page->dedupliquee && bloc != 0 && fs->references[bloc] == 0) {
+            fs->references[bloc] = 1;
+            indexer_bloc(fs, bloc, page->somme);
+        }
+    }
+    pthread_mutex_unlock(&fs->verrou_allocation);
+}
+
+/**
+ * Indique si un bloc ne contient que des zéros
+ * @param donnees Le bloc
+ * @return 1 si le bloc est nul, 0 sinon
+ */
+static int bloc_nul(const char* donnees) {
+    return donnees[0] == 0 && memcmp(donnees, donnees + 1, TAILLE_BLOC - 1) == 0;
+}
+
+/**
+ * Écrit un cluster d'un fichier compressé dans des blocs neufs, puis
+ * libère ses anciens blocs. Le cluster est compressé s'il y gagne au
+ * moins un bloc ; sinon il est stocké tel quel, ses blocs nuls restant
+ * des trous.
+ * @param inode L'inode (épinglé, verrouillé en écriture)
+ * @param blocs_indirects Sa table indirecte (allouée si le cluster en dépend)
+ * @param carte Sa carte des clusters, mise à jour
+ * @param cluster Le numéro du cluster
+ * @param donnees Le contenu du cluster
+ * @param compresse Zone de travail de TAILLE_CLUSTER octets
+ * @param longueur Nombre d'octets du cluster dans le fichier
+ * @param nb_reserves Blocs réservés par les pages du cluster
+ * @param indirect_modifie Mis à 1 si la table indirecte change
+ * @return 0 si succès, -1 si erreur (le cluster reste inchangé)
+ */
+static int ecrire_cluster(SystemeFichiers* fs, Inode* inode, int* blocs_indirects, uint16_t* carte,
+                          int cluster, const char* donnees, char* compresse, int longueur,
+                          int nb_reserves, int* indirect_modifie) {
+    int nb_bruts = (longueur + TAILLE_BLOC - 1) / TAILLE_BLOC;
+    int taille_compressee = compresser_lz(donnees, longueur, compresse, (nb_bruts - 1) * TAILLE_BLOC);
+    
+    // Blocs à écrire : les premiers du cluster s'il est compressé, sinon
+    // ses blocs non nuls
+    const void* sources[BLOCS_PAR_CLUSTER];
+    int emplacements[BLOCS_PAR_CLUSTER];
+    int nb = 0;
+    if (taille_compressee > 0) {
+        int nb_compresses = (taille_compressee + TAILLE_BLOC - 1) / TAILLE_BLOC;
+        memset(compresse + taille_compressee, 0, nb_compresses * TAILLE_BLOC - taille_compressee);
+        for (; nb < nb_compresses; nb++) {
+            sources[nb] = compresse + nb * TAILLE_BLOC;
+            emplacements[nb] = nb;
+        }
+    } else {
+        for (int k = 0; k < nb_bruts; k++) {
+            if (!bloc_nul(donnees + k * TAILLE_BLOC)) {
+                sources[nb] = donnees + k * TAILLE_BLOC;
+                emplacements[nb] = k;
+                nb++;
+            }
+        }
+    }
+    
+    // Les réservations des pages du cluster sont reprises ; les autres
+    // réservations restent garanties
+    pthread_mutex_lock(&fs->verrou_allocation);
+    int disponible = fs->superbloc.nb_blocs_libres - (fs->nb_blocs_reserves - nb_reserves) >= nb;
+    pthread_mutex_unlock(&fs->verrou_allocation);
+    if (!disponible) {
+        erreur("Aucun bloc libre");
+        return -1;
+    }
+    
+    // Allocation, de préférence à la suite du cluster précédent
+    int but = 0;
+    for (int index = cluster * BLOCS_PAR_CLUSTER - 1; index >= 0 && but == 0; index--) {
+        int precedent = index < NB_BLOCS_DIRECTS
+            ? inode->blocs_directs[index]
+            : blocs_indirects[index - NB_BLOCS_DIRECTS];
+        if (precedent != 0) {
+            but = precedent + 1;
+        }
+    }
+    int nouveaux[BLOCS_PAR_CLUSTER] = {0};
+    int blocs[BLOCS_PAR_CLUSTER];
+    for (int alloues = 0; alloues < nb; ) {
+        int nb_obtenus = 0;
+        int debut = allouer_blocs_contigus(fs, nb - alloues, but, &nb_obtenus);
+        if (debut == -1) {
+            for (int k = 0; k < alloues; k++) {
+                liberer_bloc(fs, blocs[k]);
+            }
+            erreur("Aucun bloc libre");
+            return -1;
+        }
+        for (int k = 0; k < nb_obtenus; k++, alloues++) {
+            blocs[alloues] = debut + k;
+            nouveaux[emplacements[alloues]] = debut + k;
+        }
+        but = debut + nb_obtenus;
+    }
+    if (nb > 0 && ecrire_blocs(fs, blocs, sources, nb) == -1) {
+        for (int k = 0; k < nb; k++) {
+            liberer_bloc(fs, blocs[k]);
+        }
+        return -1;
+    }
+    
+    // Le cluster est sur disque : ses anciens blocs sont rendus
+    for (int k = 0; k < BLOCS_PAR_CLUSTER; k++) {
+        int index = cluster * BLOCS_PAR_CLUSTER + k;
+        if (index >= MAX_BLOCS_FICHIER) {
+            break;
+        }
+        int* pointeur = index < NB_BLOCS_DIRECTS
+            ? &inode->blocs_directs[index]
+            : &blocs_indirects[index - NB_BLOCS_DIRECTS];
+        if (*pointeur == nouveaux[k]) {
+            continue;
+        }
+        if (*pointeur != 0) {
+            liberer_bloc(fs, *pointeur);
+        }
+        *pointeur = nouveaux[k];
+        *indirect_modifie |= index >= NB_BLOCS_DIRECTS;
+    }
+    carte[cluster] = (uint16_t)taille_compressee;
+    
+    __atomic_add_fetch(&fs->nb_clusters_ecrits, 1, __ATOMIC_RELAXED);
+    if (taille_compressee > 0) {
+        __atomic_add_fetch(&fs->nb_clusters_compresses, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&fs->octets_avant_compression, longueur, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&fs->octets_apres_compression, (unsigned long)nb * TAILLE_BLOC, __ATOMIC_RELAXED);
+    }
+    return 0;
+}
+
+/**
+ * Vide les pages en attente d'un fichier compressé : chaque cluster qui
+ * contient une page est recomposé (les blocs sans page sont repris du
+ * disque), puis réécrit ; les autres clusters ne sont pas touchés.
+ * @param tampon Les pages de l'inode, verrouillé en écriture
+ * @param inode L'inode (épinglé)
+ * @return 0 si succès, -1 si erreur (les pages des clusters non écrits
+ *         restent en attente)
+ */
+static int vider_clusters(SystemeFichiers* fs, TamponInode* tampon, Inode* inode) {
+    uint16_t carte[TAILLE_BLOC / sizeof(uint16_t)];
+    int blocs_indirects[NB_POINTEURS_INDIRECTS] = {0};
+    int indirect_modifie = 0;
+    if (lire_carte_clusters(fs, inode, carte) == -1
+        || (inode->bloc_indirect != 0 && lire_bloc(fs, inode->bloc_indirect, blocs_indirects) == -1)) {
+        return -1;
+    }
+    
+    // La carte et la table indirecte sont allouées avant les clusters
+    PageTampon* derniere = tampon->pages;
+    while (derniere->suivante != NULL) {
+        derniere = derniere->suivante;
+    }
+    int dernier_index = (derniere->index / BLOCS_PAR_CLUSTER + 1) * BLOCS_PAR_CLUSTER - 1;
+    if (dernier_index > (inode->taille - 1) / TAILLE_BLOC) {
+        dernier_index = (inode->taille - 1) / TAILLE_BLOC;
+    }
+    if (inode->bloc_carte == 0) {
+        inode->bloc_carte = trouver_bloc_libre(fs);
+        if (inode->bloc_carte == -1) {
+            inode->bloc_carte = 0;
+            erreur("Aucun bloc libre");
+            return -1;
+        }
+    }
+    if (dernier_index >= NB_BLOCS_DIRECTS && inode->bloc_indirect == 0) {
+        inode->bloc_indirect = trouver_bloc_libre(fs);
+        if (inode->bloc_indirect == -1) {
+            inode->bloc_indirect = 0;
+            ecrire_bloc(fs, inode->bloc_carte, carte);
+            erreur("Aucun bloc libre");
+            return -1;
+        }
+        indirect_modifie = 1;
+    }
+    
+    char* donnees = allouer_aligne(2 * TAILLE_CLUSTER);
+    if (!donnees) {
+        ecrire_bloc(fs, inode->bloc_carte, carte);
+        if (indirect_modifie) {
+            ecrire_bloc(fs, inode->bloc_indirect, blocs_indirects);
+        }
+        erreur("Mémoire insuffisante");
+        return -1;
+    }
+    char* compresse = donnees + TAILLE_CLUSTER;
+    
+    int echec = 0;
+    PageTampon* page = tampon->pages;
+    while (page != NULL && !echec) {
+        int cluster = page->index / BLOCS_PAR_CLUSTER;
+        PageTampon* pages[BLOCS_PAR_CLUSTER] = {NULL};
+        int nb_pages = 0, nb_reserves = 0;
+        for (; page != NULL && page->index / BLOCS_PAR_CLUSTER == cluster; page = page->suivante) {
+            pages[page->index % BLOCS_PAR_CLUSTER] = page;
+            nb_pages++;
+            nb_reserves += page->bloc_reserve;
+        }
+        
+        // Le contenu sur disque n'est relu que si des pages manquent
+        int longueur = inode->taille - cluster * TAILLE_CLUSTER;
+        if (longueur > TAILLE_CLUSTER) {
+            longueur = TAILLE_CLUSTER;
+        }
+        if (nb_pages < (longueur + TAILLE_BLOC - 1) / TAILLE_BLOC) {
+            if (lire_cluster(fs, inode, blocs_indirects, carte, cluster, donnees) == -1) {
+                echec = 1;
+                break;
+            }
+        } else {
+            memset(donnees, 0, TAILLE_CLUSTER);
+        }
+        for (int k = 0; k < BLOCS_PAR_CLUSTER; k++) {
+            if (pages[k]) {
+                memcpy(donnees + k * TAILLE_BLOC, pages[k]->donnees, TAILLE_BLOC);
+            }
+        }
+        
+        if (ecrire_cluster(fs, inode, blocs_indirects, carte, cluster, donnees, compresse,
+                           longueur, nb_reserves, &indirect_modifie) == -1) {
+            echec = 1;
+            break;
+        }
+        
+        // Le cluster est écrit : ses pages n'ont plus de bloc à réserver
+        for (int k = 0; k < BLOCS_PAR_CLUSTER; k++) {
+            if (pages[k]) {
+                pages[k]->bloc_reserve = 0;
+            }
+        }
+        pthread_mutex_lock(&fs->verrou_allocation);
+        fs->nb_blocs_reserves -= nb_reserves;
+        pthread_mutex_unlock(&fs->verrou_allocation);
+    }
+    free(donnees);
+    
+    if (indirect_modifie) {
+        ecrire_bloc(fs, inode->bloc_indirect, blocs_indirects);
+    }
+    ecrire_bloc(fs, inode->bloc_carte, carte);
+    return echec ? -1 : 0;
+}
+
+/**
+ * Vide les pages en attente d'un inode déjà verrouillé en écriture.
+ * Les pages consécutives sans bloc physique reçoivent une zone contiguë
+ * allouée en une seule fois, à la suite des blocs déjà présents.
+ * @param inode_id L'inode dont le tampon doit être vidé
+ * @return 0 si succès, -1 si erreur (les pages restent alors en attente)
+ */
+static int vider_tampon_verrouille(SystemeFichiers* fs, int inode_id) {
+    TamponInode* tampon = chercher_tampon(fs, inode_id, 0);
+    if (!tampon) {
+        return 0;
+    }
+    
+    Inode* inode = epingler_inode(fs, inode_id);
+    if (inode == NULL) {
+        return -1;
+    }
+    
+    // Un petit fichier tenant dans une seule page est rangé dans un
+    // fragment plutôt que dans un bloc entier
+    PageTampon* premiere = tampon->pages;
+    if (tampon->nb_pages == 1 && premiere->index == 0 && premiere->bloc_reserve
+        && inode->taille <= TAILLE_MAX_FRAGMENT
+        && !((inode->drapeaux & INODE_COMPRESSE) && inode->bloc_carte != 0)) {
+        if (inode->drapeaux & INODE_FRAGMENT) {
+            detacher_fragment(fs, inode);
+        }
+        int bloc, offset;
+        if (allouer_fragment(fs, inode->taille, &bloc, &offset) == 0) {
+            ecrire_fragment(fs, bloc, offset, premiere->donnees, inode->taille);
+            inode->bloc_fragment = bloc;
+            inode->offset_fragment = offset;
+            inode->longueur_fragment = inode->taille;
+            inode->drapeaux |= INODE_FRAGMENT;
+            premiere->bloc_reserve = 0;
+            pthread_mutex_lock(&fs->verrou_allocation);
+            fs->nb_blocs_reserves--;
+            pthread_mutex_unlock(&fs->verrou_allocation);
+            desepingler_inode(fs, inode_id, 1);
+            abandonner_tampon_inode(fs, inode_id);
+            return 0;
+        }
+    }
+    
+    // Un fichier compressé est réécrit par clusters
+    if (inode->drapeaux & INODE_COMPRESSE) {
+        int resultat = vider_clusters(fs, tampon, inode);
+        if (resultat == 0 && (inode->drapeaux & INODE_FRAGMENT)) {
+            detacher_fragment(fs, inode);
+        }
+        desepingler_inode(fs, inode_id, 1);
+        if (resultat == 0) {
+            abandonner_tampon_inode(fs, inode_id);
+        }
+        return resultat;
+    }
+    
+    // La table indirecte n'est lue (et réécrite) qu'une fois par vidage
+    int blocs_indirects[NB_POINTEURS_INDIRECTS] = {0};
+    int indirect_modifie = 0;
+    PageTampon* derniere = tampon->pages;
+    while (derniere != NULL && derniere->suivante != NULL) {
+        derniere = derniere->suivante;
+    }
+    if (derniere != NULL && derniere->index >= NB_BLOCS_DIRECTS) {
+        if (inode->bloc_indirect == 0) {
+            inode->bloc_indirect = trouver_bloc_libre(fs);
+            if (inode->bloc_indirect == -1) {
+                inode->bloc_indirect = 0;
+                desepingler_inode(fs, inode_id, 0);
+                erreur("Aucun bloc libre");
+                return -1;
+            }
+            indirect_modifie = 1;
+        } else {
+            lire_bloc(fs, inode->bloc_indirect, blocs_indirects);
+        }
+    }
+    
+    // Blocs partagés : déduplication des pages et copie sur écriture
+    int partage = fs->bloc_references != -1;
+    if (partage && preparer_pages_partagees(fs, tampon, inode, blocs_indirects, &indirect_modifie) == -1) {
+        if (indirect_modifie) {
+            ecrire_bloc(fs, inode->bloc_indirect, blocs_indirects);
+        }
+        desepingler_inode(fs, inode_id, 1);
+        return -1;
+    }
+    
+    // Les pages sont écrites ensemble, une écriture par suite de blocs
+    // consécutifs
+    int blocs_groupes[NB_VECTEURS_BLOCS] = { 0 };
+    const void* sources[NB_VECTEURS_BLOCS] = { NULL };
+    int nb_groupes = 0;
+    
+    PageTampon* page = tampon->pages;
+    while (page != NULL) {
+        int* pointeur = page->index < NB_BLOCS_DIRECTS
+            ? &inode->blocs_directs[page->index]
+            : &blocs_indirects[page->index - NB_BLOCS_DIRECTS];
+        
+        if (partage && page->dedupliquee) {
+            page = page->suivante;
+            continue;
+        }
+        if (nb_groupes == NB_VECTEURS_BLOCS) {
+            ecrire_blocs(fs, blocs_groupes, sources, nb_groupes);
+            nb_groupes = 0;
+        }
+        if (!page->bloc_reserve) {
+            blocs_groupes[nb_groupes] = *pointeur;
+            sources[nb_groupes] = page->donnees;
+            nb_groupes++;
+            page = page->suivante;
+            continue;
+        }
+        
+        // Longueur de la suite de pages consécutives à allouer
+        int nb = 1;
+        for (PageTampon* p = page; p->suivante != NULL && p->suivante->bloc_reserve
+             && p->suivante->index == p->index + 1; p = p->suivante) {
+            nb++;
+        }
+        
+        // Viser le bloc qui suit le bloc logique précédent
+        int but = 0;
+        if (page->index > 0) {
+            int precedent = page->index - 1 < NB_BLOCS_DIRECTS
+                ? inode->blocs_directs[page->index - 1]
+                : blocs_indirects[page->index - 1 - NB_BLOCS_DIRECTS];
+            if (precedent != 0) {
+                but = precedent + 1;
+            }
+        }
+        
+        int nb_obtenus = 0;
+        int debut = allouer_blocs_contigus(fs, nb, but, &nb_obtenus);
+        if (debut == -1) {
+            erreur("Aucun bloc libre");
+            ecrire_blocs(fs, blocs_groupes, sources, nb_groupes);
+            if (indirect_modifie) {
+                ecrire_bloc(fs, inode->bloc_indirect, blocs_indirects);
+            }
+            desepingler_inode(fs, inode_id, 1);
+            return -1;
+        }
+        
+        for (int k = 0; k < nb_obtenus; k++) {
+            pointeur = page->index < NB_BLOCS_DIRECTS
+                ? &inode->blocs_directs[page->index]
+                : &blocs_indirects[page->index - NB_BLOCS_DIRECTS];
+            *pointeur = debut + k;
+            if (page->index >= NB_BLOCS_DIRECTS) {
+                indirect_modifie = 1;
+            }
+            if (nb_groupes == NB_VECTEURS_BLOCS) {
+                ecrire_blocs(fs, blocs_groupes, sources, nb_groupes);
+                nb_groupes = 0;
+            }
+            blocs_groupes[nb_groupes] = debut + k;
+            sources[nb_groupes] = page->donnees;
+            nb_groupes++;
+            page->bloc_reserve = 0;
+            pthread_mutex_lock(&fs->verrou_allocation);
+            fs->nb_blocs_reserves--;
+            pthread_mutex_unlock(&fs->verrou_allocation);
+            page = page->suivante;
+        }
+    }
+    ecrire_blocs(fs, blocs_groupes, sources, nb_groupes);
+    
+    if (indirect_modifie) {
+        ecrire_bloc(fs, inode->bloc_indirect, blocs_indirects);
+    }
+    if (partage && fs->deduplication) {
+        indexer_pages(fs, tampon, inode, blocs_indirects);
+    }
+    
+    // Le fichier a grandi : son ancien fragment est remplacé par des blocs
+    if (inode->drapeaux & INODE_FRAGMENT) {
+        detacher_fragment(fs, inode);
+    }
+    desepingler_inode(fs, inode_id, 1);
+    
+    // Toutes les pages sont sur disque : le tampon peut être libéré
+    abandonner_tampon_inode(fs, inode_id);
+    return 0;
+}
+
+/**
+ * Vide sur la partition les pages en attente d'un inode
+ * @param inode_id L'inode dont le tampon doit être vidé (non verrouillé
+ *                 par l'appelant)
+ * @return 0 si succès, -1 si erreur (les pages restent alors en attente)
+ */
+int vider_tampon_inode(SystemeFichiers* fs, int inode_id) {
+    if (!inode_valide(fs, inode_id)) {
+        return -1;
+    }
+    verrouiller_inode(fs, inode_id, 1);
+    int resultat = vider_tampon_verrouille(fs, inode_id);
+    deverrouiller_inode(fs, inode_id);
+    return resultat;
+}
+
+/**
+ * Vide les tampons d'écriture de tous les inodes.
+ * La liste des inodes est relevée d'abord : chaque vidage prend ensuite le
+ * verrou de son inode, que l'appelant ne doit pas détenir.
+ * @return 0 si succès, -1 si au moins un vidage a échoué
+ */
+static int synchroniser_tampons_interne(SystemeFichiers* fs) {
+    int resultat = 0;
+    int inodes[NB_INODES];
+    int nb = 0;
+    
+    pthread_mutex_lock(&fs->verrou_tampons);
+    for (TamponInode* t = fs->tampons_ecriture; t != NULL && nb < NB_INODES; t = t->suivant) {
+        inodes[nb++] = t->inode;
+    }
+    pthread_mutex_unlock(&fs->verrou_tampons);
+    
+    for (int i = 0; i < nb; i++) {
+        if (vider_tampon_inode(fs, inodes[i]) == -1) {
+            resultat = -1;
+        }
+    }
+    
+    return resultat;
+}
+
+/**
+ * Abandonne les pages en attente d'un inode sans les écrire
+ * (fichier supprimé ou tronqué avant le vidage)
+ * @param inode_id L'inode concerné
+ */
+void abandonner_tampon_inode(SystemeFichiers* fs, int inode_id) {
+    pthread_mutex_lock(&fs->verrou_tampons);
+    TamponInode** lien = &fs->tampons_ecriture;
+    while (*lien != NULL && (*lien)->inode != inode_id) {
+        lien = &(*lien)->suivant;
+    }
+    if (*lien == NULL) {
+        pthread_mutex_unlock(&fs->verrou_tampons);
+        return;
+    }
+    
+    TamponInode* tampon = *lien;
+    *lien = tampon->suivant;
+    
+    int nb_reserves = 0;
+    PageTampon* page = tampon->pages;
+    while (page != NULL) {
+        PageTampon* suivante = page->suivante;
+        if (page->bloc_reserve) {
+            nb_reserves++;
+        }
+        fs->nb_pages_tampon--;
+        free(page);
+        page = suivante;
+    }
+    free(tampon);
+    
+    pthread_mutex_lock(&fs->verrou_allocation);
+    fs->nb_blocs_reserves -= nb_reserves;
+    pthread_mutex_unlock(&fs->verrou_allocation);
+    pthread_mutex_unlock(&fs->verrou_tampons);
+}
+
+/**
+ * Vérifie les droits d'accès
+ * @param num_inode L'inode à vérifier
+ * @param droits_requis Les droits nécessaires (DROIT_LECTURE/ECRITURE/EXECUTION)
+ * @return 1 si les droits sont accordés, 0 sinon
+ */
+int verifier_droits(SystemeFichiers* fs, int num_inode, int droits_requis) {
+    // Vérification de l'identifiant d'inode
+    if (!inode_valide(fs, num_inode)) {
+        return 0;
+    }
+    
+    // L'utilisateur root a tous les droits
+    if (getuid() == 0) {
+        return 1;
+    }
+    
+    Inode* inode = epingler_inode(fs, num_inode);
+    if (inode == NULL) {
+        return 0;
+    }
+    
+    // Détermination du masque de droits selon l'utilisateur
+    int mask = 0;
+    
+    if (inode->proprietaire == getuid()) {
+        // Droits du propriétaire (bits 6-8)
+        mask = (inode->droits >> 6) & 0x7;
+    } else if (inode->groupe == getgid()) {
+        // Droits du groupe (bits 3-5)
+        mask = (inode->droits >> 3) & 0x7;
+    } else {
+        // Droits des autres (bits 0-2)
+        mask = inode->droits & 0x7;
+    }
+    desepingler_inode(fs, num_inode, 0);
+   
+    // Vérification que le masque contient tous les droits requis
+    return (droits_requis & mask) == droits_requis;
+}
+
+/**
+ * Crée un lien physique : une nouvelle entrée du répertoire courant qui
+ * désigne l'inode de la source. Aucun inode n'est alloué ni copié ; seul
+ * le nombre de liens de la source augmente.
+ * @param source Le fichier source
+ * @param nom_lien Le nom du lien à créer
+ * @return 0 si succès, -1 si erreur
+ */
+static int creer_lien_interne(Session* s, const char* source, const char* nom_lien) {
+    SystemeFichiers* fs = s->fs;
+    if (!valider_nom_fichier(nom_lien) || strcmp(nom_lien, ".") == 0 || strcmp(nom_lien, "..") == 0) {
+        erreur("Nom de lien invalide");
+        return -1;
+    }
+
+    // Le répertoire reste verrouillé jusqu'à l'ajout de l'entrée : la
+    // source y garde son nom, donc au moins un lien, jusqu'à l'incrément
+    int parent = s->inode_courant;
+    if (!inode_valide(fs, parent)) {
+        erreur("Répertoire courant invalide");
+        return -1;
+    }
+    verrouiller_inode(fs, parent, 1);
+
+    int inode_source = chercher_entree(fs, parent, source);
+    if (inode_source == -1) {
+        deverrouiller_inode(fs, parent);
+        erreur("Fichier source non trouvé");
+        return -1;
+    }
+    if (chercher_entree(fs, parent, nom_lien) != -1) {
+        deverrouiller_inode(fs, parent);
+        erreur("Un fichier avec ce nom de lien existe déjà");
+        return -1;
+    }
+
+    verrouiller_inode(fs, inode_source, 1);
+    Inode* inode = epingler_inode(fs, inode_source);
+    if (inode == NULL) {
+        deverrouiller_inode(fs, inode_source);
+        deverrouiller_inode(fs, parent);
+        erreur("Numéro d'inode invalide");
+        return -1;
+    }
+    if (inode->type == TYPE_REPERTOIRE) {
+        desepingler_inode(fs, inode_source, 0);
+        deverrouiller_inode(fs, inode_source);
+        deverrouiller_inode(fs, parent);
+        erreur("Impossible de créer un lien physique vers un répertoire");
+        return -1;
+    }
+
+    int resultat = ajouter_entree(fs, parent, nom_lien, inode_source);
+    if (resultat == 0) {
+        inode->nb_liens++;
+    }
+    desepingler_inode(fs, inode_source, resultat == 0);
+    deverrouiller_inode(fs, inode_source);
+    deverrouiller_inode(fs, parent);
+    return resultat;
+}
+
+/**
+ * Indique si un lien physique de l'ancien format est la copie d'un
+ * fichier : mêmes données en ligne, ou mêmes pointeurs de blocs
+ * @param copie L'inode TYPE_LIEN_PHYSIQUE
+ * @param source Un fichier ordinaire
+ * @return 1 si oui, 0 sinon
+ */
+static int copie_de_fichier(const Inode* copie, const Inode* source) {
+    if (source->type != TYPE_FICHIER || source->nb_liens == 0 || copie->taille == 0
+            || copie->drapeaux != source->drapeaux) {
+        return 0;
+    }
+    if (copie->drapeaux & INODE_EN_LIGNE) {
+        return copie->taille == source->taille
+               && memcmp(copie->donnees_en_ligne, source->donnees_en_ligne, TAILLE_EN_LIGNE) == 0;
+    }
+    return memcmp(copie->donnees_en_ligne, source->donnees_en_ligne, TAILLE_EN_LIGNE) == 0;
+}
+
+/**
+ * Convertit les liens physiques de l'ancien format, qui étaient des
+ * copies de l'inode source (type TYPE_LIEN_PHYSIQUE) : leurs entrées
+ * désignent désormais la source et la copie est libérée sans toucher aux
+ * blocs. Une copie dont la source a disparu ou a été réécrite ne désigne
+ * plus des blocs sûrs : elle devient un fichier vide. Le nombre de liens
+ * des inodes concernés est recompté à partir des répertoires. Le
+ * superbloc garde trace de la conversion : elle ne parcourt la table des
+ * inodes qu'une fois par partition.
+ * L'appelant doit avoir l'exclusivité de la partition.
+ * @param fs La partition
+ * @return Le nombre de liens convertis, -1 si erreur
+ */
+static int convertir_liens_physiques(SystemeFichiers* fs) {
+    if (fs->superbloc.liens_convertis) {
+        return 0;
+    }
+    int nb_inodes = fs->superbloc.nb_inodes;
+    Inode* inodes = malloc((size_t)nb_inodes * sizeof(Inode));
+    if (!inodes) {
+        erreur("Mémoire insuffisante");
+        return -1;
+    }
+    int nb_copies = 0;
+    for (int i = 0; i < nb_inodes; i++) {
+        Inode* inode = epingler_inode(fs, i);
+        if (inode == NULL) {
+            free(inodes);
+            return -1;
+        }
+        inodes[i] = *inode;
+        desepingler_inode(fs, i, 0);
+        nb_copies += inodes[i].type == TYPE_LIEN_PHYSIQUE;
+    }
+    if (nb_copies == 0) {
+        free(inodes);
+        fs->superbloc.liens_convertis = 1;
+        return 0;
+    }
+
+    // Source de chaque copie (-1 : inode conservé)
+    int cible[NB_INODES];
+    for (int i = 0; i < nb_inodes; i++) {
+        cible[i] = -1;
+        for (int j = 0; inodes[i].type == TYPE_LIEN_PHYSIQUE && j < nb_inodes; j++) {
+            if (j != i && copie_de_fichier(&inodes[i], &inodes[j])) {
+                cible[i] = j;
+                break;
+            }
+        }
+    }
+
+    // Redirection des entrées et recomptage des noms de chaque inode
+    int nb_noms[NB_INODES] = { 0 };
+    for (int d = 0; d < nb_inodes; d++) {
+        if (inodes[d].type != TYPE_REPERTOIRE || inodes[d].nb_liens == 0 || inodes[d].blocs_directs[0] == 0) {
+            continue;
+        }
+        EntreeRepertoire entrees[MAX_ENTREES_DIR];
+        if (lire_entrees(fs, inodes[d].blocs_directs[0], entrees) == -1) {
+            continue;
+        }
+        int modifie = 0;
+        for (int j = 0; j < MAX_ENTREES_DIR; j++) {
+            int inode_id = entrees[j].inode;
+            if (entrees[j].nom[0] == '\0' || strcmp(entrees[j].nom, ".") == 0
+                    || strcmp(entrees[j].nom, "..") == 0 || inode_id < 0 || inode_id >= nb_inodes) {
+                continue;
+            }
+            if (cible[inode_id] != -1) {
+                entrees[j].inode = inode_id = cible[inode_id];
+                modifie = 1;
+            }
+            nb_noms[inode_id]++;
+        }
+        if (modifie) {
+            ecrire_entrees(fs, inodes[d].blocs_directs[0], entrees);
+        }
+    }
+
+    // Les copies redirigées sont libérées, les autres vidées. Chaque
+    // copie avait aussi augmenté le nombre de liens de sa source, même
+    // introuvable : les fichiers comptent désormais leurs noms.
+    int nb_videes = 0;
+    for (int i = 0; i < nb_inodes; i++) {
+        int copie = inodes[i].type == TYPE_LIEN_PHYSIQUE;
+        if (copie && (cible[i] != -1 || nb_noms[i] == 0)) {
+            liberer_inode(fs, i);
+            continue;
+        }
+        if (!copie && (inodes[i].type != TYPE_FICHIER || nb_noms[i] == 0 || inodes[i].nb_liens == nb_noms[i])) {
+            continue;
+        }
+        Inode* inode = epingler_inode(fs, i);
+        if (inode == NULL) {
+            continue;
+        }
+        if (copie) {
+            memset(inode->donnees_en_ligne, 0, TAILLE_EN_LIGNE);
+            inode->type = TYPE_FICHIER;
+            inode->taille = 0;
+            inode->drapeaux = 0;
+            nb_videes++;
+        }
+        inode->nb_liens = nb_noms[i];
+        desepingler_inode(fs, i, 1);
+    }
+    free(inodes);
+    fs->superbloc.liens_convertis = 1;
+
+    fprintf(flux_sortie(), "%d lien(s) physique(s) de l'ancien format converti(s)", nb_copies);
+    if (nb_videes > 0) {
+        fprintf(flux_sortie(), ", dont %d sans source (vidé(s))", nb_videes);
+    }
+    fprintf(flux_sortie(), "\n");
+    return nb_copies;
+}
+
+/**
+ * Crée un lien symbolique
+ * @param source Le chemin cible du lien
+ * @param destination Le nom du lien symbolique
+ * @return L'identifiant de l'inode créé ou -1 si erreur
+ */
+static int creer_lien_symbolique_interne(Session* s, const char* source, const char* destination) {
+    SystemeFichiers* fs = s->fs;
+    // Vérifier le nom du lien symbolique
+    if (!valider_nom_fichier(destination)) {
+        erreur("Nom de lien symbolique invalide");
+        return -1;
+    }
+
+    // Vérifier s'il existe déjà un fichier du même nom
+    if (trouver_inode_par_nom(fs, s->inode_courant, destination) != -1) {
+        erreur("Un fichier avec ce nom existe déjà");
+        return -1;
+    }
+
+    // Trouver un inode libre pour le lien symbolique
+    int inode_lien = trouver_inode_libre(fs);
+    if (inode_lien == -1) {
+        erreur("Aucun inode libre pour le lien symbolique");
+        return -1;
+    }
+
+    verrouiller_inode(fs, inode_lien, 1);
+    Inode* inode = epingler_inode(fs, inode_lien);
+    if (inode == NULL) {
+        liberer_inode(fs, inode_lien);
+        deverrouiller_inode(fs, inode_lien);
+        erreur("Impossible de charger l'inode du lien symbolique");
+        return -1;
+    }
+    memset(inode, 0, sizeof(Inode));
+    
+    inode->type = TYPE_LIEN_SYMBOLIQUE;
+    inode->date_creation = time(NULL);
+    inode->date_modification = time(NULL);
+    inode->date_acces = time(NULL);
+    inode->nb_liens = 1;
+    inode->proprietaire = getuid();
+    inode->groupe = getgid();
+    inode->droits = 0777;  // Accès total au lien
+
+    // Stocker le chemin source comme contenu du lien
+    size_t longueur = strlen(source);
+    if (longueur >= TAILLE_BLOC) {
+        erreur("Chemin source trop long pour le lien symbolique");
+        desepingler_inode(fs, inode_lien, 1);
+        liberer_inode(fs, inode_lien);
+        deverrouiller_inode(fs, inode_lien);
+        return -1;
+    }
+    inode->taille = longueur + 1;
+
+    // Un chemin court est conservé dans l'inode ; sinon on le stocke dans
+    // un bloc du fichier comme si c'était le contenu
+    int bloc = 0;
+    if (longueur < TAILLE_EN_LIGNE) {
+        memcpy(inode->donnees_en_ligne, source, longueur + 1);
+        inode->drapeaux |= INODE_EN_LIGNE;
+    } else {
+        bloc = trouver_bloc_libre(fs);
+        if (bloc == -1) {
+            erreur("Aucun bloc libre pour le lien symbolique");
+            desepingler_inode(fs, inode_lien, 1);
+            liberer_inode(fs, inode_lien);
+            deverrouiller_inode(fs, inode_lien);
+            return -1;
+        }
+        inode->blocs_directs[0] = bloc;
+
+        char buffer[TAILLE_BLOC] = {0};
+        memcpy(buffer, source, longueur);
+        ecrire_bloc(fs, bloc, buffer);
+    }
+
+    desepingler_inode(fs, inode_lien, 1);
+    deverrouiller_inode(fs, inode_lien);
+
+    // Ajouter l'entrée dans le répertoire courant
+    if (ajouter_entree_repertoire(fs, s->inode_courant, destination, inode_lien) != 0) {
+        if (bloc != 0) {
+            liberer_bloc(fs, bloc);
+        }
+        liberer_inode(fs, inode_lien);
+        erreur("Échec de l'ajout du lien symbolique dans le répertoire");
+        return -1;
+    }
+
+    return 0;  // Succès
+}
+
+/**
+ * Affiche le contenu d'un répertoire
+ * @param inode_dir L'inode du répertoire à afficher
+ */
+void afficher_repertoire(SystemeFichiers* fs, int inode_dir) {
+    // Vérification de l'inode
+    Inode* inode_repertoire = epingler_inode(fs, inode_dir);
+    if (inode_repertoire == NULL) {
+        erreur("Indice d'inode invalide !");
+        return;
+    }
+    int type_repertoire = inode_repertoire->type;
+    int bloc_repertoire = inode_repertoire->blocs_directs[0];
+    desepingler_inode(fs, inode_dir, 0);
+
+    // Vérification du type
+    if (type_repertoire != TYPE_REPERTOIRE) {
+        erreur("L'inode n'est pas un répertoire");
+        return;
+    }
+
+    // Lecture du bloc de répertoire
+    if (bloc_repertoire < 0) {
+        erreur("Bloc de répertoire invalide !");
+        return;
+    }
+
+    EntreeRepertoire entrees[MAX_ENTREES_DIR];
+    verrouiller_inode(fs, inode_dir, 0);
+    int lecture = lire_entrees(fs, bloc_repertoire, entrees);
+    deverrouiller_inode(fs, inode_dir);
+    if (lecture == -1) {
+        erreur("Erreur lors de la lecture du répertoire !");
+        return;
+    }
+
+    // Affichage de l'en-tête
+    fprintf(flux_sortie(), "Contenu du répertoire :\n");
+    fprintf(flux_sortie(), "%-20s %-10s %-6s %-6s %-10s %-10s %-20s\n", "Nom", "Type", "Inode", "Liens",
+            "Taille", "Droits", "Modification");
+    fprintf(flux_sortie(), "------------------------------------------------------------------------------\n");
+
+    // Parcours des entrées
+    for (int i = 0; i < MAX_ENTREES_DIR; i++) {
+        if (entrees[i].nom[0] != '\0') {  // Entrée valide
+            int inode_id = entrees[i].inode;
+
+            // Copie de l'inode sous son verrou : une autre session peut
+            // l'écrire pendant l'affichage
+            if (!inode_valide(fs, inode_id)) {
+                erreur("ID d'inode invalide dans le répertoire !");
+                continue;
+            }
+            verrouiller_inode(fs, inode_id, 0);
+            Inode* epingle = epingler_inode(fs, inode_id);
+            if (epingle == NULL) {
+                deverrouiller_inode(fs, inode_id);
+                erreur("ID d'inode invalide dans le répertoire !");
+                continue;
+            }
+            Inode copie = *epingle;
+            desepingler_inode(fs, inode_id, 0);
+            deverrouiller_inode(fs, inode_id);
+            const Inode* inode = &copie;
+
+            // Détermination du type
+            char type_char = '-';
+            if (inode->type == TYPE_FICHIER) {
+                type_char = 'f';
+            } else if(inode->type == TYPE_REPERTOIRE) {
+                type_char = 'd';
+            } else if (inode->type == TYPE_LIEN_SYMBOLIQUE) {
+                type_char = 'l';
+            }
+
+            // Construction des permissions
+            char droits[11] = { type_char, 
+                (inode->droits & 0400) ? 'r' : '-',
+                (inode->droits & 0200) ? 'w' : '-',
+                (inode->droits & 0100) ? 'x' : '-',
+                (inode->droits & 0040) ? 'r' : '-',
+                (inode->droits & 0020) ? 'w' : '-',
+                (inode->droits & 0010) ? 'x' : '-',
+                (inode->droits & 0004) ? 'r' : '-',
+                (inode->droits & 0002) ? 'w' : '-',
+                (inode->droits & 0001) ? 'x' : '-',
+                '\0' };
+
+            // Formatage de la date
+            char date_buf[20] = "Date inconnue";
+            if (inode->date_modification > 0) {
+                time_t date = (time_t)inode->date_modification;
+                struct tm tm_info;
+                if (localtime_r(&date, &tm_info)) {
+                    strftime(date_buf, sizeof(date_buf), "%Y-%m-%d %H:%M", &tm_info);
+                }
+            }
+
+            // Texte du type
+            char type_str[20];
+            if (inode->type == TYPE_REPERTOIRE) {
+                strcpy(type_str, "Répertoire");
+            } else if (inode->type == TYPE_LIEN_SYMBOLIQUE) {
+                strcpy(type_str, "Lien symb.");
+            } else{
+                strcpy(type_str, "Fichier");
+            }
+
+            // Affichage des informations (les noms d'un même fichier ont
+            // le même inode)
+            fprintf(flux_sortie(), "%-20s %-10s %-6d %-6d %-10d %-10s %-20s\n",
+                   entrees[i].nom, type_str, inode_id, inode->nb_liens, inode->taille, droits, date_buf);
+        }
+    }
+}
+
+/**
+ * Change le répertoire courant
+ * @param chemin Le chemin du répertoire cible
+ * @return 0 si succès, -1 si erreur
+ */
+static int changer_repertoire_interne(Session* s, const char* chemin) {
+    SystemeFichiers* fs = s->fs;
+    // Cas particulier pour remonter au parent
+    if (strcmp(chemin, "..") == 0) {
+        Inode* courant = epingler_inode(fs, s->inode_courant);
+        if (courant == NULL) {
+            return -1;
+        }
+        EntreeRepertoire entrees[MAX_ENTREES_DIR];
+        verrouiller_inode(fs, s->inode_courant, 0);
+        lire_entrees(fs, courant->blocs_directs[0], entrees);
+        deverrouiller_inode(fs, s->inode_courant);
+        desepingler_inode(fs, s->inode_courant, 0);
+        
+        // Recherche de l'entrée ".."
+        for (int i = 0; i < MAX_ENTREES_DIR; i++) {
+            if (strcmp(entrees[i].nom, "..") == 0) {
+                s->inode_courant = entrees[i].inode;
+                return 0;
+            }
+        }
+        
+        return -1;
+    } 
+    // Cas particulier pour le répertoire courant
+    else if (strcmp(chemin, ".") == 0) {
+        return 0;
+    } 
+    // Cas général
+    else {
+        // Recherche du répertoire
+        int inode_id = trouver_inode_par_nom(fs, s->inode_courant, chemin);
+        if (inode_id == -1) {
+            erreur("Répertoire non trouvé");
+            return -1;
+        }
+        
+        // Vérification du type
+        Inode* inode = epingler_inode(fs, inode_id);
+        if (inode == NULL) {
+            erreur("Répertoire non trouvé");
+            return -1;
+        }
+        int type = inode->type;
+        desepingler_inode(fs, inode_id, 0);
+        if (type != TYPE_REPERTOIRE) {
+            erreur("Ce n'est pas un répertoire");
+            return -1;
+        }
+        
+        // Vérification des droits
+        if (!verifier_droits(fs, inode_id, DROIT_EXECUTION)) {
+            erreur("Permission refusée");
+            return -1;
+        }
+        
+        // Changement de répertoire
+        s->inode_courant = inode_id;
+        
+        // Mise à jour de la date d'accès
+        inode = epingler_inode(fs, inode_id);
+        if (inode != NULL) {
+            __atomic_store_n(&inode->date_acces, (int64_t)time(NULL), __ATOMIC_RELAXED);
+            desepingler_inode(fs, inode_id, 1);
+        }
+        
+        return 0;
+    }
+}
+
+/**
+ * Copie le contenu d'un inode dans un nouveau fichier du répertoire courant
+ * @param inode_source L'inode à copier
+ * @param destination Le nom du fichier à créer
+ * @return 0 si succès, -1 si erreur
+ */
+static int copier_contenu(Session* s, int inode_source, const char* destination) {
+    SystemeFichiers* fs = s->fs;
+    // Vérification des droits
+    if (!verifier_droits(fs, inode_source, DROIT_LECTURE)) {
+        erreur("Permission refusée sur le fichier source");
+        return -1;
+    }
+    
+    // Vérification que la destination n'existe pas
+    int inode_dest = trouver_inode_par_nom(fs, s->inode_courant, destination);
+    if (inode_dest != -1) {
+        erreur("La destination existe déjà");
+        return -1;
+    }
+    
+    // Création du fichier destination
+    inode_dest = creer_fichier(s, destination, TYPE_FICHIER);
+    if (inode_dest == -1) {
+        return -1;
+    }
+    
+    // Copie des données par morceaux de NB_BLOCS_COPIE blocs : chaque
+    // morceau est lu et écrit en quelques appels vectoriels
+    Inode* inode = epingler_inode(fs, inode_source);
+    if (inode == NULL) {
+        supprimer_fichier(s, destination);
+        return -1;
+    }
+    int taille = inode->taille;
+    int compresse = (inode->drapeaux & INODE_COMPRESSE) != 0;
+    desepingler_inode(fs, inode_source, 0);
+    
+    // La copie d'un fichier compressé est compressée
+    if (compresse && modifier_compression(fs, inode_dest, 1) == -1) {
+        supprimer_fichier(s, destination);
+        return -1;
+    }
+    char* buffer = allouer_aligne((size_t)NB_BLOCS_COPIE * TAILLE_BLOC);
+    if (!buffer) {
+        supprimer_fichier(s, destination);
+        erreur("Mémoire insuffisante");
+        return -1;
+    }
+    int offset = 0;
+    
+    while (offset < taille) {
+        int bytes_to_read = NB_BLOCS_COPIE * TAILLE_BLOC;
+        if (offset + bytes_to_read > taille) {
+            bytes_to_read = taille - offset;
+        }
+        
+        // Lecture depuis la source, puis écriture vers la destination
+        if (lire_fichier(s, inode_source, buffer, bytes_to_read, offset) != bytes_to_read
+                || ecrire_fichier(s, inode_dest, buffer, bytes_to_read, offset) != bytes_to_read) {
+            free(buffer);
+            supprimer_fichier(s, destination);
+            return -1;
+        }
+        
+        offset += bytes_to_read;
+    }
+    
+    free(buffer);
+    return 0;
+}
+
+/**
+ * Copie un fichier
+ * @param source Le fichier source
+ * @param destination Le fichier destination
+ * @return 0 si succès, -1 si erreur
+ */
+static int copier_fichier_interne(Session* s, const char* source, const char* destination) {
+    // Recherche de l'inode source
+    int inode_source = trouver_inode_par_nom(s->fs, s->inode_courant, source);
+    if (inode_source == -1) {
+        erreur("Fichier source non trouvé");
+        return -1;
+    }
+    return copier_contenu(s, inode_source, destination);
+}
+
+/**
+ * Déplace un fichier ou répertoire
+ * @param source Le fichier/répertoire source
+ * @param destination La nouvelle destination
+ * @return 0 si succès, -1 si erreur
+ */
+static int deplacer_fichier_interne(Session* s, const char* source, const char* destination) {
+    SystemeFichiers* fs = s->fs;
+    // Recherche de l'inode source
+    int inode_source = trouver_inode_par_nom(fs, s->inode_courant, source);
+    if (inode_source == -1) {
+        erreur("Fichier source non trouvé");
+        return -1;
+    }
+    
+    // Vérification que la destination n'existe pas
+    if (trouver_inode_par_nom(fs, s->inode_courant, destination) != -1) {
+        erreur("La destination existe déjà");
+        return -1;
+    }
+    
+    // Vérification des droits
+    if (!verifier_droits(fs, inode_source, DROIT_ECRITURE)) {
+        erreur("Permission refusée");
+        return -1;
+    }
+    
+    // Ajout de la nouvelle entrée
+    if (ajouter_entree_repertoire(fs, s->inode_courant, destination, inode_source) == -1) {
+        return -1;
+    }
+    
+    // Suppression de l'ancienne entrée (met aussi à jour la date de
+    // modification du répertoire)
+    supprimer_entree_repertoire(fs, s->inode_courant, source);
+    
+    return 0;
+}
+
+/**
+ * @brief Copie d'une arborescence relevée par parcourir_arbre, indexée
+ * par numéro d'inode
+ */
+typedef struct {
+    int racine;                                           // Répertoire de départ
+    uint8_t atteint[NB_INODES];                           // 1 si l'inode est dans l'arborescence
+    Inode inodes[NB_INODES];                              // Copie des inodes atteints
+    int nb_blocs[NB_INODES];                              // Blocs occupés par chacun
+    EntreeRepertoire entrees[NB_INODES][MAX_ENTREES_DIR]; // Entrées des répertoires atteints
+} Arborescence;
+
+/**
+ * @brief Répertoires confiés à un thread du parcours. Son propriétaire
+ * dépose et reprend par le bas (les derniers répertoires découverts,
+ * encore chauds), les autres threads volent par le haut (les plus
+ * anciens, qui portent les plus grands sous-arbres).
+ */
+typedef struct {
+    int taches[NB_INODES];
+    int haut;                            // Prochaine tâche à voler
+    int bas;                             // Case suivant la dernière tâche
+} FileParcours;
+
+/**
+ * @brief État partagé d'un parcours parallèle
+ */
+typedef struct {
+    SystemeFichiers* fs;
+    Arborescence* arbre;
+    FileParcours files[NB_FILS_PARCOURS];
+    int restants;                        // Répertoires en file ou en cours de traitement
+    int erreur;                          // 1 si une lecture a échoué
+    pthread_mutex_t verrou;              // Protège les files et les compteurs
+    pthread_cond_t travail;              // Signalé à chaque dépôt et à la fin du parcours
+} Parcours;
+
+/**
+ * @brief Un thread du parcours
+ */
+typedef struct {
+    Parcours* p;
+    int numero;                          // Sa file dans p->files
+    char* blocs;                         // MAX_ENTREES_DIR blocs lus d'un coup
+} FilParcours;
+
+/**
+ * Copie un inode atteint par le parcours et compte les blocs qu'il occupe
+ * (un contenu en ligne ou dans un fragment n'en occupe aucun en propre)
+ * @param arbre L'arborescence
+ * @param id L'inode
+ * @return 0 si succès, -1 si erreur
+ */
+static int relever_inode(SystemeFichiers* fs, Arborescence* arbre, int id) {
+    verrouiller_inode(fs, id, 0);
+    Inode* inode = epingler_inode(fs, id);
+    if (inode == NULL) {
+        deverrouiller_inode(fs, id);
+        return -1;
+    }
+    arbre->inodes[id] = *inode;
+    desepingler_inode(fs, id, 0);
+    deverrouiller_inode(fs, id);
+
+    const Inode* copie = &arbre->inodes[id];
+    int nb = 0;
+    if (!(copie->drapeaux & (INODE_EN_LIGNE | INODE_FRAGMENT))) {
+        for (int i = 0; i < NB_BLOCS_DIRECTS; i++) {
+            nb += copie->blocs_directs[i] != 0;
+        }
+        if (copie->type != TYPE_REPERTOIRE && copie->bloc_indirect != 0) {
+            int pointeurs[NB_POINTEURS_INDIRECTS];
+            if (lire_bloc(fs, copie->bloc_indirect, pointeurs) == -1) {
+                return -1;
+            }
+            nb++;
+            for (int i = 0; i < NB_POINTEURS_INDIRECTS; i++) {
+                nb += pointeurs[i] != 0;
+            }
+        }
+        if ((copie->drapeaux & INODE_COMPRESSE) && copie->bloc_carte != 0) {
+            nb++;
+        }
+    }
+    arbre->nb_blocs[id] = nb;
+    return 0;
+}
+
+/**
+ * Indique si une entrée de répertoire désigne un élément de l'arborescence
+ * (ni libre, ni . ou .., ni vers un inode inexistant)
+ * @param entree L'entrée
+ * @return 1 si oui, 0 sinon
+ */
+static int entree_descendante(SystemeFichiers* fs, const EntreeRepertoire* entree) {
+    return entree->nom[0] != '\0' && strcmp(entree->nom, ".") != 0 && strcmp(entree->nom, "..") != 0
+           && entree->inode > 0 && inode_valide(fs, entree->inode);
+}
+
+/**
+ * Prend un répertoire à traiter : dans sa propre file, sinon dans celle
+ * d'un autre thread. Attend qu'un répertoire soit déposé tant que le
+ * parcours n'est pas fini.
+ * @param f Le thread
+ * @return Le répertoire, ou -1 quand le parcours est fini
+ */
+static int prendre_repertoire(FilParcours* f) {
+    Parcours* p = f->p;
+    int repertoire = -1;
+    pthread_mutex_lock(&p->verrou);
+    while (repertoire == -1 && p->restants > 0) {
+        FileParcours* propre = &p->files[f->numero];
+        if (propre->bas > propre->haut) {
+            repertoire = propre->taches[--propre->bas];
+            break;
+        }
+        for (int k = 1; k < NB_FILS_PARCOURS && repertoire == -1; k++) {
+            FileParcours* autre = &p->files[(f->numero + k) % NB_FILS_PARCOURS];
+            if (autre->bas > autre->haut) {
+                repertoire = autre->taches[autre->haut++];
+            }
+        }
+        if (repertoire == -1) {
+            pthread_cond_wait(&p->travail, &p->verrou);
+        }
+    }
+    pthread_mutex_unlock(&p->verrou);
+    return repertoire;
+}
+
+/**
+ * Traite un répertoire dont les entrées sont déjà relevées : copie les
+ * inodes qu'il contient, lit d'un seul appel vectoriel les blocs de ses
+ * sous-répertoires, puis dépose ceux-ci dans la file du thread
+ * @param f Le thread
+ * @param repertoire Le répertoire
+ */
+static void traiter_repertoire(FilParcours* f, int repertoire) {
+    Parcours* p = f->p;
+    SystemeFichiers* fs = p->fs;
+    Arborescence* arbre = p->arbre;
+    int sous_repertoires[MAX_ENTREES_DIR];
+    int nb = 0, erreur_lecture = 0;
+
+    for (int i = 0; i < MAX_ENTREES_DIR; i++) {
+        const EntreeRepertoire* entree = &arbre->entrees[repertoire][i];
+        if (!entree_descendante(fs, entree)) {
+            continue;
+        }
+        // Un fichier qui a plusieurs noms n'est relevé qu'une fois ; un
+        // répertoire déjà atteint (partition incohérente) n'est pas repris
+        int id = entree->inode;
+        if (__atomic_exchange_n(&arbre->atteint[id], 1, __ATOMIC_ACQ_REL)) {
+            continue;
+        }
+        if (relever_inode(fs, arbre, id) == -1) {
+            erreur_lecture = 1;
+        } else if (arbre->inodes[id].type == TYPE_REPERTOIRE) {
+            sous_repertoires[nb++] = id;
+        }
+    }
+
+    // Lecture groupée des blocs des sous-répertoires, verrouillés en
+    // lecture le temps de la lecture (un répertoire sans bloc est vide)
+    int blocs[MAX_ENTREES_DIR];
+    void* destinations[MAX_ENTREES_DIR];
+    int nb_lus = 0;
+    for (int i = 0; i < nb; i++) {
+        int bloc = arbre->inodes[sous_repertoires[i]].blocs_directs[0];
+        memset(arbre->entrees[sous_repertoires[i]], 0, sizeof(arbre->entrees[0]));
+        if (bloc != 0) {
+            verrouiller_inode(fs, sous_repertoires[i], 0);
+            blocs[nb_lus] = bloc;
+            destinations[nb_lus++] = f->blocs + (size_t)i * TAILLE_BLOC;
+        }
+    }
+    int lecture = nb_lus > 0 ? lire_blocs(fs, blocs, destinations, nb_lus) : 0;
+    for (int i = 0; i < nb; i++) {
+        if (arbre->inodes[sous_repertoires[i]].blocs_directs[0] != 0) {
+            deverrouiller_inode(fs, sous_repertoires[i]);
+            if (lecture == 0) {
+                memcpy(arbre->entrees[sous_repertoires[i]], f->blocs + (size_t)i * TAILLE_BLOC,
+                       sizeof(arbre->entrees[0]));
+            }
+        }
+    }
+    if (lecture == -1) {
+        erreur_lecture = 1;
+        nb = 0;
+    }
+
+    pthread_mutex_lock(&p->verrou);
+    FileParcours* propre = &p->files[f->numero];
+    for (int i = 0; i < nb; i++) {
+        propre->taches[propre->bas++] = sous_repertoires[i];
+    }
+    p->restants += nb - 1;
+    p->erreur |= erreur_lecture;
+    pthread_cond_broadcast(&p->travail);
+    pthread_mutex_unlock(&p->verrou);
+}
+
+/**
+ * Boucle d'un thread du parcours
+ * @param argument Le thread (FilParcours*)
+ * @return NULL
+ */
+static void* parcourir_sous_arbres(void* argument) {
+    FilParcours* f = argument;
+    int repertoire;
+    while ((repertoire = prendre_repertoire(f)) != -1) {
+        traiter_repertoire(f, repertoire);
+    }
+    return NULL;
+}
+
+/**
+ * Relève toute l'arborescence d'un répertoire : entrées des répertoires,
+ * inodes et blocs occupés. Les sous-arbres sont répartis entre
+ * NB_FILS_PARCOURS threads qui se volent le travail ; les blocs des
+ * sous-répertoires d'un répertoire sont lus ensemble avant d'être
+ * distribués. Un thread qui n'a pas pu être créé est remplacé par
+ * l'appelant.
+ * @param racine Le répertoire
+ * @param arbre Reçoit l'arborescence
+ * @return 0 si succès, -1 si erreur
+ */
+static int parcourir_arbre(SystemeFichiers* fs, int racine, Arborescence* arbre) {
+    memset(arbre->atteint, 0, sizeof(arbre->atteint));
+    arbre->racine = racine;
+    arbre->atteint[racine] = 1;
+    if (relever_inode(fs, arbre, racine) == -1 || arbre->inodes[racine].type != TYPE_REPERTOIRE) {
+        erreur("L'inode n'est pas un répertoire");
+        return -1;
+    }
+    verrouiller_inode(fs, racine, 0);
+    int lecture = lire_entrees(fs, arbre->inodes[racine].blocs_directs[0], arbre->entrees[racine]);
+    deverrouiller_inode(fs, racine);
+    if (lecture == -1) {
+        erreur("Erreur lors de la lecture du répertoire");
+        return -1;
+    }
+
+    Parcours* p = calloc(1, sizeof(Parcours));
+    char* blocs = allouer_aligne((size_t)NB_FILS_PARCOURS * MAX_ENTREES_DIR * TAILLE_BLOC);
+    if (!p || !blocs) {
+        free(p);
+        free(blocs);
+        erreur("Mémoire insuffisante");
+        return -1;
+    }
+    p->fs = fs;
+    p->arbre = arbre;
+    p->files[0].taches[p->files[0].bas++] = racine;
+    p->restants = 1;
+    pthread_mutex_init(&p->verrou, NULL);
+    pthread_cond_init(&p->travail, NULL);
+
+    FilParcours fils_parcours[NB_FILS_PARCOURS];
+    pthread_t fils[NB_FILS_PARCOURS];
+    int lance[NB_FILS_PARCOURS];
+    for (int f = 0; f < NB_FILS_PARCOURS; f++) {
+        fils_parcours[f] = (FilParcours){ p, f, blocs + (size_t)f * MAX_ENTREES_DIR * TAILLE_BLOC };
+        lance[f] = pthread_create(&fils[f], NULL, parcourir_sous_arbres, &fils_parcours[f]) == 0;
+    }
+    for (int f = 0; f < NB_FILS_PARCOURS; f++) {
+        if (!lance[f]) {
+            parcourir_sous_arbres(&fils_parcours[f]);
+        }
+    }
+    for (int f = 0; f < NB_FILS_PARCOURS; f++) {
+        if (lance[f]) {
+            pthread_join(fils[f], NULL);
+        }
+    }
+
+    int resultat = p->erreur ? -1 : 0;
+    pthread_cond_destroy(&p->travail);
+    pthread_mutex_destroy(&p->verrou);
+    free(p);
+    free(blocs);
+    if (resultat == -1) {
+        erreur("Erreur de lecture pendant le parcours de l'arborescence");
+    }
+    return resultat;
+}
+
+/**
+ * Supprime un répertoire et tout son contenu. L'arborescence est relevée
+ * par le parcours parallèle ; un fichier dont des noms restent hors de
+ * l'arborescence perd seulement les siens. Les blocs de tous les inodes
+ * libérés sont rendus en un seul lot, puis les inodes en un seul autre.
+ * Un nom qui ne désigne pas un répertoire est supprimé comme par rm.
+ * Appelée sous le verrou global exclusif.
+ * @param nom Le nom du répertoire dans le répertoire courant
+ * @return 0 si succès, -1 si erreur
+ */
+static int supprimer_arbre_interne(Session* s, const char* nom) {
+    SystemeFichiers* fs = s->fs;
+    if (!valider_nom_fichier(nom) || strcmp(nom, ".") == 0 || strcmp(nom, "..") == 0) {
+        erreur("Nom de fichier invalide");
+        return -1;
+    }
+    int parent = s->inode_courant;
+    int racine = trouver_inode_par_nom(fs, parent, nom);
+    if (racine == -1) {
+        erreur("Fichier non trouvé");
+        return -1;
+    }
+    Inode* inode = epingler_inode(fs, racine);
+    if (inode == NULL) {
+        erreur("Numéro d'inode invalide");
+        return -1;
+    }
+    int type = inode->type;
+    desepingler_inode(fs, racine, 0);
+    if (type != TYPE_REPERTOIRE) {
+        return supprimer_fichier_interne(s, nom);
+    }
+
+    Arborescence* arbre = malloc(sizeof(Arborescence));
+    int* lot = malloc((size_t)(NB_BLOCS + MAX_BLOCS_INODE) * sizeof(int));
+    if (!arbre || !lot) {
+        free(arbre);
+        free(lot);
+        erreur("Mémoire insuffisante");
+        return -1;
+    }
+    if (parcourir_arbre(fs, racine, arbre) == -1) {
+        free(arbre);
+        free(lot);
+        return -1;
+    }
+
+    // Chaque répertoire de l'arborescence doit pouvoir être modifié : en
+    // cas de refus, rien n'est supprimé
+    int nb_noms[NB_INODES] = {0};
+    nb_noms[racine] = 1;
+    for (int i = 0; i < NB_INODES; i++) {
+        if (!arbre->atteint[i] || arbre->inodes[i].type != TYPE_REPERTOIRE) {
+            continue;
+        }
+        if (!verifier_droits(fs, i, DROIT_ECRITURE)) {
+            free(arbre);
+            free(lot);
+            erreur("Permission refusée");
+            return -1;
+        }
+        for (int k = 0; k < MAX_ENTREES_DIR; k++) {
+            if (entree_descendante(fs, &arbre->entrees[i][k])) {
+                nb_noms[arbre->entrees[i][k].inode]++;
+            }
+        }
+    }
+
+    // Relevé des blocs des inodes qui perdent leur dernier nom
+    int liberes[NB_INODES];
+    int nb_liberes = 0, nb_fichiers = 0, nb_repertoires = 0, nb_blocs = 0;
+    int capacite = NB_BLOCS + MAX_BLOCS_INODE;
+    for (int i = 0; i < NB_INODES; i++) {
+        if (!arbre->atteint[i]) {
+            continue;
+        }
+        verrouiller_inode(fs, i, 1);
+        inode = epingler_inode(fs, i);
+        if (inode == NULL) {
+            deverrouiller_inode(fs, i);
+            continue;
+        }
+        if (inode->type != TYPE_REPERTOIRE && inode->nb_liens > nb_noms[i]) {
+            inode->nb_liens -= nb_noms[i];
+            desepingler_inode(fs, i, 1);
+            deverrouiller_inode(fs, i);
+            nb_fichiers++;
+            continue;
+        }
+        if (inode->drapeaux & INODE_FRAGMENT) {
+            detacher_fragment(fs, inode);
+        } else if (!(inode->drapeaux & INODE_EN_LIGNE)) {
+            // Un lot plein (blocs dédupliqués comptés plusieurs fois) est rendu
+            if (nb_blocs + MAX_BLOCS_INODE > capacite) {
+                liberer_blocs(fs, lot, nb_blocs);
+                nb_blocs = 0;
+            }
+            nb_blocs += detacher_blocs_inode(fs, inode, lot + nb_blocs);
+        }
+        if (inode->type == TYPE_REPERTOIRE) {
+            nb_repertoires++;
+        } else {
+            nb_fichiers++;
+        }
+        desepingler_inode(fs, i, 1);
+        deverrouiller_inode(fs, i);
+        liberes[nb_liberes++] = i;
+    }
+    // Les noms de l'arborescence quittent l'index
+    for (int i = 0; i < NB_INODES; i++) {
+        for (int k = 0; arbre->atteint[i] && arbre->inodes[i].type == TYPE_REPERTOIRE && k < MAX_ENTREES_DIR; k++) {
+            if (entree_descendante(fs, &arbre->entrees[i][k])) {
+                desindexer_nom(fs, i, arbre->entrees[i][k].nom);
+            }
+        }
+    }
+    liberer_blocs(fs, lot, nb_blocs);
+    liberer_inodes(fs, liberes, nb_liberes);
+    free(arbre);
+    free(lot);
+
+    int resultat = supprimer_entree_repertoire(fs, parent, nom);
+    if (resultat == 0) {
+        fprintf(flux_sortie(), "%d répertoire(s) et %d fichier(s) supprimé(s)\n", nb_repertoires, nb_fichiers);
+    }
+    return resultat;
+}
+
+/**
+ * Copie un lien symbolique dans le répertoire courant (le chemin qu'il
+ * contient, sans le suivre)
+ * @param lien L'inode du lien
+ * @param destination Le nom de la copie
+ * @return 0 si succès, -1 si erreur
+ */
+static int copier_lien_symbolique(Session* s, const Inode* lien, const char* destination) {
+    char cible[TAILLE_BLOC];
+    if (lien->drapeaux & INODE_EN_LIGNE) {
+        memcpy(cible, lien->donnees_en_ligne, TAILLE_EN_LIGNE);
+        cible[TAILLE_EN_LIGNE] = '\0';
+    } else if (lire_bloc(s->fs, lien->blocs_directs[0], cible) == -1) {
+        return -1;
+    }
+    cible[TAILLE_BLOC - 1] = '\0';
+    return creer_lien_symbolique_interne(s, cible, destination);
+}
+
+/**
+ * @brief Un fichier à recopier par copier_arbre
+ */
+typedef struct {
+    int source;                          // Inode copié
+    int repertoire;                      // Répertoire de la copie
+    const char* nom;                     // Nom de la copie
+} TacheCopie;
+
+/**
+ * @brief Fichiers d'une copie d'arborescence, que les threads se partagent
+ */
+typedef struct {
+    SystemeFichiers* fs;
+    const Arborescence* arbre;
+    TacheCopie* taches;
+    int nb_taches;
+    int suivante;                        // Prochaine tâche à prendre
+    int erreur;                          // 1 dès qu'une copie a échoué
+} CopieArbre;
+
+/**
+ * Crée les répertoires de la copie, en profondeur, et relève les fichiers
+ * à recopier
+ * @param c La copie
+ * @param source Un répertoire de l'arborescence source
+ * @param copie Sa copie
+ * @param copies Copie de chaque répertoire déjà créée (-1 : aucune)
+ * @return 0 si succès, -1 si erreur
+ */
+static int creer_squelette(CopieArbre* c, int source, int copie, int* copies) {
+    Session s = { c->fs, copie };
+    for (int i = 0; i < MAX_ENTREES_DIR; i++) {
+        const EntreeRepertoire* entree = &c->arbre->entrees[source][i];
+        if (!entree_descendante(c->fs, entree) || !c->arbre->atteint[entree->inode]) {
+            continue;
+        }
+        int id = entree->inode;
+        if (c->arbre->inodes[id].type != TYPE_REPERTOIRE) {
+            c->taches[c->nb_taches++] = (TacheCopie){ id, copie, entree->nom };
+            continue;
+        }
+        if (copies[id] != -1) {
+            continue;
+        }
+        copies[id] = creer_fichier_interne(&s, entree->nom, TYPE_REPERTOIRE);
+        if (copies[id] == -1 || creer_squelette(c, id, copies[id], copies) == -1) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Boucle d'un thread de copie : prend les fichiers un à un
+ * @param argument La copie (CopieArbre*)
+ * @return NULL
+ */
+static void* copier_fichiers(void* argument) {
+    CopieArbre* c = argument;
+    int k;
+    while (!__atomic_load_n(&c->erreur, __ATOMIC_RELAXED)
+           && (k = __atomic_fetch_add(&c->suivante, 1, __ATOMIC_RELAXED)) < c->nb_taches) {
+        const TacheCopie* tache = &c->taches[k];
+        Session s = { c->fs, tache->repertoire };
+        const Inode* source = &c->arbre->inodes[tache->source];
+        int resultat = source->type == TYPE_LIEN_SYMBOLIQUE
+                       ? copier_lien_symbolique(&s, source, tache->nom)
+                       : copier_contenu(&s, tache->source, tache->nom);
+        if (resultat == -1) {
+            __atomic_store_n(&c->erreur, 1, __ATOMIC_RELAXED);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Copie un répertoire et tout son contenu. L'arborescence source est
+ * relevée par le parcours parallèle, les répertoires de la copie sont
+ * créés, puis les fichiers sont recopiés par NB_FILS_PARCOURS threads.
+ * Chaque nom d'un fichier à plusieurs liens devient un fichier distinct,
+ * comme avec cp -r. Une copie incomplète est supprimée. Un nom qui ne
+ * désigne pas un répertoire est copié comme par cp. Appelée sous le
+ * verrou global exclusif.
+ * @param source Le répertoire source, dans le répertoire courant
+ * @param destination Le nom de la copie
+ * @return 0 si succès, -1 si erreur
+ */
+static int copier_arbre_interne(Session* s, const char* source, const char* destination) {
+    SystemeFichiers* fs = s->fs;
+    int racine = trouver_inode_par_nom(fs, s->inode_courant, source);
+    if (racine == -1) {
+        erreur("Fichier source non trouvé");
+        return -1;
+    }
+    Inode* inode = epingler_inode(fs, racine);
+    if (inode == NULL) {
+        erreur("Numéro d'inode invalide");
+        return -1;
+    }
+    int type = inode->type;
+    desepingler_inode(fs, racine, 0);
+    if (type != TYPE_REPERTOIRE) {
+        return copier_fichier_interne(s, source, destination);
+    }
+    if (!verifier_droits(fs, racine, DROIT_LECTURE)) {
+        erreur("Permission refusée sur le répertoire source");
+        return -1;
+    }
+    if (!valider_nom_fichier(destination) || strcmp(destination, ".") == 0 || strcmp(destination, "..") == 0) {
+        erreur("Nom de destination invalide");
+        return -1;
+    }
+    if (trouver_inode_par_nom(fs, s->inode_courant, destination) != -1) {
+        erreur("La destination existe déjà");
+        return -1;
+    }
+
+    Arborescence* arbre = malloc(sizeof(Arborescence));
+    TacheCopie* taches = malloc((size_t)NB_INODES * MAX_ENTREES_DIR * sizeof(TacheCopie));
+    if (!arbre || !taches) {
+        free(arbre);
+        free(taches);
+        erreur("Mémoire insuffisante");
+        return -1;
+    }
+    // L'arborescence est relevée avant la création de la copie, qui n'y
+    // figure donc pas
+    if (parcourir_arbre(fs, racine, arbre) == -1) {
+        free(arbre);
+        free(taches);
+        return -1;
+    }
+
+    CopieArbre c = { fs, arbre, taches, 0, 0, 0 };
+    int copies[NB_INODES];
+    for (int i = 0; i < NB_INODES; i++) {
+        copies[i] = -1;
+    }
+    copies[racine] = creer_fichier_interne(s, destination, TYPE_REPERTOIRE);
+    int resultat = copies[racine] == -1 ? -1 : creer_squelette(&c, racine, copies[racine], copies);
+
+    if (resultat == 0) {
+        pthread_t fils[NB_FILS_PARCOURS];
+        int lance[NB_FILS_PARCOURS];
+        // L'appelant est le premier des NB_FILS_PARCOURS threads
+        lance[0] = 0;
+        for (int f = 1; f < NB_FILS_PARCOURS; f++) {
+            lance[f] = pthread_create(&fils[f], NULL, copier_fichiers, &c) == 0;
+        }
+        copier_fichiers(&c);
+        for (int f = 1; f < NB_FILS_PARCOURS; f++) {
+            if (lance[f]) {
+                pthread_join(fils[f], NULL);
+            }
+        }
+        resultat = c.erreur ? -1 : 0;
+    }
+
+    if (resultat == -1 && copies[racine] != -1) {
+        erreur("Copie incomplète : elle est supprimée");
+        supprimer_arbre_interne(s, destination);
+    }
+    free(arbre);
+    free(taches);
+    return resultat;
+}
+
+/**
+ * Cumule l'occupation d'un répertoire de l'arborescence et l'affiche
+ * après celle de chacun de ses sous-répertoires, comme du
+ * @param arbre L'arborescence
+ * @param repertoire Le répertoire
+ * @param chemin Son chemin, prolongé le temps de ses sous-répertoires
+ * @param comptes 1 pour chaque inode déjà compté (un fichier qui a
+ *        plusieurs noms ne l'est qu'une fois)
+ * @param taille Reçoit la taille cumulée (octets)
+ * @param blocs Reçoit le nombre de blocs cumulé
+ */
+static void cumuler_occupation(SystemeFichiers* fs, const Arborescence* arbre, int repertoire, char* chemin,
+                               uint8_t* comptes, long* taille, long* blocs) {
+    *taille = arbre->inodes[repertoire].taille;
+    *blocs = arbre->nb_blocs[repertoire];
+    size_t longueur = strlen(chemin);
+    for (int i = 0; i < MAX_ENTREES_DIR; i++) {
+        const EntreeRepertoire* entree = &arbre->entrees[repertoire][i];
+        if (!entree_descendante(fs, entree) || !arbre->atteint[entree->inode] || comptes[entree->inode]) {
+            continue;
+        }
+        int id = entree->inode;
+        comptes[id] = 1;
+        if (arbre->inodes[id].type != TYPE_REPERTOIRE) {
+            *taille += arbre->inodes[id].taille;
+            *blocs += arbre->nb_blocs[id];
+            continue;
+        }
+        long taille_sous_arbre, blocs_sous_arbre;
+        chemin[longueur] = '/';
+        strcpy(chemin + longueur + 1, entree->nom);
+        cumuler_occupation(fs, arbre, id, chemin, comptes, &taille_sous_arbre, &blocs_sous_arbre);
+        chemin[longueur] = '\0';
+        *taille += taille_sous_arbre;
+        *blocs += blocs_sous_arbre;
+    }
+    fprintf(flux_sortie(), "%10ld %6ld  %s\n", *taille, *blocs, chemin);
+}
+
+/**
+ * Affiche l'occupation d'un répertoire et de chacun de ses
+ * sous-répertoires : taille cumulée et blocs occupés
+ * @param nom Le répertoire, dans le répertoire courant (NULL : le
+ *        répertoire courant)
+ * @return 0 si succès, -1 si erreur
+ */
+static int afficher_occupation_interne(Session* s, const char* nom) {
+    SystemeFichiers* fs = s->fs;
+    int racine = nom ? trouver_inode_par_nom(fs, s->inode_courant, nom) : s->inode_courant;
+    if (racine == -1) {
+        erreur("Fichier non trouvé");
+        return -1;
+    }
+    Arborescence* arbre = malloc(sizeof(Arborescence));
+    char* chemin = malloc((size_t)NB_INODES * (MAX_NOM_FICHIER + 1) + 2);
+    uint8_t* comptes = calloc(NB_INODES, 1);
+    if (!arbre || !chemin || !comptes) {
+        free(arbre);
+        free(chemin);
+        free(comptes);
+        erreur("Mémoire insuffisante");
+        return -1;
+    }
+    strcpy(chemin, nom ? nom : ".");
+
+    int resultat = relever_inode(fs, arbre, racine);
+    if (resultat == 0 && arbre->inodes[racine].type != TYPE_REPERTOIRE) {
+        fprintf(flux_sortie(), "%10s %6s  %s\n", "Taille", "Blocs", "Chemin");
+        fprintf(flux_sortie(), "%10d %6d  %s\n", arbre->inodes[racine].taille, arbre->nb_blocs[racine], chemin);
+    } else if (resultat == 0 && (resultat = parcourir_arbre(fs, racine, arbre)) == 0) {
+        long taille, blocs;
+        comptes[racine] = 1;
+        fprintf(flux_sortie(), "%10s %6s  %s\n", "Taille", "Blocs", "Chemin");
+        cumuler_occupation(fs, arbre, racine, chemin, comptes, &taille, &blocs);
+    } else if (resultat == -1) {
+        erreur("Impossible de lire l'inode");
+    }
+    free(arbre);
+    free(chemin);
+    free(comptes);
+    return resultat;
+}
+
+/**
+ * Affiche le contenu d'un répertoire de l'arborescence, en arbre
+ * @param arbre L'arborescence
+ * @param repertoire Le répertoire
+ * @param prefixe Les traits des niveaux supérieurs, prolongé le temps des
+ *        sous-répertoires
+ * @param affiches 1 pour chaque répertoire déjà développé
+ * @param nb_repertoires Compteur de répertoires, incrémenté
+ * @param nb_fichiers Compteur de fichiers, incrémenté
+ */
+static void afficher_branche(SystemeFichiers* fs, const Arborescence* arbre, int repertoire, char* prefixe,
+                             uint8_t* affiches, int* nb_repertoires, int* nb_fichiers) {
+    int enfants[MAX_ENTREES_DIR];
+    int nb = 0;
+    for (int i = 0; i < MAX_ENTREES_DIR; i++) {
+        const EntreeRepertoire* entree = &arbre->entrees[repertoire][i];
+        if (entree_descendante(fs, entree) && arbre->atteint[entree->inode]) {
+            enfants[nb++] = i;
+        }
+    }
+
+    size_t longueur = strlen(prefixe);
+    for (int k = 0; k < nb; k++) {
+        const EntreeRepertoire* entree = &arbre->entrees[repertoire][enfants[k]];
+        const Inode* inode = &arbre->inodes[entree->inode];
+        int dernier = k == nb - 1;
+        fprintf(flux_sortie(), "%s%s%s", prefixe, dernier ? "└── " : "├── ", entree->nom);
+        if (inode->type == TYPE_LIEN_SYMBOLIQUE && (inode->drapeaux & INODE_EN_LIGNE)) {
+            fprintf(flux_sortie(), " -> %.*s", TAILLE_EN_LIGNE, inode->donnees_en_ligne);
+        }
+        fprintf(flux_sortie(), "%s\n", inode->type == TYPE_REPERTOIRE ? "/" : "");
+
+        if (inode->type != TYPE_REPERTOIRE) {
+            (*nb_fichiers)++;
+            continue;
+        }
+        (*nb_repertoires)++;
+        if (!affiches[entree->inode]) {
+            affiches[entree->inode] = 1;
+            strcpy(prefixe + longueur, dernier ? "    " : "│   ");
+            afficher_branche(fs, arbre, entree->inode, prefixe, affiches, nb_repertoires, nb_fichiers);
+            prefixe[longueur] = '\0';
+        }
+    }
+}
+
+/**
+ * Affiche l'arborescence d'un répertoire, comme tree
+ * @param nom Le répertoire, dans le répertoire courant (NULL : le
+ *        répertoire courant)
+ * @return 0 si succès, -1 si erreur
+ */
+static int afficher_arborescence_interne(Session* s, const char* nom) {
+    SystemeFichiers* fs = s->fs;
+    int racine = nom ? trouver_inode_par_nom(fs, s->inode_courant, nom) : s->inode_courant;
+    if (racine == -1) {
+        erreur("Fichier non trouvé");
+        return -1;
+    }
+    Arborescence* arbre = malloc(sizeof(Arborescence));
+    char* prefixe = malloc((size_t)NB_INODES * sizeof("│   "));
+    uint8_t* affiches = calloc(NB_INODES, 1);
+    if (!arbre || !prefixe || !affiches) {
+        free(arbre);
+        free(prefixe);
+        free(affiches);
+        erreur("Mémoire insuffisante");
+        return -1;
+    }
+
+    int resultat = parcourir_arbre(fs, racine, arbre);
+    if (resultat == 0) {
+        int nb_repertoires = 0, nb_fichiers = 0;
+        prefixe[0] = '\0';
+        affiches[racine] = 1;
+        fprintf(flux_sortie(), "%s\n", nom ? nom : ".");
+        afficher_branche(fs, arbre, racine, prefixe, affiches, &nb_repertoires, &nb_fichiers);
+        fprintf(flux_sortie(), "\n%d répertoire(s), %d fichier(s)\n", nb_repertoires, nb_fichiers);
+    }
+    free(arbre);
+    free(prefixe);
+    free(affiches);
+    return resultat;
+}
+
+/**
+ * @brief Un nom retenu par find, avec son chemin complet
+ */
+typedef struct {
+    char* chemin;
+    int inode;
+} NomTrouve;
+
+/**
+ * Ordre des noms trouvés : par chemin
+ */
+static int comparer_noms_trouves(const void* a, const void* b) {
+    return strcmp(((const NomTrouve*)a)->chemin, ((const NomTrouve*)b)->chemin);
+}
+
+/**
+ * Choisit la liste de trigrammes la moins peuplée parmi les parties fixes
+ * d'un motif (suites sans *, ? ni classe [...]) d'au moins trois octets :
+ * tout nom qui correspond au motif y figure. L'appelant tient le verrou
+ * de l'index.
+ * @param motif Le motif
+ * @return La liste, ou NULL si aucune partie fixe n'est assez longue
+ */
+static const ListeTrigrammes* candidats_du_motif(const IndexNoms* index, const char* motif) {
+    const ListeTrigrammes* meilleure = NULL;
+    char partie[MAX_NOM_FICHIER + 1];
+    int longueur = 0;
+    for (const char* c = motif;; c++) {
+        int fixe = *c != '\0' && strchr("*?[", *c) == NULL && !(*c == '\\' && c[1] == '\0');
+        if (fixe) {
+            if (*c == '\\') {
+                c++;                      // Caractère échappé
+            }
+            if (longueur < MAX_NOM_FICHIER) {
+                partie[longueur++] = *c;
+            }
+            continue;
+        }
+        for (int i = 0; i + 3 <= longueur; i++) {
+            const ListeTrigrammes* liste = &index->trigrammes[seau_du_trigramme(partie + i)];
+            if (meilleure == NULL || liste->nb < meilleure->nb) {
+                meilleure = liste;
+            }
+        }
+        longueur = 0;
+        if (*c == '\0') {
+            break;
+        }
+        if (*c == '[') {
+            // Un ']' juste après '[', '[!' ou '[^' fait partie de la classe
+            const char* fin = c + 1;
+            if (*fin == '!' || *fin == '^') fin++;
+            if (*fin == ']') fin++;
+            while (*fin != '\0' && *fin != ']') fin++;
+            if (*fin == ']') {
+                c = fin;
+            }
+        }
+    }
+    return meilleure;
+}
+
+/**
+ * Affiche les fichiers de la partition dont le nom correspond à un motif
+ * (syntaxe de fnmatch : *, ?, [...]), avec leur chemin complet. Un nom
+ * sans caractère spécial est cherché par son hachage ; un motif, parmi
+ * les noms d'un seul seau de trigrammes, sinon parmi tous les noms.
+ * @param motif Le motif
+ * @return 0 si succès, -1 si erreur
+ */
+static int rechercher_noms_interne(Session* s, const char* motif) {
+    SystemeFichiers* fs = s->fs;
+    IndexNoms* index = &fs->index_noms;
+    int* candidats = malloc(MAX_NOMS_INDEX * sizeof(int));
+    int* composantes = malloc(NB_INODES * sizeof(int));
+    char* chemin = malloc((size_t)NB_INODES * (MAX_NOM_FICHIER + 1) + 2);
+    NomTrouve* trouves = NULL;
+    if (!candidats || !composantes || !chemin) {
+        free(candidats);
+        free(composantes);
+        free(chemin);
+        erreur("Mémoire insuffisante");
+        return -1;
+    }
+
+    preparer_index_noms(fs);
+    pthread_mutex_lock(&fs->verrou_noms);
+    int nb_candidats = 0;
+    const ListeTrigrammes* liste;
+    if (strpbrk(motif, "*?[\\") == NULL) {
+        for (int k = index->seaux[seau_du_nom(motif)]; k != -1; k = index->noms[k].suivant) {
+            candidats[nb_candidats++] = k;
+        }
+    } else if ((liste = candidats_du_motif(index, motif)) != NULL) {
+        memcpy(candidats, liste->cases, (size_t)liste->nb * sizeof(int));
+        nb_candidats = liste->nb;
+    } else {
+        for (int k = 0; k < MAX_NOMS_INDEX; k++) {
+            if (index->noms[k].nom != NULL) {
+                candidats[nb_candidats++] = k;
+            }
+        }
+    }
+
+    int nb_trouves = 0, resultat = 0;
+    for (int j = 0; j < nb_candidats && resultat == 0; j++) {
+        NomIndexe* nom = &index->noms[candidats[j]];
+        int nb = fnmatch(motif, nom->nom, 0) == 0 ? remonter_nom(index, candidats[j], composantes) : -1;
+        if (nb == -1) {
+            continue;
+        }
+        char* fin = chemin;
+        while (nb-- > 0) {
+            fin += sprintf(fin, "/%s", index->noms[composantes[nb]].nom);
+        }
+        NomTrouve* agrandi = realloc(trouves, (size_t)(nb_trouves + 1) * sizeof(NomTrouve));
+        char* copie = strdup(chemin);
+        if (agrandi) {
+            trouves = agrandi;
+        }
+        if (!agrandi || !copie) {
+            free(copie);
+            resultat = -1;
+            break;
+        }
+        trouves[nb_trouves++] = (NomTrouve){ copie, nom->inode };
+    }
+    pthread_mutex_unlock(&fs->verrou_noms);
+
+    if (resultat == -1) {
+        erreur("Mémoire insuffisante");
+    } else {
+        qsort(trouves, nb_trouves, sizeof(NomTrouve), comparer_noms_trouves);
+        for (int j = 0; j < nb_trouves; j++) {
+            fprintf(flux_sortie(), "%6d  %s\n", trouves[j].inode, trouves[j].chemin);
+        }
+        fprintf(flux_sortie(), "%d fichier(s) trouvé(s)\n", nb_trouves);
+    }
+    for (int j = 0; j < nb_trouves; j++) {
+        free(trouves[j].chemin);
+    }
+    free(trouves);
+    free(candidats);
+    free(composantes);
+    free(chemin);
+    return resultat;
+}
+
+/**
+ * Modifie les droits d'un fichier
+ * @param inode_id L'inode à modifier
+ * @param nouveaux_droits Les nouveaux droits (en octal)
+ * @return 0 si succès, -1 si erreur
+ */
+int modifier_droits(SystemeFichiers* fs, int inode_id, int nouveaux_droits) {
+    Inode* inode = epingler_inode(fs, inode_id);
+    if (inode == NULL) {
+        fprintf(flux_sortie(), "Erreur: Numéro d'inode invalide.\n");
+        return -1;
+    }
+
+    verrouiller_inode(fs, inode_id, 1);
+    inode->droits = nouveaux_droits; 
+    inode->date_modification = time(NULL);
+    deverrouiller_inode(fs, inode_id);
+
+    fprintf(flux_sortie(), "Les droits de l'inode %d ont été modifiés avec succès.\n", inode_id);
+    desepingler_inode(fs, inode_id, 1);
+    return 0;
+}
+
+/**
+ * Active ou désactive la compression d'un fichier (chattr +c / -c).
+ * Le contenu déjà écrit est converti : tous ses blocs sont repris dans
+ * des pages, puis réécrits au nouveau format par le vidage.
+ * @param inode_id L'inode du fichier
+ * @param actif 1 pour compresser le fichier, 0 pour le stocker tel quel
+ * @return 0 si succès, -1 si erreur
+ */
+int modifier_compression(SystemeFichiers* fs, int inode_id, int actif) {
+    if (!inode_valide(fs, inode_id)) {
+        erreur("Numéro d'inode invalide");
+        return -1;
+    }
+    
+    verrouiller_inode(fs, inode_id, 1);
+    Inode* inode = epingler_inode(fs, inode_id);
+    if (inode == NULL) {
+        deverrouiller_inode(fs, inode_id);
+        erreur("Numéro d'inode invalide");
+        return -1;
+    }
+    if (inode->type != TYPE_FICHIER) {
+        desepingler_inode(fs, inode_id, 0);
+        deverrouiller_inode(fs, inode_id);
+        erreur("L'inode n'est pas un fichier");
+        return -1;
+    }
+    if (!verifier_droits(fs, inode_id, DROIT_ECRITURE)) {
+        desepingler_inode(fs, inode_id, 0);
+        deverrouiller_inode(fs, inode_id);
+        erreur("Permission refusée");
+        return -1;
+    }
+    if (!(inode->drapeaux & INODE_COMPRESSE) == !actif) {
+        desepingler_inode(fs, inode_id, 0);
+        deverrouiller_inode(fs, inode_id);
+        return 0;
+    }
+    
+    // Les pages en attente sont d'abord écrites au format actuel
+    int resultat = vider_tampon_verrouille(fs, inode_id);
+    if (resultat == 0 && (inode->taille == 0 || (inode->drapeaux & (INODE_EN_LIGNE | INODE_FRAGMENT)))) {
+        // Aucun bloc de données : seul le drapeau change
+        inode->drapeaux ^= INODE_COMPRESSE;
+    } else if (resultat == 0) {
+        // Chaque bloc est lu dans l'ancien format...
+        TamponInode* tampon = chercher_tampon(fs, inode_id, 1);
+        int nb_blocs = (inode->taille + TAILLE_BLOC - 1) / TAILLE_BLOC;
+        for (int i = 0; i < nb_blocs && resultat == 0; i++) {
+            if (tampon == NULL || obtenir_page(fs, tampon, inode, i) == NULL) {
+                resultat = -1;
+            }
+        }
+        
+        // ... puis réécrit dans le nouveau. Un échec du vidage laisse les
+        // pages en attente : elles sont déjà au nouveau format.
+        if (resultat == -1) {
+            abandonner_tampon_inode(fs, inode_id);
+        } else {
+            inode->drapeaux ^= INODE_COMPRESSE;
+            if (!actif && inode->bloc_carte != 0) {
+                liberer_bloc(fs, inode->bloc_carte);
+                inode->bloc_carte = 0;
+            }
+            resultat = vider_tampon_verrouille(fs, inode_id);
+        }
+    }
+    
+    inode->date_modification = time(NULL);
+    desepingler_inode(fs, inode_id, 1);
+    deverrouiller_inode(fs, inode_id);
+    return resultat;
+}
+
+/**
+ * Convertit une chaîne de droits (rwxrwxrwx) en valeur octale
+ * @param droits La chaîne de droits
+ * @return La valeur octale ou -1 si format invalide
+ */
+int convertir_droits_char(const char* droits) {
+    int result = 0;
+    
+    // Vérifier que les droits sont bien sous la forme de 9 caractères
+    if (strlen(droits) == 9) {
+        // Les trois premiers caractères sont pour le propriétaire
+        if (droits[0] == 'r') result |= 0400; 
+        if (droits[1] == 'w') result |= 0200; 
+        if (droits[2] == 'x') result |= 0100;
+
+        // Les trois suivants sont pour le groupe
+        if (droits[3] == 'r') result |= 0040;
+        if (droits[4] == 'w') result |= 0020; 
+        if (droits[5] == 'x') result |= 0010; 
+
+        // Les trois derniers sont pour les autres
+        if (droits[6] == 'r') result |= 0004;
+        if (droits[7] == 'w') result |= 0002; 
+        if (droits[8] == 'x') result |= 0001;
+
+        return result;
+    }
+    
+    return -1; // Format invalide
+}
+
+
+/**
+ * Sauvegarde l'état actuel de la partition dans un fichier.
+ * 
+ * @param fichier_sauvegarde Le chemin du fichier où sauvegarder l'état.
+ * @return void
+ */
+static void sauvegarder_etat_interne(SystemeFichiers* fs, const char* fichier_sauvegarde) {
+    FILE* f = fopen(fichier_sauvegarde, "wb");
+    if (!f) {
+        erreur("Impossible d'ouvrir le fichier de sauvegarde");
+        return;
+    }
+
+    // La sauvegarde doit contenir les données en attente et une table
+    // des inodes à jour dans la partition
+    sauvegarder_partition(fs);
+
+    void* buffer = allouer_aligne((size_t)NB_BLOCS_COPIE * TAILLE_BLOC);
+    if (!buffer) {
+        fclose(f);
+        erreur("Mémoire insuffisante");
+        return;
+    }
+
+    fwrite(&fs->superbloc, sizeof(Superbloc), 1, f);
+    fwrite(fs->bitmap, sizeof(fs->bitmap), 1, f);
+
+    // Recopie de la table des inodes par morceaux (elle n'est pas en mémoire)
+    long reste = (long)fs->superbloc.nb_inodes * sizeof(Inode);
+    long position = OFFSET_TABLE_INODES;
+    while (reste > 0) {
+        size_t morceau = reste < TAILLE_BLOC ? reste : TAILLE_BLOC;
+        lire_partition(fs, buffer, morceau, position);
+        fwrite(buffer, morceau, 1, f);
+        reste -= morceau;
+        position += morceau;
+    }
+
+    // Les blocs sont recopiés par morceaux de NB_BLOCS_COPIE blocs
+    for (int i = 0; i < NB_BLOCS; i += NB_BLOCS_COPIE) {
+        size_t morceau = (size_t)(NB_BLOCS - i < NB_BLOCS_COPIE ? NB_BLOCS - i : NB_BLOCS_COPIE) * TAILLE_BLOC;
+        lire_partition(fs, buffer, morceau, (long)i * TAILLE_BLOC);
+        fwrite(buffer, morceau, 1, f);
+    }
+
+    free(buffer);
+    fclose(f);
+    fprintf(flux_sortie(), "Partition sauvegardée dans '%s'\n", fichier_sauvegarde);
+}
+
+/**
+ * Restaure l'état de la partition à partir d'un fichier de sauvegarde.
+ * 
+ * @param fichier_sauvegarde Le chemin du fichier de sauvegarde.
+ * @return void
+ */
+static void restaurer_etat_interne(SystemeFichiers* fs, const char* fichier_sauvegarde) {
+    FILE* f = fopen(fichier_sauvegarde, "rb");
+    if (!f) {
+        erreur("Impossible d'ouvrir le fichier de restauration");
+        return;
+    }
+
+    // Les pages en attente concernent l'ancien état
+    while (fs->tampons_ecriture != NULL) {
+        abandonner_tampon_inode(fs, fs->tampons_ecriture->inode);
+    }
+
+    void* buffer = allouer_aligne((size_t)NB_BLOCS_COPIE * TAILLE_BLOC);
+    if (!buffer) {
+        fclose(f);
+        erreur("Mémoire insuffisante");
+        return;
+    }
+
+    Superbloc superbloc;
+    if (fread(&superbloc, sizeof(Superbloc), 1, f) != 1
+            || superbloc.nb_inodes < 0 || superbloc.nb_inodes > NB_INODES) {
+        free(buffer);
+        fclose(f);
+        erreur("Fichier de sauvegarde invalide");
+        return;
+    }
+    fs->superbloc = superbloc;
+    fread(fs->bitmap, sizeof(fs->bitmap), 1, f);
+    invalider_cache_inodes(fs);
+    // L'ancienne table des sommes est recouverte : plus rien n'y est écrit
+    fs->bloc_sommes = -1;
+
+    // La table des inodes sera recopiée après les blocs, qui en
+    // contiennent une version potentiellement plus ancienne
+    int ancien_format = strcmp(fs->superbloc.identifiant_fs, SIGNATURE_FS_V1) == 0;
+    long debut_table = ftell(f);
+    long taille_table = (long)fs->superbloc.nb_inodes * (ancien_format ? sizeof(InodeV1) : sizeof(Inode));
+    fseek(f, taille_table, SEEK_CUR);
+
+    for (int i = 0; i < NB_BLOCS; i += NB_BLOCS_COPIE) {
+        size_t morceau = (size_t)(NB_BLOCS - i < NB_BLOCS_COPIE ? NB_BLOCS - i : NB_BLOCS_COPIE) * TAILLE_BLOC;
+        fread(buffer, morceau, 1, f);
+        ecrire_partition(fs, buffer, morceau, (long)i * TAILLE_BLOC);
+    }
+
+    fseek(f, debut_table, SEEK_SET);
+    long position = ancien_format ? OFFSET_TABLE_INODES_V1 : OFFSET_TABLE_INODES;
+    while (taille_table > 0) {
+        size_t morceau = taille_table < TAILLE_BLOC ? taille_table : TAILLE_BLOC;
+        fread(buffer, morceau, 1, f);
+        ecrire_partition(fs, buffer, morceau, position);
+        taille_table -= morceau;
+        position += morceau;
+    }
+
+    free(buffer);
+    fclose(f);
+
+    // Une sauvegarde de l'ancien format est convertie à la volée
+    if (ancien_format) {
+        migrer_partition_v1(fs);
+    } else {
+        charger_table_fragments(fs);
+    }
+    // La table des sommes est peut-être ailleurs dans la sauvegarde, ou absente
+    charger_sommes_controle(fs, 0);
+    charger_references(fs);
+    convertir_liens_physiques(fs);
+    invalider_index_noms(fs);
+    fprintf(flux_sortie(), "Partition restaurée depuis '%s'\n", fichier_sauvegarde);
+}
+
+/**
+ * Lit l'image complète de la partition, par morceaux de NB_BLOCS_COPIE blocs
+ * @param fs La partition
+ * @return L'image (à libérer par free), ou NULL si erreur
+ */
+static char* lire_image_partition(SystemeFichiers* fs) {
+    char* image = allouer_aligne(TAILLE_PARTITION);
+    if (!image) {
+        erreur("Mémoire insuffisante");
+        return NULL;
+    }
+    for (int i = 0; i < NB_BLOCS; i += NB_BLOCS_COPIE) {
+        size_t morceau = (size_t)(NB_BLOCS - i < NB_BLOCS_COPIE ? NB_BLOCS - i : NB_BLOCS_COPIE) * TAILLE_BLOC;
+        if (lire_partition(fs, image + (long)i * TAILLE_BLOC, morceau, (long)i * TAILLE_BLOC) == -1) {
+            free(image);
+            erreur("Impossible de lire la partition");
+            return NULL;
+        }
+    }
+    return image;
+}
+
+/**
+ * Affiche le bilan d'un transfert avec le dépôt
+ * @param action "sauvegardé" ou "restauré"
+ * @param nom Le nom de l'instantané
+ * @param bilan Le bilan
+ */
+static void afficher_bilan_depot(const char* action, const char* nom, const BilanDepot* bilan) {
+    fprintf(flux_sortie(), "Instantané '%s' %s : %d morceau(x), %d transféré(s) (%ld octets, %ld dans le dépôt)\n",
+            nom, action, bilan->nb_morceaux, bilan->nb_transferes, bilan->octets_transferes,
+            bilan->octets_stockes);
+}
+
+/**
+ * Enregistre un instantané de la partition dans un dépôt de sauvegardes
+ * dédupliquées. Seuls les morceaux absents du dépôt y sont écrits.
+ * @param fs La partition
+ * @param depot Le répertoire du dépôt (créé au besoin)
+ * @param nom Le nom de l'instantané, ou NULL pour la date courante
+ * @return 0 si succès, -1 si erreur
+ */
+static int sauvegarder_instantane_interne(SystemeFichiers* fs, const char* depot, const char* nom) {
+    char nom_date[32];
+    if (nom == NULL) {
+        time_t maintenant = time(NULL);
+        struct tm tm_info;
+        strftime(nom_date, sizeof(nom_date), "%Y%m%d-%H%M%S", localtime_r(&maintenant, &tm_info));
+        nom = nom_date;
+    }
+
+    // L'instantané doit contenir les données en attente et une table des
+    // inodes à jour
+    sauvegarder_partition(fs);
+    char* image = lire_image_partition(fs);
+    if (!image) {
+        return -1;
+    }
+    BilanDepot bilan;
+    int resultat = ecrire_instantane(depot, nom, image, TAILLE_PARTITION, &bilan);
+    free(image);
+    if (resultat == 0) {
+        afficher_bilan_depot("sauvegardé", nom, &bilan);
+    }
+    return resultat;
+}
+
+/**
+ * Ramène la partition à l'état d'un instantané du dépôt. Seuls les
+ * morceaux qui diffèrent sont relus, et seuls les blocs qu'ils couvrent
+ * sont réécrits.
+ * @param fs La partition
+ * @param depot Le répertoire du dépôt
+ * @param nom Le nom de l'instantané
+ * @return 0 si succès, -1 si erreur
+ */
+static int restaurer_instantane_interne(SystemeFichiers* fs, const char* depot, const char* nom) {
+    // Les pages en attente concernent l'état actuel, et la table des
+    // inodes doit être sur le disque pour être comparée
+    while (fs->tampons_ecriture != NULL) {
+        abandonner_tampon_inode(fs, fs->tampons_ecriture->inode);
+    }
+    vider_cache_inodes(fs);
+
+    char* image = lire_image_partition(fs);
+    if (!image) {
+        return -1;
+    }
+    uint8_t blocs_modifies[NB_BLOCS];
+    BilanDepot bilan;
+    if (relire_instantane(depot, nom, image, TAILLE_PARTITION, blocs_modifies, &bilan) == -1) {
+        free(image);
+        return -1;
+    }
+
+    // L'ancienne table des sommes est recouverte : plus rien n'y est écrit
+    fs->bloc_sommes = -1;
+    int resultat = 0;
+    for (int debut = 0; debut < NB_BLOCS; ) {
+        if (!blocs_modifies[debut]) {
+            debut++;
+            continue;
+        }
+        int fin = debut;
+        while (fin < NB_BLOCS && blocs_modifies[fin]) {
+            fin++;
+        }
+        if (ecrire_partition(fs, image + (long)debut * TAILLE_BLOC, (size_t)(fin - debut) * TAILLE_BLOC,
+                             (long)debut * TAILLE_BLOC) == -1) {
+            resultat = -1;
+        }
+        debut = fin;
+    }
+    free(image);
+
+    if (recharger_metadonnees(fs) == -1) {
+        resultat = -1;
+    }
+    charger_sommes_controle(fs, 0);
+    if (resultat == -1) {
+        erreur("Restauration incomplète de la partition");
+        return -1;
+    }
+    convertir_liens_physiques(fs);
+    invalider_index_noms(fs);
+    afficher_bilan_depot("restauré", nom, &bilan);
+    return 0;
+}
+
+/**
+ * Recherche un inode par son nom dans toute l'arborescence.
+ * Les inodes ne contenant plus de nom, la recherche porte sur les entrées
+ * de répertoire : d'abord le répertoire courant, puis l'index des noms,
+ * où le nom le moins profond l'emporte.
+ * @param nom Nom du fichier/répertoire à rechercher
+ * @return Le numéro de l'inode trouvé, ou -1 si non trouvé
+ */
+int trouver_ind(Session* s, const char* nom) {
+    SystemeFichiers* fs = s->fs;
+    int inode_id = trouver_inode_par_nom(fs, s->inode_courant, nom);
+    if (inode_id != -1) {
+        return inode_id;
+    }
+
+    int composantes[NB_INODES];
+    int profondeur_min = NB_INODES + 1;
+    preparer_index_noms(fs);
+    pthread_mutex_lock(&fs->verrou_noms);
+    IndexNoms* index = &fs->index_noms;
+    for (int k = index->seaux[seau_du_nom(nom)]; k != -1; k = index->noms[k].suivant) {
+        if (strcmp(index->noms[k].nom, nom) != 0) {
+            continue;
+        }
+        int profondeur = remonter_nom(index, k, composantes);
+        if (profondeur != -1 && profondeur < profondeur_min) {
+            profondeur_min = profondeur;
+            inode_id = index->noms[k].inode;
+        }
+    }
+    pthread_mutex_unlock(&fs->verrou_noms);
+
+    if (inode_id != -1) {
+        return inode_id;
+    }
+    
+    // Si le fichier ou répertoire n'est pas trouvé, afficher un message d'erreur.
+    fprintf(flux_sortie(), "Inode non trouvé pour %s\n", nom);
+    return -1;
+}
+
+/**
+ * Affiche les informations détaillées d'un inode (métadonnées d'un fichier/répertoire)
+ * @param inode_id Le numéro de l'inode à afficher
+ * @param nom Le nom sous lequel l'inode a été trouvé
+ */
+void afficher_inode(SystemeFichiers* fs, int inode_id, const char* nom) {
+    // Les blocs affichés doivent refléter les données en attente
+    vider_tampon_inode(fs, inode_id);
+
+    // Copie locale : l'affichage relit de nombreux blocs
+    Inode copie;
+    Inode* epingle = epingler_inode(fs, inode_id);
+    if (epingle == NULL) {
+        erreur("Numéro d'inode invalide");
+        return;
+    }
+    verrouiller_inode(fs, inode_id, 0);
+    copie = *epingle;
+    deverrouiller_inode(fs, inode_id);
+    desepingler_inode(fs, inode_id, 0);
+    const Inode* inode = &copie;
+
+    // Affichage des informations de l'inode
+    fprintf(flux_sortie(), "Nom: %s\n", nom);
+    fprintf(flux_sortie(), "Taille: %d octets\n", inode->taille);
+    
+    // Affichage du type (fichier, répertoire, lien)
+    const char *type_str;
+    switch (inode->type) {
+        case TYPE_FICHIER:
+            type_str = "Fichier";
+            break;
+        case TYPE_REPERTOIRE:
+            type_str = "Répertoire";
+            break;
+        case TYPE_LIEN_SYMBOLIQUE:
+            type_str = "Lien symbolique";
+            break;
+        case TYPE_LIEN_PHYSIQUE:
+            type_str = "Lien physique (ancien format)";
+            break;
+        default:
+            type_str = "Type inconnu";
+            break;
+    }
+    fprintf(flux_sortie(), "Type: %s\n", type_str);
+    
+    // Affichage du propriétaire et du groupe
+    fprintf(flux_sortie(), "Propriétaire (UID): %d\n", inode->proprietaire);
+    fprintf(flux_sortie(), "Groupe (GID): %d\n", inode->groupe);
+    
+    // Affichage des droits d'accès (format Unix)
+    fprintf(flux_sortie(), "Droits: %o\n", inode->droits);
+    
+    // Affichage des dates de création, modification, et accès
+    char date_creation[20], date_modification[20], date_acces[20];
+    time_t creation = (time_t)inode->date_creation;
+    time_t modification = (time_t)inode->date_modification;
+    time_t acces = (time_t)inode->date_acces;
+    struct tm tm_info;
+    strftime(date_creation, sizeof(date_creation), "%Y-%m-%d %H:%M:%S", localtime_r(&creation, &tm_info));
+    strftime(date_modification, sizeof(date_modification), "%Y-%m-%d %H:%M:%S", localtime_r(&modification, &tm_info));
+    strftime(date_acces, sizeof(date_acces), "%Y-%m-%d %H:%M:%S", localtime_r(&acces, &tm_info));
+    
+    fprintf(flux_sortie(), "Date de création: %s\n", date_creation);
+    fprintf(flux_sortie(), "Date de dernière modification: %s\n", date_modification);
+    fprintf(flux_sortie(), "Date de dernier accès: %s\n", date_acces);
+    
+    // Affichage du nombre de liens
+    fprintf(flux_sortie(), "Nombre de liens: %d\n", inode->nb_liens);
+    
+    // Contenu stocké dans l'inode : aucun bloc associé
+    if (inode->drapeaux & INODE_EN_LIGNE) {
+        fprintf(flux_sortie(), "\n=== Données en ligne (%d/%d octets dans l'inode) ===\n",
+               inode->taille, TAILLE_EN_LIGNE);
+        for (int i = 0; i < inode->taille; i++) {
+            unsigned char c = inode->donnees_en_ligne[i];
+            fputc(isprint(c) || isspace(c) ? c : '.', flux_sortie());
+        }
+        fprintf(flux_sortie(), "\n\n=== Résumé de l'utilisation des blocs ===\n");
+        fprintf(flux_sortie(), "Total des blocs utilisés: 0\n");
+        fprintf(flux_sortie(), "Taille réelle du fichier: %d octets\n", inode->taille);
+        return;
+    }
+    
+    // Contenu rangé dans un bloc de fragments partagé
+    if (inode->drapeaux & INODE_FRAGMENT) {
+        char contenu[TAILLE_BLOC];
+        fprintf(flux_sortie(), "\n=== Fragment ===\n");
+        fprintf(flux_sortie(), "Bloc de fragments: %d, offset %d, longueur %d octets (%d unités de %d octets)\n",
+               inode->bloc_fragment, inode->offset_fragment, inode->longueur_fragment,
+               (inode->longueur_fragment + TAILLE_UNITE_FRAGMENT - 1) / TAILLE_UNITE_FRAGMENT,
+               TAILLE_UNITE_FRAGMENT);
+        if (lire_fragment(fs, inode, contenu) == 0) {
+            for (int i = 0; i < inode->longueur_fragment; i++) {
+                unsigned char c = contenu[i];
+                fputc(isprint(c) || isspace(c) ? c : '.', flux_sortie());
+            }
+        }
+        fprintf(flux_sortie(), "\n\n=== Résumé de l'utilisation des blocs ===\n");
+        fprintf(flux_sortie(), "Total des blocs utilisés: 0 (bloc partagé)\n");
+        fprintf(flux_sortie(), "Taille réelle du fichier: %d octets\n", inode->taille);
+        return;
+    }
+    
+    // Contenu compressé : une ligne par cluster, puis le contenu décompressé
+    if (inode->drapeaux & INODE_COMPRESSE) {
+        uint16_t carte[TAILLE_BLOC / sizeof(uint16_t)];
+        int blocs_indirects[NB_POINTEURS_INDIRECTS] = {0};
+        if (lire_carte_clusters(fs, inode, carte) == -1
+            || (inode->bloc_indirect != 0 && lire_bloc(fs, inode->bloc_indirect, blocs_indirects) == -1)) {
+            return;
+        }
+        
+        int nb_clusters = (inode->taille + TAILLE_CLUSTER - 1) / TAILLE_CLUSTER;
+        int nb_blocs_donnees = 0, nb_compresses = 0;
+        fprintf(flux_sortie(), "\n=== Clusters compressés (%d blocs par cluster) ===\n", BLOCS_PAR_CLUSTER);
+        fprintf(flux_sortie(), "Carte des clusters: bloc %d\n", inode->bloc_carte);
+        for (int c = 0; c < nb_clusters; c++) {
+            fprintf(flux_sortie(), "Cluster %d: blocs", c);
+            for (int k = 0; k < BLOCS_PAR_CLUSTER; k++) {
+                int index = c * BLOCS_PAR_CLUSTER + k;
+                if (index >= MAX_BLOCS_FICHIER) {
+                    break;
+                }
+                int bloc = index < NB_BLOCS_DIRECTS
+                    ? inode->blocs_directs[index]
+                    : blocs_indirects[index - NB_BLOCS_DIRECTS];
+                fprintf(flux_sortie(), " %d", bloc);
+                nb_blocs_donnees += bloc != 0;
+            }
+            if (carte[c] > 0) {
+                fprintf(flux_sortie(), " - %u octets compressés\n", carte[c]);
+                nb_compresses++;
+            } else {
+                fprintf(flux_sortie(), " - non compressé\n");
+            }
+        }
+        
+        char* contenu = malloc(inode->taille + 1);
+        if (contenu && lire_clusters(fs, inode, NULL, contenu, inode->taille, 0) == 0) {
+            int est_texte = 1;
+            for (int i = 0; i < inode->taille && est_texte; i++) {
+                unsigned char c = contenu[i];
+                est_texte = isprint(c) || isspace(c) || c == 0;
+            }
+            fprintf(flux_sortie(), "\n=== Contenu complet du fichier ===\n");
+            if (est_texte) {
+                contenu[inode->taille] = '\0';
+                fprintf(flux_sortie(), "%s\n", contenu);
+            } else {
+                fprintf(flux_sortie(), "(Fichier contient des données binaires non affichables en texte)\n");
+            }
+        }
+        free(contenu);
+        
+        int total = nb_blocs_donnees + (inode->bloc_indirect != 0) + (inode->bloc_carte != 0);
+        fprintf(flux_sortie(), "\n=== Résumé de l'utilisation des blocs ===\n");
+        fprintf(flux_sortie(), "Clusters compressés: %d/%d\n", nb_compresses, nb_clusters);
+        fprintf(flux_sortie(), "Total des blocs utilisés: %d (dont carte et bloc indirect)\n", total);
+        fprintf(flux_sortie(), "Taille réelle du fichier: %d octets\n", inode->taille);
+        if (nb_blocs_donnees > 0) {
+            fprintf(flux_sortie(), "Taux de compression: %.2f\n",
+                   (double)inode->taille / ((double)nb_blocs_donnees * TAILLE_BLOC));
+        }
+        return;
+    }
+    
+    // Créer un buffer suffisamment grand pour le contenu complet
+    // Calculer d'abord combien d'espace nous avons besoin
+    int max_taille_fichier = TAILLE_BLOC * 10;  // Pour blocs directs
+    if (inode->bloc_indirect != 0) {
+        max_taille_fichier += TAILLE_BLOC * (TAILLE_BLOC / sizeof(int));  // Pour blocs indirects
+    }
+    
+    // Allouer dynamiquement la mémoire nécessaire
+    unsigned char *buffer_complet = NULL;
+    if (inode->type == TYPE_FICHIER && inode->taille > 0) {
+        buffer_complet = (unsigned char *)malloc(inode->taille + 1);  // +1 pour le '\0' terminal
+        if (!buffer_complet) {
+            fprintf(flux_sortie(), "Erreur: Impossible d'allouer de la mémoire pour le contenu du fichier\n");
+            return;
+        }
+        memset(buffer_complet, 0, inode->taille + 1);  // Initialiser à zéro
+    }
+    
+    int octets_lus = 0;
+    int taille_restante = inode->taille;
+    
+    // Affichage des blocs directs
+    fprintf(flux_sortie(), "\n=== Blocs directs ===\n");
+    for (int i = 0; i < 10 && taille_restante > 0; i++) {
+        if (inode->blocs_directs[i] != 0) {
+            fprintf(flux_sortie(), "Bloc direct %d: Numéro de bloc = %d (offset physique = %ld octets)\n", 
+                i, inode->blocs_directs[i], (long)inode->blocs_directs[i] * TAILLE_BLOC);
+            
+            // Lire le contenu du bloc
+            unsigned char buffer[TAILLE_BLOC];
+            if (lire_bloc_donnees(fs, inode->blocs_directs[i], buffer) == 0) {
+                int taille_bloc = taille_restante < TAILLE_BLOC ? taille_restante : TAILLE_BLOC;
+                
+                fprintf(flux_sortie(), "  Contenu du bloc (octets %d à %d du fichier):\n  ", 
+                       octets_lus, octets_lus + taille_bloc - 1);
+                
+                // Afficher le contenu en texte (si possible)
+                fprintf(flux_sortie(), "Texte: ");
+                for (int j = 0; j < taille_bloc; j++) {
+                    if (isprint(buffer[j])) {
+                        fprintf(flux_sortie(), "%c", buffer[j]);
+                    } else {
+                        fprintf(flux_sortie(), ".");
+                    }
+                }
+                fprintf(flux_sortie(), "\n");
+                
+                // Afficher l'hexdump avec 16 octets par ligne
+                fprintf(flux_sortie(), "  Hexdump:\n");
+                for (int j = 0; j < taille_bloc; j += 16) {
+                    fprintf(flux_sortie(), "    %04x: ", j);
+                    for (int k = 0; k < 16 && j + k < taille_bloc; k++) {
+                        fprintf(flux_sortie(), "%02x ", buffer[j + k]);
+                        if (k == 7) fprintf(flux_sortie(), " "); // Séparateur au milieu
+                    }
+                    
+                    // Padding pour aligner la partie texte si la ligne est incomplète
+                    int padding = 16 - (taille_bloc - j < 16 ? taille_bloc - j : 16);
+                    for (int k = 0; k < padding; k++) {
+                        fprintf(flux_sortie(), "   ");
+                    }
+                    if (padding > 7) fprintf(flux_sortie(), " "); // Ajustement du séparateur
+                    
+                    fprintf(flux_sortie(), " |");
+                    for (int k = 0; k < 16 && j + k < taille_bloc; k++) {
+                        if (isprint(buffer[j + k])) {
+                            fprintf(flux_sortie(), "%c", buffer[j + k]);
+                        } else {
+                            fprintf(flux_sortie(), ".");
+                        }
+                    }
+                    fprintf(flux_sortie(), "|\n");
+                }
+                
+                // Copier dans le buffer complet pour l'affichage final
+                if (buffer_complet) {
+                    memcpy(buffer_complet + octets_lus, buffer, taille_bloc);
+                }
+                
+                octets_lus += taille_bloc;
+                taille_restante -= taille_bloc;
+            }
+        }
+    }
+    
+    // Affichage du bloc indirect
+    if (inode->bloc_indirect != 0 && taille_restante > 0) {
+        fprintf(flux_sortie(), "\n=== Bloc indirect ===\n");
+        fprintf(flux_sortie(), "Bloc indirect: Numéro de bloc = %d (offset physique = %ld octets)\n", 
+               inode->bloc_indirect, (long)inode->bloc_indirect * TAILLE_BLOC);
+        
+        // Lire le bloc indirect qui contient des pointeurs vers d'autres blocs
+        int pointeurs_blocs[TAILLE_BLOC / sizeof(int)];
+        if (lire_bloc(fs, inode->bloc_indirect, pointeurs_blocs) == 0) {
+            fprintf(flux_sortie(), "Contient des pointeurs vers %lu blocs maximum\n", TAILLE_BLOC / sizeof(int));
+            
+            // Afficher les blocs référencés par le bloc indirect
+            int nb_pointeurs_valides = 0;
+            for (int i = 0; i < TAILLE_BLOC / sizeof(int) && taille_restante > 0; i++) {
+                if (pointeurs_blocs[i] != 0) {
+                    nb_pointeurs_valides++;
+                    fprintf(flux_sortie(), "  Pointeur %d: Bloc %d (offset physique = %ld octets)\n", 
+                           i, pointeurs_blocs[i], (long)pointeurs_blocs[i] * TAILLE_BLOC);
+                    
+                    // Lire le contenu du bloc référencé
+                    unsigned char buffer[TAILLE_BLOC];
+                    if (lire_bloc_donnees(fs, pointeurs_blocs[i], buffer) == 0) {
+                        int taille_bloc = taille_restante < TAILLE_BLOC ? taille_restante : TAILLE_BLOC;
+                        
+                        fprintf(flux_sortie(), "    Contenu du bloc (octets %d à %d du fichier):\n    ", 
+                               octets_lus, octets_lus + taille_bloc - 1);
+                        
+                        // Afficher le contenu en texte (si possible)
+                        fprintf(flux_sortie(), "Texte: ");
+                        for (int j = 0; j < taille_bloc; j++) {
+                            if (isprint(buffer[j])) {
+                                fprintf(flux_sortie(), "%c", buffer[j]);
+                            } else {
+                                fprintf(flux_sortie(), ".");
+                            }
+                        }
+                        fprintf(flux_sortie(), "\n");
+                        
+                        // Afficher l'hexdump avec 16 octets par ligne
+                        fprintf(flux_sortie(), "    Hexdump:\n");
+                        for (int j = 0; j < taille_bloc; j += 16) {
+                            fprintf(flux_sortie(), "      %04x: ", j);
+                            for (int k = 0; k < 16 && j + k < taille_bloc; k++) {
+                                fprintf(flux_sortie(), "%02x ", buffer[j + k]);
+                                if (k == 7) fprintf(flux_sortie(), " "); // Séparateur au milieu
+                            }
+                            
+                            // Padding pour aligner la partie texte si la ligne est incomplète
+                            int padding = 16 - (taille_bloc - j < 16 ? taille_bloc - j : 16);
+                            for (int k = 0; k < padding; k++) {
+                                fprintf(flux_sortie(), "   ");
+                            }
+                            if (padding > 7) fprintf(flux_sortie(), " "); // Ajustement du séparateur
+                            
+                            fprintf(flux_sortie(), " |");
+                            for (int k = 0; k < 16 && j + k < taille_bloc; k++) {
+                                if (isprint(buffer[j + k])) {
+                                    fprintf(flux_sortie(), "%c", buffer[j + k]);
+                                } else {
+                                    fprintf(flux_sortie(), ".");
+                                }
+                            }
+                            fprintf(flux_sortie(), "|\n");
+                        }
+                        
+                        // Copier dans le buffer complet pour l'affichage final
+                        if (buffer_complet) {
+                            memcpy(buffer_complet + octets_lus, buffer, taille_bloc);
+                        }
+                        
+                        octets_lus += taille_bloc;
+                        taille_restante -= taille_bloc;
+                    }
+                }
+            }
+            fprintf(flux_sortie(), "Total de %d pointeurs valides dans le bloc indirect\n", nb_pointeurs_valides);
+        }
+    } else if (inode->bloc_indirect == 0) {
+        fprintf(flux_sortie(), "\nPas de bloc indirect utilisé\n");
+    }
+    
+    // Affichage du contenu complet du fichier (si c'est un fichier texte)
+    if (inode->type == TYPE_FICHIER && buffer_complet) {
+        fprintf(flux_sortie(), "\n=== Contenu complet du fichier ===\n");
+        // Vérifier si le fichier semble être du texte
+        int est_texte = 1;
+        for (int i = 0; i < inode->taille && est_texte; i++) {
+            if (!isprint(buffer_complet[i]) && !isspace(buffer_complet[i]) && buffer_complet[i] != 0) {
+                est_texte = 0;
+            }
+        }
+        
+        if (est_texte) {
+            // Assurer que le buffer est terminé par un caractère nul
+            buffer_complet[inode->taille] = '\0';
+            fprintf(flux_sortie(), "%s\n", buffer_complet);
+        } else {
+            fprintf(flux_sortie(), "(Fichier contient des données binaires non affichables en texte)\n");
+        }
+    }
+    
+    // Libérer la mémoire
+    if (buffer_complet) {
+        free(buffer_complet);
+    }
+    
+    // Calcul et affichage des statistiques d'utilisation
+    int blocs_directs_utilises = 0;
+    for (int i = 0; i < 10; i++) {
+        if (inode->blocs_directs[i] != 0) {
+            blocs_directs_utilises++;
+        }
+    }
+    
+    int blocs_indirects_utilises = 0;
+    if (inode->bloc_indirect != 0) {
+        int pointeurs_blocs[TAILLE_BLOC / sizeof(int)];
+        if (lire_bloc(fs, inode->bloc_indirect, pointeurs_blocs) == 0) {
+            for (int i = 0; i < TAILLE_BLOC / sizeof(int); i++) {
+                if (pointeurs_blocs[i] != 0) {
+                    blocs_indirects_utilises++;
+                }
+            }
+        }
+    }
+    
+    fprintf(flux_sortie(), "\n=== Résumé de l'utilisation des blocs ===\n");
+    fprintf(flux_sortie(), "Blocs directs utilisés: %d/10\n", blocs_directs_utilises);
+    fprintf(flux_sortie(), "Bloc indirect: %s\n", inode->bloc_indirect != 0 ? "Utilisé" : "Non utilisé");
+    fprintf(flux_sortie(), "Blocs via indirection: %d/%lu\n", blocs_indirects_utilises, TAILLE_BLOC / sizeof(int));
+    fprintf(flux_sortie(), "Total des blocs utilisés: %d\n", blocs_directs_utilises + (inode->bloc_indirect != 0 ? 1 : 0) + blocs_indirects_utilises);
+    fprintf(flux_sortie(), "Espace théorique occupé: %d octets\n", (blocs_directs_utilises + (inode->bloc_indirect != 0 ? 1 : 0) + blocs_indirects_utilises) * TAILLE_BLOC);
+    fprintf(flux_sortie(), "Taille réelle du fichier: %d octets\n", inode->taille);
+    fprintf(flux_sortie(), "Taux d'utilisation: %.2f%%\n", inode->taille > 0 ? 
+           (float)inode->taille / ((blocs_directs_utilises + (inode->bloc_indirect != 0 ? 1 : 0) + blocs_indirects_utilises) * TAILLE_BLOC) * 100 : 0);
+}
+
+
+/**
+ * Prend le premier bloc libre à partir d'un curseur dans le bitmap en
+ * construction de la défragmentation, comme trouver_bloc_libre
+ * @param bitmap_temp Le bitmap en construction
+ * @param curseur Premier bloc candidat, avancé après le bloc pris
+ * @return Le bloc, marqué utilisé
+ */
+static int prendre_bloc_defragmentation(uint8_t* bitmap_temp, int* curseur) {
+    while (bitmap_temp[*curseur / BITS_PAR_OCTET] & (1 << (*curseur % BITS_PAR_OCTET))) {
+        (*curseur)++;
+    }
+    int bloc = (*curseur)++;
+    bitmap_temp[bloc / BITS_PAR_OCTET] |= (1 << (bloc % BITS_PAR_OCTET));
+    return bloc;
+}
+
+/**
+ * Défragmente le système de fichiers en réorganisant les blocs
+ * pour rendre les fichiers contigus et l'espace libre consolidé
+ * @return 0 si succès, -1 si erreur
+ */
+static int defragmenter_interne(SystemeFichiers* fs) {
+    fprintf(flux_sortie(), "Démarrage de la défragmentation...\n");
+    
+    // Tous les blocs doivent être alloués avant la réorganisation
+    if (synchroniser_tampons(fs) == -1) {
+        erreur("Impossible de vider les tampons d'écriture");
+        return -1;
+    }
+    
+    // Chaque fichier a un seul inode, quel que soit son nombre de noms :
+    // ses blocs sont déplacés une fois. Une copie de l'ancien format
+    // déplacerait une seconde fois des blocs qui ne sont pas les siens.
+    int nb_convertis = convertir_liens_physiques(fs);
+    if (nb_convertis == -1) {
+        return -1;
+    }
+    if (nb_convertis > 0) {
+        invalider_index_noms(fs);
+    }
+    
+    // Allouer un bitmap temporaire pour le suivi
+    uint8_t bitmap_temp[TAILLE_BITMAP];
+    memset(bitmap_temp, 0, TAILLE_BITMAP);
+    
+    // Marquer les blocs réservés au système comme utilisés
+    bitmap_temp[0] = 1; // Superbloc
+    
+    // Réserver les blocs pour la table d'inodes
+    int blocs_inodes = nb_blocs_metadonnees(fs) - 1;
+    for (int i = 1; i <= blocs_inodes; i++) {
+        bitmap_temp[i / BITS_PAR_OCTET] |= (1 << (i % BITS_PAR_OCTET));
+    }
+    
+    // Les tables des sommes de contrôle et des références ne bougent pas
+    for (int i = 0; fs->bloc_sommes != -1 && i < NB_BLOCS_SOMMES; i++) {
+        int bloc = fs->bloc_sommes + i;
+        bitmap_temp[bloc / BITS_PAR_OCTET] |= (1 << (bloc % BITS_PAR_OCTET));
+    }
+    if (fs->bloc_references != -1) {
+        bitmap_temp[fs->bloc_references / BITS_PAR_OCTET] |= (1 << (fs->bloc_references % BITS_PAR_OCTET));
+    }
+    
+    // Un bloc dédupliqué n'est déplacé qu'une fois, avec le premier
+    // fichier qui l'utilise ; les suivants reprennent sa nouvelle position
+    uint8_t deja_place[NB_BLOCS];
+    memset(deja_place, 0, sizeof(deja_place));
+    
+    MapBloc* map_blocs = malloc(NB_BLOCS * sizeof(MapBloc));
+    
+    // Le contenu des fragments est mis de côté : ils sont réempaquetés
+    // dans des blocs neufs une fois les fichiers déplacés
+    int* inodes_fragments = malloc(fs->superbloc.nb_inodes * sizeof(int));
+    char* fragments = malloc((size_t)fs->superbloc.nb_inodes * TAILLE_MAX_FRAGMENT);
+    int nb_fragments = 0;
+    if (!map_blocs || !inodes_fragments || !fragments) {
+        free(map_blocs);
+        free(inodes_fragments);
+        free(fragments);
+        erreur("Échec d'allocation mémoire pour la défragmentation");
+        return -1;
+    }
+    int nb_blocs_mappés = 0;
+    
+    // Pour chaque inode, traiter ses blocs
+    for (int i = 0; i < fs->superbloc.nb_inodes; i++) {
+        // Copie locale : cette passe ne modifie pas les inodes
+        Inode* epingle = epingler_inode(fs, i);
+        if (epingle == NULL) {
+            free(map_blocs);
+            free(inodes_fragments);
+            free(fragments);
+            return -1;
+        }
+        Inode copie = *epingle;
+        desepingler_inode(fs, i, 0);
+        Inode* inode = &copie;
+        
+        // Ignorer les inodes vides/non utilisés et les contenus en ligne
+        if (inode->taille == 0 || inode->nb_liens == 0) continue;
+        if (inode->drapeaux & INODE_EN_LIGNE) continue;
+        
+        if (inode->drapeaux & INODE_FRAGMENT) {
+            char contenu[TAILLE_BLOC];
+            lire_fragment(fs, inode, contenu);
+            memcpy(fragments + (size_t)nb_fragments * TAILLE_MAX_FRAGMENT, contenu, inode->longueur_fragment);
+            inodes_fragments[nb_fragments++] = i;
+            continue;
+        }
+        
+        // Calculer le nombre de blocs nécessaires pour ce fichier
+        int nb_blocs = (inode->taille + TAILLE_BLOC - 1) / TAILLE_BLOC;
+        if (nb_blocs == 0) continue;
+        
+        int blocs_indirects[TAILLE_BLOC / sizeof(int)];
+        int indirect = inode->bloc_indirect != 0 && nb_blocs > 10;
+        if (indirect) {
+            lire_bloc(fs, inode->bloc_indirect, blocs_indirects);
+        }
+        
+        // Blocs qui seront réellement déplacés avec ce fichier : ni trous,
+        // ni blocs dédupliqués déjà placés avec un fichier précédent
+        int nb_a_placer = indirect + ((inode->drapeaux & INODE_COMPRESSE) && inode->bloc_carte != 0);
+        for (int j = 0; j < nb_blocs && j < 10; j++) {
+            int ancien = inode->blocs_directs[j];
+            nb_a_placer += ancien != 0 && !deja_place[ancien];
+        }
+        for (int j = 0; indirect && j < TAILLE_BLOC / sizeof(int) && j + 10 < nb_blocs; j++) {
+            int ancien = blocs_indirects[j];
+            nb_a_placer += ancien > 0 && ancien < NB_BLOCS && !deja_place[ancien];
+        }
+        if (nb_a_placer == 0) continue;
+        
+        // Trouver une zone contiguë suffisamment grande
+        int bloc_debut = blocs_inodes + 1; // Premier bloc après la table d'inodes
+        int espace_contigu = 0;
+        
+        while (bloc_debut < NB_BLOCS) {
+            // Vérifie si ce bloc est libre dans le bitmap temporaire
+            if (!(bitmap_temp[bloc_debut / BITS_PAR_OCTET] & (1 << (bloc_debut % BITS_PAR_OCTET)))) {
+                espace_contigu++;
+                if (espace_contigu >= nb_a_placer) break;
+            } else {
+                espace_contigu = 0;
+            }
+            bloc_debut++;
+            
+            // Si on n'a pas trouvé assez d'espace, on revient au début
+            if (bloc_debut + espace_contigu >= NB_BLOCS) {
+                erreur("Impossible de trouver suffisamment d'espace contigu");
+                free(map_blocs);
+                free(inodes_fragments);
+                free(fragments);
+                return -1;
+            }
+        }
+        
+        // Début de la zone contiguë : chaque bloc déplacé y prend la
+        // place libre suivante, dans l'ordre du fichier
+        int curseur = bloc_debut - espace_contigu + 1;
+        
+        // Pour les blocs directs
+        for (int j = 0; j < nb_blocs && j < 10; j++) {
+            int ancien = inode->blocs_directs[j];
+            if (ancien == 0 || deja_place[ancien]) {
+                continue;
+            }
+            deja_place[ancien] = fs->references[ancien] > 1;
+            map_blocs[nb_blocs_mappés].ancien_bloc = ancien;
+            map_blocs[nb_blocs_mappés].nouveau_bloc = prendre_bloc_defragmentation(bitmap_temp, &curseur);
+            nb_blocs_mappés++;
+        }
+        
+        // Pour les blocs indirects si nécessaire
+        if (indirect) {
+            // Le bloc indirect précède les blocs qu'il désigne
+            map_blocs[nb_blocs_mappés].ancien_bloc = inode->bloc_indirect;
+            map_blocs[nb_blocs_mappés].nouveau_bloc = prendre_bloc_defragmentation(bitmap_temp, &curseur);
+            nb_blocs_mappés++;
+            
+            // Mettre à jour les références des blocs indirects
+            for (int j = 0; j < TAILLE_BLOC / sizeof(int) && j + 10 < nb_blocs; j++) {
+                int ancien = blocs_indirects[j];
+                if (ancien <= 0 || ancien >= NB_BLOCS || deja_place[ancien]) {
+                    continue;
+                }
+                deja_place[ancien] = fs->references[ancien] > 1;
+                map_blocs[nb_blocs_mappés].ancien_bloc = ancien;
+                map_blocs[nb_blocs_mappés].nouveau_bloc = prendre_bloc_defragmentation(bitmap_temp, &curseur);
+                nb_blocs_mappés++;
+            }
+        }
+        
+        // La carte des clusters d'un fichier compressé suit ses blocs
+        if ((inode->drapeaux & INODE_COMPRESSE) && inode->bloc_carte != 0) {
+            map_blocs[nb_blocs_mappés].ancien_bloc = inode->bloc_carte;
+            map_blocs[nb_blocs_mappés].nouveau_bloc = prendre_bloc_defragmentation(bitmap_temp, &curseur);
+            nb_blocs_mappés++;
+        }
+    }
+    
+    // Copier les données des blocs : tous les anciens blocs sont lus avant
+    // la première écriture, car une nouvelle position peut être l'ancienne
+    // position d'un bloc qui n'a pas encore été déplacé
+    char* contenus = allouer_aligne((size_t)nb_blocs_mappés * TAILLE_BLOC + 1);
+    int* anciens = malloc((nb_blocs_mappés + 1) * sizeof(int));
+    int* nouveaux = malloc((nb_blocs_mappés + 1) * sizeof(int));
+    void** buffers = malloc((nb_blocs_mappés + 1) * sizeof(void*));
+    if (!contenus || !anciens || !nouveaux || !buffers) {
+        erreur("Échec d'allocation mémoire pour la défragmentation");
+        free(contenus);
+        free(anciens);
+        free(nouveaux);
+        free(buffers);
+        free(map_blocs);
+        free(inodes_fragments);
+        free(fragments);
+        return -1;
+    }
+    for (int i = 0; i < nb_blocs_mappés; i++) {
+        anciens[i] = map_blocs[i].ancien_bloc;
+        nouveaux[i] = map_blocs[i].nouveau_bloc;
+        buffers[i] = contenus + (size_t)i * TAILLE_BLOC;
+    }
+    // Lectures puis écritures par lots, plusieurs requêtes en cours à la fois
+    lire_blocs(fs, anciens, buffers, nb_blocs_mappés);
+    ecrire_blocs(fs, nouveaux, (const void* const*)buffers, nb_blocs_mappés);
+    free(contenus);
+    free(anciens);
+    free(nouveaux);
+    free(buffers);
+    
+    // Mettre à jour les inodes avec les nouvelles références de blocs
+    for (int i = 0; i < fs->superbloc.nb_inodes; i++) {
+        Inode* inode = epingler_inode(fs, i);
+        if (inode == NULL) {
+            break;
+        }
+        
+        // Ignorer les inodes vides et ceux dont le contenu est en ligne
+        if (inode->taille == 0 || inode->nb_liens == 0
+            || (inode->drapeaux & (INODE_EN_LIGNE | INODE_FRAGMENT))) {
+            desepingler_inode(fs, i, 0);
+            continue;
+        }
+        
+        // Mettre à jour les blocs directs
+        for (int j = 0; j < 10; j++) {
+            if (inode->blocs_directs[j] != 0) {
+                // Chercher la nouvelle position
+                for (int k = 0; k < nb_blocs_mappés; k++) {
+                    if (map_blocs[k].ancien_bloc == inode->blocs_directs[j]) {
+                        inode->blocs_directs[j] = map_blocs[k].nouveau_bloc;
+                        break;
+                    }
+                }
+            }
+        }
+        
+        // Mettre à jour le bloc indirect
+        if (inode->bloc_indirect != 0) {
+            // Chercher la nouvelle position du bloc indirect
+            for (int k = 0; k < nb_blocs_mappés; k++) {
+                if (map_blocs[k].ancien_bloc == inode->bloc_indirect) {
+                    inode->bloc_indirect = map_blocs[k].nouveau_bloc;
+                    break;
+                }
+            }
+            
+            // Lire le contenu du bloc indirect
+            int blocs_indirects[TAILLE_BLOC / sizeof(int)];
+            lire_bloc(fs, inode->bloc_indirect, blocs_indirects);
+            
+            // Mettre à jour les références
+            for (int j = 0; j < TAILLE_BLOC / sizeof(int); j++) {
+                if (blocs_indirects[j] != 0) {
+                    for (int k = 0; k < nb_blocs_mappés; k++) {
+                        if (map_blocs[k].ancien_bloc == blocs_indirects[j]) {
+                            blocs_indirects[j] = map_blocs[k].nouveau_bloc;
+                            break;
+                        }
+                    }
+                }
+            }
+            
+            // Réécrire le bloc indirect
+            ecrire_bloc(fs, inode->bloc_indirect, blocs_indirects);
+        }
+        
+        // Mettre à jour la carte des clusters
+        if ((inode->drapeaux & INODE_COMPRESSE) && inode->bloc_carte != 0) {
+            for (int k = 0; k < nb_blocs_mappés; k++) {
+                if (map_blocs[k].ancien_bloc == inode->bloc_carte) {
+                    inode->bloc_carte = map_blocs[k].nouveau_bloc;
+                    break;
+                }
+            }
+        }
+        desepingler_inode(fs, i, 1);
+    }
+    
+    // Les références suivent les blocs déplacés
+    if (fs->bloc_references != -1) {
+        uint8_t references[NB_BLOCS];
+        memset(references, 0, sizeof(references));
+        for (int k = 0; k < nb_blocs_mappés; k++) {
+            references[map_blocs[k].nouveau_bloc] = fs->references[map_blocs[k].ancien_bloc];
+        }
+        memcpy(fs->references, references, sizeof(references));
+        reconstruire_index_dedup(fs);
+    }
+    
+    // Remplacer l'ancien bitmap par le nouveau
+    memcpy(fs->bitmap, bitmap_temp, TAILLE_BITMAP);
+    fs->superbloc.nb_blocs_libres = 0;
+    for (int i = 0; i < NB_BLOCS; i++) {
+        if (!(fs->bitmap[i / BITS_PAR_OCTET] & (1 << (i % BITS_PAR_OCTET)))) {
+            fs->superbloc.nb_blocs_libres++;
+        }
+    }
+    
+    // Réempaqueter les fragments, à la suite des fichiers déplacés
+    memset(&fs->table_fragments, 0, sizeof(TableFragments));
+    for (int n = 0; n < nb_fragments; n++) {
+        Inode* inode = epingler_inode(fs, inodes_fragments[n]);
+        if (inode == NULL) {
+            break;
+        }
+        int bloc, offset;
+        if (allouer_fragment(fs, inode->longueur_fragment, &bloc, &offset) == -1) {
+            desepingler_inode(fs, inodes_fragments[n], 0);
+            erreur("Impossible de replacer un fragment");
+            break;
+        }
+        ecrire_fragment(fs, bloc, offset, fragments + (size_t)n * TAILLE_MAX_FRAGMENT, inode->longueur_fragment);
+        inode->bloc_fragment = bloc;
+        inode->offset_fragment = offset;
+        desepingler_inode(fs, inodes_fragments[n], 1);
+    }
+    free(inodes_fragments);
+    free(fragments);
+    
+    // Mettre à jour le superbloc
+    fs->superbloc.derniere_modification = time(NULL);
+    
+    // Sauvegarder les changements
+    sauvegarder_partition(fs);
+    
+    // Libérer la mémoire
+    free(map_blocs);
+    
+    fprintf(flux_sortie(), "Défragmentation terminée avec succès.\n");
+    return 0;
+}
+
+/**
+ * Mesure le partage des blocs dédupliqués et la mémoire de l'index
+ * @param etat Reçoit la mesure
+ */
+void mesurer_deduplication(SystemeFichiers* fs, EtatDeduplication* etat) {
+    memset(etat, 0, sizeof(EtatDeduplication));
+    etat->octets_index = sizeof(fs->index_dedup) + sizeof(fs->references);
+    pthread_mutex_lock(&fs->verrou_allocation);
+    etat->nb_blocs_indexes = fs->index_dedup.nb_entrees;
+    for (int b = 0; b < NB_BLOCS; b++) {
+        if (fs->references[b] > 1) {
+            etat->nb_blocs_partages++;
+            etat->nb_blocs_economises += fs->references[b] - 1;
+        }
+    }
+    etat->nb_blocs_donnees = NB_BLOCS - nb_blocs_metadonnees(fs) - fs->superbloc.nb_blocs_libres;
+    pthread_mutex_unlock(&fs->verrou_allocation);
+}
+
+/**
+ * Mesure la fragmentation des fichiers (extensions par fichier) et de
+ * l'espace libre (zones libres). Les données encore dans les tampons
+ * d'écriture n'ont pas de blocs et ne sont pas comptées.
+ * @param etat Reçoit la mesure
+ * @return 0 si succès, -1 si erreur
+ */
+int mesurer_fragmentation(SystemeFichiers* fs, EtatFragmentation* etat) {
+    memset(etat, 0, sizeof(EtatFragmentation));
+    
+    for (int i = 0; i < fs->superbloc.nb_inodes; i++) {
+        Inode* epingle = epingler_inode(fs, i);
+        if (epingle == NULL) {
+            return -1;
+        }
+        Inode inode = *epingle;
+        desepingler_inode(fs, i, 0);
+        
+        // Seul un fichier de plusieurs blocs peut être fragmenté
+        if (inode.nb_liens == 0 || inode.type != TYPE_FICHIER) continue;
+        if (inode.drapeaux & (INODE_EN_LIGNE | INODE_FRAGMENT)) continue;
+        
+        int blocs[MAX_BLOCS_FICHIER];
+        int nb_blocs = 0;
+        for (int j = 0; j < NB_BLOCS_DIRECTS && inode.blocs_directs[j] != 0; j++) {
+            blocs[nb_blocs++] = inode.blocs_directs[j];
+        }
+        if (inode.bloc_indirect != 0) {
+            int blocs_indirects[NB_POINTEURS_INDIRECTS];
+            if (lire_bloc(fs, inode.bloc_indirect, blocs_indirects) == 0) {
+                for (int j = 0; j < NB_POINTEURS_INDIRECTS && blocs_indirects[j] != 0; j++) {
+                    blocs[nb_blocs++] = blocs_indirects[j];
+                }
+            }
+        }
+        if (nb_blocs < 2) continue;
+        
+        int nb_extensions = 1;
+        for (int j = 1; j < nb_blocs; j++) {
+            if (blocs[j] != blocs[j - 1] + 1) {
+                nb_extensions++;
+            }
+        }
+        etat->nb_fichiers++;
+        etat->nb_extensions += nb_extensions;
+        if (nb_extensions > 1) {
+            etat->nb_fichiers_fragmentes++;
+        }
+    }
+    
+    pthread_mutex_lock(&fs->verrou_allocation);
+    int longueur = 0;
+    for (int i = nb_blocs_metadonnees(fs); i < NB_BLOCS; i++) {
+        etat->nb_blocs_donnees++;
+        if (fs->bitmap[i / BITS_PAR_OCTET] & (1 << (i % BITS_PAR_OCTET))) {
+            longueur = 0;
+            continue;
+        }
+        etat->nb_blocs_libres++;
+        if (longueur++ == 0) {
+            etat->nb_zones_libres++;
+        }
+        if (longueur > etat->plus_grande_zone_libre) {
+            etat->plus_grande_zone_libre = longueur;
+        }
+    }
+    pthread_mutex_unlock(&fs->verrou_allocation);
+    return 0;
+}
+
+/* Propriétaire d'un bloc de fragments (partagé par plusieurs inodes) */
+#define BLOC_FRAGMENTS -2
+
+/* Propriétaire des blocs de la table des sommes de contrôle */
+#define BLOC_SOMMES -3
+
+/* Propriétaire du bloc de la table des références */
+#define BLOC_REFERENCES -4
+
+/**
+ * @brief Constat d'une vérification, rempli en parallèle par les threads
+ * qui se partagent la table des inodes
+ */
+typedef struct {
+    SystemeFichiers* fs;
+    int premier_bloc_donnees;            // Les blocs précédents sont les métadonnées
+    Inode inodes[NB_INODES];             // Copie des inodes lus
+    int utilise[NB_INODES];              // 1 si l'inode est alloué
+    int pointeurs_invalides[NB_INODES];  // Pointeurs hors de la zone de données
+    int entrees_invalides[NB_INODES];    // Entrées d'un répertoire vers un inode libre ou inexistant
+    int nb_references[NB_INODES];        // Entrées de répertoire qui désignent l'inode (hors . et ..)
+    int proprietaire[NB_BLOCS];          // Inode qui utilise le bloc (-1 : aucun, BLOC_FRAGMENTS, BLOC_SOMMES)
+    int autre_proprietaire[NB_BLOCS];    // Second inode qui l'utilise aussi (-1 : aucun)
+    int nb_utilisations[NB_BLOCS];       // Attributions du bloc
+    int nb_pointeurs_donnees[NB_BLOCS];  // Dont pointeurs de données de fichiers ordinaires
+    uint32_t occupation_fragments[NB_BLOCS]; // Unités utilisées des blocs de fragments
+    int nb_liens_physiques;              // Inodes TYPE_LIEN_PHYSIQUE de l'ancien format, pas encore convertis
+    int erreur_lecture;
+} Verification;
+
+/**
+ * @brief Inodes confiés à un thread de vérification
+ */
+typedef struct {
+    Verification* v;
+    int debut;                           // Premier inode de la tranche
+    int fin;                             // Inode suivant le dernier
+} TrancheVerification;
+
+/**
+ * Indique si un pointeur désigne un bloc de la zone de données
+ * @param v La vérification
+ * @param bloc Le numéro de bloc
+ * @return 1 si oui, 0 sinon
+ */
+static int bloc_de_donnees(const Verification* v, int bloc) {
+    return bloc >= v->premier_bloc_donnees && bloc < NB_BLOCS;
+}
+
+/**
+ * Attribue un bloc à un inode ; un bloc déjà attribué est noté partagé
+ * @param v La vérification
+ * @param bloc Le bloc
+ * @param inode_id L'inode, ou BLOC_FRAGMENTS
+ */
+static void attribuer_bloc(Verification* v, int bloc, int inode_id) {
+    __atomic_add_fetch(&v->nb_utilisations[bloc], 1, __ATOMIC_RELAXED);
+    int ancien = -1;
+    if (__atomic_compare_exchange_n(&v->proprietaire[bloc], &ancien, inode_id, 0,
+                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        return;
+    }
+    if (ancien != BLOC_FRAGMENTS || inode_id != BLOC_FRAGMENTS) {
+        __atomic_store_n(&v->autre_proprietaire[bloc], inode_id, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * Attribue à un inode un bloc de données et, pour un fichier ordinaire,
+ * compte ce pointeur (un bloc dédupliqué en a plusieurs)
+ * @param v La vérification
+ * @param bloc Le bloc
+ * @param i L'inode
+ */
+static void attribuer_bloc_donnees(Verification* v, int bloc, int i) {
+    if (v->inodes[i].type == TYPE_FICHIER) {
+        __atomic_add_fetch(&v->nb_pointeurs_donnees[bloc], 1, __ATOMIC_RELAXED);
+    }
+    attribuer_bloc(v, bloc, i);
+}
+
+/**
+ * Indique si les utilisations multiples d'un bloc sont celles d'un bloc
+ * dédupliqué : uniquement des pointeurs de données de fichiers ordinaires,
+ * sur une partition qui a une table des références
+ * @param v La vérification
+ * @param bloc Le bloc
+ * @return 1 si oui, 0 sinon
+ */
+static int bloc_deduplique(const Verification* v, int bloc) {
+    return v->fs->bloc_references != -1 && v->proprietaire[bloc] >= 0
+           && v->nb_pointeurs_donnees[bloc] == v->nb_utilisations[bloc]
+           && v->nb_pointeurs_donnees[bloc] > 1 && v->nb_pointeurs_donnees[bloc] <= MAX_REFERENCES;
+}
+
+/**
+ * Attribue à un inode les blocs de ses pointeurs et compte les pointeurs
+ * invalides. Un lien physique de l'ancien format partage les blocs de sa
+ * source : ils ne lui sont pas attribués.
+ * @param v La vérification
+ * @param i L'inode (déjà copié dans v->inodes)
+ */
+static void attribuer_blocs_inode(Verification* v, int i) {
+    const Inode* inode = &v->inodes[i];
+    if (inode->type == TYPE_LIEN_PHYSIQUE) {
+        __atomic_add_fetch(&v->nb_liens_physiques, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    if (inode->drapeaux & INODE_EN_LIGNE) {
+        return;
+    }
+    if (inode->drapeaux & INODE_FRAGMENT) {
+        int bloc = inode->bloc_fragment;
+        if (!bloc_de_donnees(v, bloc) || inode->offset_fragment < 0 || inode->longueur_fragment <= 0
+                || inode->offset_fragment % TAILLE_UNITE_FRAGMENT != 0
+                || inode->offset_fragment + inode->longueur_fragment > TAILLE_BLOC) {
+            v->pointeurs_invalides[i]++;
+            return;
+        }
+        attribuer_bloc(v, bloc, BLOC_FRAGMENTS);
+        uint32_t masque = masque_fragment(inode->offset_fragment, inode->longueur_fragment);
+        if (__atomic_fetch_or(&v->occupation_fragments[bloc], masque, __ATOMIC_RELAXED) & masque) {
+            __atomic_store_n(&v->autre_proprietaire[bloc], i, __ATOMIC_RELAXED);
+        }
+        return;
+    }
+
+    for (int j = 0; j < NB_BLOCS_DIRECTS; j++) {
+        int bloc = inode->blocs_directs[j];
+        if (bloc == 0) continue;
+        if (bloc_de_donnees(v, bloc)) {
+            attribuer_bloc_donnees(v, bloc, i);
+        } else {
+            v->pointeurs_invalides[i]++;
+        }
+    }
+    if ((inode->drapeaux & INODE_COMPRESSE) && inode->bloc_carte != 0) {
+        if (bloc_de_donnees(v, inode->bloc_carte)) {
+            attribuer_bloc(v, inode->bloc_carte, i);
+        } else {
+            v->pointeurs_invalides[i]++;
+        }
+    }
+    if (inode->bloc_indirect == 0) {
+        return;
+    }
+    if (!bloc_de_donnees(v, inode->bloc_indirect)) {
+        v->pointeurs_invalides[i]++;
+        return;
+    }
+    attribuer_bloc(v, inode->bloc_indirect, i);
+    int pointeurs[NB_POINTEURS_INDIRECTS];
+    if (lire_bloc(v->fs, inode->bloc_indirect, pointeurs) == -1) {
+        __atomic_store_n(&v->erreur_lecture, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    for (int j = 0; j < NB_POINTEURS_INDIRECTS; j++) {
+        if (pointeurs[j] == 0) continue;
+        if (bloc_de_donnees(v, pointeurs[j])) {
+            attribuer_bloc_donnees(v, pointeurs[j], i);
+        } else {
+            v->pointeurs_invalides[i]++;
+        }
+    }
+}
+
+/**
+ * Première passe d'un thread : lit les inodes de sa tranche et leur
+ * attribue leurs blocs
+ * @param argument La tranche (TrancheVerification*)
+ */
+static void* verifier_inodes(void* argument) {
+    TrancheVerification* t = argument;
+    Verification* v = t->v;
+    for (int i = t->debut; i < t->fin; i++) {
+        Inode* inode = epingler_inode(v->fs, i);
+        if (inode == NULL) {
+            __atomic_store_n(&v->erreur_lecture, 1, __ATOMIC_RELAXED);
+            return NULL;
+        }
+        v->inodes[i] = *inode;
+        desepingler_inode(v->fs, i, 0);
+
+        // Même critère que trouver_inode_libre
+        v->utilise[i] = v->inodes[i].nb_liens != 0 || v->inodes[i].taille != 0;
+        if (v->utilise[i]) {
+            attribuer_blocs_inode(v, i);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Seconde passe d'un thread : compte les entrées des répertoires de sa
+ * tranche qui désignent chaque inode. Tous les inodes doivent avoir été lus.
+ * @param argument La tranche (TrancheVerification*)
+ */
+static void* verifier_repertoires(void* argument) {
+    TrancheVerification* t = argument;
+    Verification* v = t->v;
+    EntreeRepertoire entrees[MAX_ENTREES_DIR];
+    for (int i = t->debut; i < t->fin; i++) {
+        const Inode* inode = &v->inodes[i];
+        if (!v->utilise[i] || inode->type != TYPE_REPERTOIRE || !bloc_de_donnees(v, inode->blocs_directs[0])) {
+            continue;
+        }
+        if (lire_entrees(v->fs, inode->blocs_directs[0], entrees) == -1) {
+            __atomic_store_n(&v->erreur_lecture, 1, __ATOMIC_RELAXED);
+            return NULL;
+        }
+        for (int j = 0; j < MAX_ENTREES_DIR; j++) {
+            if (entrees[j].nom[0] == '\0' || strcmp(entrees[j].nom, ".") == 0 || strcmp(entrees[j].nom, "..") == 0) {
+                continue;
+            }
+            // L'inode 0 (la racine) n'est jamais désigné par un nom
+            int cible = entrees[j].inode;
+            if (cible <= 0 || cible >= v->fs->superbloc.nb_inodes || !v->utilise[cible]) {
+                v->entrees_invalides[i]++;
+            } else {
+                __atomic_add_fetch(&v->nb_references[cible], 1, __ATOMIC_RELAXED);
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Exécute une passe de vérification sur toute la table des inodes,
+ * découpée en NB_FILS_VERIFICATION tranches traitées en parallèle. Une
+ * tranche dont le thread n'a pas pu être créé est traitée par l'appelant.
+ * @param v La vérification
+ * @param passe verifier_inodes ou verifier_repertoires
+ */
+static void executer_passe(Verification* v, void* (*passe)(void*)) {
+    TrancheVerification tranches[NB_FILS_VERIFICATION];
+    pthread_t fils[NB_FILS_VERIFICATION];
+    int lance[NB_FILS_VERIFICATION];
+    int nb_inodes = v->fs->superbloc.nb_inodes;
+
+    for (int f = 0; f < NB_FILS_VERIFICATION; f++) {
+        tranches[f] = (TrancheVerification){ v, nb_inodes * f / NB_FILS_VERIFICATION,
+                                             nb_inodes * (f + 1) / NB_FILS_VERIFICATION };
+        lance[f] = pthread_create(&fils[f], NULL, passe, &tranches[f]) == 0;
+    }
+    for (int f = 0; f < NB_FILS_VERIFICATION; f++) {
+        if (lance[f]) {
+            pthread_join(fils[f], NULL);
+        } else {
+            passe(&tranches[f]);
+        }
+    }
+}
+
+/**
+ * Efface les pointeurs de bloc invalides d'un inode
+ * @param v La vérification
+ * @param i L'inode
+ */
+static void effacer_pointeurs_invalides(Verification* v, int i) {
+    Inode* inode = epingler_inode(v->fs, i);
+    if (inode == NULL) {
+        return;
+    }
+    if (inode->drapeaux & INODE_FRAGMENT) {
+        // Le contenu est perdu : le fichier devient vide
+        inode->drapeaux &= ~INODE_FRAGMENT;
+        inode->bloc_fragment = inode->offset_fragment = inode->longueur_fragment = 0;
+        inode->taille = 0;
+    } else {
+        for (int j = 0; j < NB_BLOCS_DIRECTS; j++) {
+            if (inode->blocs_directs[j] != 0 && !bloc_de_donnees(v, inode->blocs_directs[j])) {
+                inode->blocs_directs[j] = 0;
+            }
+        }
+        if ((inode->drapeaux & INODE_COMPRESSE) && inode->bloc_carte != 0
+            && !bloc_de_donnees(v, inode->bloc_carte)) {
+            inode->bloc_carte = 0;
+        }
+        if (inode->bloc_indirect != 0 && !bloc_de_donnees(v, inode->bloc_indirect)) {
+            inode->bloc_indirect = 0;
+        } else if (inode->bloc_indirect != 0) {
+            int pointeurs[NB_POINTEURS_INDIRECTS];
+            if (lire_bloc(v->fs, inode->bloc_indirect, pointeurs) == 0) {
+                for (int j = 0; j < NB_POINTEURS_INDIRECTS; j++) {
+                    if (pointeurs[j] != 0 && !bloc_de_donnees(v, pointeurs[j])) {
+                        pointeurs[j] = 0;
                     }
                 }
-                printf("\n");
-                
-                // Afficher l'hexdump avec 16 octets par ligne
-                printf("  Hexdump:\n");
-                for (int j = 0; j < taille_bloc; j += 16) {
-                    printf("    %04x: ", j);
-                    for (int k = 0; k < 16 && j + k < taille_bloc; k++) {
-                        printf("%02x ", buffer[j + k]);
-                        if (k == 7) printf(" "); // Séparateur au milieu
-                    }
-                    
-                    // Padding pour aligner la partie texte si la ligne est incomplète
-                    int padding = 16 - (taille_bloc - j < 16 ? taille_bloc - j : 16);
-                    for (int k = 0; k < padding; k++) {
-                        printf("   ");
-                    }
-                    if (padding > 7) printf(" "); // Ajustement du séparateur
-                    
-                    printf(" |");
-                    for (int k = 0; k < 16 && j + k < taille_bloc; k++) {
-                        if (isprint(buffer[j + k])) {
-                            printf("%c", buffer[j + k]);
-                        } else {
-                            printf(".");
-                        }
-                    }
-                    printf("|\n");
+                ecrire_bloc(v->fs, inode->bloc_indirect, pointeurs);
+            }
+        }
+    }
+    v->inodes[i] = *inode;
+    desepingler_inode(v->fs, i, 1);
+}
+
+/**
+ * Signale (et retire si demandé) les entrées d'un répertoire qui désignent
+ * un inode libre ou inexistant
+ * @param v La vérification
+ * @param i Le répertoire
+ * @param reparer 1 pour retirer les entrées
+ * @return Le nombre d'entrées signalées
+ */
+static int retirer_entrees_invalides(Verification* v, int i, int reparer) {
+    EntreeRepertoire entrees[MAX_ENTREES_DIR];
+    int bloc = v->inodes[i].blocs_directs[0];
+    if (lire_entrees(v->fs, bloc, entrees) == -1) {
+        return 0;
+    }
+    int nb = 0;
+    for (int j = 0; j < MAX_ENTREES_DIR; j++) {
+        if (entrees[j].nom[0] == '\0' || strcmp(entrees[j].nom, ".") == 0 || strcmp(entrees[j].nom, "..") == 0) {
+            continue;
+        }
+        int cible = entrees[j].inode;
+        if (cible > 0 && cible < v->fs->superbloc.nb_inodes && v->utilise[cible]) {
+            continue;
+        }
+        fprintf(flux_sortie(), "Répertoire %d : l'entrée « %s » désigne l'inode %d, %s\n",
+                i, entrees[j].nom, cible, cible > 0 && cible < v->fs->superbloc.nb_inodes ? "libre" : "inexistant");
+        memset(&entrees[j], 0, sizeof(EntreeRepertoire));
+        nb++;
+    }
+    if (reparer && nb > 0) {
+        ecrire_entrees(v->fs, bloc, entrees);
+    }
+    return nb;
+}
+
+/**
+ * Rattache un inode orphelin à la racine sous le nom « #<numéro> »
+ * @param v La vérification
+ * @param i L'inode
+ * @return 0 si succès, -1 si erreur (racine pleine)
+ */
+static int rattacher_orphelin(Verification* v, int i) {
+    char nom[32];
+    snprintf(nom, sizeof(nom), "#%d", i);
+    if (ajouter_entree_repertoire(v->fs, ID_INODE_RACINE, nom, i) == -1) {
+        return -1;
+    }
+    Inode* inode = epingler_inode(v->fs, i);
+    if (inode == NULL) {
+        return -1;
+    }
+    inode->nb_liens = 1;
+    // Le parent d'un répertoire rattaché devient la racine
+    if (inode->type == TYPE_REPERTOIRE && bloc_de_donnees(v, inode->blocs_directs[0])) {
+        EntreeRepertoire entrees[MAX_ENTREES_DIR];
+        if (lire_entrees(v->fs, inode->blocs_directs[0], entrees) == 0) {
+            for (int j = 0; j < MAX_ENTREES_DIR; j++) {
+                if (strcmp(entrees[j].nom, "..") == 0) {
+                    entrees[j].inode = ID_INODE_RACINE;
                 }
-                
-                // Copier dans le buffer complet pour l'affichage final
-                if (buffer_complet) {
-                    memcpy(buffer_complet + octets_lus, buffer, taille_bloc);
+            }
+            ecrire_entrees(v->fs, inode->blocs_directs[0], entrees);
+        }
+    }
+    v->inodes[i] = *inode;
+    desepingler_inode(v->fs, i, 1);
+    v->nb_references[i] = 1;
+    return 0;
+}
+
+/**
+ * Vérifie la cohérence de la partition et répare ce qui peut l'être :
+ * - pointeurs de blocs hors de la zone de données (effacés) ;
+ * - blocs utilisés par plusieurs inodes (signalés seulement) ;
+ * - entrées de répertoire vers un inode libre (retirées) ;
+ * - inodes alloués qu'aucune entrée ne désigne (rattachés à la racine) ;
+ * - nb_liens différent du nombre d'entrées (corrigé) ;
+ * - bitmap et table des fragments, reconstruits à partir des pointeurs
+ *   des inodes, et compteurs du superbloc.
+ * Les inodes sont lus et leurs blocs attribués par NB_FILS_VERIFICATION
+ * threads, chacun sur une tranche de la table. La vérification rapide ne
+ * contrôle que ce qu'un arrêt brutal laisse périmé : l'allocation, écrite
+ * seulement à la sauvegarde, et les entrées de répertoire, écrites tout
+ * de suite alors que les inodes qu'elles désignent ne l'étaient pas
+ * encore (au plus un bloc par répertoire).
+ * L'appelant doit avoir l'exclusivité de la partition.
+ * @param fs La partition
+ * @param options VERIFIER_REPARER, VERIFIER_RAPIDE
+ * @return Le nombre de problèmes non réparés, -1 si erreur
+ */
+int verifier_partition(SystemeFichiers* fs, int options) {
+    FILE* sortie = flux_sortie();
+    int reparer = options & VERIFIER_REPARER;
+    int complete = !(options & VERIFIER_RAPIDE);
+
+    // Les pointeurs des inodes doivent désigner tous les blocs alloués
+    if (synchroniser_tampons(fs) == -1) {
+        erreur("Impossible de vider les tampons d'écriture");
+        return -1;
+    }
+    Verification* v = calloc(1, sizeof(Verification));
+    if (!v) {
+        erreur("Mémoire insuffisante");
+        return -1;
+    }
+    v->fs = fs;
+    v->premier_bloc_donnees = nb_blocs_metadonnees(fs);
+    for (int b = 0; b < NB_BLOCS; b++) {
+        v->proprietaire[b] = v->autre_proprietaire[b] = -1;
+    }
+    for (int b = 0; fs->bloc_sommes != -1 && b < NB_BLOCS_SOMMES; b++) {
+        v->proprietaire[fs->bloc_sommes + b] = BLOC_SOMMES;
+    }
+    if (fs->bloc_references != -1) {
+        v->proprietaire[fs->bloc_references] = BLOC_REFERENCES;
+    }
+
+    executer_passe(v, verifier_inodes);
+    if (!v->erreur_lecture) {
+        executer_passe(v, verifier_repertoires);
+    }
+    if (v->erreur_lecture) {
+        erreur("Lecture de la partition impossible");
+        free(v);
+        return -1;
+    }
+
+    int nb_problemes = 0, nb_repares = 0;
+    int nb_inodes = fs->superbloc.nb_inodes;
+
+    for (int i = 0; i < nb_inodes; i++) {
+        if (v->pointeurs_invalides[i]) {
+            fprintf(sortie, "Inode %d : %d pointeur(s) de bloc invalide(s)\n", i, v->pointeurs_invalides[i]);
+            nb_problemes++;
+            if (reparer) {
+                effacer_pointeurs_invalides(v, i);
+                nb_repares++;
+            }
+        }
+    }
+    for (int b = 0; b < NB_BLOCS; b++) {
+        if (v->autre_proprietaire[b] != -1 && !bloc_deduplique(v, b)) {
+            int premier = v->proprietaire[b], second = v->autre_proprietaire[b];
+            if (premier == BLOC_SOMMES && second == BLOC_FRAGMENTS) {
+                fprintf(sortie, "Bloc %d : table des sommes de contrôle utilisée aussi pour des fragments\n", b);
+            } else if (premier == BLOC_SOMMES) {
+                fprintf(sortie, "Bloc %d : table des sommes de contrôle utilisée aussi par l'inode %d\n",
+                        b, second);
+            } else if (premier == BLOC_REFERENCES && second == BLOC_FRAGMENTS) {
+                fprintf(sortie, "Bloc %d : table des références utilisée aussi pour des fragments\n", b);
+            } else if (premier == BLOC_REFERENCES) {
+                fprintf(sortie, "Bloc %d : table des références utilisée aussi par l'inode %d\n", b, second);
+            } else if (premier == BLOC_FRAGMENTS || second == BLOC_FRAGMENTS) {
+                fprintf(sortie, "Bloc %d : bloc de fragments utilisé aussi par l'inode %d\n",
+                        b, premier == BLOC_FRAGMENTS ? second : premier);
+            } else {
+                fprintf(sortie, "Bloc %d : utilisé par les inodes %d et %d\n", b, premier, second);
+            }
+            nb_problemes++;
+        }
+    }
+
+    for (int i = 0; i < nb_inodes; i++) {
+        if (v->entrees_invalides[i]) {
+            int nb = retirer_entrees_invalides(v, i, reparer);
+            nb_problemes += nb;
+            nb_repares += reparer ? nb : 0;
+        }
+    }
+    if (complete) {
+        for (int i = 1; i < nb_inodes; i++) {
+            if (!v->utilise[i]) continue;
+            if (v->nb_references[i] == 0) {
+                fprintf(sortie, "Inode %d : alloué mais absent de tous les répertoires\n", i);
+                nb_problemes++;
+                if (reparer && rattacher_orphelin(v, i) == 0) {
+                    fprintf(sortie, "Inode %d : rattaché à la racine sous le nom #%d\n", i, i);
+                    nb_repares++;
+                }
+                continue;
+            }
+            // Les liens physiques de l'ancien format comptent dans nb_liens
+            // de leur source sans entrée qui la désigne
+            int nb_liens = v->inodes[i].nb_liens;
+            if (v->inodes[i].type != TYPE_LIEN_PHYSIQUE && (nb_liens < v->nb_references[i]
+                    || (nb_liens > v->nb_references[i] && v->nb_liens_physiques == 0))) {
+                fprintf(sortie, "Inode %d : %d lien(s) enregistré(s), %d entrée(s) le désignent\n",
+                        i, nb_liens, v->nb_references[i]);
+                nb_problemes++;
+                Inode* inode = reparer ? epingler_inode(fs, i) : NULL;
+                if (inode != NULL) {
+                    inode->nb_liens = v->nb_references[i];
+                    desepingler_inode(fs, i, 1);
+                    nb_repares++;
                 }
-                
-                octets_lus += taille_bloc;
-                taille_restante -= taille_bloc;
             }
         }
     }
-    
-    // Affichage du bloc indirect
-    if (inode->bloc_indirect != 0 && taille_restante > 0) {
-        printf("\n=== Bloc indirect ===\n");
-        printf("Bloc indirect: Numéro de bloc = %d (offset physique = %ld octets)\n", 
-               inode->bloc_indirect, (long)inode->bloc_indirect * TAILLE_BLOC);
-        
-        // Lire le bloc indirect qui contient des pointeurs vers d'autres blocs
-        int pointeurs_blocs[TAILLE_BLOC / sizeof(int)];
-        if (lire_bloc(inode->bloc_indirect, pointeurs_blocs) == 0) {
-            printf("Contient des pointeurs vers %lu blocs maximum\n", TAILLE_BLOC / sizeof(int));
-            
-            // Afficher les blocs référencés par le bloc indirect
-            int nb_pointeurs_valides = 0;
-            for (int i = 0; i < TAILLE_BLOC / sizeof(int) && taille_restante > 0; i++) {
-                if (pointeurs_blocs[i] != 0) {
-                    nb_pointeurs_valides++;
-                    printf("  Pointeur %d: Bloc %d (offset physique = %ld octets)\n", 
-                           i, pointeurs_blocs[i], (long)pointeurs_blocs[i] * TAILLE_BLOC);
-                    
-                    // Lire le contenu du bloc référencé
-                    unsigned char buffer[TAILLE_BLOC];
-                    if (lire_bloc(pointeurs_blocs[i], buffer) == 0) {
-                        int taille_bloc = taille_restante < TAILLE_BLOC ? taille_restante : TAILLE_BLOC;
-                        
-                        printf("    Contenu du bloc (octets %d à %d du fichier):\n    ", 
-                               octets_lus, octets_lus + taille_bloc - 1);
-                        
-                        // Afficher le contenu en texte (si possible)
-                        printf("Texte: ");
-                        for (int j = 0; j < taille_bloc; j++) {
-                            if (isprint(buffer[j])) {
-                                printf("%c", buffer[j]);
-                            } else {
-                                printf(".");
-                            }
-                        }
-                        printf("\n");
-                        
-                        // Afficher l'hexdump avec 16 octets par ligne
-                        printf("    Hexdump:\n");
-                        for (int j = 0; j < taille_bloc; j += 16) {
-                            printf("      %04x: ", j);
-                            for (int k = 0; k < 16 && j + k < taille_bloc; k++) {
-                                printf("%02x ", buffer[j + k]);
-                                if (k == 7) printf(" "); // Séparateur au milieu
-                            }
-                            
-                            // Padding pour aligner la partie texte si la ligne est incomplète
-                            int padding = 16 - (taille_bloc - j < 16 ? taille_bloc - j : 16);
-                            for (int k = 0; k < padding; k++) {
-                                printf("   ");
-                            }
-                            if (padding > 7) printf(" "); // Ajustement du séparateur
-                            
-                            printf(" |");
-                            for (int k = 0; k < 16 && j + k < taille_bloc; k++) {
-                                if (isprint(buffer[j + k])) {
-                                    printf("%c", buffer[j + k]);
-                                } else {
-                                    printf(".");
-                                }
-                            }
-                            printf("|\n");
-                        }
-                        
-                        // Copier dans le buffer complet pour l'affichage final
-                        if (buffer_complet) {
-                            memcpy(buffer_complet + octets_lus, buffer, taille_bloc);
-                        }
-                        
-                        octets_lus += taille_bloc;
-                        taille_restante -= taille_bloc;
-                    }
+
+    // Bitmap attendu : métadonnées et blocs attribués aux inodes
+    uint8_t attendu[TAILLE_BITMAP] = { 0 };
+    for (int b = 0; b < NB_BLOCS; b++) {
+        if (b < v->premier_bloc_donnees || v->proprietaire[b] != -1) {
+            attendu[b / BITS_PAR_OCTET] |= 1 << (b % BITS_PAR_OCTET);
+        }
+    }
+    pthread_mutex_lock(&fs->verrou_allocation);
+    int nb_perdus = 0, nb_fuites = 0;
+    for (int b = 0; b < NB_BLOCS; b++) {
+        int marque = (fs->bitmap[b / BITS_PAR_OCTET] >> (b % BITS_PAR_OCTET)) & 1;
+        int utilise = (attendu[b / BITS_PAR_OCTET] >> (b % BITS_PAR_OCTET)) & 1;
+        nb_perdus += utilise && !marque;
+        nb_fuites += marque && !utilise;
+    }
+    if (nb_perdus || nb_fuites) {
+        fprintf(sortie, "Bitmap : %d bloc(s) utilisé(s) marqué(s) libre(s), %d bloc(s) libre(s) marqué(s) utilisé(s)\n",
+                nb_perdus, nb_fuites);
+        nb_problemes++;
+        if (reparer) {
+            memcpy(fs->bitmap, attendu, TAILLE_BITMAP);
+            nb_repares++;
+        }
+    }
+
+    // Table des fragments attendue : un bloc par propriétaire BLOC_FRAGMENTS
+    TableFragments* table = &fs->table_fragments;
+    int nb_ecarts = 0, nb_blocs_fragments = 0;
+    for (int b = 0; b < NB_BLOCS; b++) {
+        if (v->proprietaire[b] != BLOC_FRAGMENTS) continue;
+        nb_blocs_fragments++;
+        int k = 0;
+        while (k < table->nb_blocs && table->blocs[k].bloc != b) k++;
+        nb_ecarts += k == table->nb_blocs || table->blocs[k].occupation != v->occupation_fragments[b];
+    }
+    nb_ecarts += table->nb_blocs > nb_blocs_fragments ? table->nb_blocs - nb_blocs_fragments : 0;
+    if (nb_ecarts) {
+        fprintf(sortie, "Table des fragments : %d bloc(s) mal décrit(s)\n", nb_ecarts);
+        nb_problemes++;
+        if (reparer && nb_blocs_fragments <= MAX_BLOCS_FRAGMENTS) {
+            table->nb_blocs = 0;
+            for (int b = 0; b < NB_BLOCS; b++) {
+                if (v->proprietaire[b] == BLOC_FRAGMENTS) {
+                    table->blocs[table->nb_blocs++] = (BlocFragments){ b, v->occupation_fragments[b] };
                 }
             }
-            printf("Total de %d pointeurs valides dans le bloc indirect\n", nb_pointeurs_valides);
+            nb_repares++;
         }
-    } else if (inode->bloc_indirect == 0) {
-        printf("\nPas de bloc indirect utilisé\n");
     }
-    
-    // Affichage du contenu complet du fichier (si c'est un fichier texte)
-    if (inode->type == TYPE_FICHIER && buffer_complet) {
-        printf("\n=== Contenu complet du fichier ===\n");
-        // Vérifier si le fichier semble être du texte
-        int est_texte = 1;
-        for (int i = 0; i < inode->taille && est_texte; i++) {
-            if (!isprint(buffer_complet[i]) && !isspace(buffer_complet[i]) && buffer_complet[i] != 0) {
-                est_texte = 0;
+
+    // Références attendues : le nombre de pointeurs d'un bloc dédupliqué ;
+    // un bloc d'un seul pointeur peut rester indexé
+    if (fs->bloc_references != -1) {
+        uint8_t references[NB_BLOCS];
+        int nb_mal_comptes = 0;
+        for (int b = 0; b < NB_BLOCS; b++) {
+            int seul = v->proprietaire[b] >= 0 && v->nb_utilisations[b] == 1 && v->nb_pointeurs_donnees[b] == 1;
+            references[b] = bloc_deduplique(v, b) ? v->nb_pointeurs_donnees[b]
+                            : seul && fs->references[b] == 1 ? 1 : 0;
+            nb_mal_comptes += references[b] != fs->references[b];
+        }
+        if (nb_mal_comptes) {
+            fprintf(sortie, "Table des références : %d bloc(s) mal compté(s)\n", nb_mal_comptes);
+            nb_problemes++;
+            if (reparer) {
+                memcpy(fs->references, references, sizeof(references));
+                reconstruire_index_dedup(fs);
+                nb_repares++;
             }
         }
-        
-        if (est_texte) {
-            // Assurer que le buffer est terminé par un caractère nul
-            buffer_complet[inode->taille] = '\0';
-            printf("%s\n", buffer_complet);
-        } else {
-            printf("(Fichier contient des données binaires non affichables en texte)\n");
+    }
+
+    // Compteurs du superbloc, d'après le bitmap (éventuellement réparé)
+    int blocs_libres = 0, inodes_libres = 0;
+    for (int b = 0; b < NB_BLOCS; b++) {
+        blocs_libres += !(fs->bitmap[b / BITS_PAR_OCTET] & (1 << (b % BITS_PAR_OCTET)));
+    }
+    for (int i = 0; i < nb_inodes; i++) {
+        inodes_libres += !v->utilise[i];
+    }
+    if (fs->superbloc.nb_blocs_libres != blocs_libres || fs->superbloc.nb_inodes_libres != inodes_libres) {
+        fprintf(sortie, "Superbloc : %d blocs et %d inodes libres enregistrés, %d et %d en réalité\n",
+                fs->superbloc.nb_blocs_libres, fs->superbloc.nb_inodes_libres, blocs_libres, inodes_libres);
+        nb_problemes++;
+        if (reparer) {
+            fs->superbloc.nb_blocs_libres = blocs_libres;
+            fs->superbloc.nb_inodes_libres = inodes_libres;
+            nb_repares++;
+        }
+    }
+    pthread_mutex_unlock(&fs->verrou_allocation);
+    free(v);
+
+    if (nb_problemes == 0) {
+        fprintf(sortie, "Vérification %s : aucun problème\n", complete ? "complète" : "rapide");
+    } else {
+        fprintf(sortie, "Vérification %s : %d problème(s), %d réparé(s)\n",
+                complete ? "complète" : "rapide", nb_problemes, nb_repares);
+    }
+    if (nb_repares > 0) {
+        invalider_index_noms(fs);
+        sauvegarder_partition(fs);
+    }
+    return nb_problemes - nb_repares;
+}
+
+/**
+ * @brief Blocs relus par un thread pendant le contrôle des sommes
+ */
+typedef struct {
+    SystemeFichiers* fs;
+    int debut;                           // Premier bloc de la tranche
+    int fin;                             // Bloc suivant le dernier
+    uint8_t* corrompus;                  // Partagé : 1 pour chaque bloc corrompu
+    int nb_verifies;                     // Blocs utilisés dont la somme a été vérifiée
+    int erreur_lecture;
+} TrancheSommes;
+
+/**
+ * Thread du contrôle des sommes : relit sur le disque, sans passer par
+ * le cache de blocs, les blocs utilisés d'une tranche
+ * @param argument La tranche (TrancheSommes)
+ */
+static void* controler_tranche_sommes(void* argument) {
+    TrancheSommes* t = argument;
+    SystemeFichiers* fs = t->fs;
+    char* buffer = allouer_aligne((size_t)NB_BLOCS_COPIE * TAILLE_BLOC);
+    if (!buffer) {
+        t->erreur_lecture = 1;
+        return NULL;
+    }
+    for (int debut = t->debut; debut < t->fin; debut += NB_BLOCS_COPIE) {
+        int nb = t->fin - debut < NB_BLOCS_COPIE ? t->fin - debut : NB_BLOCS_COPIE;
+        if (lire_disque(fs, buffer, (size_t)nb * TAILLE_BLOC, (off_t)debut * TAILLE_BLOC) == -1) {
+            t->erreur_lecture = 1;
+            break;
+        }
+        for (int j = 0; j < nb; j++) {
+            int b = debut + j;
+            if (!(fs->bitmap[b / BITS_PAR_OCTET] & (1 << (b % BITS_PAR_OCTET)))
+                    || bloc_table_sommes(fs, b) || fs->somme_perimee[b]) {
+                continue;
+            }
+            t->nb_verifies++;
+            if (calculer_crc32c(buffer + (size_t)j * TAILLE_BLOC, TAILLE_BLOC) != fs->sommes[b]) {
+                t->corrompus[b] = 1;
+            }
         }
     }
-    
-    // Libérer la mémoire
-    if (buffer_complet) {
-        free(buffer_complet);
+    free(buffer);
+    return NULL;
+}
+
+/**
+ * Contrôle les sommes de tous les blocs utilisés (scrub). La partition
+ * est relue par NB_FILS_VERIFICATION threads, chacun sur une tranche de
+ * blocs ; une tranche dont le thread n'a pas pu être créé est traitée par
+ * l'appelant. Appelée sous le verrou global exclusif.
+ * @param fs La partition
+ * @return 0 si tous les blocs sont intacts, -1 sinon
+ */
+int controler_sommes_partition(SystemeFichiers* fs) {
+    FILE* sortie = flux_sortie();
+    if (fs->bloc_sommes == -1) {
+        erreur("Partition sans sommes de contrôle");
+        return -1;
+    }
+    uint8_t* corrompus = calloc(NB_BLOCS, sizeof(uint8_t));
+    if (!corrompus) {
+        erreur("Mémoire insuffisante");
+        return -1;
+    }
+    pthread_mutex_lock(&fs->verrou_allocation);
+    rafraichir_sommes_perimees(fs);
+    pthread_mutex_unlock(&fs->verrou_allocation);
+
+    TrancheSommes tranches[NB_FILS_VERIFICATION];
+    pthread_t fils[NB_FILS_VERIFICATION];
+    int lance[NB_FILS_VERIFICATION];
+    for (int f = 0; f < NB_FILS_VERIFICATION; f++) {
+        tranches[f] = (TrancheSommes){ fs, NB_BLOCS * f / NB_FILS_VERIFICATION,
+                                       NB_BLOCS * (f + 1) / NB_FILS_VERIFICATION, corrompus, 0, 0 };
+        lance[f] = pthread_create(&fils[f], NULL, controler_tranche_sommes, &tranches[f]) == 0;
     }
-    
-    // Calcul et affichage des statistiques d'utilisation
-    int blocs_directs_utilises = 0;
-    for (int i = 0; i < 10; i++) {
-        if (inode->blocs_directs[i] != 0) {
-            blocs_directs_utilises++;
+    int nb_verifies = 0, erreur_lecture = 0;
+    for (int f = 0; f < NB_FILS_VERIFICATION; f++) {
+        if (lance[f]) {
+            pthread_join(fils[f], NULL);
+        } else {
+            controler_tranche_sommes(&tranches[f]);
         }
+        nb_verifies += tranches[f].nb_verifies;
+        erreur_lecture |= tranches[f].erreur_lecture;
     }
-    
-    int blocs_indirects_utilises = 0;
-    if (inode->bloc_indirect != 0) {
-        int pointeurs_blocs[TAILLE_BLOC / sizeof(int)];
-        if (lire_bloc(inode->bloc_indirect, pointeurs_blocs) == 0) {
-            for (int i = 0; i < TAILLE_BLOC / sizeof(int); i++) {
-                if (pointeurs_blocs[i] != 0) {
-                    blocs_indirects_utilises++;
-                }
-            }
+
+    // Les threads n'écrivent pas dans le flux de la session : les blocs
+    // corrompus sont signalés ici, dans l'ordre
+    int nb_corrompus = 0;
+    int nb_meta = nb_blocs_metadonnees(fs);
+    for (int b = 0; b < NB_BLOCS; b++) {
+        if (corrompus[b]) {
+            fprintf(sortie, "Bloc %d%s : somme de contrôle incorrecte\n", b, b < nb_meta ? " (métadonnées)" : "");
+            nb_corrompus++;
         }
     }
-    
-    printf("\n=== Résumé de l'utilisation des blocs ===\n");
-    printf("Blocs directs utilisés: %d/10\n", blocs_directs_utilises);
-    printf("Bloc indirect: %s\n", inode->bloc_indirect != 0 ? "Utilisé" : "Non utilisé");
-    printf("Blocs via indirection: %d/%lu\n", blocs_indirects_utilises, TAILLE_BLOC / sizeof(int));
-    printf("Total des blocs utilisés: %d\n", blocs_directs_utilises + (inode->bloc_indirect != 0 ? 1 : 0) + blocs_indirects_utilises);
-    printf("Espace théorique occupé: %d octets\n", (blocs_directs_utilises + (inode->bloc_indirect != 0 ? 1 : 0) + blocs_indirects_utilises) * TAILLE_BLOC);
-    printf("Taille réelle du fichier: %d octets\n", inode->taille);
-    printf("Taux d'utilisation: %.2f%%\n", inode->taille > 0 ? 
-           (float)inode->taille / ((blocs_directs_utilises + (inode->bloc_indirect != 0 ? 1 : 0) + blocs_indirects_utilises) * TAILLE_BLOC) * 100 : 0);
+    free(corrompus);
+    __atomic_add_fetch(&fs->nb_sommes_verifiees, nb_verifies, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&fs->nb_blocs_corrompus, nb_corrompus, __ATOMIC_RELAXED);
+    if (erreur_lecture) {
+        erreur("Lecture de la partition impossible");
+        return -1;
+    }
+    fprintf(sortie, "Contrôle des sommes (crc32c %s) : %d bloc(s) vérifié(s), %d corrompu(s)\n",
+            nom_calcul_crc32c(), nb_verifies, nb_corrompus);
+    return nb_corrompus == 0 ? 0 : -1;
 }
 
+/**
+ * Fait pointer un pointeur de données vers le bloc indexé de même contenu
+ * s'il en existe un, sinon indexe son bloc
+ * @param pointeur Le pointeur (bloc direct ou entrée de la table indirecte)
+ * @param contenu Buffer d'un bloc
+ * @return 1 si le pointeur a changé, 0 sinon
+ */
+static int dedupliquer_pointeur(SystemeFichiers* fs, int* pointeur, char* contenu) {
+    int bloc = *pointeur;
+    if (bloc == 0 || lire_bloc_donnees(fs, bloc, contenu) == -1) {
+        return 0;
+    }
+    uint32_t somme = calculer_crc32c(contenu, TAILLE_BLOC);
+    int doublon = trouver_doublon(fs, contenu, somme);
+    if (doublon == -1) {
+        pthread_mutex_lock(&fs->verrou_allocation);
+        if (fs->references[bloc] == 0) {
+            fs->references[bloc] = 1;
+            indexer_bloc(fs, bloc, somme);
+        }
+        pthread_mutex_unlock(&fs->verrou_allocation);
+        return 0;
+    }
+    // Le bloc perd ce pointeur ou, s'il est lui-même le bloc indexé, la
+    // référence qui vient d'être prise
+    liberer_bloc(fs, bloc);
+    if (doublon == bloc) {
+        return 0;
+    }
+    *pointeur = doublon;
+    __atomic_add_fetch(&fs->nb_blocs_dedupliques, 1, __ATOMIC_RELAXED);
+    return 1;
+}
 
 /**
- * Défragmente le système de fichiers en réorganisant les blocs
- * pour rendre les fichiers contigus et l'espace libre consolidé
+ * Déduplique les blocs déjà écrits : chaque bloc de données d'un fichier
+ * ordinaire est comparé aux blocs indexés, remplacé par son double s'il
+ * en a un (puis libéré), sinon indexé à son tour.
+ * L'appelant doit avoir l'exclusivité de la partition.
+ * @param fs La partition
  * @return 0 si succès, -1 si erreur
  */
-int defragmenter() {
-    printf("Démarrage de la défragmentation...\n");
-    
-    // Allouer un bitmap temporaire pour le suivi
-    uint8_t bitmap_temp[TAILLE_BITMAP];
-    memset(bitmap_temp, 0, TAILLE_BITMAP);
-    
-    // Marquer les blocs réservés au système comme utilisés
-    bitmap_temp[0] = 1; // Superbloc
-    
-    // Réserver les blocs pour la table d'inodes
-    int blocs_inodes = (NB_INODES * sizeof(Inode) + TAILLE_BLOC - 1) / TAILLE_BLOC;
-    for (int i = 1; i <= blocs_inodes; i++) {
-        bitmap_temp[i / BITS_PAR_OCTET] |= (1 << (i % BITS_PAR_OCTET));
+int dedupliquer_partition(SystemeFichiers* fs) {
+    if (synchroniser_tampons(fs) == -1) {
+        erreur("Impossible de vider les tampons d'écriture");
+        return -1;
     }
-    
-    MapBloc* map_blocs = malloc(NB_BLOCS * sizeof(MapBloc));
-    if (!map_blocs) {
-        erreur("Échec d'allocation mémoire pour la défragmentation");
+    if (fs->bloc_references == -1 && allouer_table_references(fs) == -1) {
+        erreur("Aucun bloc libre pour la table des références");
         return -1;
     }
-    int nb_blocs_mappés = 0;
-    
-    // Pour chaque inode, traiter ses blocs
-    for (int i = 0; i < NB_INODES; i++) {
-        Inode* inode = &inodes[i];
-        
-        // Ignorer les inodes vides/non utilisés
-        if (inode->taille == 0 || inode->nb_liens == 0) continue;
-        
-        // Calculer le nombre de blocs nécessaires pour ce fichier
-        int nb_blocs = (inode->taille + TAILLE_BLOC - 1) / TAILLE_BLOC;
-        if (nb_blocs == 0) continue;
-        
-        // Trouver une zone contiguë suffisamment grande
-        int bloc_debut = blocs_inodes + 1; // Premier bloc après la table d'inodes
-        int espace_contigu = 0;
-        
-        while (bloc_debut < NB_BLOCS) {
-            // Vérifie si ce bloc est libre dans le bitmap temporaire
-            if (!(bitmap_temp[bloc_debut / BITS_PAR_OCTET] & (1 << (bloc_debut % BITS_PAR_OCTET)))) {
-                espace_contigu++;
-                if (espace_contigu >= nb_blocs) break;
-            } else {
-                espace_contigu = 0;
-            }
-            bloc_debut++;
-            
-            // Si on n'a pas trouvé assez d'espace, on revient au début
-            if (bloc_debut + espace_contigu >= NB_BLOCS) {
-                erreur("Impossible de trouver suffisamment d'espace contigu");
-                free(map_blocs);
-                return -1;
-            }
-        }
-        
-        // Début de la zone contiguë
-        bloc_debut = bloc_debut - espace_contigu + 1;
-        
-        // Pour les blocs directs
-        for (int j = 0; j < nb_blocs && j < 10; j++) {
-            if (inode->blocs_directs[j] != 0) {
-                // Enregistrer le mapping
-                map_blocs[nb_blocs_mappés].ancien_bloc = inode->blocs_directs[j];
-                map_blocs[nb_blocs_mappés].nouveau_bloc = bloc_debut + j;
-                nb_blocs_mappés++;
-                
-                // Mettre à jour l'inode (on le fera plus tard)
-                // inode->blocs_directs[j] = bloc_debut + j;
-                
-                // Marquer comme utilisé dans le bitmap temporaire
-                bitmap_temp[(bloc_debut + j) / BITS_PAR_OCTET] |= (1 << ((bloc_debut + j) % BITS_PAR_OCTET));
-            }
+    char* contenu = allouer_aligne(TAILLE_BLOC);
+    if (!contenu) {
+        erreur("Mémoire insuffisante");
+        return -1;
+    }
+
+    int blocs_libres = fs->superbloc.nb_blocs_libres;
+    int nb_partages = 0;
+    for (int i = 0; i < fs->superbloc.nb_inodes; i++) {
+        Inode* inode = epingler_inode(fs, i);
+        if (inode == NULL) {
+            break;
         }
-        
-        // Pour les blocs indirects si nécessaire
-        if (inode->bloc_indirect != 0 && nb_blocs > 10) {
-            int blocs_indirects[TAILLE_BLOC / sizeof(int)];
-            lire_bloc(inode->bloc_indirect, blocs_indirects);
-            
-            // Allouer un nouveau bloc pour le bloc indirect
-            int nouveau_bloc_indirect = bloc_debut + nb_blocs;
-            
-            // Marquer comme utilisé
-            bitmap_temp[nouveau_bloc_indirect / BITS_PAR_OCTET] |= (1 << (nouveau_bloc_indirect % BITS_PAR_OCTET));
-            
-            // Enregistrer le mapping pour le bloc indirect
-            map_blocs[nb_blocs_mappés].ancien_bloc = inode->bloc_indirect;
-            map_blocs[nb_blocs_mappés].nouveau_bloc = nouveau_bloc_indirect;
-            nb_blocs_mappés++;
-            
-            // Mettre à jour les références des blocs indirects
-            for (int j = 0; j < TAILLE_BLOC / sizeof(int) && j + 10 < nb_blocs; j++) {
-                if (blocs_indirects[j] != 0) {
-                    // Enregistrer le mapping
-                    map_blocs[nb_blocs_mappés].ancien_bloc = blocs_indirects[j];
-                    map_blocs[nb_blocs_mappés].nouveau_bloc = bloc_debut + 10 + j;
-                    nb_blocs_mappés++;
-                    
-                    // Marquer comme utilisé
-                    bitmap_temp[(bloc_debut + 10 + j) / BITS_PAR_OCTET] |= (1 << ((bloc_debut + 10 + j) % BITS_PAR_OCTET));
-                }
-            }
+        if (inode->type != TYPE_FICHIER || inode->nb_liens == 0
+                || (inode->drapeaux & (INODE_EN_LIGNE | INODE_FRAGMENT))) {
+            desepingler_inode(fs, i, 0);
+            continue;
         }
-    }
-    
-    // Copier les données des blocs
-    char buffer[TAILLE_BLOC];
-    for (int i = 0; i < nb_blocs_mappés; i++) {
-        // Lire l'ancien bloc
-        lire_bloc(map_blocs[i].ancien_bloc, buffer);
-        // Écrire dans le nouveau bloc
-        ecrire_bloc(map_blocs[i].nouveau_bloc, buffer);
-    }
-    
-    // Mettre à jour les inodes avec les nouvelles références de blocs
-    for (int i = 0; i < NB_INODES; i++) {
-        Inode* inode = &inodes[i];
-        
-        // Ignorer les inodes vides
-        if (inode->taille == 0 || inode->nb_liens == 0) continue;
-        
-        // Mettre à jour les blocs directs
-        for (int j = 0; j < 10; j++) {
-            if (inode->blocs_directs[j] != 0) {
-                // Chercher la nouvelle position
-                for (int k = 0; k < nb_blocs_mappés; k++) {
-                    if (map_blocs[k].ancien_bloc == inode->blocs_directs[j]) {
-                        inode->blocs_directs[j] = map_blocs[k].nouveau_bloc;
-                        break;
-                    }
-                }
-            }
+        int modifie = 0;
+        for (int j = 0; j < NB_BLOCS_DIRECTS; j++) {
+            int change = dedupliquer_pointeur(fs, &inode->blocs_directs[j], contenu);
+            modifie |= change;
+            nb_partages += change;
         }
-        
-        // Mettre à jour le bloc indirect
-        if (inode->bloc_indirect != 0) {
-            // Chercher la nouvelle position du bloc indirect
-            for (int k = 0; k < nb_blocs_mappés; k++) {
-                if (map_blocs[k].ancien_bloc == inode->bloc_indirect) {
-                    inode->bloc_indirect = map_blocs[k].nouveau_bloc;
-                    break;
-                }
+        int pointeurs[NB_POINTEURS_INDIRECTS];
+        if (inode->bloc_indirect != 0 && lire_bloc(fs, inode->bloc_indirect, pointeurs) == 0) {
+            int indirect_modifie = 0;
+            for (int j = 0; j < NB_POINTEURS_INDIRECTS; j++) {
+                int change = dedupliquer_pointeur(fs, &pointeurs[j], contenu);
+                indirect_modifie |= change;
+                nb_partages += change;
             }
-            
-            // Lire le contenu du bloc indirect
-            int blocs_indirects[TAILLE_BLOC / sizeof(int)];
-            lire_bloc(inode->bloc_indirect, blocs_indirects);
-            
-            // Mettre à jour les références
-            for (int j = 0; j < TAILLE_BLOC / sizeof(int); j++) {
-                if (blocs_indirects[j] != 0) {
-                    for (int k = 0; k < nb_blocs_mappés; k++) {
-                        if (map_blocs[k].ancien_bloc == blocs_indirects[j]) {
-                            blocs_indirects[j] = map_blocs[k].nouveau_bloc;
-                            break;
-                        }
-                    }
-                }
+            if (indirect_modifie) {
+                ecrire_bloc(fs, inode->bloc_indirect, pointeurs);
             }
-            
-            // Réécrire le bloc indirect
-            ecrire_bloc(inode->bloc_indirect, blocs_indirects);
         }
+        desepingler_inode(fs, i, modifie);
+    }
+    free(contenu);
+
+    sauvegarder_partition(fs);
+    fprintf(flux_sortie(), "Déduplication : %d pointeur(s) redirigé(s), %d bloc(s) libéré(s)\n",
+            nb_partages, fs->superbloc.nb_blocs_libres - blocs_libres);
+    return 0;
+}
+
+/**
+ * Ouvre une seconde fois le fichier de partition, en accès direct, et
+ * vérifie que son système de fichiers l'accepte (tmpfs le refuse à
+ * l'ouverture, d'autres seulement à la première lecture)
+ * @param descripteur Le descripteur déjà ouvert sur la partition
+ * @param nom_partition Le nom du fichier de partition
+ * @return Le descripteur direct, ou -1 si l'accès direct est impossible
+ */
+static int ouvrir_direct(int descripteur, const char* nom_partition) {
+    int direct = open(nom_partition, O_RDWR | O_DIRECT);
+    if (direct == -1) {
+        return -1;
+    }
+    void* essai = allouer_aligne(TAILLE_BLOC);
+    // Une partition qui vient d'être créée est vide : rien à lire
+    struct stat etat;
+    if (essai == NULL || fstat(descripteur, &etat) == -1
+            || (etat.st_size >= TAILLE_BLOC && pread(direct, essai, TAILLE_BLOC, 0) != TAILLE_BLOC)) {
+        close(direct);
+        direct = -1;
+    }
+    free(essai);
+    return direct;
+}
+
+/**
+ * Ferme les fichiers d'une partition et libère son contexte
+ * @param fs La partition
+ */
+static void fermer_descripteurs(SystemeFichiers* fs) {
+    if (fs->descripteur_direct != -1) {
+        close(fs->descripteur_direct);
+    }
+    close(fs->descripteur);
+    free(fs->donnees_cache_blocs);
+    free(fs->tampons_alignes);
+    free(fs);
+}
+
+/**
+ * Alloue le contexte d'une partition et ouvre son fichier.
+ * Tous les verrous sont initialisés ; l'état sur disque n'est pas lu.
+ * @param nom_partition Le nom du fichier de partition
+ * @param options Options de open (O_CREAT, O_TRUNC...)
+ * @return Le contexte, ou NULL si erreur
+ */
+static SystemeFichiers* ouvrir_systeme(const char* nom_partition, int options) {
+    SystemeFichiers* fs = calloc(1, sizeof(SystemeFichiers));
+    if (!fs) {
+        erreur("Mémoire insuffisante");
+        return NULL;
     }
     
-    // Remplacer l'ancien bitmap par le nouveau
-    memcpy(bitmap, bitmap_temp, TAILLE_BITMAP);
-    
-    // Mettre à jour le superbloc
-    superbloc.derniere_modification = time(NULL);
+#ifdef METRIQUES
+    reinitialiser_metriques(&fs->metriques);
+#endif
     
-    // Sauvegarder les changements
-    sauvegarder_partition();
+    fs->descripteur = open(nom_partition, O_RDWR | options, 0644);
+    if (fs->descripteur == -1) {
+        perror("Erreur d'ouverture de la partition");
+        free(fs);
+        return NULL;
+    }
+    fs->descripteur_direct = -1;
+    if (acces_direct) {
+        fs->descripteur_direct = ouvrir_direct(fs->descripteur, nom_partition);
+    }
+    fs->bloc_sommes = -1;
+    fs->verification_donnees = verification_donnees;
+    fs->bloc_references = -1;
+    fs->deduplication = deduplication;
+    vider_index_dedup(fs);
+    vider_index_noms(fs);
+
+    // Cache de blocs et buffers prêtés, alignés pour l'accès direct
+    fs->donnees_cache_blocs = allouer_aligne((size_t)NB_BLOCS_CACHE * TAILLE_BLOC);
+    fs->tampons_alignes = allouer_aligne((size_t)NB_TAMPONS_ALIGNES * TAILLE_BLOC);
+    if (!fs->donnees_cache_blocs || !fs->tampons_alignes) {
+        erreur("Mémoire insuffisante");
+        fermer_descripteurs(fs);
+        return NULL;
+    }
+    fs->moteur_es = creer_moteur_es(fs->descripteur, fs->descripteur_direct);
+    if (fs->moteur_es == NULL) {
+        fermer_descripteurs(fs);
+        return NULL;
+    }
     
-    // Libérer la mémoire
-    free(map_blocs);
+    // Les lecteurs sont prioritaires : un thread qui tient déjà un verrou
+    // en lecture peut le reprendre sans interblocage
+    pthread_rwlockattr_t attributs;
+    pthread_rwlockattr_init(&attributs);
+    pthread_rwlockattr_setkind_np(&attributs, PTHREAD_RWLOCK_PREFER_READER_NP);
+    pthread_rwlock_init(&fs->verrou_global, &attributs);
+    for (int i = 0; i < NB_INODES; i++) {
+        pthread_rwlock_init(&fs->verrous_inodes[i], &attributs);
+    }
+    pthread_rwlockattr_destroy(&attributs);
+    // Le verrou d'allocation est récursif : allouer_fragment et
+    // liberer_fragment le tiennent en appelant trouver_bloc_libre et liberer_bloc
+    pthread_mutexattr_t attributs_mutex;
+    pthread_mutexattr_init(&attributs_mutex);
+    pthread_mutexattr_settype(&attributs_mutex, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&fs->verrou_allocation, &attributs_mutex);
+    pthread_mutexattr_destroy(&attributs_mutex);
+    pthread_mutex_init(&fs->verrou_tampons, NULL);
+    pthread_mutex_init(&fs->verrou_cache, NULL);
+    pthread_mutex_init(&fs->verrou_transaction, NULL);
+    pthread_mutex_init(&fs->verrou_blocs, NULL);
+    pthread_mutex_init(&fs->verrou_tampons_alignes, NULL);
+    pthread_mutex_init(&fs->verrou_noms, NULL);
+    pthread_mutex_init(&fs->verrou_construction_noms, NULL);
+    for (int i = 0; i < NB_VERROUS_FRAGMENTS; i++) {
+        pthread_mutex_init(&fs->verrous_fragments[i], NULL);
+    }
+    pthread_cond_init(&fs->demande_anticipation, NULL);
+    pthread_cond_init(&fs->blocs_charges, NULL);
+
+    for (int i = 0; i < NB_BLOCS_CACHE; i++) {
+        fs->cache_blocs[i].bloc = -1;
+        fs->cache_blocs[i].donnees = fs->donnees_cache_blocs + (size_t)i * TAILLE_BLOC;
+    }
+    for (int i = 0; i < NB_TAMPONS_ALIGNES; i++) {
+        fs->tampons_libres[i] = i;
+    }
+    fs->nb_tampons_libres = NB_TAMPONS_ALIGNES;
+    for (int i = 0; i < NB_BLOCS; i++) {
+        fs->case_du_bloc[i] = -1;
+    }
+    // Sans thread de lecture, l'anticipation se fait pendant la lecture
+    fs->anticipation_asynchrone = pthread_create(&fs->fil_anticipation, NULL, lire_par_anticipation, fs) == 0;
     
-    printf("Défragmentation terminée avec succès.\n");
-    return 0;
+    return fs;
+}
+
+/**
+ * Libère le contexte d'une partition sans rien écrire
+ * @param fs La partition
+ */
+static void detruire_systeme(SystemeFichiers* fs) {
+    if (fs->anticipation_asynchrone) {
+        pthread_mutex_lock(&fs->verrou_blocs);
+        fs->arret_anticipation = 1;
+        pthread_cond_signal(&fs->demande_anticipation);
+        pthread_mutex_unlock(&fs->verrou_blocs);
+        pthread_join(fs->fil_anticipation, NULL);
+    }
+#ifdef METRIQUES
+    if (fs->trace) {
+        arreter_trace(fs->trace, NULL, NULL);
+    }
+#endif
+    detruire_moteur_es(fs->moteur_es);
+    pthread_rwlock_destroy(&fs->verrou_global);
+    for (int i = 0; i < NB_INODES; i++) {
+        pthread_rwlock_destroy(&fs->verrous_inodes[i]);
+    }
+    pthread_mutex_destroy(&fs->verrou_tampons);
+    pthread_mutex_destroy(&fs->verrou_allocation);
+    pthread_mutex_destroy(&fs->verrou_cache);
+    pthread_mutex_destroy(&fs->verrou_transaction);
+    pthread_mutex_destroy(&fs->verrou_blocs);
+    pthread_mutex_destroy(&fs->verrou_tampons_alignes);
+    pthread_mutex_destroy(&fs->verrou_noms);
+    pthread_mutex_destroy(&fs->verrou_construction_noms);
+    for (int i = 0; i < NB_VERROUS_FRAGMENTS; i++) {
+        pthread_mutex_destroy(&fs->verrous_fragments[i]);
+    }
+    vider_index_noms(fs);
+    for (int i = 0; i < NB_SEAUX_TRIGRAMMES; i++) {
+        free(fs->index_noms.trigrammes[i].cases);
+    }
+    pthread_cond_destroy(&fs->demande_anticipation);
+    pthread_cond_destroy(&fs->blocs_charges);
+    for (int i = 0; i < NB_BLOCS; i++) {
+        free(fs->blocs_ombre[i]);
+    }
+    fermer_descripteurs(fs);
 }
 
 /**
  * Initialise une nouvelle partition de système de fichiers
  * @param nom_partition Le nom du fichier de partition
+ * @return Le contexte de la partition, ou NULL si erreur
  */
-void initialiser_partition(const char* nom_partition) {
+SystemeFichiers* initialiser_partition(const char* nom_partition) {
     // Ouvrir le fichier en écriture
-    partition_file = fopen(nom_partition, "wb+");
-    if (!partition_file) {
-        perror("Erreur d'ouverture de la partition");
-        exit(EXIT_FAILURE);
+    SystemeFichiers* fs = ouvrir_systeme(nom_partition, O_CREAT | O_TRUNC);
+    if (!fs) {
+        return NULL;
     }
     
     // Créer un fichier de la bonne taille
-    fseek(partition_file, TAILLE_PARTITION - 1, SEEK_SET);
-    fputc(0, partition_file);
-    fseek(partition_file, 0, SEEK_SET);
-    
-    // Initialiser le bitmap
-    memset(bitmap, 0, TAILLE_BITMAP);
+    if (ftruncate(fs->descripteur, TAILLE_PARTITION) == -1) {
+        perror("Erreur de dimensionnement de la partition");
+        detruire_systeme(fs);
+        return NULL;
+    }
     
-    // Réserver les blocs pour le superbloc et la table d'inodes
-    bitmap[0] = 1; // Superbloc
+    // Initialiser le bitmap et la table des fragments
+    memset(fs->bitmap, 0, TAILLE_BITMAP);
+    memset(&fs->table_fragments, 0, sizeof(TableFragments));
     
-    // Calculer le nombre de blocs nécessaires pour la table d'inodes
-    int blocs_inodes = (NB_INODES * sizeof(Inode) + TAILLE_BLOC - 1) / TAILLE_BLOC;
-    for (int i = 1; i <= blocs_inodes; i++) {
-        bitmap[i / BITS_PAR_OCTET] |= (1 << (i % BITS_PAR_OCTET));
+    // Initialiser le superbloc
+    strcpy(fs->superbloc.identifiant_fs, SIGNATURE_FS);
+    fs->superbloc.emplacement_racine = 0;
+    fs->superbloc.derniere_modification = time(NULL);
+    fs->superbloc.verifier_integrite = 1;
+    fs->superbloc.taille_partition = TAILLE_PARTITION;
+    fs->superbloc.nb_blocs = NB_BLOCS;
+    fs->superbloc.nb_inodes = NB_INODES;
+    fs->superbloc.taille_bloc = TAILLE_BLOC;
+    fs->superbloc.nb_blocs_libres = NB_BLOCS - nb_blocs_metadonnees(fs);
+    fs->superbloc.nb_inodes_libres = NB_INODES - 1;
+    fs->superbloc.liens_convertis = 1;
+    
+    // Réserver les blocs du superbloc, du bitmap et de la table d'inodes
+    for (int i = 0; i < nb_blocs_metadonnees(fs); i++) {
+        fs->bitmap[i / BITS_PAR_OCTET] |= (1 << (i % BITS_PAR_OCTET));
     }
     
-    // Initialiser les inodes
-    memset(inodes, 0, NB_INODES * sizeof(Inode));
+    // La table des inodes (vide) est déjà à zéro dans le nouveau fichier
+    invalider_cache_inodes(fs);
     
-    // Initialiser le superbloc
-    strcpy(superbloc.identifiant_fs, "MONFSS");
-    superbloc.emplacement_racine = 0;
-    superbloc.derniere_modification = time(NULL);
-    superbloc.verifier_integrite = 0;
-    superbloc.taille_partition = TAILLE_PARTITION;
-    superbloc.nb_blocs = NB_BLOCS;
-    superbloc.nb_inodes = NB_INODES;
-    superbloc.taille_bloc = TAILLE_BLOC;
-    superbloc.nb_blocs_libres = NB_BLOCS - blocs_inodes - 1;
-    superbloc.nb_inodes_libres = NB_INODES - 1;
+    // Table des sommes de contrôle : le fichier neuf ne contient que des zéros
+    int bloc_sommes = allouer_table_sommes(fs);
+    if (bloc_sommes != -1) {
+        char vide[TAILLE_BLOC] = { 0 };
+        uint32_t somme_vide = calculer_crc32c(vide, TAILLE_BLOC);
+        for (int b = 0; b < NB_BLOCS; b++) {
+            fs->sommes[b] = somme_vide;
+        }
+        fs->bloc_sommes = bloc_sommes;
+    }
+    
+    // Table des références, si la déduplication est active
+    if (fs->deduplication) {
+        allouer_table_references(fs);
+    }
     
     // Créer le répertoire racine
-    Inode* racine = &inodes[0];
+    Inode* racine = epingler_inode(fs, ID_INODE_RACINE);
+    if (racine == NULL) {
+        detruire_systeme(fs);
+        return NULL;
+    }
     racine->type = TYPE_REPERTOIRE;
     racine->date_creation = time(NULL);
     racine->date_modification = time(NULL);
@@ -1815,8 +8109,9 @@ void initialiser_partition(const char* nom_partition) {
     racine->taille = TAILLE_BLOC;
     
     // Allouer un bloc pour le répertoire racine
-    int bloc_racine = trouver_bloc_libre();
+    int bloc_racine = trouver_bloc_libre(fs);
     racine->blocs_directs[0] = bloc_racine;
+    desepingler_inode(fs, ID_INODE_RACINE, 1);
     
     // Initialiser le contenu du répertoire racine
     EntreeRepertoire entrees[MAX_ENTREES_DIR] = {0};
@@ -1829,129 +8124,844 @@ void initialiser_partition(const char* nom_partition) {
     entrees[1].inode = 0; // Son parent est lui-même
     
     // Écrire les entrées dans le bloc
-    ecrire_bloc(bloc_racine, entrees);
-    
-    // Écrire le superbloc
-    fseek(partition_file, 0, SEEK_SET);
-    fwrite(&superbloc, sizeof(Superbloc), 1, partition_file);
-    
-    // Écrire les inodes
-    fwrite(inodes, sizeof(Inode), NB_INODES, partition_file);
-    
-    // Écrire le bitmap
-    fwrite(bitmap, TAILLE_BITMAP, 1, partition_file);
+    ecrire_entrees(fs, bloc_racine, entrees);
     
-    // Définir le répertoire courant
-    inode_courant = 0;
+    // Écrire le superbloc, l'inode racine et le bitmap
+    sauvegarder_partition(fs);
     
-    printf("Partition initialisée avec succès : %s\n", nom_partition);
+    fprintf(flux_sortie(), "Partition initialisée avec succès : %s\n", nom_partition);
+    return fs;
 }
 
 void afficher_bitmap(uint8_t* bitmap, int nb_blocs) {
     const int blocs_par_ligne = 16;
     
     // Afficher les en-têtes de colonnes
-    printf("    ");
+    fprintf(flux_sortie(), "    ");
     for (int i = 0; i < blocs_par_ligne; i++) {
-        printf("%2d ", i);
+        fprintf(flux_sortie(), "%2d ", i);
     }
-    printf("\n");
+    fprintf(flux_sortie(), "\n");
     
     // Afficher une ligne de séparation
-    printf("    ");
+    fprintf(flux_sortie(), "    ");
     for (int i = 0; i < blocs_par_ligne; i++) {
-        printf("---");
+        fprintf(flux_sortie(), "---");
     }
-    printf("\n");
+    fprintf(flux_sortie(), "\n");
     
     // Afficher le contenu du bitmap
     for (int i = 0; i < nb_blocs; i += blocs_par_ligne) {
         // Afficher le numéro de ligne
-        printf("%3d| ", i);
+        fprintf(flux_sortie(), "%3d| ", i);
         
         // Afficher les bits pour cette ligne
         for (int j = 0; j < blocs_par_ligne && (i + j) < nb_blocs; j++) {
             int bloc = i + j;
             int est_utilise = bitmap[bloc / BITS_PAR_OCTET] & (1 << (bloc % BITS_PAR_OCTET));
-            printf(" %c ", est_utilise ? '1' : '0');
+            fprintf(flux_sortie(), " %c ", est_utilise ? '1' : '0');
+        }
+        fprintf(flux_sortie(), "\n");
+    }
+    
+    // Compter les blocs utilisés et libres
+    int blocs_utilises = 0;
+    for (int i = 0; i < nb_blocs; i++) {
+        if (bitmap[i / BITS_PAR_OCTET] & (1 << (i % BITS_PAR_OCTET))) {
+            blocs_utilises++;
+        }
+    }
+    
+    // Afficher les statistiques
+    fprintf(flux_sortie(), "\nStatistiques du bitmap:\n");
+    fprintf(flux_sortie(), "- Blocs totaux: %d\n", nb_blocs);
+    fprintf(flux_sortie(), "- Blocs utilisés: %d (%.1f%%)\n", blocs_utilises, (float)blocs_utilises * 100 / nb_blocs);
+    fprintf(flux_sortie(), "- Blocs libres: %d (%.1f%%)\n", nb_blocs - blocs_utilises, 
+           (float)(nb_blocs - blocs_utilises) * 100 / nb_blocs);
+    fprintf(flux_sortie(), "\n");
+}
+
+/**
+ * Convertit une partition de l'ancien format (inodes de taille variable
+ * contenant le nom) vers le format compact.
+ * Le superbloc et le bitmap doivent déjà être en mémoire ; l'ancienne
+ * table des inodes est lue en entier avant d'écrire la nouvelle, qui
+ * occupe les mêmes blocs de tête de partition.
+ * @return 0 si succès, -1 si erreur
+ */
+int migrer_partition_v1(SystemeFichiers* fs) {
+    int nb_blocs_v1 = 1 + (fs->superbloc.nb_inodes * sizeof(InodeV1) + TAILLE_BLOC - 1) / TAILLE_BLOC;
+    
+    InodeV1* anciens = malloc((size_t)fs->superbloc.nb_inodes * sizeof(InodeV1));
+    if (!anciens) {
+        erreur("Mémoire insuffisante pour la migration");
+        return -1;
+    }
+    if (lire_partition(fs, anciens, (size_t)fs->superbloc.nb_inodes * sizeof(InodeV1), OFFSET_TABLE_INODES_V1) == -1) {
+        erreur("Lecture de l'ancienne table des inodes impossible");
+        free(anciens);
+        return -1;
+    }
+    
+    // Conversion page par page (le nom est déjà dans les répertoires)
+    Inode page[TAILLE_BLOC / sizeof(Inode)];
+    for (int premier = 0; premier < fs->superbloc.nb_inodes; premier += INODES_PAR_PAGE) {
+        memset(page, 0, sizeof(page));
+        for (int j = 0; j < INODES_PAR_PAGE && premier + j < fs->superbloc.nb_inodes; j++) {
+            const InodeV1* ancien = &anciens[premier + j];
+            Inode* inode = &page[j];
+            inode->type = ancien->type;
+            inode->droits = ancien->droits;
+            inode->taille = ancien->taille;
+            inode->nb_liens = ancien->nb_liens;
+            memcpy(inode->blocs_directs, ancien->blocs_directs, sizeof(inode->blocs_directs));
+            inode->bloc_indirect = ancien->bloc_indirect;
+            inode->proprietaire = ancien->proprietaire;
+            inode->groupe = ancien->groupe;
+            inode->date_creation = ancien->date_creation;
+            inode->date_modification = ancien->date_modification;
+            inode->date_acces = ancien->date_acces;
         }
-        printf("\n");
+        ecrire_partition(fs, page, TAILLE_BLOC, OFFSET_TABLE_INODES + (long)premier * sizeof(Inode));
     }
+    free(anciens);
     
-    // Compter les blocs utilisés et libres
-    int blocs_utilises = 0;
-    for (int i = 0; i < nb_blocs; i++) {
-        if (bitmap[i / BITS_PAR_OCTET] & (1 << (i % BITS_PAR_OCTET))) {
-            blocs_utilises++;
+    // Les blocs de l'ancienne table au-delà des nouvelles métadonnées
+    // redeviennent libres
+    int nb_blocs_v2 = nb_blocs_metadonnees(fs);
+    for (int i = 0; i < nb_blocs_v2; i++) {
+        fs->bitmap[i / BITS_PAR_OCTET] |= (1 << (i % BITS_PAR_OCTET));
+    }
+    for (int i = nb_blocs_v2; i < nb_blocs_v1; i++) {
+        if (fs->bitmap[i / BITS_PAR_OCTET] & (1 << (i % BITS_PAR_OCTET))) {
+            fs->bitmap[i / BITS_PAR_OCTET] &= ~(1 << (i % BITS_PAR_OCTET));
+            fs->superbloc.nb_blocs_libres++;
         }
     }
     
-    // Afficher les statistiques
-    printf("\nStatistiques du bitmap:\n");
-    printf("- Blocs totaux: %d\n", nb_blocs);
-    printf("- Blocs utilisés: %d (%.1f%%)\n", blocs_utilises, (float)blocs_utilises * 100 / nb_blocs);
-    printf("- Blocs libres: %d (%.1f%%)\n", nb_blocs - blocs_utilises, 
-           (float)(nb_blocs - blocs_utilises) * 100 / nb_blocs);
-    printf("\n");
+    // L'ancien format ne connaît pas les fragments ; le reste du bloc 0
+    // contenait le début de l'ancienne table
+    memset(&fs->table_fragments, 0, sizeof(TableFragments));
+    
+    strcpy(fs->superbloc.identifiant_fs, SIGNATURE_FS);
+    fs->superbloc.liens_convertis = 0;
+    invalider_cache_inodes(fs);
+    sauvegarder_partition(fs);
+    
+    fprintf(flux_sortie(), "Partition convertie au format compact (%d -> %d blocs de métadonnées)\n",
+           nb_blocs_v1, nb_blocs_v2);
+    return 0;
+}
+
+/**
+ * Écrit l'indicateur de vérification du superbloc. À la fermeture, la
+ * table des sommes est réécrite ensuite avec la somme du nouveau superbloc.
+ * @param fs La partition
+ * @param a_verifier 1 tant que la partition est ouverte, 0 à la fermeture
+ */
+static void marquer_partition(SystemeFichiers* fs, int a_verifier) {
+    pthread_mutex_lock(&fs->verrou_allocation);
+    fs->superbloc.verifier_integrite = a_verifier;
+    ecrire_partition(fs, &fs->superbloc, sizeof(Superbloc), 0);
+    if (!a_verifier) {
+        ecrire_sommes_controle(fs);
+    }
+    pthread_mutex_unlock(&fs->verrou_allocation);
 }
 
 /**
- * Charge une partition existante depuis le disque
+ * Lit le superbloc, le bitmap et la table des fragments d'une partition
+ * existante (migrée si elle est à l'ancien format), sans la vérifier
  * @param nom_partition Le nom du fichier de partition
+ * @return Le contexte de la partition, ou NULL si erreur
  */
-void charger_partition(const char* nom_partition) {
+static SystemeFichiers* lire_partition_existante(const char* nom_partition) {
 
-    partition_file = fopen(nom_partition, "rb+");
-    if (partition_file == NULL) {
+    SystemeFichiers* fs = ouvrir_systeme(nom_partition, 0);
+    if (fs == NULL) {
         erreur("Erreur lors de l'ouverture du fichier de partition");
-        exit(EXIT_FAILURE);
+        return NULL;
     }
     
     // Lire le superbloc
-    fread(&superbloc, sizeof(Superbloc), 1, partition_file);
-    
-    // Vérifier l'identifiant
-    if (strcmp(superbloc.identifiant_fs, "MONFSS") != 0) {
+    if (lire_partition(fs, &fs->superbloc, sizeof(Superbloc), 0) == -1
+            || fs->superbloc.nb_inodes < 0 || fs->superbloc.nb_inodes > NB_INODES) {
         erreur("Ce n'est pas une partition valide");
-        fclose(partition_file);
-        exit(EXIT_FAILURE);
+        detruire_systeme(fs);
+        return NULL;
     }
     
-    // Lire les inodes
-    fread(inodes, sizeof(Inode), NB_INODES, partition_file);
+    // Les inodes ne sont lus qu'à la demande, par pages
+    invalider_cache_inodes(fs);
     
-    // Lire le bitmap
-    fread(bitmap, TAILLE_BITMAP, 1, partition_file);
+    // Vérifier l'identifiant
+    if (strcmp(fs->superbloc.identifiant_fs, SIGNATURE_FS_V1) == 0) {
+        // Ancien format : bitmap après la table des inodes, puis migration
+        lire_partition(fs, fs->bitmap, TAILLE_BITMAP, OFFSET_TABLE_INODES_V1 + (long)fs->superbloc.nb_inodes * sizeof(InodeV1));
+        
+        if (migrer_partition_v1(fs) == -1) {
+            detruire_systeme(fs);
+            return NULL;
+        }
+    } else if (strcmp(fs->superbloc.identifiant_fs, SIGNATURE_FS) == 0) {
+        // Lire le bitmap et la table des fragments
+        lire_partition(fs, fs->bitmap, TAILLE_BITMAP, OFFSET_BITMAP);
+        charger_table_fragments(fs);
+    } else {
+        erreur("Ce n'est pas une partition valide");
+        detruire_systeme(fs);
+        return NULL;
+    }
+    charger_sommes_controle(fs, 1);
+    charger_references(fs);
+    return fs;
+}
+
+/**
+ * Charge une partition existante depuis le disque. Une partition qui n'a
+ * pas été fermée proprement passe d'abord une vérification rapide.
+ * @param nom_partition Le nom du fichier de partition
+ * @return Le contexte de la partition, ou NULL si erreur
+ */
+SystemeFichiers* charger_partition(const char* nom_partition) {
+    SystemeFichiers* fs = lire_partition_existante(nom_partition);
+    if (fs == NULL) {
+        return NULL;
+    }
     
-    // Définir le répertoire courant
-    inode_courant = 0;
+    // Le bitmap, la table des fragments et les compteurs sur le disque
+    // datent de la dernière sauvegarde, et des entrées de répertoire
+    // peuvent désigner des inodes qui n'y ont pas été écrits
+    if (fs->superbloc.verifier_integrite) {
+        fprintf(flux_sortie(), "La partition n'a pas été fermée proprement\n");
+        if (verifier_partition(fs, VERIFIER_RAPIDE | VERIFIER_REPARER) == -1) {
+            detruire_systeme(fs);
+            return NULL;
+        }
+    }
+    if (convertir_liens_physiques(fs) == -1) {
+        detruire_systeme(fs);
+        return NULL;
+    }
+    marquer_partition(fs, 1);
     
-    printf("Partition chargée avec succès : %s\n", nom_partition);
+    fprintf(flux_sortie(), "Partition chargée avec succès : %s\n", nom_partition);
+    return fs;
+}
+
+/**
+ * Vérifie une partition complètement sans l'utiliser. Sans réparation,
+ * rien n'est écrit ; après réparation, la partition est fermée proprement.
+ * @param nom_partition Le nom du fichier de partition
+ * @param options VERIFIER_REPARER
+ * @return Le nombre de problèmes non réparés, -1 si erreur
+ */
+int verifier_partition_hors_ligne(const char* nom_partition, int options) {
+    SystemeFichiers* fs = lire_partition_existante(nom_partition);
+    if (fs == NULL) {
+        return -1;
+    }
+    int resultat = verifier_partition(fs, options & VERIFIER_REPARER);
+    if ((options & VERIFIER_REPARER) && resultat != -1) {
+        fermer_partition(fs);
+    } else {
+        detruire_systeme(fs);
+    }
+    return resultat;
+}
+
+/**
+ * Écrit l'état en attente puis ferme la partition et libère son contexte.
+ * Aucune session ne doit plus l'utiliser.
+ * @param fs La partition
+ */
+void fermer_partition(SystemeFichiers* fs) {
+    if (!fs) {
+        return;
+    }
+    // Une transaction non validée est abandonnée : le disque garde l'état
+    // d'avant son ouverture
+    if (fs->session_transaction != NULL) {
+        fprintf(flux_sortie(), "Transaction non validée annulée.\n");
+        while (fs->tampons_ecriture != NULL) {
+            abandonner_tampon_inode(fs, fs->tampons_ecriture->inode);
+        }
+        detruire_systeme(fs);
+        return;
+    }
+    sauvegarder_partition(fs);
+    // Fermeture propre : le prochain chargement n'a rien à vérifier
+    marquer_partition(fs, 0);
+    detruire_systeme(fs);
+}
+
+/**
+ * Ouvre une session sur une partition. Chaque session a son propre
+ * répertoire courant ; plusieurs sessions peuvent travailler en parallèle.
+ * @param fs La partition
+ * @return La session (répertoire courant : la racine), ou NULL si erreur
+ */
+Session* ouvrir_session(SystemeFichiers* fs) {
+    Session* s = malloc(sizeof(Session));
+    if (!s) {
+        erreur("Mémoire insuffisante");
+        return NULL;
+    }
+    s->fs = fs;
+    s->inode_courant = ID_INODE_RACINE;
+    return s;
+}
+
+/**
+ * Ferme une session
+ * @param s La session
+ */
+void fermer_session(Session* s) {
+    free(s);
+}
+
+/**
+ * Marque le début d'une commande. Les commandes ordinaires s'exécutent
+ * en parallèle ; une commande exclusive (défragmentation, restauration...)
+ * attend que toutes les autres soient terminées.
+ * @param fs La partition
+ * @param exclusive 1 pour une commande qui réorganise toute la partition
+ */
+void debuter_operation(SystemeFichiers* fs, int exclusive) {
+    if (exclusive) {
+        pthread_rwlock_wrlock(&fs->verrou_global);
+    } else {
+        pthread_rwlock_rdlock(&fs->verrou_global);
+    }
+}
+
+/**
+ * Marque la fin d'une commande commencée par debuter_operation
+ * @param fs La partition
+ */
+void terminer_operation(SystemeFichiers* fs) {
+    pthread_rwlock_unlock(&fs->verrou_global);
+}
+
+/**
+ * Verrouille un inode (contenu et entrées s'il s'agit d'un répertoire)
+ * @param fs La partition
+ * @param id Identifiant de l'inode
+ * @param ecriture 1 pour un accès exclusif, 0 pour un accès partagé
+ */
+void verrouiller_inode(SystemeFichiers* fs, int id, int ecriture) {
+    if (ecriture) {
+        pthread_rwlock_wrlock(&fs->verrous_inodes[id]);
+    } else {
+        pthread_rwlock_rdlock(&fs->verrous_inodes[id]);
+    }
+}
+
+/**
+ * Libère le verrou pris par verrouiller_inode
+ * @param fs La partition
+ * @param id Identifiant de l'inode
+ */
+void deverrouiller_inode(SystemeFichiers* fs, int id) {
+    pthread_rwlock_unlock(&fs->verrous_inodes[id]);
 }
 
 /**
  * Sauvegarde l'état du système de fichiers sur le disque
  */
-void sauvegarder_partition() {
-    if (!partition_file) {
+static void sauvegarder_partition_interne(SystemeFichiers* fs) {
+    if (!fs) {
         erreur("Aucune partition ouverte");
         return;
     }
     
+    // Allouer et écrire les données en attente
+    synchroniser_tampons(fs);
+    
+    // Le superbloc, le bitmap et la table des fragments sont cohérents
+    // entre eux sous le verrou d'allocation
+    pthread_mutex_lock(&fs->verrou_allocation);
+    
     // Mettre à jour la date de dernière modification
-    superbloc.derniere_modification = time(NULL);
+    fs->superbloc.derniere_modification = time(NULL);
     
     // Écrire le superbloc
-    fseek(partition_file, 0, SEEK_SET);
-    fwrite(&superbloc, sizeof(Superbloc), 1, partition_file);
-    
-    // Écrire les inodes
-    fwrite(inodes, sizeof(Inode), NB_INODES, partition_file);
+    ecrire_partition(fs, &fs->superbloc, sizeof(Superbloc), 0);
     
     // Écrire le bitmap
-    fwrite(bitmap, TAILLE_BITMAP, 1, partition_file);
+    ecrire_partition(fs, fs->bitmap, TAILLE_BITMAP, OFFSET_BITMAP);
+    
+    // Écrire la table des fragments et celle des références
+    ecrire_table_fragments(fs);
+    ecrire_table_references(fs);
+    
+    pthread_mutex_unlock(&fs->verrou_allocation);
+    
+    // Écrire les pages d'inodes modifiées
+    vider_cache_inodes(fs);
     
-    // S'assurer que tout est écrit
-    fflush(partition_file);
+    // Puis les sommes de contrôle, qui couvrent tout ce qui précède
+    ecrire_sommes_controle(fs);
 }
  
+
+/**
+ * Oublie les blocs modifiés par la transaction en cours et la referme
+ * Appelée sous le verrou global exclusif.
+ * @param fs La partition
+ */
+static void liberer_blocs_ombre(SystemeFichiers* fs) {
+    for (int i = 0; i < NB_BLOCS; i++) {
+        free(fs->blocs_ombre[i]);
+        fs->blocs_ombre[i] = NULL;
+    }
+    fs->nb_blocs_ombre = 0;
+    fs->session_transaction = NULL;
+}
+
+/**
+ * Écrit sur le disque les blocs de la transaction d'un intervalle, une
+ * écriture vectorielle par suite de blocs consécutifs
+ * @param fs La partition
+ * @param debut Premier bloc de l'intervalle
+ * @param fin Bloc suivant le dernier bloc de l'intervalle
+ * @param nb_ecritures Incrémenté du nombre d'écritures effectuées
+ * @return 0 si succès, -1 si erreur
+ */
+static int ecrire_blocs_ombre(SystemeFichiers* fs, int debut, int fin, int* nb_ecritures) {
+    struct iovec vecteurs[NB_VECTEURS_BLOCS];
+    RequeteES requetes[NB_VECTEURS_BLOCS];
+    int nb_vecteurs = 0, nb_requetes = 0;
+    int resultat = 0;
+
+    for (int bloc = debut; bloc < fin; bloc++) {
+        if (fs->blocs_ombre[bloc] == NULL) {
+            continue;
+        }
+        if (nb_vecteurs == NB_VECTEURS_BLOCS) {
+            if (executer_lot_es(fs, requetes, nb_requetes) == -1) {
+                resultat = -1;
+            }
+            *nb_ecritures += nb_requetes;
+            nb_vecteurs = 0;
+            nb_requetes = 0;
+        }
+        // Une requête par suite de blocs consécutifs
+        if (nb_requetes == 0 || fs->blocs_ombre[bloc - 1] == NULL) {
+            requetes[nb_requetes++] = (RequeteES){ 1, &vecteurs[nb_vecteurs], 0, (off_t)bloc * TAILLE_BLOC, 0 };
+        }
+        vecteurs[nb_vecteurs].iov_base = fs->blocs_ombre[bloc];
+        vecteurs[nb_vecteurs].iov_len = TAILLE_BLOC;
+        nb_vecteurs++;
+        requetes[nb_requetes - 1].nb_vecteurs++;
+    }
+    if (executer_lot_es(fs, requetes, nb_requetes) == -1) {
+        resultat = -1;
+    }
+    *nb_ecritures += nb_requetes;
+    return resultat;
+}
+
+/**
+ * Indique si une session a ouvert la transaction en cours
+ * @param s La session
+ * @return 1 si la session a une transaction en cours, 0 sinon
+ */
+int transaction_en_cours(const Session* s) {
+    return s->fs->session_transaction == s;
+}
+
+/**
+ * Vérifie qu'une session peut valider ou annuler la transaction en cours
+ * @param s La session
+ * @return 0 si la session a ouvert la transaction, -1 sinon
+ */
+static int verifier_proprietaire_transaction(const Session* s) {
+    if (s->fs->session_transaction == NULL) {
+        erreur("Aucune transaction en cours");
+        return -1;
+    }
+    if (s->fs->session_transaction != s) {
+        erreur("La transaction a été ouverte par une autre session");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Ouvre une transaction : jusqu'à sa validation, aucune écriture
+ * n'atteint le disque, et son annulation rend la partition dans son état
+ * d'avant begin. La transaction porte sur toute la partition ; une seule
+ * peut être ouverte à la fois, et executer_commande refuse les commandes
+ * des autres sessions jusqu'à commit ou abort. Appelée sous le verrou
+ * global exclusif.
+ * @param s La session qui ouvre la transaction
+ * @return 0 si succès, -1 si erreur
+ */
+int debuter_transaction(Session* s) {
+    SystemeFichiers* fs = s->fs;
+    if (fs->session_transaction != NULL) {
+        erreur("Une transaction est déjà en cours");
+        return -1;
+    }
+
+    // Le disque doit refléter l'état en mémoire pour pouvoir y revenir
+    sauvegarder_partition(fs);
+    fs->session_transaction = s;
+
+    fprintf(flux_sortie(), "Transaction ouverte.\n");
+    return 0;
+}
+
+/**
+ * Valide la transaction de la session : l'état en attente est écrit dans
+ * les copies de blocs, puis toutes les copies sont écrites en un seul
+ * passage trié, les blocs de données avant les métadonnées qui les
+ * référencent. Appelée sous le verrou global exclusif.
+ * @param s La session qui a ouvert la transaction
+ * @return 0 si succès, -1 si erreur
+ */
+int valider_transaction(Session* s) {
+    SystemeFichiers* fs = s->fs;
+    if (verifier_proprietaire_transaction(s) == -1) {
+        return -1;
+    }
+
+    sauvegarder_partition(fs);
+
+    int nb_blocs = fs->nb_blocs_ombre;
+    int nb_ecritures = 0;
+    int nb_meta = nb_blocs_metadonnees(fs);
+    int resultat = 0;
+    if (ecrire_blocs_ombre(fs, nb_meta, NB_BLOCS, &nb_ecritures) == -1
+            || ecrire_blocs_ombre(fs, 0, nb_meta, &nb_ecritures) == -1
+            || fdatasync(fs->descripteur) == -1) {
+        erreur("Échec de l'écriture de la transaction");
+        resultat = -1;
+    }
+    liberer_blocs_ombre(fs);
+
+    if (resultat == 0) {
+        fprintf(flux_sortie(), "Transaction validée (%d blocs, %d écritures).\n", nb_blocs, nb_ecritures);
+    }
+    return resultat;
+}
+
+/**
+ * Annule la transaction de la session : les copies de blocs et les
+ * données en attente sont oubliées et les métadonnées relues depuis le
+ * disque. Appelée sous le verrou global exclusif.
+ * @param s La session qui a ouvert la transaction
+ * @return 0 si succès, -1 si erreur
+ */
+int annuler_transaction(Session* s) {
+    SystemeFichiers* fs = s->fs;
+    if (verifier_proprietaire_transaction(s) == -1) {
+        return -1;
+    }
+
+    while (fs->tampons_ecriture != NULL) {
+        abandonner_tampon_inode(fs, fs->tampons_ecriture->inode);
+    }
+    liberer_blocs_ombre(fs);
+    if (recharger_metadonnees(fs) == -1) {
+        erreur("Impossible de relire les métadonnées de la partition");
+        return -1;
+    }
+    invalider_index_noms(fs);
+
+    // Le répertoire courant a pu être créé pendant la transaction
+    Inode* courant = epingler_inode(fs, s->inode_courant);
+    int existe = courant && courant->nb_liens > 0 && courant->type == TYPE_REPERTOIRE;
+    if (courant) desepingler_inode(fs, s->inode_courant, 0);
+    if (!existe) {
+        s->inode_courant = ID_INODE_RACINE;
+    }
+
+    fprintf(flux_sortie(), "Transaction annulée.\n");
+    return 0;
+}
+
+/*
+ * Opérations mesurées : chaque fonction publique ci-dessous appelle sa
+ * version _interne et enregistre l'appel, son échec éventuel, les octets
+ * traités et la latence (voir metriques.h). Compilées sans METRIQUES,
+ * elles se contentent de l'appeler.
+ */
+
+/**
+ * Crée un fichier ou un répertoire dans le répertoire courant (opération mesurée)
+ * @see creer_fichier_interne
+ */
+int creer_fichier(Session* s, const char* nom, int type) {
+    DEBUT_MESURE(s->fs, MESURE_CREER, debut);
+    int resultat = creer_fichier_interne(s, nom, type);
+    FIN_MESURE(s->fs, MESURE_CREER, debut, resultat, 0);
+    return resultat;
+}
+
+/**
+ * Supprime un fichier ou un répertoire vide (opération mesurée)
+ * @see supprimer_fichier_interne
+ */
+int supprimer_fichier(Session* s, const char* nom) {
+    DEBUT_MESURE(s->fs, MESURE_SUPPRIMER, debut);
+    int resultat = supprimer_fichier_interne(s, nom);
+    FIN_MESURE(s->fs, MESURE_SUPPRIMER, debut, resultat, 0);
+    return resultat;
+}
+
+/**
+ * Lit des données dans un fichier (opération mesurée)
+ * @see lire_fichier_interne
+ */
+int lire_fichier(Session* s, int inode_id, void* buffer, int taille, int offset) {
+    DEBUT_MESURE(s->fs, MESURE_LIRE, debut);
+    int resultat = lire_fichier_interne(s, inode_id, buffer, taille, offset);
+    FIN_MESURE(s->fs, MESURE_LIRE, debut, resultat, resultat);
+    return resultat;
+}
+
+/**
+ * Écrit des données dans un fichier (opération mesurée)
+ * @see ecrire_fichier_interne
+ */
+int ecrire_fichier(Session* s, int inode_id, void* buffer, int taille, int offset) {
+    DEBUT_MESURE(s->fs, MESURE_ECRIRE, debut);
+    int resultat = ecrire_fichier_interne(s, inode_id, buffer, taille, offset);
+    FIN_MESURE(s->fs, MESURE_ECRIRE, debut, resultat, resultat);
+    return resultat;
+}
+
+/**
+ * Vide les tampons d'écriture de tous les inodes (opération mesurée)
+ * @see synchroniser_tampons_interne
+ */
+int synchroniser_tampons(SystemeFichiers* fs) {
+    DEBUT_MESURE(fs, MESURE_SYNCHRONISER, debut);
+    int resultat = synchroniser_tampons_interne(fs);
+    FIN_MESURE(fs, MESURE_SYNCHRONISER, debut, resultat, 0);
+    return resultat;
+}
+
+/**
+ * Crée un lien physique (opération mesurée)
+ * @see creer_lien_interne
+ */
+int creer_lien(Session* s, const char* source, const char* nom_lien) {
+    DEBUT_MESURE(s->fs, MESURE_LIEN, debut);
+    int resultat = creer_lien_interne(s, source, nom_lien);
+    FIN_MESURE(s->fs, MESURE_LIEN, debut, resultat, 0);
+    return resultat;
+}
+
+/**
+ * Crée un lien symbolique (opération mesurée)
+ * @see creer_lien_symbolique_interne
+ */
+int creer_lien_symbolique(Session* s, const char* source, const char* destination) {
+    DEBUT_MESURE(s->fs, MESURE_LIEN_SYMBOLIQUE, debut);
+    int resultat = creer_lien_symbolique_interne(s, source, destination);
+    FIN_MESURE(s->fs, MESURE_LIEN_SYMBOLIQUE, debut, resultat, 0);
+    return resultat;
+}
+
+/**
+ * Change le répertoire courant de la session (opération mesurée)
+ * @see changer_repertoire_interne
+ */
+int changer_repertoire(Session* s, const char* chemin) {
+    DEBUT_MESURE(s->fs, MESURE_CD, debut);
+    int resultat = changer_repertoire_interne(s, chemin);
+    FIN_MESURE(s->fs, MESURE_CD, debut, resultat, 0);
+    return resultat;
+}
+
+/**
+ * Copie un fichier (opération mesurée)
+ * @see copier_fichier_interne
+ */
+int copier_fichier(Session* s, const char* source, const char* destination) {
+    DEBUT_MESURE(s->fs, MESURE_COPIER, debut);
+    int resultat = copier_fichier_interne(s, source, destination);
+    FIN_MESURE(s->fs, MESURE_COPIER, debut, resultat, 0);
+    return resultat;
+}
+
+/**
+ * Renomme un fichier (opération mesurée)
+ * @see deplacer_fichier_interne
+ */
+int deplacer_fichier(Session* s, const char* source, const char* destination) {
+    DEBUT_MESURE(s->fs, MESURE_DEPLACER, debut);
+    int resultat = deplacer_fichier_interne(s, source, destination);
+    FIN_MESURE(s->fs, MESURE_DEPLACER, debut, resultat, 0);
+    return resultat;
+}
+
+/**
+ * Supprime un répertoire et tout son contenu (opération mesurée)
+ * @see supprimer_arbre_interne
+ */
+int supprimer_arbre(Session* s, const char* nom) {
+    DEBUT_MESURE(s->fs, MESURE_SUPPRIMER_ARBRE, debut);
+    int resultat = supprimer_arbre_interne(s, nom);
+    FIN_MESURE(s->fs, MESURE_SUPPRIMER_ARBRE, debut, resultat, 0);
+    return resultat;
+}
+
+/**
+ * Copie un répertoire et tout son contenu (opération mesurée)
+ * @see copier_arbre_interne
+ */
+int copier_arbre(Session* s, const char* source, const char* destination) {
+    DEBUT_MESURE(s->fs, MESURE_COPIER_ARBRE, debut);
+    int resultat = copier_arbre_interne(s, source, destination);
+    FIN_MESURE(s->fs, MESURE_COPIER_ARBRE, debut, resultat, 0);
+    return resultat;
+}
+
+/**
+ * Affiche l'occupation d'un répertoire et de ses sous-répertoires (opération mesurée)
+ * @see afficher_occupation_interne
+ */
+int afficher_occupation(Session* s, const char* nom) {
+    DEBUT_MESURE(s->fs, MESURE_OCCUPATION, debut);
+    int resultat = afficher_occupation_interne(s, nom);
+    FIN_MESURE(s->fs, MESURE_OCCUPATION, debut, resultat, 0);
+    return resultat;
+}
+
+/**
+ * Affiche l'arborescence d'un répertoire (opération mesurée)
+ * @see afficher_arborescence_interne
+ */
+int afficher_arborescence(Session* s, const char* nom) {
+    DEBUT_MESURE(s->fs, MESURE_ARBORESCENCE, debut);
+    int resultat = afficher_arborescence_interne(s, nom);
+    FIN_MESURE(s->fs, MESURE_ARBORESCENCE, debut, resultat, 0);
+    return resultat;
+}
+
+/**
+ * Affiche les fichiers dont le nom correspond à un motif (opération mesurée)
+ * @see rechercher_noms_interne
+ */
+int rechercher_noms(Session* s, const char* motif) {
+    DEBUT_MESURE(s->fs, MESURE_RECHERCHE, debut);
+    int resultat = rechercher_noms_interne(s, motif);
+    FIN_MESURE(s->fs, MESURE_RECHERCHE, debut, resultat, 0);
+    return resultat;
+}
+
+/**
+ * Sauvegarde l'état complet de la partition dans un fichier (opération mesurée)
+ * @see sauvegarder_etat_interne
+ */
+void sauvegarder_etat(SystemeFichiers* fs, const char* fichier_sauvegarde) {
+    DEBUT_MESURE(fs, MESURE_SAUVEGARDE_ETAT, debut);
+    sauvegarder_etat_interne(fs, fichier_sauvegarde);
+    FIN_MESURE(fs, MESURE_SAUVEGARDE_ETAT, debut, 0, 0);
+}
+
+/**
+ * Restaure la partition depuis un fichier de sauvegarde (opération mesurée)
+ * @see restaurer_etat_interne
+ */
+void restaurer_etat(SystemeFichiers* fs, const char* fichier_sauvegarde) {
+    DEBUT_MESURE(fs, MESURE_RESTAURATION_ETAT, debut);
+    restaurer_etat_interne(fs, fichier_sauvegarde);
+    FIN_MESURE(fs, MESURE_RESTAURATION_ETAT, debut, 0, 0);
+}
+
+/**
+ * Enregistre un instantané dans un dépôt de sauvegardes (opération mesurée)
+ * @see sauvegarder_instantane_interne
+ */
+int sauvegarder_instantane(SystemeFichiers* fs, const char* depot, const char* nom) {
+    DEBUT_MESURE(fs, MESURE_INSTANTANE, debut);
+    int resultat = sauvegarder_instantane_interne(fs, depot, nom);
+    FIN_MESURE(fs, MESURE_INSTANTANE, debut, resultat, 0);
+    return resultat;
+}
+
+/**
+ * Restaure un instantané d'un dépôt de sauvegardes (opération mesurée)
+ * @see restaurer_instantane_interne
+ */
+int restaurer_instantane(SystemeFichiers* fs, const char* depot, const char* nom) {
+    DEBUT_MESURE(fs, MESURE_RESTAURATION_INSTANTANE, debut);
+    int resultat = restaurer_instantane_interne(fs, depot, nom);
+    FIN_MESURE(fs, MESURE_RESTAURATION_INSTANTANE, debut, resultat, 0);
+    return resultat;
+}
+
+/**
+ * Défragmente le système de fichiers (opération mesurée)
+ * @see defragmenter_interne
+ */
+int defragmenter(SystemeFichiers* fs) {
+    DEBUT_MESURE(fs, MESURE_DEFRAG, debut);
+    int resultat = defragmenter_interne(fs);
+    FIN_MESURE(fs, MESURE_DEFRAG, debut, resultat, 0);
+    return resultat;
+}
+
+/**
+ * Écrit les métadonnées et les données en attente sur la partition (opération mesurée)
+ * @see sauvegarder_partition_interne
+ */
+void sauvegarder_partition(SystemeFichiers* fs) {
+    DEBUT_MESURE(fs, MESURE_SAUVEGARDE_PARTITION, debut);
+    sauvegarder_partition_interne(fs);
+    FIN_MESURE(fs, MESURE_SAUVEGARDE_PARTITION, debut, 0, 0);
+}
+
+/**
+ * Commence à enregistrer les accès aux blocs dans un fichier de trace.
+ * L'appelant doit avoir l'exclusivité de la partition.
+ * @param fs La partition
+ * @param chemin Le fichier de trace (système hôte)
+ * @return 0 si succès, -1 si erreur
+ */
+int demarrer_trace_partition(SystemeFichiers* fs, const char* chemin) {
+#ifdef METRIQUES
+    if (fs->trace) {
+        erreur("Une trace est déjà en cours");
+        return -1;
+    }
+    fs->trace = demarrer_trace(chemin, TAILLE_BLOC, NB_BLOCS);
+    return fs->trace ? 0 : -1;
+#else
+    (void)fs;
+    (void)chemin;
+    erreur("Mesures non compilées (make METRIQUES=1)");
+    return -1;
+#endif
+}
+
+/**
+ * Arrête l'enregistrement de la trace en cours.
+ * L'appelant doit avoir l'exclusivité de la partition.
+ * @param fs La partition
+ * @param nb_evenements Reçoit le nombre d'événements écrits (peut être NULL)
+ * @param nb_perdus Reçoit le nombre d'événements perdus (peut être NULL)
+ * @return 0 si succès, -1 si erreur
+ */
+int arreter_trace_partition(SystemeFichiers* fs, uint64_t* nb_evenements, uint64_t* nb_perdus) {
+#ifdef METRIQUES
+    if (!fs->trace) {
+        erreur("Aucune trace en cours");
+        return -1;
+    }
+    Trace* t = fs->trace;
+    fs->trace = NULL;
+    return arreter_trace(t, nb_evenements, nb_perdus);
+#else
+    (void)fs;
+    (void)nb_evenements;
+    (void)nb_perdus;
+    erreur("Mesures non compilées (make METRIQUES=1)");
+    return -1;
+#endif
+}
@@ -30,6 +30,15 @@
 #include <grp.h>
 #include <errno.h>
 #include <ctype.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/uio.h>
+
+#include "metriques.h"
+#include "moteur_es.h"
+#include "somme_controle.h"
+#include "compression.h"
+#include "depot.h"
 
 // =============================================
 // CONSTANTES DE CONFIGURATION DU SYSTÈME
@@ -59,12 +68,51 @@
 /* Longueur maximale d'un chemin */
 #define MAX_CHEMIN 1024
 
-/* Nombre maximal d'entrées dans un répertoire */
-#define MAX_ENTREES_DIR 128
+/* Nombre maximal d'entrées dans un répertoire (un bloc d'entrées) */
+#define MAX_ENTREES_DIR ((int)(TAILLE_BLOC / sizeof(EntreeRepertoire)))
 
 /* Inode racine (toujours 0 dans ce système) */
 #define ID_INODE_RACINE 0
 
+/* Nombre de blocs directs d'un inode */
+#define NB_BLOCS_DIRECTS 10
+
+/* Nombre de pointeurs contenus dans un bloc indirect */
+#define NB_POINTEURS_INDIRECTS (TAILLE_BLOC / (int)sizeof(int))
+
+/* Nombre maximal de blocs de données d'un fichier */
+#define MAX_BLOCS_FICHIER (NB_BLOCS_DIRECTS + NB_POINTEURS_INDIRECTS)
+
+/* Unité d'allocation dans un bloc de fragments */
+#define TAILLE_UNITE_FRAGMENT 128
+
+/* Nombre d'unités d'un bloc de fragments (une par bit du masque d'occupation) */
+#define UNITES_PAR_BLOC_FRAGMENTS (TAILLE_BLOC / TAILLE_UNITE_FRAGMENT)
+
+/* Taille maximale d'un fichier rangé dans un fragment plutôt que dans un bloc */
+#define TAILLE_MAX_FRAGMENT (TAILLE_BLOC * 3 / 4)
+
+/* Nombre maximal de blocs de fragments suivis par la table des fragments */
+#define MAX_BLOCS_FRAGMENTS 256
+
+/* Verrous des blocs de fragments (un bloc utilise celui de son numéro modulo ce nombre) */
+#define NB_VERROUS_FRAGMENTS 64
+
+/* Volume de données en attente (tous fichiers confondus) déclenchant un vidage */
+#define SEUIL_TAMPON_ECRITURE (256 * TAILLE_BLOC)
+
+/* Taille maximale d'un contenu stocké dans l'inode (zone des pointeurs) */
+#define TAILLE_EN_LIGNE (19 * (int)sizeof(int))
+
+/* Blocs logiques compressés ensemble dans un fichier compressé */
+#define BLOCS_PAR_CLUSTER 4
+
+/* Taille d'un cluster en octets */
+#define TAILLE_CLUSTER (BLOCS_PAR_CLUSTER * TAILLE_BLOC)
+
+/* Nombre maximal de clusters d'un fichier (entrées de la carte des clusters) */
+#define MAX_CLUSTERS_FICHIER ((MAX_BLOCS_FICHIER + BLOCS_PAR_CLUSTER - 1) / BLOCS_PAR_CLUSTER)
+
 // =============================================
 // TYPES DE FICHIERS
 // =============================================
@@ -72,7 +120,12 @@
 #define TYPE_FICHIER 0        // Fichier régulier
 #define TYPE_REPERTOIRE 1     // Répertoire
 #define TYPE_LIEN_SYMBOLIQUE 2 // Lien symbolique
-#define TYPE_LIEN_PHYSIQUE 3  // Lien physique (hard link)
+#define TYPE_LIEN_PHYSIQUE 3  // Ancien format : copie de l'inode source, convertie au chargement
+
+/* Drapeaux d'un inode */
+#define INODE_EN_LIGNE 0x1    // Données stockées dans l'inode
+#define INODE_FRAGMENT 0x2    // Données dans un bloc de fragments partagé
+#define INODE_COMPRESSE 0x4   // Données compressées par clusters (chattr +c)
 
 // =============================================
 // DROITS D'ACCÈS (UNIX STYLE)
@@ -97,13 +150,14 @@ typedef struct {
     char identifiant_fs[10];      // Signature du FS ("MYFSv1.0\0")
     int emplacement_racine;       // Bloc contenant le répertoire racine
     time_t derniere_modification; // Timestamp de la dernière modification
-    int verifier_integrite;       // Flag de vérification d'intégrité
+    int verifier_integrite;       // 1 tant que la partition est ouverte : à vérifier au chargement si elle n'a pas été fermée proprement
     int taille_partition;         // Taille totale en octets
     int nb_blocs;                 // Nombre total de blocs
     int nb_inodes;                // Nombre total d'inodes
     int taille_bloc;              // Taille d'un bloc en octets
     int nb_blocs_libres;          // Nombre de blocs libres
     int nb_inodes_libres;         // Nombre d'inodes libres
+    int liens_convertis;          // 1 une fois les liens physiques de l'ancien format convertis (occupe l'ancien remplissage de fin : 0 sur les partitions antérieures)
 } Superbloc;
 
 /**
@@ -111,23 +165,311 @@ typedef struct {
  * @brief Métadonnées d'un fichier/répertoire
  * 
  * Contient toutes les métadonnées d'un fichier, répertoire ou lien.
- * Un inode est identifié par un numéro unique.
+ * Un inode est identifié par un numéro unique. Le nom n'y figure pas :
+ * il n'est stocké que dans les entrées de répertoire.
+ * 
+ * Format compact de 128 octets (32 inodes par bloc) : les champs
+ * consultés à chaque accès sont regroupés en tête, les dates sont sur
+ * 64 bits quelle que soit la plateforme.
+ * 
+ * Lorsque INODE_EN_LIGNE est positionné, la zone des pointeurs de blocs
+ * contient directement les données (fichier ou cible d'un lien symbolique)
+ * et aucun bloc n'est associé à l'inode.
+ * 
+ * Lorsque INODE_FRAGMENT est positionné, le contenu du fichier est rangé
+ * dans un bloc partagé avec d'autres petits fichiers : 'longueur_fragment'
+ * octets à l'offset 'offset_fragment' du bloc 'bloc_fragment'.
+ *
+ * Lorsque INODE_COMPRESSE est positionné, les blocs logiques sont groupés
+ * par clusters de BLOCS_PAR_CLUSTER. Le bloc 'bloc_carte' donne pour
+ * chaque cluster la longueur de ses données compressées, rangées dans
+ * ses premiers blocs (les pointeurs suivants sont à 0), ou 0 si le
+ * cluster est stocké tel quel.
  */
 typedef struct {
-    int taille;                  // Taille du fichier en octets
+    // Champs chauds
     int type;                    // Type (fichier, répertoire, lien)
-    int proprietaire;            // UID du propriétaire
-    int groupe;                  // GID du groupe
     int droits;                  // Permissions (rwxrwxrwx en octal)
-    time_t date_creation;        // Date de création
-    time_t date_modification;    // Date de dernière modification
-    time_t date_acces;           // Date de dernier accès
+    int taille;                  // Taille du fichier en octets
     int nb_liens;                // Nombre de liens physiques
-    int blocs_directs[10];       // 10 blocs directs
-    int bloc_indirect;           // Bloc de pointeurs vers d'autres blocs
-    char nom[MAX_NOM_FICHIER + 1]; // Nom du fichier (pour les liens)
+    union {
+        struct {
+            int blocs_directs[10];   // 10 blocs directs
+            int bloc_indirect;       // Bloc de pointeurs vers d'autres blocs
+            int bloc_fragment;       // Bloc de fragments contenant les données
+            int offset_fragment;     // Position des données dans ce bloc
+            int longueur_fragment;   // Longueur des données dans ce bloc
+            int bloc_carte;          // Carte des clusters (fichier compressé, 0 : aucune)
+            int reserve[4];          // Réservé pour des évolutions du format
+        };
+        char donnees_en_ligne[TAILLE_EN_LIGNE]; // Contenu stocké dans l'inode
+    };
+    int drapeaux;                // Attributs de l'inode (INODE_EN_LIGNE, ...)
+    // Champs froids
+    int proprietaire;            // UID du propriétaire
+    int groupe;                  // GID du groupe
+    int64_t date_creation;       // Date de création
+    int64_t date_modification;   // Date de dernière modification
+    int64_t date_acces;          // Date de dernier accès
 } Inode;
 
+_Static_assert(sizeof(Inode) == 128, "L'inode compact doit faire 128 octets");
+_Static_assert(MAX_CLUSTERS_FICHIER * sizeof(uint16_t) <= TAILLE_BLOC && TAILLE_CLUSTER <= UINT16_MAX,
+               "La carte des clusters (une longueur sur 16 bits par cluster) doit tenir dans un bloc");
+
+/**
+ * @struct InodeV1
+ * @brief Inode de l'ancien format de partition (signature SIGNATURE_FS_V1)
+ * 
+ * Conservé uniquement pour migrer les partitions existantes.
+ */
+typedef struct {
+    int taille;
+    int type;
+    int proprietaire;
+    int groupe;
+    int droits;
+    time_t date_creation;
+    time_t date_modification;
+    time_t date_acces;
+    int nb_liens;
+    int blocs_directs[10];
+    int bloc_indirect;
+    char nom[MAX_NOM_FICHIER + 1];
+} InodeV1;
+
+/* Signatures du système de fichiers */
+#define SIGNATURE_FS "MONFSS2"       // Format actuel (inodes compacts)
+#define SIGNATURE_FS_V1 "MONFSS"     // Ancien format (inodes avec nom)
+
+/* Nombre de blocs occupés par le bitmap */
+#define NB_BLOCS_BITMAP ((TAILLE_BITMAP + TAILLE_BLOC - 1) / TAILLE_BLOC)
+
+/* Position du bitmap dans la partition (bloc qui suit le superbloc) */
+#define OFFSET_BITMAP ((long)TAILLE_BLOC)
+
+/* Position de la table des inodes dans la partition (après le bitmap) */
+#define OFFSET_TABLE_INODES ((long)(1 + NB_BLOCS_BITMAP) * TAILLE_BLOC)
+
+/* Position de la table des inodes dans l'ancien format */
+#define OFFSET_TABLE_INODES_V1 ((long)sizeof(Superbloc))
+
+/* Position de la table des fragments (dans le bloc 0, après le superbloc) */
+#define OFFSET_TABLE_FRAGMENTS 1024L
+
+/* Signature de la table des fragments */
+#define SIGNATURE_FRAGMENTS "FRAGv1"
+
+/* Nombre d'inodes chargés ensemble depuis la partition (une page) */
+#define INODES_PAR_PAGE (TAILLE_BLOC / (int)sizeof(Inode))
+
+/* Nombre de pages d'inodes conservées en mémoire */
+#define NB_PAGES_CACHE_INODES 16
+
+/**
+ * @struct PageInodes
+ * @brief Page de la table des inodes présente dans le cache
+ *
+ * La table des inodes n'est pas chargée en entier : les pages sont lues
+ * à la première utilisation et peuvent être évincées (après réécriture
+ * si elles ont été modifiées) tant qu'aucun inode n'y est épinglé.
+ */
+typedef struct {
+    int num_page;                  // Numéro de page, -1 si emplacement libre
+    int epinglages;                // Nombre d'épinglages en cours
+    int modifiee;                  // 1 si la page doit être réécrite
+    int reference;                 // Bit de seconde chance pour l'éviction
+    Inode inodes[TAILLE_BLOC / sizeof(Inode)]; // Inodes de la page
+} PageInodes;
+
+/* Blocs par lecture ou écriture vectorielle (au plus IOV_MAX) */
+#define NB_VECTEURS_BLOCS 256
+
+/* Blocs recopiés à la fois par copier_fichier et les sauvegardes d'état */
+#define NB_BLOCS_COPIE 256
+
+/* Une grande zone contiguë est lue ou écrite en plusieurs requêtes
+   simultanées de cette taille (octets) */
+#define TAILLE_REQUETE_ES (32 * TAILLE_BLOC)
+
+/* Demandes de lecture anticipée chargées ensemble par le thread de lecture */
+#define NB_DEMANDES_PAR_LOT 8
+
+/* Buffers alignés prêtés, en accès direct, aux appelants dont le buffer
+   ne l'est pas */
+#define NB_TAMPONS_ALIGNES 256
+
+/* Blocs de la table des sommes de contrôle (une somme par bloc) */
+#define NB_BLOCS_SOMMES ((NB_BLOCS * (int)sizeof(uint32_t) + TAILLE_BLOC - 1) / TAILLE_BLOC)
+
+/* Position de l'en-tête de la table des sommes (dans le bloc 0, après la
+   table des fragments) */
+#define OFFSET_EN_TETE_SOMMES 3584L
+
+/* Signature de l'en-tête de la table des sommes */
+#define SIGNATURE_SOMMES "CRC32Cv1"
+
+/* Position de l'en-tête de la table des références (bloc 0, après celui
+   des sommes) */
+#define OFFSET_EN_TETE_REFERENCES 3600L
+
+/* Signature de l'en-tête de la table des références */
+#define SIGNATURE_REFERENCES "DEDUPv1"
+
+/* Pointeurs au plus vers un même bloc dédupliqué (compteur sur un octet) */
+#define MAX_REFERENCES 255
+
+/* Seaux de l'index des blocs dédupliqués (puissance de 2) */
+#define NB_SEAUX_DEDUP 1024
+
+/* Threads qui se partagent la table des inodes pendant une vérification,
+   ou la partition pendant le contrôle des sommes */
+#define NB_FILS_VERIFICATION 4
+
+/* Seaux de l'index des noms, par nom complet et par trigramme (puissances de 2) */
+#define NB_SEAUX_NOMS 4096
+#define NB_SEAUX_TRIGRAMMES 4096
+
+/* Noms au plus dans l'index : toutes les entrées de tous les répertoires */
+#define MAX_NOMS_INDEX (NB_INODES * MAX_ENTREES_DIR)
+
+/* États de l'index des noms */
+#define INDEX_NOMS_VIDE 0                // À construire à la première recherche
+#define INDEX_NOMS_EN_CONSTRUCTION 1     // Relevé des répertoires en cours, modifications appliquées
+#define INDEX_NOMS_PRET 2
+
+/* Threads qui se partagent le parcours d'une arborescence (rm -r, cp -r,
+   du, tree) */
+#define NB_FILS_PARCOURS 4
+
+/* Blocs au plus libérés avec un inode : blocs de données, bloc indirect et
+   carte des clusters */
+#define MAX_BLOCS_INODE (MAX_BLOCS_FICHIER + 2)
+
+/* Options de verifier_partition */
+#define VERIFIER_REPARER 0x1          // Corriger ce qui peut l'être
+#define VERIFIER_RAPIDE 0x2           // Allocation et entrées de répertoire seulement
+
+/* Nombre de blocs conservés en mémoire par le cache de blocs */
+#define NB_BLOCS_CACHE 256
+
+/* Fenêtre de lecture anticipée (en blocs) : taille initiale et maximale */
+#define FENETRE_ANTICIPATION_MIN 4
+#define FENETRE_ANTICIPATION_MAX 64
+
+/* Demandes de lecture anticipée en attente du thread de lecture */
+#define NB_DEMANDES_ANTICIPATION 64
+
+/**
+ * @struct CaseBloc
+ * @brief Bloc de la partition présent dans le cache de blocs
+ *
+ * Le cache contient des copies de blocs tels qu'ils sont sur le disque :
+ * toute écriture sur le fichier de partition retire les blocs touchés.
+ */
+typedef struct {
+    int bloc;                      // Numéro du bloc, -1 si emplacement libre
+    int reference;                 // Bit de seconde chance pour l'éviction
+    int en_chargement;             // 1 pendant qu'une lecture anticipée la remplit
+    char* donnees;                 // Contenu du bloc (TAILLE_BLOC octets alignés)
+} CaseBloc;
+
+/**
+ * @struct LectureSequentielle
+ * @brief Détection des lectures séquentielles d'un fichier
+ *
+ * La fenêtre double à chaque bloc lu dans l'ordre (jusqu'à
+ * FENETRE_ANTICIPATION_MAX) et retombe à 0 dès qu'un bloc est lu ailleurs.
+ */
+typedef struct {
+    int prochain_index;            // Bloc logique attendu si la lecture est séquentielle
+    int fenetre;                   // Blocs à anticiper (0 : accès aléatoire)
+    int anticipe_jusqua;           // Premier bloc logique pas encore demandé
+} LectureSequentielle;
+
+/**
+ * @struct DemandeAnticipation
+ * @brief Suite de blocs physiques consécutifs à charger dans le cache
+ */
+typedef struct {
+    int premier;                   // Premier bloc
+    int nb;                        // Nombre de blocs
+} DemandeAnticipation;
+
+/**
+ * @struct BlocFragments
+ * @brief Bloc partagé entre les fins de plusieurs petits fichiers
+ */
+typedef struct {
+    int bloc;                      // Numéro du bloc de fragments
+    uint32_t occupation;           // Un bit par unité de TAILLE_UNITE_FRAGMENT occupée
+} BlocFragments;
+
+/**
+ * @struct TableFragments
+ * @brief Occupation des blocs de fragments, conservée dans le bloc 0
+ */
+typedef struct {
+    char signature[8];             // SIGNATURE_FRAGMENTS si la table est valide
+    int nb_blocs;                  // Nombre de blocs de fragments suivis
+    BlocFragments blocs[MAX_BLOCS_FRAGMENTS];
+} TableFragments;
+
+_Static_assert(UNITES_PAR_BLOC_FRAGMENTS <= 32, "Le masque d'occupation est sur 32 bits");
+_Static_assert(sizeof(Superbloc) <= OFFSET_TABLE_FRAGMENTS
+               && OFFSET_TABLE_FRAGMENTS + sizeof(TableFragments) <= TAILLE_BLOC,
+               "La table des fragments doit tenir dans le bloc 0");
+
+/**
+ * @struct EnTeteSommes
+ * @brief Emplacement de la table des sommes de contrôle, conservé dans le bloc 0
+ *
+ * La table occupe NB_BLOCS_SOMMES blocs consécutifs alloués comme des
+ * blocs de données. Elle n'est à jour sur le disque que si la partition a
+ * été fermée proprement.
+ */
+typedef struct {
+    char signature[12];            // SIGNATURE_SOMMES si la table existe
+    int premier_bloc;              // Premier bloc de la table
+} EnTeteSommes;
+
+_Static_assert(OFFSET_EN_TETE_SOMMES >= OFFSET_TABLE_FRAGMENTS + (long)sizeof(TableFragments)
+               && OFFSET_EN_TETE_SOMMES + sizeof(EnTeteSommes) <= TAILLE_BLOC,
+               "L'en-tête des sommes doit tenir dans le bloc 0 après la table des fragments");
+
+/**
+ * @struct EnTeteReferences
+ * @brief Emplacement de la table des références des blocs dédupliqués,
+ * conservé dans le bloc 0
+ *
+ * La table est un bloc de données : un compteur par bloc de la partition,
+ * 0 pour un bloc ordinaire, sinon le nombre de pointeurs de fichiers vers
+ * ce bloc indexé. Elle n'existe que si la déduplication a servi.
+ */
+typedef struct {
+    char signature[12];            // SIGNATURE_REFERENCES si la table existe
+    int bloc;                      // Bloc de la table
+} EnTeteReferences;
+
+_Static_assert(OFFSET_EN_TETE_REFERENCES >= OFFSET_EN_TETE_SOMMES + (long)sizeof(EnTeteSommes)
+               && OFFSET_EN_TETE_REFERENCES + sizeof(EnTeteReferences) <= TAILLE_BLOC
+               && NB_BLOCS <= TAILLE_BLOC,
+               "L'en-tête et la table des références doivent tenir chacun dans un bloc");
+
+/**
+ * @struct IndexDedup
+ * @brief Index en mémoire des blocs dédupliqués, par CRC32C de leur contenu
+ *
+ * Reconstruit au chargement d'après la table des références et la table
+ * des sommes : chaque seau chaîne les blocs dont la somme y tombe.
+ */
+typedef struct {
+    int seaux[NB_SEAUX_DEDUP];     // Premier bloc de chaque seau (-1 : vide)
+    int suivants[NB_BLOCS];        // Bloc suivant dans le même seau
+    uint32_t cles[NB_BLOCS];       // Somme sous laquelle le bloc est indexé
+    int nb_entrees;                // Blocs indexés
+} IndexDedup;
+
 /**
  * @struct EntreeRepertoire
  * @brief Entrée dans un répertoire
@@ -140,6 +482,49 @@ typedef struct {
     int inode;                     // Numéro d'inode associé
 } EntreeRepertoire;
 
+/**
+ * @struct NomIndexe
+ * @brief Une entrée de répertoire (hors . et ..) dans l'index des noms
+ */
+typedef struct {
+    char* nom;                     // Copie du nom (NULL : case libre)
+    int parent;                    // Répertoire qui contient l'entrée
+    int inode;                     // Inode qu'elle désigne
+    int suivant;                   // Case suivante du même seau, ou case libre suivante
+} NomIndexe;
+
+/**
+ * @struct ListeTrigrammes
+ * @brief Cases des noms dont un trigramme tombe dans un seau
+ */
+typedef struct {
+    int* cases;
+    int nb;
+    int capacite;
+} ListeTrigrammes;
+
+/**
+ * @struct IndexNoms
+ * @brief Index en mémoire de tous les noms de la partition
+ *
+ * Construit à la première recherche en relevant les entrées de tous les
+ * répertoires, puis tenu à jour à chaque ajout ou retrait d'une entrée ;
+ * vidé quand les répertoires changent autrement (chargement d'une
+ * sauvegarde, annulation d'une transaction, réparation). Un nom
+ * exact est retrouvé par le hachage du nom complet ; un motif, par le
+ * seau le moins peuplé parmi les trigrammes (suites de trois octets) de
+ * ses parties fixes.
+ */
+typedef struct {
+    NomIndexe noms[MAX_NOMS_INDEX];
+    int seaux[NB_SEAUX_NOMS];      // Première case de chaque seau (-1 : vide)
+    ListeTrigrammes trigrammes[NB_SEAUX_TRIGRAMMES];
+    int nom_repertoire[NB_INODES]; // Case du nom de chaque répertoire, pour les chemins (-1 : aucun)
+    int premiere_libre;            // Chaîne des cases libres (-1 : index plein)
+    int nb_noms;                   // Noms indexés
+    int etat;                      // INDEX_NOMS_VIDE, _EN_CONSTRUCTION ou _PRET
+} IndexNoms;
+
 /**
  * @struct MapBloc
  * @brief Représente un déplacement de bloc lors de la défragmentation.
@@ -153,83 +538,321 @@ typedef struct {
     int ancien_bloc;
     int nouveau_bloc;
 } MapBloc;
+
+/**
+ * @struct EtatFragmentation
+ * @brief Mesure de la fragmentation des fichiers et de l'espace libre
+ *
+ * Une extension est une suite de blocs logiques consécutifs rangés dans
+ * des blocs physiques consécutifs ; un fichier contigu n'en a qu'une.
+ */
+typedef struct {
+    int nb_fichiers;              // Fichiers occupant au moins deux blocs
+    int nb_fichiers_fragmentes;   // Ceux qui ont plus d'une extension
+    int nb_extensions;            // Total des extensions de ces fichiers
+    int nb_blocs_donnees;         // Blocs de données (hors métadonnées)
+    int nb_blocs_libres;          // Blocs libres
+    int nb_zones_libres;          // Suites de blocs libres consécutifs
+    int plus_grande_zone_libre;   // Longueur de la plus grande de ces suites
+} EtatFragmentation;
+
+/**
+ * @struct EtatDeduplication
+ * @brief Mesure du partage des blocs dédupliqués
+ */
+typedef struct {
+    int nb_blocs_indexes;         // Blocs dans l'index
+    int nb_blocs_partages;        // Blocs désignés par plusieurs pointeurs
+    int nb_blocs_economises;      // Pointeurs en plus des premiers (blocs non écrits)
+    int nb_blocs_donnees;         // Blocs de données utilisés
+    size_t octets_index;          // Mémoire de l'index et des références
+} EtatDeduplication;
+
+/**
+ * @struct PageTampon
+ * @brief Page de données en attente d'écriture (allocation différée)
+ *
+ * Contient le contenu d'un bloc logique d'un fichier tant qu'il n'a pas
+ * été vidé sur la partition. Les pages d'un même fichier sont chaînées
+ * par index logique croissant.
+ */
+typedef struct PageTampon {
+    char donnees[TAILLE_BLOC];     // Contenu du bloc (en tête : la page est alignée)
+    int index;                     // Index logique du bloc dans le fichier
+    int bloc_reserve;              // 1 si aucun bloc physique n'est encore associé
+    int dedupliquee;               // 1 si la page pointe vers un bloc identique déjà écrit
+    uint32_t somme;                // CRC32C du contenu (déduplication)
+    struct PageTampon* suivante;   // Page suivante (index supérieur)
+} PageTampon;
+
+/**
+ * @struct TamponInode
+ * @brief Ensemble des pages en attente d'un inode
+ */
+typedef struct TamponInode {
+    int inode;                     // Inode propriétaire des pages
+    int nb_pages;                  // Nombre de pages en attente
+    PageTampon* pages;             // Pages triées par index logique
+    struct TamponInode* suivant;   // Tampon de l'inode suivant
+} TamponInode;
     
-// =============================================
-// VARIABLES GLOBALES
-// =============================================
+/**
+ * @struct SystemeFichiers
+ * @brief Contexte d'une partition ouverte
+ *
+ * Regroupe tout l'état du système de fichiers, qui peut être utilisé par
+ * plusieurs threads à la fois. Verrous, du plus externe au plus interne :
+ * - verrou_global : pris en lecture pour chaque commande (debuter_operation),
+ *   en écriture par les commandes qui réorganisent toute la partition
+ *   (défragmentation, sauvegarde et restauration d'état) ;
+ * - verrous_inodes : un verrou lecteurs/rédacteur par inode. Celui d'un
+ *   répertoire protège ses entrées, celui d'un fichier son contenu et ses
+ *   pages en attente. Un répertoire est verrouillé avant ses entrées ;
+ * - verrou_tampons : liste des tampons d'écriture ;
+ * - verrous_fragments : lecture-modification-écriture d'un bloc de
+ *   fragments, partagé par plusieurs fichiers ;
+ * - verrou_allocation : bitmap, compteurs du superbloc, table des
+ *   fragments, réservations de blocs, références et index des blocs
+ *   dédupliqués ;
+ * - verrou_cache : pages du cache d'inodes ;
+ * - verrou_transaction : copies des blocs de la transaction en cours ;
+ * - verrou_blocs : cache de blocs, détection des lectures séquentielles
+ *   et demandes de lecture anticipée ;
+ * - verrou_tampons_alignes : pile des buffers alignés libres ;
+ * - verrou_noms : index des noms (mis à jour sous le verrou du répertoire
+ *   modifié) ;
+ * - verrou_construction_noms : construction de l'index des noms, pris
+ *   avant les verrous des répertoires relevés.
+ */
+typedef struct SystemeFichiers {
+    int descripteur;                 // Partition, lue et écrite par pread/pwrite
+    int descripteur_direct;          // Même fichier ouvert avec O_DIRECT (-1 : accès direct refusé ou désactivé)
+    MoteurES* moteur_es;             // Lots de lectures et d'écritures simultanées
+    char* tampons_alignes;           // NB_TAMPONS_ALIGNES buffers de TAILLE_BLOC octets alignés
+    int tampons_libres[NB_TAMPONS_ALIGNES]; // Pile des buffers alignés libres
+    int nb_tampons_libres;
+    char* donnees_cache_blocs;       // Contenu des emplacements du cache de blocs (aligné)
+    Superbloc superbloc;             // Superbloc du système
+    uint8_t bitmap[TAILLE_BITMAP];   // Bitmap des blocs libres/alloués
+    TableFragments table_fragments;  // Occupation des blocs de fragments
+    int bloc_sommes;                 // Premier bloc de la table des sommes (-1 : pas de sommes)
+    int verification_donnees;        // 1 : vérifier aussi la somme des blocs de données lus
+    uint32_t sommes[NB_BLOCS];       // CRC32C du contenu de chaque bloc sur le disque
+    uint8_t somme_perimee[NB_BLOCS]; // 1 si le bloc a été écrit en partie depuis le calcul de sa somme
+    int bloc_references;             // Bloc de la table des références (-1 : pas de déduplication)
+    int deduplication;               // 1 : dédupliquer les blocs au vidage
+    uint8_t references[NB_BLOCS];    // Pointeurs vers chaque bloc indexé (0 : bloc ordinaire)
+    IndexDedup index_dedup;          // Blocs indexés, par somme
+    IndexNoms index_noms;            // Tous les noms de la partition, pour find
+
+    PageInodes cache_inodes[NB_PAGES_CACHE_INODES]; // Pages de la table des inodes
+    int aiguille_cache;              // Position de l'horloge d'éviction
+    int prochain_inode_libre;        // Point de départ de la recherche d'inode libre
+
+    TamponInode* tampons_ecriture;   // Pages de données en attente d'allocation
+    int nb_pages_tampon;             // Pages en attente (tous inodes)
+    int nb_blocs_reserves;           // Pages n'ayant pas encore de bloc physique
+
+    const struct Session* session_transaction; // Session qui a ouvert la transaction (NULL : aucune)
+    char* blocs_ombre[NB_BLOCS];     // Blocs modifiés par la transaction, pas encore écrits
+    int nb_blocs_ombre;              // Nombre de blocs modifiés par la transaction
+
+    CaseBloc cache_blocs[NB_BLOCS_CACHE]; // Blocs lus récemment ou par anticipation
+    int case_du_bloc[NB_BLOCS];      // Emplacement de chaque bloc dans le cache (-1 : absent)
+    uint32_t generation_bloc[NB_BLOCS]; // Incrémenté à chaque écriture du bloc
+    int aiguille_blocs;              // Position de l'horloge d'éviction
+    int demandes_bloc[NB_BLOCS];     // Demandes de lecture anticipée en cours pour chaque bloc
+    LectureSequentielle lectures[NB_INODES]; // État séquentiel de chaque fichier
+    DemandeAnticipation demandes[NB_DEMANDES_ANTICIPATION]; // File circulaire
+    int premiere_demande;            // Position de la plus ancienne demande
+    int nb_demandes;                 // Demandes en attente
+    int arret_anticipation;          // Demande d'arrêt du thread de lecture
+    int anticipation_asynchrone;     // 1 si le thread de lecture a démarré
+    pthread_t fil_anticipation;      // Thread de lecture anticipée
+
+    unsigned long nb_succes_cache_blocs; // Lectures de blocs servies par le cache
+    unsigned long nb_blocs_anticipes;    // Blocs chargés par lecture anticipée
+    unsigned long nb_lectures_disque;  // Lectures sur le fichier de partition
+    unsigned long nb_ecritures_disque; // Écritures sur le fichier de partition
+    unsigned long octets_lus;          // Octets lus sur le fichier de partition
+    unsigned long octets_ecrits;       // Octets écrits sur le fichier de partition
+    unsigned long nb_lots_es;          // Lots soumis au moteur d'entrées-sorties
+    unsigned long nb_requetes_es;      // Requêtes de ces lots
+    unsigned long nb_sommes_verifiees; // Blocs lus dont la somme a été vérifiée
+    unsigned long nb_blocs_corrompus;  // Blocs lus dont la somme ne correspond pas
+    unsigned long nb_blocs_dedupliques; // Blocs remplacés par un bloc identique
+    unsigned long nb_collisions_dedup; // Sommes égales pour des contenus différents
+    unsigned long nb_clusters_ecrits;  // Clusters de fichiers compressés écrits
+    unsigned long nb_clusters_compresses; // Dont ceux qui ont gagné au moins un bloc
+    unsigned long octets_avant_compression; // Données de ces clusters
+    unsigned long octets_apres_compression; // Blocs qu'ils occupent
+    unsigned long nb_clusters_decompresses; // Clusters décompressés pour une lecture
+
+#ifdef METRIQUES
+    Metriques metriques;             // Compteurs et latences des opérations
+    Trace* trace;                    // Trace des accès aux blocs (NULL : aucune)
+#endif
+
+    pthread_rwlock_t verrou_global;
+    pthread_mutex_t verrou_tampons;
+    pthread_mutex_t verrou_allocation;
+    pthread_mutex_t verrou_cache;
+    pthread_mutex_t verrou_transaction;
+    pthread_mutex_t verrou_blocs;
+    pthread_mutex_t verrou_tampons_alignes;
+    pthread_mutex_t verrou_noms;
+    pthread_mutex_t verrou_construction_noms;
+    pthread_cond_t demande_anticipation;
+    pthread_cond_t blocs_charges;
+    pthread_rwlock_t verrous_inodes[NB_INODES];
+    pthread_mutex_t verrous_fragments[NB_VERROUS_FRAGMENTS];
+} SystemeFichiers;
 
-extern uint8_t bitmap[TAILLE_BITMAP];  // Bitmap des blocs libres/alloués
-extern Inode inodes[NB_INODES];        // Table des inodes
-extern Superbloc superbloc;            // Superbloc du système
-extern FILE* partition_file;           // Fichier représentant la partition
-extern int inode_courant;              // Inode du répertoire courant
-extern EntreeRepertoire entrees[MAX_ENTREES_DIR];
+/**
+ * @struct Session
+ * @brief Utilisateur d'une partition (interface en ligne de commande, thread...)
+ *
+ * Chaque session a son propre répertoire courant ; les noms relatifs
+ * sont résolus à partir de celui-ci.
+ */
+typedef struct Session {
+    SystemeFichiers* fs;             // Partition utilisée
+    int inode_courant;               // Inode du répertoire courant
+} Session;
 
 // =============================================
 // PROTOTYPES DES FONCTIONS
 // =============================================
 
 /* Fonctions de gestion de la partition */
-void initialiser_partition(const char* nom_partition);
-void charger_partition(const char* nom_partition);
-void sauvegarder_partition();
-int defragmenter();
+SystemeFichiers* initialiser_partition(const char* nom_partition);
+SystemeFichiers* charger_partition(const char* nom_partition);
+void fermer_partition(SystemeFichiers* fs);
+void sauvegarder_partition(SystemeFichiers* fs);
+int defragmenter(SystemeFichiers* fs);
+int mesurer_fragmentation(SystemeFichiers* fs, EtatFragmentation* etat);
+void mesurer_deduplication(SystemeFichiers* fs, EtatDeduplication* etat);
+int verifier_partition(SystemeFichiers* fs, int options);
+int verifier_partition_hors_ligne(const char* nom_partition, int options);
+int controler_sommes_partition(SystemeFichiers* fs);
+int dedupliquer_partition(SystemeFichiers* fs);
+int demarrer_trace_partition(SystemeFichiers* fs, const char* chemin);
+int arreter_trace_partition(SystemeFichiers* fs, uint64_t* nb_evenements, uint64_t* nb_perdus);
 
 /* Gestion des blocs */
-int trouver_bloc_libre();
-void liberer_bloc(int num_bloc);
+int trouver_bloc_libre(SystemeFichiers* fs);
+void liberer_bloc(SystemeFichiers* fs, int num_bloc);
 void afficher_bitmap(uint8_t* bitmap, int nb_blocs);
 
 /* Gestion des inodes */
-int trouver_inode_libre();
-void liberer_inode(int num_inode);
-void afficher_inode(const Inode *inode);
-Inode* trouver_ind(char* nom);
+int trouver_inode_libre(SystemeFichiers* fs);
+void liberer_inode(SystemeFichiers* fs, int num_inode);
+void afficher_inode(SystemeFichiers* fs, int inode_id, const char* nom);
+int trouver_ind(Session* s, const char* nom);
+int rechercher_noms(Session* s, const char* motif);
+
+/* Sessions et verrous */
+Session* ouvrir_session(SystemeFichiers* fs);
+void fermer_session(Session* s);
+void debuter_operation(SystemeFichiers* fs, int exclusive);
+void terminer_operation(SystemeFichiers* fs);
+void verrouiller_inode(SystemeFichiers* fs, int inode_id, int ecriture);
+void deverrouiller_inode(SystemeFichiers* fs, int inode_id);
+
+/* Transactions */
+int debuter_transaction(Session* s);
+int valider_transaction(Session* s);
+int annuler_transaction(Session* s);
+int transaction_en_cours(const Session* s);
+
+/* Cache des inodes (table paginée) */
+int inode_valide(SystemeFichiers* fs, int inode_id);
+Inode* epingler_inode(SystemeFichiers* fs, int inode_id);
+void desepingler_inode(SystemeFichiers* fs, int inode_id, int modifie);
+int vider_cache_inodes(SystemeFichiers* fs);
+void invalider_cache_inodes(SystemeFichiers* fs);
+int nb_blocs_metadonnees(SystemeFichiers* fs);
+int migrer_partition_v1(SystemeFichiers* fs);
 
 /* Opérations sur les blocs */
-void ecrire_bloc(int num_bloc, void* donnees);
-int lire_bloc(int num_bloc, void* donnees);
+void ecrire_bloc(SystemeFichiers* fs, int num_bloc, const void* donnees);
+int lire_bloc(SystemeFichiers* fs, int num_bloc, void* donnees);
+int lire_bloc_donnees(SystemeFichiers* fs, int num_bloc, void* donnees);
+int lire_blocs(SystemeFichiers* fs, const int* blocs, void* const* destinations, int nb);
+int ecrire_blocs(SystemeFichiers* fs, const int* blocs, const void* const* sources, int nb);
+int lire_entrees(SystemeFichiers* fs, int num_bloc, EntreeRepertoire* entrees);
+void ecrire_entrees(SystemeFichiers* fs, int num_bloc, const EntreeRepertoire* entrees);
 
 /* Utilitaires */
 void erreur(const char* message);
+void rediriger_sortie(FILE* flux);
+FILE* flux_sortie(void);
+int nb_erreurs(void);
 int valider_nom_fichier(const char* nom);
-void mySeek(FILE *f, long offset, int base);
+int lire_partition(SystemeFichiers* fs, void* donnees, size_t taille, off_t offset);
+int ecrire_partition(SystemeFichiers* fs, const void* donnees, size_t taille, off_t offset);
+void utiliser_acces_direct(int actif);
+void utiliser_verification_donnees(int actif);
+void utiliser_deduplication(int actif);
 
 /* Opérations sur les fichiers */
-int creer_fichier(const char* nom, int type);
-int supprimer_fichier(const char* nom);
-void sauvegarder_etat(const char* fichier_sauvegarde);
-void restaurer_etat(const char* fichier_sauvegarde);
+int creer_fichier(Session* s, const char* nom, int type);
+int supprimer_fichier(Session* s, const char* nom);
+void sauvegarder_etat(SystemeFichiers* fs, const char* fichier_sauvegarde);
+void restaurer_etat(SystemeFichiers* fs, const char* fichier_sauvegarde);
 
 /* Gestion des répertoires */
-int ajouter_entree_repertoire(int inode_dir, const char* nom, int inode);
-int supprimer_entree_repertoire(int inode_dir, const char* nom);
-int trouver_inode_par_nom(int inode_dir, const char* nom);
+int ajouter_entree_repertoire(SystemeFichiers* fs, int inode_dir, const char* nom, int inode);
+int supprimer_entree_repertoire(SystemeFichiers* fs, int inode_dir, const char* nom);
+int trouver_inode_par_nom(SystemeFichiers* fs, int inode_dir, const char* nom);
 
 /* Opérations de lecture/écriture */
-int lire_fichier(int inode_id, void* buffer, int taille, int offset);
-int ecrire_fichier(int inode_id, void* buffer, int taille, int offset);
+int lire_fichier(Session* s, int inode_id, void* buffer, int taille, int offset);
+int ecrire_fichier(Session* s, int inode_id, void* buffer, int taille, int offset);
+
+/* Allocation différée (tampons d'écriture) */
+TamponInode* chercher_tampon(SystemeFichiers* fs, int inode_id, int creer);
+PageTampon* chercher_page(TamponInode* tampon, int index);
+PageTampon* obtenir_page(SystemeFichiers* fs, TamponInode* tampon, const Inode* inode, int index);
+int bloc_physique(SystemeFichiers* fs, const Inode* inode, int index);
+int allouer_blocs_contigus(SystemeFichiers* fs, int nb_voulus, int but, int* nb_obtenus);
+int vider_tampon_inode(SystemeFichiers* fs, int inode_id);
+int synchroniser_tampons(SystemeFichiers* fs);
+void abandonner_tampon_inode(SystemeFichiers* fs, int inode_id);
+
+/* Fragments (fins de petits fichiers regroupées dans des blocs partagés) */
+int allouer_fragment(SystemeFichiers* fs, int longueur, int* bloc, int* offset);
+void liberer_fragment(SystemeFichiers* fs, int bloc, int offset, int longueur);
 
 /* Gestion des permissions */
-int verifier_droits(int num_inode, int droits_requis);
+int verifier_droits(SystemeFichiers* fs, int num_inode, int droits_requis);
 
 /* Gestion des liens */
-int creer_lien(const char* source, const char* nom_lien);
-int creer_lien_symbolique(const char* source, const char* destination);
+int creer_lien(Session* s, const char* source, const char* nom_lien);
+int creer_lien_symbolique(Session* s, const char* source, const char* destination);
 
 /* Navigation */
-void afficher_repertoire(int inode_dir);
-int changer_repertoire(const char* chemin);
+void afficher_repertoire(SystemeFichiers* fs, int inode_dir);
+int changer_repertoire(Session* s, const char* chemin);
 
 /* Opérations sur les fichiers */
-int copier_fichier(const char* source, const char* destination);
-int deplacer_fichier(const char* source, const char* destination);
-void sauvegarder_etat(const char* fichier_sauvegarde);
-void restaurer_etat(const char* fichier_sauvegarde);
+int copier_fichier(Session* s, const char* source, const char* destination);
+int deplacer_fichier(Session* s, const char* source, const char* destination);
+
+/* Arborescences (parcours parallèle) */
+int supprimer_arbre(Session* s, const char* nom);
+int copier_arbre(Session* s, const char* source, const char* destination);
+int afficher_occupation(Session* s, const char* nom);
+int afficher_arborescence(Session* s, const char* nom);
+void sauvegarder_etat(SystemeFichiers* fs, const char* fichier_sauvegarde);
+void restaurer_etat(SystemeFichiers* fs, const char* fichier_sauvegarde);
 
+int sauvegarder_instantane(SystemeFichiers* fs, const char* depot, const char* nom);
+int restaurer_instantane(SystemeFichiers* fs, const char* depot, const char* nom);
 
 /* Gestion des permissions */
-int modifier_droits(int inode_id, int nouveaux_droits);
+int modifier_droits(SystemeFichiers* fs, int inode_id, int nouveaux_droits);
+int modifier_compression(SystemeFichiers* fs, int inode_id, int actif);
 int convertir_droits_num(const char* droits);
 int convertir_droits_char(const char* droits);
 
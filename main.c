@@ -1,4 +1,9 @@
-#include "file_system.h"
+#include <getopt.h>
+
+#include "serveur.h"
+
+#define SORTIE_ECHEC_COMMANDE 1   // Code de sortie d'un lot dont une commande a échoué
+#define SORTIE_ERREUR 2           // Code de sortie si le lot n'a pas pu être exécuté
 
 /**
  * Pourcentage d'implication :
@@ -10,24 +15,45 @@
  * Cette fonction implémente une interface en ligne de commande pour interagir
  * avec le système de fichiers personnalisé
  */
- int main() {
-    const char* nom_partition = "partition.bin";
 
-    // Vérifier si la partition existe
-    FILE* test = fopen(nom_partition, "rb");
-    if (test) {
-        fclose(test);
-        printf("Chargement d'une partition existante...\n");
-        charger_partition(nom_partition);
-    } else {
-        printf("Création d'une nouvelle partition...\n");
-        initialiser_partition(nom_partition);
+/**
+ * Affiche l'usage du programme
+ * @param programme Le nom du programme
+ */
+static void afficher_usage(const char* programme) {
+    fprintf(stderr, "Usage: %s [options] [partition]\n", programme);
+    fprintf(stderr, "  -p, --partition <fichier> Fichier de partition (défaut: partition.bin)\n");
+    fprintf(stderr, "  -f, --fichier <script> Exécuter un script sans invite (- : entrée standard)\n");
+    fprintf(stderr, "  -c, --commandes <cmds> Exécuter des commandes séparées par ';'\n");
+    fprintf(stderr, "  -n, --sauvegarde <n>  En lot, sauvegarder toutes les n commandes (défaut: à la fin)\n");
+    fprintf(stderr, "  -e, --arret-erreur    En lot, s'arrêter à la première commande en échec\n");
+    fprintf(stderr, "  -d, --demon          Servir la partition sur une socket Unix\n");
+    fprintf(stderr, "  -C, --client         Se connecter à un démon\n");
+    fprintf(stderr, "  -s, --socket <chemin> Socket du démon (défaut: %s)\n", SOCKET_DEFAUT);
+    fprintf(stderr, "  -t, --threads <n>    Threads du démon (défaut: %d)\n", NB_TRAVAILLEURS_DEFAUT);
+    fprintf(stderr, "  -T, --trace <fichier> Enregistrer les accès aux blocs dans une trace\n");
+    fprintf(stderr, "  -E, --es <moteur>    Entrées-sorties : auto, io_uring, threads ou synchrone (défaut: auto)\n");
+    fprintf(stderr, "  -D, --sans-direct    Passer par le cache du noyau (pas d'O_DIRECT)\n");
+    fprintf(stderr, "  -V, --verifier-donnees Vérifier aussi les sommes des blocs de données lus\n");
+    fprintf(stderr, "  -u, --dedup          Partager les blocs identiques à l'écriture\n");
+    fprintf(stderr, "  -k, --verifier       Vérifier la partition sans l'utiliser, puis quitter\n");
+    fprintf(stderr, "  -K, --reparer        Vérifier et réparer la partition, puis quitter\n");
+    fprintf(stderr, "  -h, --help           Afficher cette aide\n");
+}
+
+/**
+ * Interface interactive : lit les commandes au clavier et les exécute
+ * @param fs Le système de fichiers monté
+ * @return 0 si succès, -1 si erreur
+ */
+static int interface_interactive(SystemeFichiers* fs) {
+    Session* s = ouvrir_session(fs);
+    if (s == NULL) {
+        return -1;
     }
 
     // Interface utilisateur simple
-    char commande[100];
-    char param1[MAX_NOM_FICHIER];
-    char param2[MAX_NOM_FICHIER];
+    char commande[TAILLE_MAX_COMMANDE];
 
     printf("\nGestionnaire de fichiers - Tapez 'aide' pour voir les commandes disponibles\n");
 
@@ -39,290 +65,221 @@
 
         commande[strcspn(commande, "\n")] = 0;
 
-        // Réinitialiser les paramètres
-        param1[0] = '\0';
-        param2[0] = '\0';
-
-        if (strcmp(commande, "aide") == 0) {
-            printf("================ COMMANDES DISPONIBLES ================\n\n");
-
-            // Navigation et affichage
-            printf("NAVIGATION ET AFFICHAGE:\n");
-            printf("  cd <rep>        - Changer de répertoire\n");
-            printf("  ls              - Afficher le contenu du répertoire\n\n");
-            printf("  ls -i  <nom>         - Afficher le contenu d'un inode'\n\n");
-
-            // Gestion des fichiers et répertoires
-            printf("CRÉATION ET SUPPRESSION:\n");
-            printf("  mkdir <nom>     - Créer un répertoire\n");
-            printf("  rm <nom>        - Supprimer un fichier ou répertoire\n");
-            printf("  touch <nom>     - Créer un fichier vide\n\n");
-            printf("  save <fichier>  - Sauvegarde de l'état actuel de la partition\n");
-            printf("  load <fichier>  - Restauration d’une partition depuis un fichier de sauvegarde\n");
-
-            // Manipulation et contenu
-            printf("MANIPULATION DE CONTENU:\n");
-            printf("  cat <nom>       - Afficher le contenu d'un fichier\n");
-            printf("  cp <src> <dest> - Copier un fichier\n");
-            printf("  mv <src> <dest> - Déplacer un fichier\n");
-            printf("  write <nom>     - Écrire dans un fichier\n\n");
-            printf("  defrag          - Défragmentation en réorganisant les blocs\n");
-
-            // Liens et attributs
-            printf("LIENS ET ATTRIBUTS:\n");
-            printf("  chmod <nom><droit> - Modifier les droits d'un fichier (notation symbolique)\n");
-            printf("  ln <src> <dest>    - Créer un lien physique\n");
-            printf("  lns <src> <dest>   - Créer un lien symbolique\n\n");
-
-            // Commande de sortie
-            printf("SYSTÈME:\n");
-            printf("  quit            - Quitter le programme\n");
-            printf("\n====================================================\n");
-
-        } else if (strcmp(commande, "ls") == 0) {
-            afficher_repertoire(inode_courant);
-
-        } else if (strncmp(commande, "cd ", 3) == 0) {
-            if (sscanf(commande, "cd %s", param1) == 1) {
-                changer_repertoire(param1);
-            } else {
-                erreur("Usage: cd <repertoire>");
+        // Le contenu de write est saisi avant d'exécuter la commande
+        char contenu[1024] = {0};
+        const char* donnees = NULL;
+        char fichier[MAX_NOM_FICHIER + 1];
+        if (sscanf(commande, "write %255s", fichier) == 1 && strncmp(commande, "write ", 6) == 0) {
+            if (verifier_cible_ecriture(s, fichier) != 0) {
+                continue;
             }
+            printf("Entrez le contenu à écrire (terminez par une ligne vide) :\n");
 
-        } else if (strncmp(commande, "mkdir ", 6) == 0) {
-            if (sscanf(commande, "mkdir %s", param1) == 1) {
-                creer_fichier(param1, TYPE_REPERTOIRE);
-            } else {
-                erreur("Usage: mkdir <nom>");
-            }
+            char ligne[1024];
+            while (1) {
+                printf("> ");
+                if (fgets(ligne, sizeof(ligne), stdin) == NULL) {
+                    break;
+                }
 
-        } else if (strncmp(commande, "touch ", 6) == 0) {
-            if (sscanf(commande, "touch %s", param1) == 1 && strcmp(param1, ".") != 0 && strcmp(param1, "..") != 0) {
-                creer_fichier(param1, TYPE_FICHIER);
-            } else {
-                erreur("Usage: touch <nom>");
-            }
+                // Supprimer le retour à la ligne
+                ligne[strcspn(ligne, "\n")] = 0;
 
-        } else if (strncmp(commande, "rm ", 3) == 0) {
-            if (sscanf(commande, "rm %s", param1) == 1) {
-                supprimer_fichier(param1);
-            } else {
-                erreur("Usage: rm <nom>");
-            }
+                // Ligne vide termine la saisie
+                if (strlen(ligne) == 0) {
+                    break;
+                }
 
-        } else if (strncmp(commande, "cp ", 3) == 0) {
-            if (sscanf(commande, "cp %s %s", param1, param2) == 2) {
-                copier_fichier(param1, param2);
-            } else {
-                erreur("Usage: cp <source> <destination>");
+                // Vérifier si le buffer peut contenir plus de texte
+                if (strlen(contenu) + strlen(ligne) + 1 < sizeof(contenu)) {
+                    strcat(contenu, ligne);
+                    strcat(contenu, "\n");
+                } else {
+                    erreur("Dépassement de la capacité du tampon !");
+                    break;
+                }
             }
+            donnees = contenu;
+        }
 
-        }else if (strncmp(commande, "chmod ", 6) == 0){
-    		char param1[256], param2[256];
-
-    	if (sscanf(commande, "chmod %255s %255s", param1, param2) == 2) {
-        	int inode_id = trouver_inode_par_nom(inode_courant, param1);
-        	if (inode_id == -1) {
-            		erreur("Fichier non trouvé");
-        	} else {
-                int nouveaux_droits ;
-
-                //convertir les droits en numéro pour pouvoir les modifier (ex rwx => 777)
-                nouveaux_droits = convertir_droits_char(param2);
-
-                	if (modifier_droits(inode_id, nouveaux_droits) == 0) {
-                    	printf("Droits du fichier '%s' modifiés avec succès.\n", param1);
-                    }else{
-                        printf("Erreur de modification des droits.\n");
-                    }
-            }
+        if (executer_commande(s, commande, donnees, strlen(contenu)) == COMMANDE_QUITTER) {
+            break;
+        }
 
-    } else {
-        erreur("Usage : chmod <nom_fichier> <droits>");
+        // Sauvegarder les modifications
+        debuter_operation(fs, 0);
+        sauvegarder_partition(fs);
+        terminer_operation(fs);
     }
 
-         }else if (strncmp(commande, "mv ", 3) == 0) {
-            if (sscanf(commande, "mv %s %s", param1, param2) == 2) {
-                deplacer_fichier(param1, param2);
-            } else {
-                erreur("Usage: mv <source> <destination>");
-            }
+    fermer_session(s);
+    return 0;
+}
 
-        }
- else if (strncmp(commande, "lns ", 4) == 0) {
-            if (sscanf(commande, "lns %s %s", param1, param2) == 2) {
-                creer_lien_symbolique(param1, param2);
-            } else {
-                erreur("Usage: lns <source> <destination>");
-            }
+/**
+ * Exécute un lot de commandes sans invite
+ * Les métadonnées sont sauvegardées à la fermeture de la partition, ou
+ * périodiquement selon les options.
+ * @param fs Le système de fichiers monté
+ * @param flux_script Le script à lire, ou NULL pour une liste -c
+ * @param script Le nom du script
+ * @param liste La liste de commandes séparées par ';', ou NULL
+ * @param options Les options du lot
+ * @return 0 si toutes les commandes ont réussi, SORTIE_ECHEC_COMMANDE
+ *         sinon, SORTIE_ERREUR si le lot n'a pas pu être exécuté
+ */
+static int executer_lot(SystemeFichiers* fs, FILE* flux_script, const char* script,
+                        const char* liste, const OptionsLot* options) {
+    Session* s = ouvrir_session(fs);
+    if (s == NULL) {
+        return SORTIE_ERREUR;
+    }
 
-        }else if (strncmp(commande, "ls -i", 5) == 0) {
-            char param1[MAX_NOM_FICHIER];  // Buffer pour le nom du fichier ou répertoire
+    // La sortie des commandes revient sur stdout, les erreurs sur stderr
+    rediriger_sortie(NULL);
+    int nb_echecs = flux_script ? executer_lot_flux(s, flux_script, script, options)
+                                : executer_lot_liste(s, liste, options);
+    fflush(stdout);
 
-            // Récupérer le nom du fichier ou répertoire dans la commande
-            if (sscanf(commande, "ls -i %s", param1) == 1) {
-                // Rechercher l'inode correspondant au fichier ou répertoire
-                Inode *inode = trouver_ind(param1);
+    fermer_session(s);
+    return nb_echecs == 0 ? 0 : SORTIE_ECHEC_COMMANDE;
+}
 
-                if (inode != NULL) {
-                    // Afficher l'inode trouvé en utilisant la fonction afficher_inode
-                    afficher_inode(inode);
-                } else {
-                    printf("Fichier ou répertoire '%s' non trouvé.\n", param1);
+int main(int argc, char* argv[]) {
+    const char* nom_partition = "partition.bin";
+    const char* chemin_socket = SOCKET_DEFAUT;
+    int mode_demon = 0;
+    int mode_client = 0;
+    int nb_travailleurs = NB_TRAVAILLEURS_DEFAUT;
+    const char* script = NULL;
+    const char* liste = NULL;
+    const char* fichier_trace = NULL;
+    OptionsLot options_lot = { 0 };
+    int verification = -1;
+
+    static const struct option options[] = {
+        { "demon",   no_argument,       NULL, 'd' },
+        { "client",  no_argument,       NULL, 'C' },
+        { "socket",  required_argument, NULL, 's' },
+        { "threads", required_argument, NULL, 't' },
+        { "partition",    required_argument, NULL, 'p' },
+        { "fichier",      required_argument, NULL, 'f' },
+        { "commandes",    required_argument, NULL, 'c' },
+        { "sauvegarde",   required_argument, NULL, 'n' },
+        { "arret-erreur", no_argument,       NULL, 'e' },
+        { "trace",        required_argument, NULL, 'T' },
+        { "es",           required_argument, NULL, 'E' },
+        { "sans-direct",  no_argument,       NULL, 'D' },
+        { "verifier-donnees", no_argument,   NULL, 'V' },
+        { "dedup",        no_argument,       NULL, 'u' },
+        { "verifier",     no_argument,       NULL, 'k' },
+        { "reparer",      no_argument,       NULL, 'K' },
+        { "help",    no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    int option;
+    while ((option = getopt_long(argc, argv, "dCs:t:p:f:c:n:eT:E:DVukKh", options, NULL)) != -1) {
+        switch (option) {
+            case 'd': mode_demon = 1; break;
+            case 'C': mode_client = 1; break;
+            case 's': chemin_socket = optarg; break;
+            case 't': nb_travailleurs = atoi(optarg); break;
+            case 'p': nom_partition = optarg; break;
+            case 'f': script = optarg; break;
+            case 'c': liste = optarg; break;
+            case 'n': options_lot.sauvegarde_tous = atoi(optarg); break;
+            case 'e': options_lot.arret_erreur = 1; break;
+            case 'T': fichier_trace = optarg; break;
+            case 'E':
+                if (type_moteur_es(optarg) == -1) {
+                    afficher_usage(argv[0]);
+                    return EXIT_FAILURE;
                 }
-            } else {
-                printf("Usage: ls -i <fichier_ou_répertoire>\n");
-            }
+                preferer_moteur_es(type_moteur_es(optarg));
+                break;
+            case 'D': utiliser_acces_direct(0); break;
+            case 'V': utiliser_verification_donnees(1); break;
+            case 'u': utiliser_deduplication(1); break;
+            case 'k': verification = 0; break;
+            case 'K': verification = VERIFIER_REPARER; break;
+            case 'h': afficher_usage(argv[0]); return 0;
+            default: afficher_usage(argv[0]); return EXIT_FAILURE;
         }
+    }
+    if (optind < argc) {
+        nom_partition = argv[optind++];
+    }
+    int mode_lot = script != NULL || liste != NULL;
+    if (optind < argc || mode_demon + mode_client + mode_lot + (verification != -1) > 1 || (script && liste)
+        || options_lot.sauvegarde_tous < 0) {
+        afficher_usage(argv[0]);
+        return mode_lot ? SORTIE_ERREUR : EXIT_FAILURE;
+    }
 
-        else if (strncmp(commande, "ln ", 3) == 0) {
-            if (sscanf(commande, "ln %s %s", param1, param2) == 2) {
-                creer_lien(param1, param2);
-            } else {
-                erreur("Usage: ln <source> <destination>");
-            }
+    // Le client ne monte pas la partition : le démon s'en charge
+    if (mode_client) {
+        return lancer_client(chemin_socket) == 0 ? 0 : EXIT_FAILURE;
+    }
 
-        } else if (strncmp(commande, "cat ", 4) == 0) {
-            char fichier[MAX_NOM_FICHIER], extra[10];
-            if (sscanf(commande, "cat %s %s", fichier, extra) == 1) {
-                int inode_id = trouver_inode_par_nom(inode_courant, fichier);
-                if (inode_id == -1) {
-                    erreur("Fichier non trouvé");
-                } else {
-                    char buffer[1024];
-                    int taille = inodes[inode_id].taille;
-                    int offset = 0;
-
-                    if (taille == 0) {
-                        printf("(Fichier vide)\n");
-                    } else {
-                        while (offset < taille) {
-                            int bytes_to_read = sizeof(buffer) - 1;
-                            if (offset + bytes_to_read > taille) {
-                                bytes_to_read = taille - offset;
-                            }
-
-                            int bytes_read = lire_fichier(inode_id, buffer, bytes_to_read, offset);
-                            if (bytes_read <= 0) {
-                                break;
-                            }
-
-                            buffer[bytes_read] = '\0';
-                            printf("%s", buffer);
-                            offset += bytes_read;
-                        }
-                        printf("\n");
-                    }
-                }
-            } else {
-                erreur("Usage: cat <nom_fichier>");
-            }
+    // La vérification hors ligne ne charge pas la partition pour l'utiliser
+    if (verification != -1) {
+        return verifier_partition_hors_ligne(nom_partition, verification) == 0 ? 0 : EXIT_FAILURE;
+    }
 
+    FILE* flux_script = NULL;
+    if (script) {
+        flux_script = strcmp(script, "-") == 0 ? stdin : fopen(script, "r");
+        if (flux_script == NULL) {
+            perror(script);
+            return SORTIE_ERREUR;
         }
-        else if (strncmp(commande, "save ", 5) == 0) {
-	    if (sscanf(commande, "save %s", param1) == 1) {
-		sauvegarder_etat(param1);
-	    } else {
-		erreur("Usage: save <nom_fichier>");
-	    }
-	}
-	else if (strncmp(commande, "load ", 5) == 0) {
-	    if (sscanf(commande, "load %s", param1) == 1) {
-		restaurer_etat(param1);
-	    } else {
-		erreur("Usage: load <nom_fichier>");
-	    }
-	}
-	else if (strncmp(commande, "defrag", 6) == 0) {
-    // Vérifier si la commande est suivie d'un espace
-    if (commande[6] == '\0' || commande[6] == ' ') {
-        printf("Contenu du bitmap avant défragmentation :\n");
-        afficher_bitmap(bitmap, NB_BLOCS);
-
-        defragmenter();  // Appeler la fonction de défragmentation sans argument
-
-        printf("Contenu du bitmap après défragmentation :\n");
-        afficher_bitmap(bitmap, NB_BLOCS);
-    } else {
-        erreur("Usage: defrag");
     }
-}
-        else if (strncmp(commande, "write ", 6) == 0) {
-            char fichier[MAX_NOM_FICHIER];
-            if (sscanf(commande, "write %s", fichier) == 1) {
-                int inode_id = trouver_inode_par_nom(inode_courant, fichier);
-                if (inode_id == -1) {
-                    erreur("Fichier non trouvé");
-                } else {
-                    // Vérifier que ce n'est pas un lien symbolique
-                    if (inodes[inode_id].type == TYPE_LIEN_SYMBOLIQUE ) {
-
-                        erreur("Impossible d'écrire dans un lien symbolique !");
-                    } else {
-                        if(inodes[inode_id].type == TYPE_REPERTOIRE) {
-                            printf("Impossible d'écrire dans un repertoire !");
-                        }else{
-                        printf("Entrez le contenu à écrire (terminez par une ligne vide) :\n");
-
-                        char buffer[1024] = {0};  // Initialise le buffer
-                        char ligne[1024];
-
-                        while (1) {
-                            printf("> ");
-                            if (fgets(ligne, sizeof(ligne), stdin) == NULL) {
-                                break;
-                            }
-
-                            // Supprimer le retour à la ligne
-                            ligne[strcspn(ligne, "\n")] = 0;
-
-                            // Ligne vide termine la saisie
-                            if (strlen(ligne) == 0) {
-                                break;
-                            }
-
-                            // Vérifier si le buffer peut contenir plus de texte
-                            if (strlen(buffer) + strlen(ligne) + 1 < sizeof(buffer)) {
-                                strcat(buffer, ligne);
-                                strcat(buffer, "\n");
-                            } else {
-                                erreur("Dépassement de la capacité du tampon !");
-                                break;
-                            }
-                        }
-
-                        // Écrire le contenu dans le fichier
-                        int taille = strlen(buffer);
-                        int resultat = ecrire_fichier(inode_id, buffer, taille, 0);
-
-                        if (resultat >= 0) {
-                            printf("Fichier écrit avec succès (%d octets).\n", taille);
-                        } else {
-                            erreur("Erreur lors de l'écriture du fichier");
-                        }
-                    }}
-                }
-            } else {
-                erreur("Usage: write <nom_fichier>");
-            }
 
-        } else if (strcmp(commande, "quit") == 0) {
-            break;
+    // En lot, la sortie standard ne reçoit que la sortie des commandes
+    if (mode_lot) {
+        rediriger_sortie(stderr);
+    }
 
-        } else {
-            printf("Commande inconnue. Tapez 'aide' pour voir les commandes disponibles.\n");
-        }
+    // Vérifier si la partition existe
+    SystemeFichiers* fs;
+    FILE* test = fopen(nom_partition, "rb");
+    if (test) {
+        fclose(test);
+        fprintf(flux_sortie(), "Chargement d'une partition existante...\n");
+        fs = charger_partition(nom_partition);
+    } else {
+        fprintf(flux_sortie(), "Création d'une nouvelle partition...\n");
+        fs = initialiser_partition(nom_partition);
+    }
+    if (fs == NULL || (fichier_trace && demarrer_trace_partition(fs, fichier_trace) != 0)) {
+        if (flux_script && flux_script != stdin) fclose(flux_script);
+        if (fs) fermer_partition(fs);
+        return mode_lot ? SORTIE_ERREUR : EXIT_FAILURE;
+    }
 
-        // Sauvegarder les modifications
-        sauvegarder_partition();
+    int resultat;
+    if (mode_lot) {
+        resultat = executer_lot(fs, flux_script, script, liste, &options_lot);
+        if (flux_script != NULL && flux_script != stdin) fclose(flux_script);
+    } else if (mode_demon) {
+        resultat = lancer_demon(fs, chemin_socket, nb_travailleurs);
+    } else {
+        resultat = interface_interactive(fs);
     }
 
     // Fermer la partition
-    if (partition_file) {
-        sauvegarder_partition();
-        fclose(partition_file);
+    if (mode_lot) {
+        rediriger_sortie(stderr);
     }
+    fermer_partition(fs);
 
-    printf("Au revoir !\n");
-    return 0;
+    if (mode_lot) {
+        return resultat;
+    }
+
+    if (!mode_demon) {
+        printf("Au revoir !\n");
+    }
+    return resultat == 0 ? 0 : EXIT_FAILURE;
 }
@@ -0,0 +1,289 @@
+#include <string.h>
+
+#include "metriques.h"
+#include "trace.h"
+
+/**
+ * Pourcentage d'implication :
+ * GOBALOUKICHENIN Bala : 33%
+ * DEHOUCHE Lisa : 33%
+ * GABITA William : 33%
+ *
+ * Compteurs et histogrammes de latence des opérations
+ */
+
+/* Noms des opérations, dans l'ordre de OperationMesuree */
+static const char* noms_operations[NB_OPERATIONS_MESUREES] = {
+    "creer_fichier", "trouver_inode_par_nom", "lire_fichier", "ecrire_fichier",
+    "supprimer_fichier", "creer_lien", "creer_lien_symbolique", "changer_repertoire",
+    "copier_fichier", "deplacer_fichier", "defragmenter", "synchroniser_tampons",
+    "sauvegarder_partition", "sauvegarder_etat", "restaurer_etat", "sauvegarder_instantane",
+    "restaurer_instantane", "supprimer_arbre", "copier_arbre", "afficher_occupation",
+    "afficher_arborescence", "rechercher_noms",
+};
+
+/* Noms des types d'accès, dans l'ordre de TypeAcces */
+static const char* noms_acces[NB_TYPES_ACCES] = { "lire_bloc", "ecrire_bloc" };
+
+/**
+ * Donne la tranche d'une valeur : 0 pour 0 et 1, puis le rang du bit de
+ * poids fort, borné à la dernière tranche
+ * @param valeur La valeur
+ * @param nb_tranches Le nombre de tranches
+ * @return La tranche
+ */
+static int tranche(uint64_t valeur, int nb_tranches) {
+    int rang = valeur > 1 ? 63 - __builtin_clzll(valeur) : 0;
+    return rang < nb_tranches ? rang : nb_tranches - 1;
+}
+
+/**
+ * Lit un compteur modifié par d'autres threads
+ */
+static uint64_t lire(const uint64_t* compteur) {
+    return __atomic_load_n(compteur, __ATOMIC_RELAXED);
+}
+
+/**
+ * Ajoute une valeur à un compteur partagé entre threads
+ */
+static void ajouter(uint64_t* compteur, uint64_t valeur) {
+    __atomic_add_fetch(compteur, valeur, __ATOMIC_RELAXED);
+}
+
+/**
+ * Enregistre la fin d'une opération
+ * @param m Les mesures de la partition
+ * @param operation L'opération
+ * @param debut_ns L'heure de début (horloge_ns)
+ * @param echec 1 si l'opération a échoué
+ * @param octets Les octets traités (négatif : aucun)
+ */
+void enregistrer_operation(Metriques* m, OperationMesuree operation, uint64_t debut_ns, int echec, long octets) {
+    uint64_t duree = horloge_ns() - debut_ns;
+    CompteurOperation* c = &m->operations[operation];
+
+    ajouter(&c->nb_appels, 1);
+    if (echec) {
+        ajouter(&c->nb_echecs, 1);
+    }
+    if (octets > 0) {
+        ajouter(&c->octets, octets);
+    }
+    ajouter(&c->duree_totale_ns, duree);
+    ajouter(&c->latences[tranche(duree, NB_TRANCHES_LATENCE)], 1);
+
+    uint64_t max = lire(&c->duree_max_ns);
+    while (duree > max && !__atomic_compare_exchange_n(&c->duree_max_ns, &max, duree, 1,
+                                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+/* Opération en cours dans le thread appelant */
+static __thread ContexteOperation contexte_courant = { TRACE_HORS_OPERATION, 0 };
+
+/**
+ * Enregistre un accès à la couche blocs
+ * @param m Les mesures de la partition
+ * @param trace La trace en cours (NULL : aucune)
+ * @param type Lecture ou écriture
+ * @param num_bloc Le bloc accédé
+ * @param octets Les octets transférés
+ */
+void enregistrer_acces_bloc(Metriques* m, Trace* trace, TypeAcces type, int num_bloc, long octets) {
+    CompteurBlocs* c = &m->blocs[type];
+    int precedent = __atomic_exchange_n(&m->dernier_bloc, num_bloc, __ATOMIC_RELAXED);
+    uint64_t distance = num_bloc > precedent ? num_bloc - precedent : precedent - num_bloc;
+
+    ajouter(&c->nb_acces, 1);
+    ajouter(&c->octets, octets);
+    ajouter(&c->distance_totale, distance);
+    // Tranche 0 : même bloc ; tranche 1 : bloc voisin ; puis puissances de 2
+    ajouter(&c->distances[distance == 0 ? 0 : tranche(distance, NB_TRANCHES_DISTANCE - 1) + 1], 1);
+
+    if (trace) {
+        tracer_evenement(trace, type, num_bloc, contexte_courant);
+    }
+}
+
+/**
+ * Marque le début d'une opération dans le thread appelant : les accès aux
+ * blocs qui suivent lui sont attribués dans la trace
+ * @param m Les mesures de la partition
+ * @param operation L'opération qui commence
+ * @return Le contexte précédent, à rendre à sortir_operation
+ */
+ContexteOperation entrer_operation(Metriques* m, OperationMesuree operation) {
+    ContexteOperation precedent = contexte_courant;
+    uint32_t numero = __atomic_add_fetch(&m->dernier_numero, 1, __ATOMIC_RELAXED);
+    contexte_courant.operation = operation;
+    contexte_courant.numero = numero ? numero : __atomic_add_fetch(&m->dernier_numero, 1, __ATOMIC_RELAXED);
+    return precedent;
+}
+
+/**
+ * Marque la fin de l'opération en cours du thread appelant
+ * @param precedent Le contexte rendu par entrer_operation
+ */
+void sortir_operation(ContexteOperation precedent) {
+    contexte_courant = precedent;
+}
+
+/**
+ * Donne le nom d'une opération mesurée
+ * @param operation L'opération (TRACE_HORS_OPERATION : hors opération)
+ * @return Le nom, ou "?" si l'opération est inconnue
+ */
+const char* nom_operation(int operation) {
+    if (operation == TRACE_HORS_OPERATION) {
+        return "hors_operation";
+    }
+    return operation >= 0 && operation < NB_OPERATIONS_MESUREES ? noms_operations[operation] : "?";
+}
+
+/**
+ * Remet toutes les mesures à zéro. L'appelant doit avoir l'exclusivité
+ * de la partition : aucune opération ne doit être en cours.
+ * @param m Les mesures de la partition
+ */
+void reinitialiser_metriques(Metriques* m) {
+    memset(m, 0, sizeof(Metriques));
+    m->debut = time(NULL);
+}
+
+/**
+ * Estime un percentile des latences d'une opération à partir de son
+ * histogramme : borne supérieure de la tranche qui le contient, sans
+ * dépasser la latence maximale observée
+ * @param c Les compteurs de l'opération
+ * @param rang Le percentile voulu (entre 0 et 1)
+ * @return La latence en nanosecondes (0 si aucun appel)
+ */
+static uint64_t percentile(const CompteurOperation* c, double rang) {
+    uint64_t total = 0;
+    for (int i = 0; i < NB_TRANCHES_LATENCE; i++) {
+        total += lire(&c->latences[i]);
+    }
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t cumul = 0;
+    for (int i = 0; i < NB_TRANCHES_LATENCE; i++) {
+        cumul += lire(&c->latences[i]);
+        if (cumul >= rang * total) {
+            uint64_t max = lire(&c->duree_max_ns);
+            return (2ULL << i) < max ? 2ULL << i : max;
+        }
+    }
+    return lire(&c->duree_max_ns);
+}
+
+/**
+ * Formate une durée avec l'unité la plus lisible
+ * @param ns La durée en nanosecondes
+ * @param texte Reçoit le texte (16 octets)
+ * @return texte
+ */
+static const char* formater_duree(double ns, char* texte) {
+    if (ns < 1e3) {
+        snprintf(texte, 16, "%.0f ns", ns);
+    } else if (ns < 1e6) {
+        snprintf(texte, 16, "%.1f µs", ns / 1e3);
+    } else if (ns < 1e9) {
+        snprintf(texte, 16, "%.1f ms", ns / 1e6);
+    } else {
+        snprintf(texte, 16, "%.2f s", ns / 1e9);
+    }
+    return texte;
+}
+
+/**
+ * Affiche les mesures sous forme de tableaux
+ * @param m Les mesures de la partition
+ * @param flux Le flux de sortie
+ */
+void afficher_metriques(const Metriques* m, FILE* flux) {
+    char moyenne[16], p50[16], p99[16], max[16];
+    fprintf(flux, "Mesures depuis %d s\n\n", (int)(time(NULL) - m->debut));
+    fprintf(flux, "%-24s %9s %7s %10s %10s %10s %10s %12s\n",
+            "Opération", "appels", "échecs", "moyenne", "p50 <=", "p99 <=", "max", "octets");
+    for (int i = 0; i < NB_OPERATIONS_MESUREES; i++) {
+        const CompteurOperation* c = &m->operations[i];
+        uint64_t appels = lire(&c->nb_appels);
+        if (appels == 0) {
+            continue;
+        }
+        fprintf(flux, "%-24s %9lu %7lu %10s %10s %10s %10s %12lu\n", noms_operations[i],
+                (unsigned long)appels, (unsigned long)lire(&c->nb_echecs),
+                formater_duree((double)lire(&c->duree_totale_ns) / appels, moyenne),
+                formater_duree(percentile(c, 0.50), p50), formater_duree(percentile(c, 0.99), p99),
+                formater_duree(lire(&c->duree_max_ns), max), (unsigned long)lire(&c->octets));
+    }
+
+    fprintf(flux, "\n%-24s %9s %12s %18s\n", "Couche blocs", "accès", "octets", "distance moyenne");
+    for (int i = 0; i < NB_TYPES_ACCES; i++) {
+        const CompteurBlocs* c = &m->blocs[i];
+        uint64_t acces = lire(&c->nb_acces);
+        fprintf(flux, "%-24s %9lu %12lu %18.1f\n", noms_acces[i], (unsigned long)acces,
+                (unsigned long)lire(&c->octets), acces ? (double)lire(&c->distance_totale) / acces : 0.0);
+    }
+
+    fprintf(flux, "\nDistances (blocs) :");
+    for (int t = 0; t < NB_TRANCHES_DISTANCE; t++) {
+        uint64_t n = lire(&m->blocs[ACCES_LECTURE].distances[t]) + lire(&m->blocs[ACCES_ECRITURE].distances[t]);
+        if (n == 0) {
+            continue;
+        }
+        if (t <= 1) {
+            fprintf(flux, " %d:%lu", t, (unsigned long)n);
+        } else {
+            fprintf(flux, " %d-%d:%lu", 1 << (t - 1), (1 << t) - 1, (unsigned long)n);
+        }
+    }
+    fprintf(flux, "\n");
+}
+
+/**
+ * Écrit un tableau JSON de compteurs
+ */
+static void ecrire_tableau_json(FILE* flux, const uint64_t* valeurs, int nb) {
+    fprintf(flux, "[");
+    for (int i = 0; i < nb; i++) {
+        fprintf(flux, "%s%lu", i ? ", " : "", (unsigned long)lire(&valeurs[i]));
+    }
+    fprintf(flux, "]");
+}
+
+/**
+ * Écrit toutes les mesures au format JSON. Tranches de latence : la
+ * tranche i compte les appels de durée comprise entre 2^i et 2^(i+1) ns.
+ * Tranches de distance : 0 (même bloc), 1 (bloc voisin), puis la tranche
+ * i compte les distances comprises entre 2^(i-1) et 2^i - 1 blocs.
+ * @param m Les mesures de la partition
+ * @param flux Le flux de sortie
+ */
+void ecrire_metriques_json(const Metriques* m, FILE* flux) {
+    fprintf(flux, "{\n  \"depuis\": %lld,\n  \"duree_s\": %lld,\n  \"operations\": {\n",
+            (long long)m->debut, (long long)(time(NULL) - m->debut));
+    for (int i = 0; i < NB_OPERATIONS_MESUREES; i++) {
+        const CompteurOperation* c = &m->operations[i];
+        fprintf(flux, "    \"%s\": {\"appels\": %lu, \"echecs\": %lu, \"octets\": %lu, "
+                      "\"duree_totale_ns\": %lu, \"duree_max_ns\": %lu, \"p50_ns\": %lu, \"p99_ns\": %lu, "
+                      "\"tranches_latence_ns\": ",
+                noms_operations[i], (unsigned long)lire(&c->nb_appels), (unsigned long)lire(&c->nb_echecs),
+                (unsigned long)lire(&c->octets), (unsigned long)lire(&c->duree_totale_ns),
+                (unsigned long)lire(&c->duree_max_ns),
+                (unsigned long)percentile(c, 0.50), (unsigned long)percentile(c, 0.99));
+        ecrire_tableau_json(flux, c->latences, NB_TRANCHES_LATENCE);
+        fprintf(flux, "}%s\n", i + 1 < NB_OPERATIONS_MESUREES ? "," : "");
+    }
+    fprintf(flux, "  },\n  \"blocs\": {\n");
+    for (int i = 0; i < NB_TYPES_ACCES; i++) {
+        const CompteurBlocs* c = &m->blocs[i];
+        fprintf(flux, "    \"%s\": {\"acces\": %lu, \"octets\": %lu, \"distance_totale\": %lu, \"tranches_distance\": ",
+                noms_acces[i], (unsigned long)lire(&c->nb_acces), (unsigned long)lire(&c->octets),
+                (unsigned long)lire(&c->distance_totale));
+        ecrire_tableau_json(flux, c->distances, NB_TRANCHES_DISTANCE);
+        fprintf(flux, "}%s\n", i + 1 < NB_TYPES_ACCES ? "," : "");
+    }
+    fprintf(flux, "  }\n}\n");
+}
@@ -0,0 +1,154 @@
+/**
+ * @file metriques.h
+ * @brief Compteurs et histogrammes de latence des opérations
+ *
+ * Chaque opération publique du système de fichiers (création, recherche,
+ * lecture, écriture...) compte ses appels, ses échecs, les octets traités
+ * et la répartition de ses latences par tranches de puissances de 2
+ * (nanosecondes). La couche blocs (lire_bloc / ecrire_bloc) compte ses
+ * accès, ses octets et la distance parcourue depuis le bloc précédemment
+ * accédé.
+ *
+ * Les mesures n'existent que si le programme est compilé avec -DMETRIQUES
+ * (option par défaut du Makefile, retirée par make METRIQUES=0) : sinon
+ * les macros de mesure ne produisent aucun code et le contexte de la
+ * partition ne contient aucun compteur.
+ *
+ * Les compteurs sont mis à jour par des opérations atomiques relâchées :
+ * plusieurs threads peuvent mesurer en même temps sans verrou. Quand une
+ * trace est en cours (voir trace.h), chaque accès aux blocs y est aussi
+ * enregistré avec l'opération qui l'a provoqué.
+ */
+
+#ifndef METRIQUES_H
+#define METRIQUES_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+#define NB_TRANCHES_LATENCE 32    // Tranche i : [2^i, 2^(i+1)) ns, la dernière est ouverte
+#define NB_TRANCHES_DISTANCE 16   // Tranche 0 : même bloc, tranche i : [2^(i-1), 2^i) blocs
+
+/**
+ * @brief Opérations mesurées
+ */
+typedef enum {
+    MESURE_CREER,                 // creer_fichier
+    MESURE_CHERCHER,              // trouver_inode_par_nom
+    MESURE_LIRE,                  // lire_fichier
+    MESURE_ECRIRE,                // ecrire_fichier
+    MESURE_SUPPRIMER,             // supprimer_fichier
+    MESURE_LIEN,                  // creer_lien
+    MESURE_LIEN_SYMBOLIQUE,       // creer_lien_symbolique
+    MESURE_CD,                    // changer_repertoire
+    MESURE_COPIER,                // copier_fichier
+    MESURE_DEPLACER,              // deplacer_fichier
+    MESURE_DEFRAG,                // defragmenter
+    MESURE_SYNCHRONISER,          // synchroniser_tampons
+    MESURE_SAUVEGARDE_PARTITION,  // sauvegarder_partition
+    MESURE_SAUVEGARDE_ETAT,       // sauvegarder_etat
+    MESURE_RESTAURATION_ETAT,     // restaurer_etat
+    MESURE_INSTANTANE,            // sauvegarder_instantane
+    MESURE_RESTAURATION_INSTANTANE, // restaurer_instantane
+    MESURE_SUPPRIMER_ARBRE,       // supprimer_arbre
+    MESURE_COPIER_ARBRE,          // copier_arbre
+    MESURE_OCCUPATION,            // afficher_occupation
+    MESURE_ARBORESCENCE,          // afficher_arborescence
+    MESURE_RECHERCHE,             // rechercher_noms
+    NB_OPERATIONS_MESUREES
+} OperationMesuree;
+
+/**
+ * @brief Types d'accès à la couche blocs
+ */
+typedef enum {
+    ACCES_LECTURE,                // lire_bloc
+    ACCES_ECRITURE,               // ecrire_bloc
+    NB_TYPES_ACCES
+} TypeAcces;
+
+/**
+ * @brief Compteurs d'une opération
+ */
+typedef struct {
+    uint64_t nb_appels;
+    uint64_t nb_echecs;           // Appels ayant rendu une valeur négative ou signalé une erreur
+    uint64_t octets;              // Octets lus ou écrits (lire_fichier, ecrire_fichier)
+    uint64_t duree_totale_ns;
+    uint64_t duree_max_ns;
+    uint64_t latences[NB_TRANCHES_LATENCE];
+} CompteurOperation;
+
+/**
+ * @brief Compteurs d'un type d'accès aux blocs
+ */
+typedef struct {
+    uint64_t nb_acces;
+    uint64_t octets;
+    uint64_t distance_totale;     // Somme des distances au bloc accédé précédemment
+    uint64_t distances[NB_TRANCHES_DISTANCE];
+} CompteurBlocs;
+
+/**
+ * @brief Ensemble des mesures d'une partition
+ */
+typedef struct {
+    CompteurOperation operations[NB_OPERATIONS_MESUREES];
+    CompteurBlocs blocs[NB_TYPES_ACCES];
+    int dernier_bloc;             // Dernier bloc accédé (lecture ou écriture)
+    uint32_t dernier_numero;      // Numéro du dernier appel d'opération
+    int64_t debut;                // Date de la dernière remise à zéro
+} Metriques;
+
+/**
+ * @brief Opération en cours dans un thread (la plus interne si elles
+ * s'imbriquent, par exemple lire_fichier appelé par copier_fichier)
+ */
+typedef struct {
+    uint8_t operation;            // OperationMesuree, ou TRACE_HORS_OPERATION
+    uint32_t numero;              // Numéro de l'appel (0 : hors opération)
+} ContexteOperation;
+
+typedef struct Trace Trace;       // Enregistrement en cours (voir trace.h)
+
+/**
+ * Donne l'heure de l'horloge monotone en nanosecondes
+ */
+static inline uint64_t horloge_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+#ifdef METRIQUES
+/* Début d'une mesure : retient l'heure, le nombre d'erreurs du thread et
+   l'opération englobante */
+#define DEBUT_MESURE(fs, operation, debut) \
+    uint64_t debut = horloge_ns(); \
+    int debut##_erreurs __attribute__((unused)) = nb_erreurs(); \
+    ContexteOperation debut##_contexte = entrer_operation(&(fs)->metriques, operation)
+/* Fin d'une mesure : l'opération échoue si 'resultat' est négatif ou si une erreur a été signalée */
+#define FIN_MESURE(fs, operation, debut, resultat, octets) \
+    (sortir_operation(debut##_contexte), \
+     enregistrer_operation(&(fs)->metriques, operation, debut, \
+                           (resultat) < 0 || nb_erreurs() > debut##_erreurs, octets))
+#define MESURER_ACCES_BLOC(fs, type, num_bloc, octets) \
+    enregistrer_acces_bloc(&(fs)->metriques, (fs)->trace, type, num_bloc, octets)
+#else
+#define DEBUT_MESURE(fs, operation, debut)
+#define FIN_MESURE(fs, operation, debut, resultat, octets) ((void)0)
+#define MESURER_ACCES_BLOC(fs, type, num_bloc, octets) ((void)0)
+#endif
+
+/* Mise à jour et consultation des mesures */
+void enregistrer_operation(Metriques* m, OperationMesuree operation, uint64_t debut_ns, int echec, long octets);
+void enregistrer_acces_bloc(Metriques* m, Trace* trace, TypeAcces type, int num_bloc, long octets);
+ContexteOperation entrer_operation(Metriques* m, OperationMesuree operation);
+void sortir_operation(ContexteOperation precedent);
+const char* nom_operation(int operation);
+void reinitialiser_metriques(Metriques* m);
+void afficher_metriques(const Metriques* m, FILE* flux);
+void ecrire_metriques_json(const Metriques* m, FILE* flux);
+
+#endif // METRIQUES_H
@@ -0,0 +1,409 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include "moteur_es.h"
+#include "file_system.h"
+
+/**
+ * Pourcentage d'implication :
+ * GOBALOUKICHENIN Bala : 33%
+ * DEHOUCHE Lisa : 33%
+ * GABITA William : 33%
+ *
+ * Moteur d'entrées-sorties asynchrones : io_uring ou groupe de threads
+ */
+
+/**
+ * @brief Requête confiée aux threads du moteur de repli
+ */
+typedef struct {
+    RequeteES* requete;
+    int* restantes;                       // Requêtes du lot pas encore terminées
+} TacheES;
+
+/**
+ * @brief Moteur ouvert sur un fichier
+ */
+struct MoteurES {
+    TypeMoteurES type;
+    int descripteur;
+    int descripteur_direct;               // -1 : pas d'accès direct
+    pthread_mutex_t verrou;               // io_uring : un lot à la fois ; threads : la file
+
+    /* io_uring : anneaux partagés avec le noyau */
+    int anneau;
+    unsigned nb_entrees;
+    void* zone_soumission;
+    size_t taille_soumission;
+    void* zone_fin;
+    size_t taille_fin;
+    struct io_uring_sqe* sqes;
+    size_t taille_sqes;
+    unsigned* sq_tete;
+    unsigned* sq_queue;
+    unsigned* sq_masque;
+    unsigned* sq_tableau;
+    unsigned* cq_tete;
+    unsigned* cq_queue;
+    unsigned* cq_masque;
+    struct io_uring_cqe* cqes;
+
+    /* Groupe de threads */
+    pthread_t fils[NB_FILS_ES];
+    int nb_fils;
+    int arret;
+    pthread_cond_t tache_disponible;
+    pthread_cond_t tache_terminee;
+    TacheES file[CAPACITE_FILE_ES];
+    int premiere_tache;
+    int nb_taches;
+};
+
+/* Moteur choisi pour les prochaines partitions ouvertes */
+static TypeMoteurES moteur_prefere = MOTEUR_AUTO;
+
+/**
+ * Choisit le moteur des partitions ouvertes par la suite. Si io_uring est
+ * demandé mais indisponible, le groupe de threads est utilisé.
+ * @param type Le moteur
+ */
+void preferer_moteur_es(TypeMoteurES type) {
+    moteur_prefere = type;
+}
+
+/**
+ * Donne le moteur désigné par un nom (auto, io_uring, threads, synchrone)
+ * @param nom Le nom
+ * @return Le moteur, ou -1 si le nom est inconnu
+ */
+int type_moteur_es(const char* nom) {
+    static const char* noms[] = { "auto", "io_uring", "threads", "synchrone" };
+    for (int i = 0; i < (int)(sizeof(noms) / sizeof(noms[0])); i++) {
+        if (strcmp(nom, noms[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Donne le nom du moteur utilisé
+ * @param m Le moteur
+ * @return Le nom
+ */
+const char* nom_moteur_es(const MoteurES* m) {
+    switch (m->type) {
+        case MOTEUR_IO_URING: return "io_uring";
+        case MOTEUR_THREADS: return "threads";
+        default: return "synchrone";
+    }
+}
+
+/**
+ * Choisit le descripteur d'une requête : l'accès direct si la position,
+ * les buffers et les tailles sont alignés
+ * @param m Le moteur
+ * @param r La requête
+ * @return Le descripteur
+ */
+static int descripteur_requete(const MoteurES* m, const RequeteES* r) {
+    if (m->descripteur_direct == -1 || r->offset % ALIGNEMENT_DIRECT != 0) {
+        return m->descripteur;
+    }
+    for (int v = 0; v < r->nb_vecteurs; v++) {
+        if ((uintptr_t)r->vecteurs[v].iov_base % ALIGNEMENT_DIRECT != 0
+                || r->vecteurs[v].iov_len % ALIGNEMENT_DIRECT != 0) {
+            return m->descripteur;
+        }
+    }
+    return m->descripteur_direct;
+}
+
+/**
+ * Exécute une requête avec preadv / pwritev
+ * @param descripteur Le fichier
+ * @param r La requête
+ * @return Les octets transférés, ou -errno
+ */
+static ssize_t executer_requete(int descripteur, const RequeteES* r) {
+    ssize_t n;
+    do {
+        n = r->ecriture ? pwritev(descripteur, r->vecteurs, r->nb_vecteurs, r->offset)
+                        : preadv(descripteur, r->vecteurs, r->nb_vecteurs, r->offset);
+    } while (n < 0 && errno == EINTR);
+    return n < 0 ? -errno : n;
+}
+
+/**
+ * Ouvre les anneaux io_uring du moteur
+ * @param m Le moteur
+ * @return 0 si succès, -1 si le noyau ne le permet pas
+ */
+static int ouvrir_io_uring(MoteurES* m) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    int anneau = syscall(__NR_io_uring_setup, PROFONDEUR_ES, &p);
+    if (anneau < 0) {
+        return -1;
+    }
+
+    m->taille_soumission = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    m->taille_fin = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    m->taille_sqes = p.sq_entries * sizeof(struct io_uring_sqe);
+    m->zone_soumission = mmap(NULL, m->taille_soumission, PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_POPULATE, anneau, IORING_OFF_SQ_RING);
+    m->zone_fin = mmap(NULL, m->taille_fin, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, anneau, IORING_OFF_CQ_RING);
+    m->sqes = mmap(NULL, m->taille_sqes, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, anneau, IORING_OFF_SQES);
+    if (m->zone_soumission == MAP_FAILED || m->zone_fin == MAP_FAILED || m->sqes == MAP_FAILED) {
+        if (m->zone_soumission != MAP_FAILED) munmap(m->zone_soumission, m->taille_soumission);
+        if (m->zone_fin != MAP_FAILED) munmap(m->zone_fin, m->taille_fin);
+        if (m->sqes != MAP_FAILED) munmap(m->sqes, m->taille_sqes);
+        close(anneau);
+        return -1;
+    }
+
+    char* sq = m->zone_soumission;
+    char* cq = m->zone_fin;
+    m->sq_tete = (unsigned*)(sq + p.sq_off.head);
+    m->sq_queue = (unsigned*)(sq + p.sq_off.tail);
+    m->sq_masque = (unsigned*)(sq + p.sq_off.ring_mask);
+    m->sq_tableau = (unsigned*)(sq + p.sq_off.array);
+    m->cq_tete = (unsigned*)(cq + p.cq_off.head);
+    m->cq_queue = (unsigned*)(cq + p.cq_off.tail);
+    m->cq_masque = (unsigned*)(cq + p.cq_off.ring_mask);
+    m->cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+    m->anneau = anneau;
+    m->nb_entrees = p.sq_entries;
+    return 0;
+}
+
+/**
+ * Exécute un lot avec io_uring : les requêtes sont soumises par paquets
+ * de la taille de l'anneau, les suivantes dès que des places se libèrent
+ * @param m Le moteur
+ * @param requetes Les requêtes
+ * @param nb Nombre de requêtes
+ */
+static void executer_io_uring(MoteurES* m, RequeteES* requetes, int nb) {
+    int soumises = 0, terminees = 0;
+
+    pthread_mutex_lock(&m->verrou);
+    while (terminees < nb) {
+        // Remplir l'anneau de soumission (seul ce thread écrit sa queue)
+        unsigned queue = *m->sq_queue;
+        while (soumises < nb && soumises - terminees < (int)m->nb_entrees) {
+            RequeteES* r = &requetes[soumises];
+            unsigned index = queue & *m->sq_masque;
+            struct io_uring_sqe* sqe = &m->sqes[index];
+            memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = r->ecriture ? IORING_OP_WRITEV : IORING_OP_READV;
+            sqe->fd = descripteur_requete(m, r);
+            sqe->addr = (uint64_t)(uintptr_t)r->vecteurs;
+            sqe->len = r->nb_vecteurs;
+            sqe->off = r->offset;
+            sqe->user_data = soumises;
+            m->sq_tableau[index] = index;
+            queue++;
+            soumises++;
+        }
+        __atomic_store_n(m->sq_queue, queue, __ATOMIC_RELEASE);
+
+        // Soumettre ce que le noyau n'a pas encore pris, attendre une fin
+        unsigned a_soumettre = queue - __atomic_load_n(m->sq_tete, __ATOMIC_ACQUIRE);
+        if (syscall(__NR_io_uring_enter, m->anneau, a_soumettre, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0
+                && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            // Refus du noyau : les requêtes qu'il n'a pas prises échouent
+            int code = errno;
+            unsigned prises = __atomic_load_n(m->sq_tete, __ATOMIC_ACQUIRE);
+            for (unsigned k = prises; k != queue; k++) {
+                requetes[soumises - (queue - k)].resultat = -code;
+                terminees++;
+            }
+            __atomic_store_n(m->sq_queue, prises, __ATOMIC_RELEASE);
+        }
+
+        // Relever les fins
+        unsigned tete = *m->cq_tete;
+        while (tete != __atomic_load_n(m->cq_queue, __ATOMIC_ACQUIRE)) {
+            struct io_uring_cqe* cqe = &m->cqes[tete & *m->cq_masque];
+            requetes[cqe->user_data].resultat = cqe->res;
+            tete++;
+            terminees++;
+        }
+        __atomic_store_n(m->cq_tete, tete, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&m->verrou);
+}
+
+/**
+ * Boucle d'un thread du moteur de repli : exécute les requêtes de la
+ * file jusqu'à la demande d'arrêt
+ * @param argument Le moteur
+ */
+static void* executer_taches(void* argument) {
+    MoteurES* m = argument;
+
+    pthread_mutex_lock(&m->verrou);
+    while (1) {
+        while (m->nb_taches == 0 && !m->arret) {
+            pthread_cond_wait(&m->tache_disponible, &m->verrou);
+        }
+        if (m->nb_taches == 0) {
+            break;
+        }
+        TacheES tache = m->file[m->premiere_tache];
+        m->premiere_tache = (m->premiere_tache + 1) % CAPACITE_FILE_ES;
+        m->nb_taches--;
+        pthread_mutex_unlock(&m->verrou);
+
+        tache.requete->resultat = executer_requete(descripteur_requete(m, tache.requete), tache.requete);
+
+        pthread_mutex_lock(&m->verrou);
+        (*tache.restantes)--;
+        pthread_cond_broadcast(&m->tache_terminee);
+    }
+    pthread_mutex_unlock(&m->verrou);
+    return NULL;
+}
+
+/**
+ * Exécute un lot avec le groupe de threads
+ * @param m Le moteur
+ * @param requetes Les requêtes
+ * @param nb Nombre de requêtes
+ */
+static void executer_threads(MoteurES* m, RequeteES* requetes, int nb) {
+    int restantes = nb;
+
+    pthread_mutex_lock(&m->verrou);
+    for (int i = 0; i < nb; i++) {
+        while (m->nb_taches == CAPACITE_FILE_ES) {
+            pthread_cond_wait(&m->tache_terminee, &m->verrou);
+        }
+        int position = (m->premiere_tache + m->nb_taches) % CAPACITE_FILE_ES;
+        m->file[position].requete = &requetes[i];
+        m->file[position].restantes = &restantes;
+        m->nb_taches++;
+        pthread_cond_signal(&m->tache_disponible);
+    }
+    while (restantes > 0) {
+        pthread_cond_wait(&m->tache_terminee, &m->verrou);
+    }
+    pthread_mutex_unlock(&m->verrou);
+}
+
+/**
+ * Exécute un lot de requêtes et attend qu'elles soient toutes terminées.
+ * Le résultat de chacune est rangé dans son champ 'resultat' ; une
+ * requête peut n'avoir transféré qu'une partie de sa zone.
+ * @param m Le moteur
+ * @param requetes Les requêtes
+ * @param nb Nombre de requêtes
+ * @return 0 si toutes ont transféré leur zone entière, -1 sinon
+ */
+int executer_requetes(MoteurES* m, RequeteES* requetes, int nb) {
+    if (m->type == MOTEUR_IO_URING && nb > 0) {
+        executer_io_uring(m, requetes, nb);
+    } else if (m->type == MOTEUR_THREADS && nb > 1) {
+        executer_threads(m, requetes, nb);
+    } else {
+        // Une requête seule n'a pas à attendre un autre thread
+        for (int i = 0; i < nb; i++) {
+            requetes[i].resultat = executer_requete(descripteur_requete(m, &requetes[i]), &requetes[i]);
+        }
+    }
+
+    // Accès direct refusé par le système de fichiers : refaire la requête
+    // en passant par le cache du noyau
+    for (int i = 0; i < nb; i++) {
+        if (requetes[i].resultat == -EINVAL && descripteur_requete(m, &requetes[i]) != m->descripteur) {
+            requetes[i].resultat = executer_requete(m->descripteur, &requetes[i]);
+        }
+    }
+
+    int resultat = 0;
+    for (int i = 0; i < nb; i++) {
+        size_t attendu = 0;
+        for (int v = 0; v < requetes[i].nb_vecteurs; v++) {
+            attendu += requetes[i].vecteurs[v].iov_len;
+        }
+        if (requetes[i].resultat < 0 || (size_t)requetes[i].resultat != attendu) {
+            resultat = -1;
+        }
+    }
+    return resultat;
+}
+
+/**
+ * Crée le moteur d'entrées-sorties d'un fichier, selon le moteur préféré
+ * (voir preferer_moteur_es) et ce que le système permet
+ * @param descripteur Le fichier
+ * @param descripteur_direct Le même fichier ouvert avec O_DIRECT, ou -1
+ * @return Le moteur, ou NULL si erreur
+ */
+MoteurES* creer_moteur_es(int descripteur, int descripteur_direct) {
+    MoteurES* m = calloc(1, sizeof(MoteurES));
+    if (!m) {
+        erreur("Mémoire insuffisante");
+        return NULL;
+    }
+    m->descripteur = descripteur;
+    m->descripteur_direct = descripteur_direct;
+    m->anneau = -1;
+    pthread_mutex_init(&m->verrou, NULL);
+    pthread_cond_init(&m->tache_disponible, NULL);
+    pthread_cond_init(&m->tache_terminee, NULL);
+
+    m->type = MOTEUR_SYNCHRONE;
+    if ((moteur_prefere == MOTEUR_AUTO || moteur_prefere == MOTEUR_IO_URING) && ouvrir_io_uring(m) == 0) {
+        m->type = MOTEUR_IO_URING;
+    } else if (moteur_prefere != MOTEUR_SYNCHRONE) {
+        while (m->nb_fils < NB_FILS_ES
+               && pthread_create(&m->fils[m->nb_fils], NULL, executer_taches, m) == 0) {
+            m->nb_fils++;
+        }
+        if (m->nb_fils > 0) {
+            m->type = MOTEUR_THREADS;
+        }
+    }
+    return m;
+}
+
+/**
+ * Arrête le moteur et le libère. Aucun lot ne doit être en cours.
+ * @param m Le moteur (peut être NULL)
+ */
+void detruire_moteur_es(MoteurES* m) {
+    if (m == NULL) {
+        return;
+    }
+    if (m->nb_fils > 0) {
+        pthread_mutex_lock(&m->verrou);
+        m->arret = 1;
+        pthread_cond_broadcast(&m->tache_disponible);
+        pthread_mutex_unlock(&m->verrou);
+        for (int i = 0; i < m->nb_fils; i++) {
+            pthread_join(m->fils[i], NULL);
+        }
+    }
+    if (m->anneau != -1) {
+        munmap(m->sqes, m->taille_sqes);
+        munmap(m->zone_fin, m->taille_fin);
+        munmap(m->zone_soumission, m->taille_soumission);
+        close(m->anneau);
+    }
+    pthread_mutex_destroy(&m->verrou);
+    pthread_cond_destroy(&m->tache_disponible);
+    pthread_cond_destroy(&m->tache_terminee);
+    free(m);
+}
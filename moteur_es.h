@@ -0,0 +1,62 @@
+/**
+ * @file moteur_es.h
+ * @brief Entrées-sorties asynchrones sur le fichier de partition
+ *
+ * Un lot de requêtes (lectures ou écritures vectorielles) est soumis en
+ * une seule fois : toutes les requêtes du lot sont en cours en même temps
+ * et l'appel rend la main quand elles sont toutes terminées. Le moteur
+ * utilise io_uring quand le noyau le permet (détecté à l'exécution, par
+ * appels système directs), sinon un groupe de threads qui font les
+ * preadv / pwritev. En dernier recours, les requêtes sont exécutées l'une
+ * après l'autre par l'appelant.
+ *
+ * Si le fichier est aussi ouvert avec O_DIRECT, les requêtes dont la
+ * position, les buffers et les tailles sont alignés passent par ce
+ * descripteur, sans le cache du noyau.
+ */
+
+#ifndef MOTEUR_ES_H
+#define MOTEUR_ES_H
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#define ALIGNEMENT_DIRECT 4096            // Alignement des positions, buffers et tailles en O_DIRECT
+#define PROFONDEUR_ES 64                  // Requêtes en cours au plus dans io_uring
+#define NB_FILS_ES 4                      // Threads du moteur de repli
+#define CAPACITE_FILE_ES 256              // Requêtes en attente des threads
+
+/**
+ * @brief Moteurs disponibles
+ */
+typedef enum {
+    MOTEUR_AUTO,                          // io_uring si possible, sinon threads
+    MOTEUR_IO_URING,
+    MOTEUR_THREADS,
+    MOTEUR_SYNCHRONE                      // Exécution par l'appelant
+} TypeMoteurES;
+
+/**
+ * @brief Lecture ou écriture vectorielle d'une zone du fichier
+ */
+typedef struct {
+    int ecriture;                         // 1 : écriture, 0 : lecture
+    const struct iovec* vecteurs;         // Buffers, dans l'ordre du fichier
+    int nb_vecteurs;
+    off_t offset;                         // Position dans le fichier
+    ssize_t resultat;                     // Octets transférés, ou -errno
+} RequeteES;
+
+typedef struct MoteurES MoteurES;
+
+/* Création et destruction */
+void preferer_moteur_es(TypeMoteurES type);
+int type_moteur_es(const char* nom);
+MoteurES* creer_moteur_es(int descripteur, int descripteur_direct);
+void detruire_moteur_es(MoteurES* m);
+
+/* Exécution d'un lot */
+int executer_requetes(MoteurES* m, RequeteES* requetes, int nb);
+const char* nom_moteur_es(const MoteurES* m);
+
+#endif // MOTEUR_ES_H
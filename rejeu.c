@@ -0,0 +1,540 @@
+#include <getopt.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "file_system.h"
+#include "trace.h"
+
+/**
+ * Pourcentage d'implication :
+ * GOBALOUKICHENIN Bala : 33%
+ * DEHOUCHE Lisa : 33%
+ * GABITA William : 33%
+ *
+ * Rejeu d'une trace d'accès aux blocs
+ *
+ * Relit une trace enregistrée par la commande trace (ou l'option -T du
+ * gestionnaire) et refait ses lectures et écritures de blocs, dans l'ordre
+ * du fichier, sur une copie de la partition. Le moyen d'accès au fichier
+ * (pread/pwrite ou projection mmap), la taille d'un cache LRU de blocs et
+ * la lecture anticipée sont au choix, pour comparer plusieurs réglages sur
+ * exactement la même suite d'accès. Les écritures rejouées contiennent des
+ * octets fictifs : la copie n'est plus une partition utilisable ensuite.
+ */
+
+/**
+ * @brief Moyens d'accès au fichier de partition
+ */
+typedef enum {
+    BACKEND_PREAD,                 // pread / pwrite, un appel système par accès manqué
+    BACKEND_MMAP,                  // Projection de toute la partition, copies mémoire
+    NB_BACKENDS
+} Backend;
+
+static const char* noms_backends[NB_BACKENDS] = { "pread", "mmap" };
+
+/**
+ * @brief Case du cache LRU de blocs
+ */
+typedef struct {
+    int bloc;                      // Bloc contenu (-1 : case libre)
+    int precedent;                 // Case utilisée plus récemment (-1 : aucune)
+    int suivant;                   // Case utilisée moins récemment (-1 : aucune)
+} CaseCache;
+
+/**
+ * @brief Compteurs d'une opération de la trace
+ */
+typedef struct {
+    uint64_t nb_acces;
+    uint64_t nb_succes_cache;
+    uint64_t duree_ns;
+} CompteurRejeu;
+
+/**
+ * @brief État du rejeu
+ */
+typedef struct {
+    Backend backend;
+    int descripteur;
+    char* projection;              // Partition projetée (BACKEND_MMAP)
+    uint32_t taille_bloc;
+    uint32_t nb_blocs;
+
+    int capacite_cache;            // Blocs du cache (0 : pas de cache)
+    int lecture_anticipee;         // Blocs lus en plus après un défaut séquentiel
+    CaseCache* cases;
+    char* donnees_cache;           // capacite_cache blocs
+    int* case_du_bloc;             // Case de chaque bloc (-1 : absent du cache)
+    int plus_recente;
+    int plus_ancienne;
+    int nb_cases_utilisees;
+    int dernier_defaut;            // Dernier bloc lu sur le disque
+
+    char* tampon;                  // (1 + lecture_anticipee) blocs
+
+    uint64_t nb_lectures;
+    uint64_t nb_ecritures;
+    uint64_t nb_succes_cache;
+    uint64_t appels_systeme;
+    uint64_t octets_lus_disque;
+    uint64_t octets_ecrits_disque;
+    CompteurRejeu operations[256];
+} Rejeu;
+
+/**
+ * Lit une trace entière en mémoire
+ * @param chemin Le fichier de trace
+ * @param entete Reçoit l'en-tête
+ * @param nb_evenements Reçoit le nombre d'événements
+ * @return Les événements (à libérer), ou NULL si erreur
+ */
+static EvenementTrace* charger_trace(const char* chemin, EnteteTrace* entete, size_t* nb_evenements) {
+    FILE* f = fopen(chemin, "rb");
+    if (!f) {
+        perror(chemin);
+        return NULL;
+    }
+    if (fread(entete, sizeof(EnteteTrace), 1, f) != 1
+        || memcmp(entete->signature, SIGNATURE_TRACE, sizeof(SIGNATURE_TRACE)) != 0) {
+        fprintf(stderr, "%s : ce n'est pas un fichier de trace\n", chemin);
+        fclose(f);
+        return NULL;
+    }
+    if (entete->version != VERSION_TRACE || entete->taille_evenement != sizeof(EvenementTrace)) {
+        fprintf(stderr, "%s : version de trace %u non prise en charge\n", chemin, entete->version);
+        fclose(f);
+        return NULL;
+    }
+
+    struct stat infos;
+    fstat(fileno(f), &infos);
+    size_t nb = (infos.st_size - sizeof(EnteteTrace)) / sizeof(EvenementTrace);
+    EvenementTrace* evenements = malloc((nb ? nb : 1) * sizeof(EvenementTrace));
+    if (!evenements) {
+        fprintf(stderr, "Mémoire insuffisante pour %zu événements\n", nb);
+        fclose(f);
+        return NULL;
+    }
+    *nb_evenements = fread(evenements, sizeof(EvenementTrace), nb, f);
+    fclose(f);
+
+    for (size_t i = 0; i < *nb_evenements; i++) {
+        if (evenements[i].bloc < 0 || (uint32_t)evenements[i].bloc >= entete->nb_blocs
+            || evenements[i].type >= NB_TYPES_ACCES) {
+            fprintf(stderr, "%s : événement %zu invalide\n", chemin, i);
+            free(evenements);
+            return NULL;
+        }
+    }
+    return evenements;
+}
+
+/**
+ * Copie la partition vers le fichier de rejeu
+ * @param source La partition
+ * @param destination La copie (créée ou remplacée)
+ * @return Le descripteur de la copie, ou -1 si erreur
+ */
+static int copier_partition(const char* source, const char* destination) {
+    int entree = open(source, O_RDONLY);
+    if (entree == -1) {
+        perror(source);
+        return -1;
+    }
+    int sortie = open(destination, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (sortie == -1) {
+        perror(destination);
+        close(entree);
+        return -1;
+    }
+
+    char tampon[64 * 1024];
+    ssize_t lus;
+    while ((lus = read(entree, tampon, sizeof(tampon))) > 0) {
+        if (write(sortie, tampon, lus) != lus) {
+            perror(destination);
+            lus = -1;
+            break;
+        }
+    }
+    close(entree);
+    if (lus < 0) {
+        close(sortie);
+        return -1;
+    }
+    return sortie;
+}
+
+/**
+ * Place une case en tête de la liste LRU (utilisée le plus récemment)
+ */
+static void mettre_en_tete(Rejeu* r, int c) {
+    CaseCache* cases = r->cases;
+    if (r->plus_recente == c) {
+        return;
+    }
+    // Détacher la case si elle est déjà dans la liste
+    if (cases[c].precedent != -1) {
+        cases[cases[c].precedent].suivant = cases[c].suivant;
+    }
+    if (cases[c].suivant != -1) {
+        cases[cases[c].suivant].precedent = cases[c].precedent;
+    }
+    if (r->plus_ancienne == c) {
+        r->plus_ancienne = cases[c].precedent;
+    }
+
+    cases[c].precedent = -1;
+    cases[c].suivant = r->plus_recente;
+    if (r->plus_recente != -1) {
+        cases[r->plus_recente].precedent = c;
+    }
+    r->plus_recente = c;
+    if (r->plus_ancienne == -1) {
+        r->plus_ancienne = c;
+    }
+}
+
+/**
+ * Range un bloc dans le cache, en évinçant le moins récemment utilisé
+ * @param r Le rejeu
+ * @param bloc Le bloc
+ * @param donnees Son contenu
+ */
+static void ranger_dans_cache(Rejeu* r, int bloc, const char* donnees) {
+    int c = r->case_du_bloc[bloc];
+    if (c == -1) {
+        if (r->nb_cases_utilisees < r->capacite_cache) {
+            c = r->nb_cases_utilisees++;
+        } else {
+            c = r->plus_ancienne;
+            r->case_du_bloc[r->cases[c].bloc] = -1;
+        }
+        r->cases[c].bloc = bloc;
+        r->case_du_bloc[bloc] = c;
+    }
+    memcpy(r->donnees_cache + (size_t)c * r->taille_bloc, donnees, r->taille_bloc);
+    mettre_en_tete(r, c);
+}
+
+/**
+ * Lit des blocs consécutifs sur la copie de la partition
+ * @return 0 si succès, -1 si erreur
+ */
+static int lire_disque_rejeu(Rejeu* r, int bloc, int nb, char* donnees) {
+    size_t taille = (size_t)nb * r->taille_bloc;
+    off_t offset = (off_t)bloc * r->taille_bloc;
+
+    r->octets_lus_disque += taille;
+    if (r->backend == BACKEND_MMAP) {
+        memcpy(donnees, r->projection + offset, taille);
+        return 0;
+    }
+    r->appels_systeme++;
+    return pread(r->descripteur, donnees, taille, offset) == (ssize_t)taille ? 0 : -1;
+}
+
+/**
+ * Écrit un bloc sur la copie de la partition
+ * @return 0 si succès, -1 si erreur
+ */
+static int ecrire_disque_rejeu(Rejeu* r, int bloc, const char* donnees) {
+    off_t offset = (off_t)bloc * r->taille_bloc;
+
+    r->octets_ecrits_disque += r->taille_bloc;
+    if (r->backend == BACKEND_MMAP) {
+        memcpy(r->projection + offset, donnees, r->taille_bloc);
+        return 0;
+    }
+    r->appels_systeme++;
+    return pwrite(r->descripteur, donnees, r->taille_bloc, offset) == (ssize_t)r->taille_bloc ? 0 : -1;
+}
+
+/**
+ * Rejoue une lecture : dans le cache si possible, sinon sur le disque,
+ * avec lecture anticipée si le défaut suit le précédent
+ * @param r Le rejeu
+ * @param bloc Le bloc lu
+ * @param succes Reçoit 1 si le bloc était dans le cache
+ * @return 0 si succès, -1 si erreur
+ */
+static int rejouer_lecture(Rejeu* r, int bloc, int* succes) {
+    r->nb_lectures++;
+    if (r->capacite_cache > 0 && r->case_du_bloc[bloc] != -1) {
+        int c = r->case_du_bloc[bloc];
+        memcpy(r->tampon, r->donnees_cache + (size_t)c * r->taille_bloc, r->taille_bloc);
+        mettre_en_tete(r, c);
+        r->nb_succes_cache++;
+        *succes = 1;
+        return 0;
+    }
+
+    *succes = 0;
+    int nb = 1;
+    if (r->lecture_anticipee > 0 && bloc == r->dernier_defaut + 1) {
+        nb += r->lecture_anticipee;
+        if ((uint32_t)(bloc + nb) > r->nb_blocs) {
+            nb = r->nb_blocs - bloc;
+        }
+    }
+    if (lire_disque_rejeu(r, bloc, nb, r->tampon) != 0) {
+        return -1;
+    }
+    r->dernier_defaut = bloc + nb - 1;
+    if (r->capacite_cache > 0) {
+        // Les blocs anticipés d'abord, pour que le bloc demandé soit le plus récent
+        for (int i = nb - 1; i >= 0; i--) {
+            ranger_dans_cache(r, bloc + i, r->tampon + (size_t)i * r->taille_bloc);
+        }
+    }
+    return 0;
+}
+
+/**
+ * Rejoue une écriture (écriture immédiate, le cache garde une copie)
+ * @param r Le rejeu
+ * @param bloc Le bloc écrit
+ * @return 0 si succès, -1 si erreur
+ */
+static int rejouer_ecriture(Rejeu* r, int bloc) {
+    r->nb_ecritures++;
+    memset(r->tampon, (unsigned char)bloc, r->taille_bloc);
+    if (r->capacite_cache > 0) {
+        ranger_dans_cache(r, bloc, r->tampon);
+    }
+    return ecrire_disque_rejeu(r, bloc, r->tampon);
+}
+
+/**
+ * Attend jusqu'à une heure de l'horloge monotone
+ */
+static void attendre_jusqua(uint64_t echeance_ns) {
+    struct timespec t = { echeance_ns / 1000000000ULL, echeance_ns % 1000000000ULL };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, NULL) == EINTR);
+}
+
+static int comparer_durees(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static void afficher_usage(const char* programme) {
+    fprintf(stderr, "Usage: %s [options] <trace> <partition>\n", programme);
+    fprintf(stderr, "  -b, --backend <nom>         Accès au fichier : pread ou mmap (défaut: pread)\n");
+    fprintf(stderr, "  -c, --cache <blocs>         Cache LRU de blocs (défaut: 0, aucun cache)\n");
+    fprintf(stderr, "  -a, --anticipation <blocs>  Blocs lus en plus après un défaut séquentiel (avec -c)\n");
+    fprintf(stderr, "  -t, --temps-reel            Respecter les intervalles enregistrés\n");
+    fprintf(stderr, "  -o, --copie <fichier>       Copie de la partition à garder (défaut: temporaire)\n");
+    fprintf(stderr, "  -j, --json                  Résultat sur une ligne JSON\n");
+    fprintf(stderr, "  -h, --help                  Afficher cette aide\n");
+}
+
+int main(int argc, char* argv[]) {
+    Rejeu r = { 0 };
+    const char* copie = NULL;
+    int temps_reel = 0;
+    int json = 0;
+
+    static const struct option options[] = {
+        { "backend",      required_argument, NULL, 'b' },
+        { "cache",        required_argument, NULL, 'c' },
+        { "anticipation", required_argument, NULL, 'a' },
+        { "temps-reel",   no_argument,       NULL, 't' },
+        { "copie",        required_argument, NULL, 'o' },
+        { "json",         no_argument,       NULL, 'j' },
+        { "help",         no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    int option;
+    while ((option = getopt_long(argc, argv, "b:c:a:to:jh", options, NULL)) != -1) {
+        switch (option) {
+            case 'b':
+                r.backend = NB_BACKENDS;
+                for (int i = 0; i < NB_BACKENDS; i++) {
+                    if (strcmp(optarg, noms_backends[i]) == 0) {
+                        r.backend = i;
+                    }
+                }
+                break;
+            case 'c': r.capacite_cache = atoi(optarg); break;
+            case 'a': r.lecture_anticipee = atoi(optarg); break;
+            case 't': temps_reel = 1; break;
+            case 'o': copie = optarg; break;
+            case 'j': json = 1; break;
+            case 'h': afficher_usage(argv[0]); return 0;
+            default: afficher_usage(argv[0]); return 2;
+        }
+    }
+    if (argc - optind != 2 || r.backend == NB_BACKENDS || r.capacite_cache < 0
+        || r.lecture_anticipee < 0 || (r.lecture_anticipee > 0 && r.capacite_cache == 0)) {
+        afficher_usage(argv[0]);
+        return 2;
+    }
+    const char* fichier_trace = argv[optind];
+    const char* partition = argv[optind + 1];
+
+    EnteteTrace entete;
+    size_t nb_evenements = 0;
+    EvenementTrace* evenements = charger_trace(fichier_trace, &entete, &nb_evenements);
+    if (!evenements) {
+        return 1;
+    }
+    r.taille_bloc = entete.taille_bloc;
+    r.nb_blocs = entete.nb_blocs;
+
+    char copie_temporaire[] = "/tmp/rejeu_fs.XXXXXX";
+    if (!copie) {
+        int d = mkstemp(copie_temporaire);
+        if (d == -1) {
+            perror("mkstemp");
+            free(evenements);
+            return 1;
+        }
+        close(d);
+        copie = copie_temporaire;
+    }
+    r.descripteur = copier_partition(partition, copie);
+    if (r.descripteur == -1) {
+        free(evenements);
+        return 1;
+    }
+    struct stat infos;
+    fstat(r.descripteur, &infos);
+    size_t taille_partition = (size_t)r.nb_blocs * r.taille_bloc;
+    if ((size_t)infos.st_size < taille_partition) {
+        fprintf(stderr, "%s : partition plus petite que celle de la trace\n", partition);
+        close(r.descripteur);
+        free(evenements);
+        return 1;
+    }
+    if (r.backend == BACKEND_MMAP) {
+        r.projection = mmap(NULL, taille_partition, PROT_READ | PROT_WRITE, MAP_SHARED, r.descripteur, 0);
+        if (r.projection == MAP_FAILED) {
+            perror("mmap");
+            close(r.descripteur);
+            free(evenements);
+            return 1;
+        }
+    }
+
+    r.dernier_defaut = -2;
+    r.plus_recente = r.plus_ancienne = -1;
+    r.tampon = malloc((size_t)(1 + r.lecture_anticipee) * r.taille_bloc);
+    r.case_du_bloc = malloc(r.nb_blocs * sizeof(int));
+    r.cases = malloc((r.capacite_cache ? r.capacite_cache : 1) * sizeof(CaseCache));
+    r.donnees_cache = malloc((size_t)(r.capacite_cache ? r.capacite_cache : 1) * r.taille_bloc);
+    uint64_t* durees = malloc((nb_evenements ? nb_evenements : 1) * sizeof(uint64_t));
+    if (!r.tampon || !r.case_du_bloc || !r.cases || !r.donnees_cache || !durees) {
+        fprintf(stderr, "Mémoire insuffisante\n");
+        return 1;
+    }
+    for (uint32_t i = 0; i < r.nb_blocs; i++) {
+        r.case_du_bloc[i] = -1;
+    }
+    for (int i = 0; i < r.capacite_cache; i++) {
+        r.cases[i] = (CaseCache){ -1, -1, -1 };
+    }
+
+    int nb_erreurs_rejeu = 0;
+    uint64_t debut = horloge_ns();
+    for (size_t i = 0; i < nb_evenements; i++) {
+        const EvenementTrace* e = &evenements[i];
+        if (temps_reel) {
+            attendre_jusqua(debut + e->horodatage_ns);
+        }
+
+        uint64_t avant = horloge_ns();
+        int succes = 0;
+        int resultat = e->type == ACCES_LECTURE ? rejouer_lecture(&r, e->bloc, &succes)
+                                                : rejouer_ecriture(&r, e->bloc);
+        durees[i] = horloge_ns() - avant;
+        if (resultat != 0) {
+            nb_erreurs_rejeu++;
+        }
+
+        CompteurRejeu* c = &r.operations[e->operation];
+        c->nb_acces++;
+        c->nb_succes_cache += succes;
+        c->duree_ns += durees[i];
+    }
+    // Les écritures doivent avoir atteint le fichier pour être comparables
+    if (r.backend == BACKEND_MMAP) {
+        msync(r.projection, taille_partition, MS_SYNC);
+    } else {
+        fsync(r.descripteur);
+    }
+    r.appels_systeme++;
+    uint64_t duree = horloge_ns() - debut;
+
+    qsort(durees, nb_evenements, sizeof(uint64_t), comparer_durees);
+    uint64_t p50 = nb_evenements ? durees[nb_evenements / 2] : 0;
+    uint64_t p99 = nb_evenements ? durees[(nb_evenements * 99) / 100] : 0;
+    double taux = r.nb_lectures ? 100.0 * r.nb_succes_cache / r.nb_lectures : 0.0;
+
+    if (json) {
+        printf("{\"trace\": \"%s\", \"backend\": \"%s\", \"cache\": %d, \"anticipation\": %d, "
+               "\"temps_reel\": %d, \"evenements\": %zu, \"lectures\": %lu, \"ecritures\": %lu, "
+               "\"succes_cache_pct\": %.1f, \"appels_systeme\": %lu, \"octets_lus_disque\": %lu, "
+               "\"octets_ecrits_disque\": %lu, \"duree_ns\": %lu, \"p50_ns\": %lu, \"p99_ns\": %lu, "
+               "\"erreurs\": %d, \"operations\": {",
+               fichier_trace, noms_backends[r.backend], r.capacite_cache, r.lecture_anticipee, temps_reel,
+               nb_evenements, (unsigned long)r.nb_lectures, (unsigned long)r.nb_ecritures, taux,
+               (unsigned long)r.appels_systeme, (unsigned long)r.octets_lus_disque,
+               (unsigned long)r.octets_ecrits_disque, (unsigned long)duree, (unsigned long)p50,
+               (unsigned long)p99, nb_erreurs_rejeu);
+        int premier = 1;
+        for (int i = 0; i < 256; i++) {
+            const CompteurRejeu* c = &r.operations[i];
+            if (c->nb_acces == 0) {
+                continue;
+            }
+            printf("%s\"%s\": {\"acces\": %lu, \"succes_cache\": %lu, \"duree_ns\": %lu}",
+                   premier ? "" : ", ", nom_operation(i), (unsigned long)c->nb_acces,
+                   (unsigned long)c->nb_succes_cache, (unsigned long)c->duree_ns);
+            premier = 0;
+        }
+        printf("}}\n");
+    } else {
+        printf("Trace %s : %zu accès (%lu lectures, %lu écritures), partition de %u blocs\n",
+               fichier_trace, nb_evenements, (unsigned long)r.nb_lectures, (unsigned long)r.nb_ecritures,
+               r.nb_blocs);
+        printf("Rejeu : backend %s, cache %d blocs, anticipation %d blocs%s\n",
+               noms_backends[r.backend], r.capacite_cache, r.lecture_anticipee,
+               temps_reel ? ", temps réel" : "");
+        printf("Succès du cache : %.1f %% des lectures\n", taux);
+        printf("Appels système : %lu, octets lus sur le disque : %lu, écrits : %lu\n",
+               (unsigned long)r.appels_systeme, (unsigned long)r.octets_lus_disque,
+               (unsigned long)r.octets_ecrits_disque);
+        printf("Durée : %.3f ms, par accès p50 %lu ns, p99 %lu ns\n",
+               duree / 1e6, (unsigned long)p50, (unsigned long)p99);
+        if (nb_erreurs_rejeu > 0) {
+            printf("Accès en échec : %d\n", nb_erreurs_rejeu);
+        }
+        printf("\n%-24s %10s %10s %12s\n", "Opération", "accès", "cache", "durée (µs)");
+        for (int i = 0; i < 256; i++) {
+            const CompteurRejeu* c = &r.operations[i];
+            if (c->nb_acces > 0) {
+                printf("%-24s %10lu %10lu %12.1f\n", nom_operation(i), (unsigned long)c->nb_acces,
+                       (unsigned long)c->nb_succes_cache, c->duree_ns / 1e3);
+            }
+        }
+    }
+
+    if (r.projection) {
+        munmap(r.projection, taille_partition);
+    }
+    close(r.descripteur);
+    if (copie == copie_temporaire) {
+        unlink(copie);
+    }
+    free(durees);
+    free(r.donnees_cache);
+    free(r.cases);
+    free(r.case_du_bloc);
+    free(r.tampon);
+    free(evenements);
+    return nb_erreurs_rejeu == 0 ? 0 : 1;
+}
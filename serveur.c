@@ -0,0 +1,658 @@
+#define _GNU_SOURCE
+#include "serveur.h"
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/**
+ * Pourcentage d'implication :
+ * GOBALOUKICHENIN Bala : 33%
+ * DEHOUCHE Lisa : 33%
+ * GABITA William : 33%
+ *
+ * Démon multi-clients sur socket Unix et client léger
+ *
+ * Le thread principal attend les évènements avec epoll et reconstitue les
+ * trames des clients sans bloquer. Une trame complète est confiée au pool
+ * de threads, qui exécute la commande et renvoie la réponse. Chaque socket
+ * est surveillée en EPOLLONESHOT : tant qu'une requête est en cours, aucun
+ * autre thread ne touche au client, qui est réarmé une fois la réponse
+ * envoyée.
+ */
+
+#define NB_EVENEMENTS 64            // Évènements traités par appel à epoll_wait
+#define DELAI_ENVOI_MS 5000         // Attente maximale d'un client qui ne lit plus
+
+/**
+ * @brief Connexion d'un client au démon
+ */
+typedef struct Client {
+    int fd;                         // Socket du client
+    Session* session;               // Session (répertoire courant) du client
+    EnteteRequete entete;           // En-tête de la requête en cours
+    size_t recu;                    // Octets reçus de la requête en cours
+    char* tampon;                   // Commande, '\0', puis données
+    struct Client* suivant_file;    // Client suivant dans la file de travail
+    struct Client* precedent;       // Chaînage des clients connectés
+    struct Client* suivant;
+} Client;
+
+/**
+ * @brief État du démon
+ */
+typedef struct {
+    SystemeFichiers* fs;
+    int fd_ecoute;                  // Socket d'écoute
+    int fd_signal;                  // signalfd de SIGINT et SIGTERM
+    int fd_epoll;
+    pthread_mutex_t verrou_file;    // Protège la file de travail et arret
+    pthread_cond_t condition_file;
+    Client* tete_file;
+    Client* queue_file;
+    int arret;
+    pthread_mutex_t verrou_clients; // Protège la liste des clients
+    Client* clients;
+    unsigned long commandes_executees;  // Depuis la dernière sauvegarde
+} Demon;
+
+/**
+ * Prépare un client pour la requête suivante
+ * @param c Le client
+ */
+static void reinitialiser_requete(Client* c) {
+    free(c->tampon);
+    c->tampon = NULL;
+    c->recu = 0;
+}
+
+/**
+ * Surveille à nouveau la socket d'un client
+ * @param d Le démon
+ * @param c Le client
+ */
+static void rearmer_client(Demon* d, Client* c) {
+    struct epoll_event ev = { .events = EPOLLIN | EPOLLONESHOT, .data.ptr = c };
+    pthread_mutex_lock(&d->verrou_clients);
+    epoll_ctl(d->fd_epoll, EPOLL_CTL_MOD, c->fd, &ev);
+    pthread_mutex_unlock(&d->verrou_clients);
+}
+
+/**
+ * Déconnecte un client et libère sa session
+ * @param d Le démon
+ * @param c Le client
+ */
+static void fermer_client(Demon* d, Client* c) {
+    // Une transaction laissée ouverte par le client est annulée
+    debuter_operation(d->fs, 0);
+    int transaction = transaction_en_cours(c->session);
+    terminer_operation(d->fs);
+    if (transaction) {
+        debuter_operation(d->fs, 1);
+        annuler_transaction(c->session);
+        terminer_operation(d->fs);
+    }
+
+    epoll_ctl(d->fd_epoll, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+
+    pthread_mutex_lock(&d->verrou_clients);
+    if (c->precedent) c->precedent->suivant = c->suivant;
+    else d->clients = c->suivant;
+    if (c->suivant) c->suivant->precedent = c->precedent;
+    pthread_mutex_unlock(&d->verrou_clients);
+
+    fermer_session(c->session);
+    free(c->tampon);
+    free(c);
+}
+
+/**
+ * Accepte les connexions en attente sur la socket d'écoute
+ * @param d Le démon
+ */
+static void accepter_clients(Demon* d) {
+    while (1) {
+        int fd = accept4(d->fd_ecoute, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                erreur("Échec de l'acceptation d'un client");
+            }
+            return;
+        }
+
+        Client* c = calloc(1, sizeof(Client));
+        Session* s = c ? ouvrir_session(d->fs) : NULL;
+        if (!s) {
+            free(c);
+            close(fd);
+            erreur("Mémoire insuffisante pour un nouveau client");
+            continue;
+        }
+        c->fd = fd;
+        c->session = s;
+
+        pthread_mutex_lock(&d->verrou_clients);
+        c->suivant = d->clients;
+        if (d->clients) d->clients->precedent = c;
+        d->clients = c;
+        pthread_mutex_unlock(&d->verrou_clients);
+
+        struct epoll_event ev = { .events = EPOLLIN | EPOLLONESHOT, .data.ptr = c };
+        if (epoll_ctl(d->fd_epoll, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            fermer_client(d, c);
+        }
+    }
+}
+
+/**
+ * Lit sans bloquer la suite de la requête d'un client
+ * @param c Le client
+ * @return 1 si la requête est complète, 0 s'il faut attendre, -1 si le
+ *         client s'est déconnecté ou a envoyé une trame invalide
+ */
+static int recevoir_trame(Client* c) {
+    const size_t taille_entete = sizeof(EnteteRequete);
+
+    while (1) {
+        char* destination;
+        size_t reste;
+
+        if (c->recu < taille_entete) {
+            destination = (char*)&c->entete + c->recu;
+            reste = taille_entete - c->recu;
+        } else {
+            size_t longueur_commande = c->entete.longueur_commande;
+            size_t total = longueur_commande + c->entete.longueur_donnees;
+
+            if (c->tampon == NULL) {
+                if (longueur_commande == 0 || longueur_commande >= TAILLE_MAX_COMMANDE
+                    || c->entete.longueur_donnees > TAILLE_MAX_DONNEES) {
+                    return -1;
+                }
+                c->tampon = calloc(total + 1, 1);
+                if (!c->tampon) return -1;
+            }
+
+            // La commande est suivie d'un '\0', les données viennent après
+            size_t position = c->recu - taille_entete;
+            if (position == total) return 1;
+            if (position < longueur_commande) {
+                destination = c->tampon + position;
+                reste = longueur_commande - position;
+            } else {
+                destination = c->tampon + position + 1;
+                reste = total - position;
+            }
+        }
+
+        ssize_t n = recv(c->fd, destination, reste, 0);
+        if (n > 0) {
+            c->recu += n;
+        } else if (n == 0) {
+            return -1;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return 0;
+        } else {
+            return -1;
+        }
+    }
+}
+
+/**
+ * Envoie un tampon entier sur une socket non bloquante
+ * @param fd La socket
+ * @param donnees Les octets à envoyer
+ * @param taille Le nombre d'octets
+ * @return 0 si succès, -1 si le client est injoignable
+ */
+static int envoyer_tout(int fd, const void* donnees, size_t taille) {
+    const char* position = donnees;
+
+    while (taille > 0) {
+        ssize_t n = send(fd, position, taille, MSG_NOSIGNAL);
+        if (n > 0) {
+            position += n;
+            taille -= n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            struct pollfd attente = { .fd = fd, .events = POLLOUT };
+            if (poll(&attente, 1, DELAI_ENVOI_MS) <= 0) return -1;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Exécute la requête complète d'un client et lui envoie la réponse
+ * @param d Le démon
+ * @param c Le client
+ * @return 1 si le client reste connecté, 0 s'il faut le déconnecter
+ */
+static int traiter_requete(Demon* d, Client* c) {
+    char* sortie = NULL;
+    size_t taille = 0;
+    FILE* flux = open_memstream(&sortie, &taille);
+    if (!flux) return 0;
+
+    const char* donnees = c->tampon + c->entete.longueur_commande + 1;
+    rediriger_sortie(flux);
+    int statut = executer_commande(c->session, c->tampon, donnees, c->entete.longueur_donnees);
+    rediriger_sortie(NULL);
+    fclose(flux);
+    __atomic_add_fetch(&d->commandes_executees, 1, __ATOMIC_RELAXED);
+
+    EnteteReponse reponse = { .statut = statut, .longueur = taille };
+    int envoye = envoyer_tout(c->fd, &reponse, sizeof(reponse)) == 0
+                 && envoyer_tout(c->fd, sortie, taille) == 0;
+    free(sortie);
+    reinitialiser_requete(c);
+
+    return envoye && statut != COMMANDE_QUITTER;
+}
+
+/**
+ * Boucle d'un thread du pool : exécute les requêtes de la file
+ * @param argument Le démon
+ * @return NULL
+ */
+static void* travailleur(void* argument) {
+    Demon* d = argument;
+
+    while (1) {
+        pthread_mutex_lock(&d->verrou_file);
+        while (d->tete_file == NULL && !d->arret) {
+            pthread_cond_wait(&d->condition_file, &d->verrou_file);
+        }
+        Client* c = d->tete_file;
+        if (c == NULL) {
+            pthread_mutex_unlock(&d->verrou_file);
+            break;
+        }
+        d->tete_file = c->suivant_file;
+        if (d->tete_file == NULL) d->queue_file = NULL;
+        pthread_mutex_unlock(&d->verrou_file);
+
+        if (traiter_requete(d, c)) {
+            rearmer_client(d, c);
+        } else {
+            fermer_client(d, c);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Confie la requête complète d'un client au pool de threads
+ * @param d Le démon
+ * @param c Le client
+ */
+static void enfiler_client(Demon* d, Client* c) {
+    c->suivant_file = NULL;
+    pthread_mutex_lock(&d->verrou_file);
+    if (d->queue_file) d->queue_file->suivant_file = c;
+    else d->tete_file = c;
+    d->queue_file = c;
+    pthread_cond_signal(&d->condition_file);
+    pthread_mutex_unlock(&d->verrou_file);
+}
+
+/**
+ * Écrit les métadonnées sur la partition si des commandes ont été
+ * exécutées depuis la dernière sauvegarde
+ * @param d Le démon
+ */
+static void sauvegarder_si_necessaire(Demon* d) {
+    if (__atomic_exchange_n(&d->commandes_executees, 0, __ATOMIC_RELAXED) == 0) {
+        return;
+    }
+    debuter_operation(d->fs, 0);
+    sauvegarder_partition(d->fs);
+    terminer_operation(d->fs);
+}
+
+/**
+ * Crée la socket d'écoute du démon
+ * Une socket laissée par un démon arrêté brutalement est remplacée, mais
+ * pas celle d'un démon encore actif.
+ * @param chemin Le chemin de la socket
+ * @return Le descripteur de la socket, ou -1 si erreur
+ */
+static int ouvrir_socket_ecoute(const char* chemin) {
+    struct sockaddr_un adresse = { .sun_family = AF_UNIX };
+    if (strlen(chemin) >= sizeof(adresse.sun_path)) {
+        erreur("Chemin de socket trop long");
+        return -1;
+    }
+    strcpy(adresse.sun_path, chemin);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        erreur("Impossible de créer la socket");
+        return -1;
+    }
+
+    int attache = bind(fd, (struct sockaddr*)&adresse, sizeof(adresse));
+    if (attache < 0 && errno == EADDRINUSE) {
+        int test = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        int actif = test >= 0 && connect(test, (struct sockaddr*)&adresse, sizeof(adresse)) == 0;
+        if (test >= 0) close(test);
+        if (actif) {
+            erreur("Un démon écoute déjà sur cette socket");
+            close(fd);
+            return -1;
+        }
+        unlink(chemin);
+        attache = bind(fd, (struct sockaddr*)&adresse, sizeof(adresse));
+    }
+    if (attache < 0) {
+        erreur("Impossible d'attacher la socket");
+        close(fd);
+        return -1;
+    }
+
+    if (listen(fd, SOMAXCONN) < 0) {
+        erreur("Impossible d'écouter sur la socket");
+        close(fd);
+        unlink(chemin);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * Sert les commandes de plusieurs clients jusqu'à SIGINT ou SIGTERM
+ * Les métadonnées sont sauvegardées périodiquement et à l'arrêt.
+ * @param fs Le système de fichiers monté
+ * @param chemin_socket Le chemin de la socket Unix
+ * @param nb_travailleurs Le nombre de threads du pool
+ * @return 0 si succès, -1 si erreur
+ */
+int lancer_demon(SystemeFichiers* fs, const char* chemin_socket, int nb_travailleurs) {
+    if (nb_travailleurs < 1 || nb_travailleurs > NB_TRAVAILLEURS_MAX) {
+        erreur("Nombre de threads invalide");
+        return -1;
+    }
+
+    Demon d = { .fs = fs, .fd_ecoute = -1, .fd_signal = -1, .fd_epoll = -1 };
+    pthread_mutex_init(&d.verrou_file, NULL);
+    pthread_cond_init(&d.condition_file, NULL);
+    pthread_mutex_init(&d.verrou_clients, NULL);
+
+    // Les signaux d'arrêt sont lus par la boucle d'évènements ; le masque
+    // est hérité par les threads du pool
+    sigset_t signaux;
+    sigemptyset(&signaux);
+    sigaddset(&signaux, SIGINT);
+    sigaddset(&signaux, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signaux, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    int resultat = -1;
+    pthread_t travailleurs[NB_TRAVAILLEURS_MAX];
+    int nb_lances = 0;
+
+    d.fd_ecoute = ouvrir_socket_ecoute(chemin_socket);
+    d.fd_signal = signalfd(-1, &signaux, SFD_NONBLOCK | SFD_CLOEXEC);
+    d.fd_epoll = epoll_create1(EPOLL_CLOEXEC);
+    if (d.fd_ecoute < 0 || d.fd_signal < 0 || d.fd_epoll < 0) {
+        if (d.fd_ecoute >= 0) erreur("Impossible d'initialiser la boucle d'évènements");
+        goto fin;
+    }
+
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = &d.fd_ecoute };
+    epoll_ctl(d.fd_epoll, EPOLL_CTL_ADD, d.fd_ecoute, &ev);
+    ev.data.ptr = &d.fd_signal;
+    epoll_ctl(d.fd_epoll, EPOLL_CTL_ADD, d.fd_signal, &ev);
+
+    for (; nb_lances < nb_travailleurs; nb_lances++) {
+        if (pthread_create(&travailleurs[nb_lances], NULL, travailleur, &d) != 0) {
+            erreur("Impossible de créer les threads du pool");
+            goto fin;
+        }
+    }
+
+    printf("Démon à l'écoute sur %s (%d threads)\n", chemin_socket, nb_travailleurs);
+    fflush(stdout);
+
+    struct epoll_event evenements[NB_EVENEMENTS];
+    struct timespec derniere_sauvegarde;
+    clock_gettime(CLOCK_MONOTONIC, &derniere_sauvegarde);
+    int arret = 0;
+    while (!arret) {
+        int n = epoll_wait(d.fd_epoll, evenements, NB_EVENEMENTS, DELAI_SAUVEGARDE_MS);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            erreur("Échec de epoll_wait");
+            goto fin;
+        }
+
+        // Le réarmement se fait sous ce verrou : le prendre ici ordonne les
+        // écritures des threads du pool avant la lecture des clients réarmés
+        pthread_mutex_lock(&d.verrou_clients);
+        pthread_mutex_unlock(&d.verrou_clients);
+
+        for (int i = 0; i < n; i++) {
+            void* source = evenements[i].data.ptr;
+            if (source == &d.fd_signal) {
+                // Consommer le signal pour qu'il ne soit pas délivré au
+                // rétablissement du masque
+                struct signalfd_siginfo info;
+                while (read(d.fd_signal, &info, sizeof(info)) == sizeof(info)) {
+                }
+                arret = 1;
+            } else if (source == &d.fd_ecoute) {
+                accepter_clients(&d);
+            } else {
+                Client* c = source;
+                int etat = recevoir_trame(c);
+                if (etat < 0) fermer_client(&d, c);
+                else if (etat == 0) rearmer_client(&d, c);
+                else enfiler_client(&d, c);
+            }
+        }
+
+        // Sauvegarde périodique, même si les clients ne laissent jamais
+        // la boucle inactive
+        struct timespec maintenant;
+        clock_gettime(CLOCK_MONOTONIC, &maintenant);
+        long ecoule_ms = (maintenant.tv_sec - derniere_sauvegarde.tv_sec) * 1000
+                         + (maintenant.tv_nsec - derniere_sauvegarde.tv_nsec) / 1000000;
+        if (ecoule_ms >= DELAI_SAUVEGARDE_MS) {
+            sauvegarder_si_necessaire(&d);
+            derniere_sauvegarde = maintenant;
+        }
+    }
+    resultat = 0;
+    printf("Arrêt du démon...\n");
+
+fin:
+    // Terminer les requêtes en cours avant de déconnecter les clients
+    pthread_mutex_lock(&d.verrou_file);
+    d.arret = 1;
+    pthread_cond_broadcast(&d.condition_file);
+    pthread_mutex_unlock(&d.verrou_file);
+    for (int i = 0; i < nb_lances; i++) {
+        pthread_join(travailleurs[i], NULL);
+    }
+    while (d.clients) {
+        fermer_client(&d, d.clients);
+    }
+    sauvegarder_si_necessaire(&d);
+
+    if (d.fd_epoll >= 0) close(d.fd_epoll);
+    if (d.fd_signal >= 0) close(d.fd_signal);
+    if (d.fd_ecoute >= 0) {
+        close(d.fd_ecoute);
+        unlink(chemin_socket);
+    }
+    pthread_mutex_destroy(&d.verrou_clients);
+    pthread_cond_destroy(&d.condition_file);
+    pthread_mutex_destroy(&d.verrou_file);
+    pthread_sigmask(SIG_UNBLOCK, &signaux, NULL);
+    return resultat;
+}
+
+/**
+ * Lit une réponse complète sur une socket bloquante
+ * @param fd La socket
+ * @param destination Le tampon de destination
+ * @param taille Le nombre d'octets à lire
+ * @return 0 si succès, -1 si la connexion est perdue
+ */
+static int recevoir_tout(int fd, void* destination, size_t taille) {
+    char* position = destination;
+
+    while (taille > 0) {
+        ssize_t n = recv(fd, position, taille, 0);
+        if (n > 0) {
+            position += n;
+            taille -= n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Lit sur l'entrée standard le contenu d'une commande write
+ * La saisie se termine par une ligne vide.
+ * @param taille Reçoit la taille du contenu
+ * @return Le contenu (à libérer), ou NULL si erreur
+ */
+static char* lire_contenu(size_t* taille) {
+    size_t capacite = 1024;
+    char* contenu = malloc(capacite);
+    char ligne[1024];
+    *taille = 0;
+    if (!contenu) return NULL;
+
+    printf("Entrez le contenu à écrire (terminez par une ligne vide) :\n");
+    while (1) {
+        printf("> ");
+        if (fgets(ligne, sizeof(ligne), stdin) == NULL) {
+            break;
+        }
+
+        // Ligne vide termine la saisie
+        ligne[strcspn(ligne, "\n")] = 0;
+        if (strlen(ligne) == 0) {
+            break;
+        }
+
+        size_t longueur = strlen(ligne);
+        if (*taille + longueur + 1 > TAILLE_MAX_DONNEES) {
+            erreur("Dépassement de la capacité du tampon !");
+            break;
+        }
+        if (*taille + longueur + 1 > capacite) {
+            while (*taille + longueur + 1 > capacite) capacite *= 2;
+            char* agrandi = realloc(contenu, capacite);
+            if (!agrandi) {
+                free(contenu);
+                return NULL;
+            }
+            contenu = agrandi;
+        }
+        memcpy(contenu + *taille, ligne, longueur);
+        contenu[*taille + longueur] = '\n';
+        *taille += longueur + 1;
+    }
+    return contenu;
+}
+
+/**
+ * Client léger : envoie les commandes saisies au démon et affiche ses
+ * réponses
+ * @param chemin_socket Le chemin de la socket du démon
+ * @return 0 si succès, -1 si le démon est injoignable
+ */
+int lancer_client(const char* chemin_socket) {
+    struct sockaddr_un adresse = { .sun_family = AF_UNIX };
+    if (strlen(chemin_socket) >= sizeof(adresse.sun_path)) {
+        erreur("Chemin de socket trop long");
+        return -1;
+    }
+    strcpy(adresse.sun_path, chemin_socket);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&adresse, sizeof(adresse)) < 0) {
+        erreur("Impossible de joindre le démon");
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    char commande[TAILLE_MAX_COMMANDE];
+    int resultat = 0;
+
+    printf("\nConnecté à %s - Tapez 'aide' pour voir les commandes disponibles\n", chemin_socket);
+
+    while (1) {
+        printf("\n> ");
+        if (fgets(commande, sizeof(commande), stdin) == NULL) {
+            break;
+        }
+        commande[strcspn(commande, "\n")] = 0;
+        if (commande[0] == '\0') {
+            continue;
+        }
+
+        char* donnees = NULL;
+        size_t taille_donnees = 0;
+        if (strncmp(commande, "write ", 6) == 0) {
+            donnees = lire_contenu(&taille_donnees);
+            if (!donnees) {
+                erreur("Mémoire insuffisante");
+                continue;
+            }
+        }
+
+        EnteteRequete requete = { .longueur_commande = strlen(commande), .longueur_donnees = taille_donnees };
+        EnteteReponse reponse;
+        int envoye = envoyer_tout(fd, &requete, sizeof(requete)) == 0
+                     && envoyer_tout(fd, commande, requete.longueur_commande) == 0
+                     && envoyer_tout(fd, donnees, taille_donnees) == 0
+                     && recevoir_tout(fd, &reponse, sizeof(reponse)) == 0;
+        free(donnees);
+        if (!envoye) {
+            erreur("Connexion au démon perdue");
+            resultat = -1;
+            break;
+        }
+
+        // Recopier la sortie de la commande par morceaux
+        char morceau[4096];
+        size_t reste = reponse.longueur;
+        while (reste > 0) {
+            size_t a_lire = reste < sizeof(morceau) ? reste : sizeof(morceau);
+            if (recevoir_tout(fd, morceau, a_lire) < 0) {
+                erreur("Connexion au démon perdue");
+                resultat = -1;
+                break;
+            }
+            fwrite(morceau, 1, a_lire, stdout);
+            reste -= a_lire;
+        }
+        if (resultat < 0 || reponse.statut == COMMANDE_QUITTER) {
+            break;
+        }
+    }
+
+    close(fd);
+    printf("Au revoir !\n");
+    return resultat;
+}
@@ -0,0 +1,46 @@
+/**
+ * @file serveur.h
+ * @brief Mode démon et mode client du gestionnaire de fichiers
+ *
+ * Le démon monte la partition une seule fois et sert les commandes de
+ * plusieurs clients sur une socket Unix locale. Chaque client dispose de
+ * sa propre session, donc de son propre répertoire courant.
+ *
+ * Trame d'une requête : EnteteRequete, puis la commande (sans '\0'),
+ * puis les données (contenu de write). Trame d'une réponse : EnteteReponse,
+ * puis la sortie de la commande. Les entiers sont dans l'ordre de la
+ * machine, la socket étant locale.
+ */
+
+#ifndef SERVEUR_H
+#define SERVEUR_H
+
+#include "commandes.h"
+
+#define SOCKET_DEFAUT "gestionnairefs.sock"   // Chemin par défaut de la socket
+#define NB_TRAVAILLEURS_DEFAUT 4              // Taille par défaut du pool de threads
+#define NB_TRAVAILLEURS_MAX 64                // Taille maximale du pool de threads
+#define TAILLE_MAX_DONNEES (1 << 20)          // Taille maximale des données d'une requête
+#define DELAI_SAUVEGARDE_MS 1000              // Délai entre deux sauvegardes des métadonnées
+
+/**
+ * @brief En-tête d'une requête envoyée au démon
+ */
+typedef struct {
+    uint32_t longueur_commande;   // Longueur de la ligne de commande
+    uint32_t longueur_donnees;    // Longueur des données qui la suivent
+} EnteteRequete;
+
+/**
+ * @brief En-tête d'une réponse du démon
+ */
+typedef struct {
+    int32_t statut;               // Résultat de executer_commande
+    uint32_t longueur;            // Longueur de la sortie qui suit
+} EnteteReponse;
+
+/* Démon et client */
+int lancer_demon(SystemeFichiers* fs, const char* chemin_socket, int nb_travailleurs);
+int lancer_client(const char* chemin_socket);
+
+#endif // SERVEUR_H
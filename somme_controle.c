@@ -0,0 +1,228 @@
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+#include "somme_controle.h"
+
+/**
+ * Pourcentage d'implication :
+ * GOBALOUKICHENIN Bala : 33%
+ * DEHOUCHE Lisa : 33%
+ * GABITA William : 33%
+ *
+ * Calcul du CRC32C, par SSE4.2 ou par tables, et empreintes SHA-256
+ */
+
+#define POLYNOME_CRC32C 0x82F63B78u       // Polynôme de Castagnoli, bits inversés
+
+static uint32_t tables[8][256];           // tables[k][i] : CRC de l'octet i suivi de k octets nuls
+static int calcul_materiel = 0;           // 1 si l'instruction crc32 est disponible
+static pthread_once_t initialisation = PTHREAD_ONCE_INIT;
+
+/**
+ * Construit les tables du calcul logiciel et détecte SSE4.2
+ */
+static void initialiser_crc32c(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (crc & 1 ? POLYNOME_CRC32C : 0);
+        }
+        tables[0][i] = crc;
+    }
+    for (int k = 1; k < 8; k++) {
+        for (int i = 0; i < 256; i++) {
+            tables[k][i] = (tables[k - 1][i] >> 8) ^ tables[0][tables[k - 1][i] & 0xFF];
+        }
+    }
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    calcul_materiel = __builtin_cpu_supports("sse4.2");
+#endif
+}
+
+/**
+ * Calcul logiciel : huit octets par tour, une consultation de table par octet
+ * @param crc Le CRC en cours (inversé)
+ * @param octets Les données
+ * @param taille Nombre d'octets
+ * @return Le CRC mis à jour (inversé)
+ */
+static uint32_t crc32c_tables(uint32_t crc, const uint8_t* octets, size_t taille) {
+    while (taille >= 8) {
+        uint32_t bas = crc ^ ((uint32_t)octets[0] | (uint32_t)octets[1] << 8
+                              | (uint32_t)octets[2] << 16 | (uint32_t)octets[3] << 24);
+        uint32_t haut = (uint32_t)octets[4] | (uint32_t)octets[5] << 8
+                        | (uint32_t)octets[6] << 16 | (uint32_t)octets[7] << 24;
+        crc = tables[7][bas & 0xFF] ^ tables[6][(bas >> 8) & 0xFF]
+              ^ tables[5][(bas >> 16) & 0xFF] ^ tables[4][bas >> 24]
+              ^ tables[3][haut & 0xFF] ^ tables[2][(haut >> 8) & 0xFF]
+              ^ tables[1][(haut >> 16) & 0xFF] ^ tables[0][haut >> 24];
+        octets += 8;
+        taille -= 8;
+    }
+    while (taille-- > 0) {
+        crc = (crc >> 8) ^ tables[0][(crc ^ *octets++) & 0xFF];
+    }
+    return crc;
+}
+
+#if defined(__x86_64__)
+/**
+ * Calcul par l'instruction crc32 de SSE4.2, huit octets à la fois
+ * @param crc Le CRC en cours (inversé)
+ * @param octets Les données
+ * @param taille Nombre d'octets
+ * @return Le CRC mis à jour (inversé)
+ */
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42(uint32_t crc, const uint8_t* octets, size_t taille) {
+    while (taille > 0 && ((uintptr_t)octets & 7) != 0) {
+        crc = _mm_crc32_u8(crc, *octets++);
+        taille--;
+    }
+    // Les mots sont alignés : lecture directe, quatre mots par tour
+    const uint64_t* mots = (const uint64_t*)octets;
+    uint64_t crc64 = crc;
+    while (taille >= 32) {
+        crc64 = _mm_crc32_u64(crc64, mots[0]);
+        crc64 = _mm_crc32_u64(crc64, mots[1]);
+        crc64 = _mm_crc32_u64(crc64, mots[2]);
+        crc64 = _mm_crc32_u64(crc64, mots[3]);
+        mots += 4;
+        taille -= 32;
+    }
+    while (taille >= 8) {
+        crc64 = _mm_crc32_u64(crc64, *mots++);
+        taille -= 8;
+    }
+    octets = (const uint8_t*)mots;
+    crc = (uint32_t)crc64;
+    while (taille-- > 0) {
+        crc = _mm_crc32_u8(crc, *octets++);
+    }
+    return crc;
+}
+#endif
+
+/**
+ * Calcule le CRC32C d'une zone mémoire
+ * @param donnees Les données
+ * @param taille Nombre d'octets
+ * @return Le CRC32C
+ */
+uint32_t calculer_crc32c(const void* donnees, size_t taille) {
+    pthread_once(&initialisation, initialiser_crc32c);
+#if defined(__x86_64__)
+    if (calcul_materiel) {
+        return ~crc32c_sse42(~0u, donnees, taille);
+    }
+#endif
+    return ~crc32c_tables(~0u, donnees, taille);
+}
+
+/**
+ * Nom du calcul utilisé, pour les statistiques
+ * @return "sse4.2" ou "tables"
+ */
+const char* nom_calcul_crc32c(void) {
+    pthread_once(&initialisation, initialiser_crc32c);
+    return calcul_materiel ? "sse4.2" : "tables";
+}
+
+/* Constantes des tours de SHA-256 (FIPS 180-4) */
+static const uint32_t constantes_sha256[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROTATION(x, n) ((x) >> (n) | (x) << (32 - (n)))
+
+/**
+ * Traite un bloc de 64 octets
+ * @param etat Les huit mots de l'état, mis à jour
+ * @param bloc Le bloc
+ */
+static void compresser_bloc_sha256(uint32_t etat[8], const uint8_t* bloc) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (uint32_t)bloc[4 * i] << 24 | (uint32_t)bloc[4 * i + 1] << 16
+               | (uint32_t)bloc[4 * i + 2] << 8 | bloc[4 * i + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROTATION(w[i - 15], 7) ^ ROTATION(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROTATION(w[i - 2], 17) ^ ROTATION(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = etat[0], b = etat[1], c = etat[2], d = etat[3];
+    uint32_t e = etat[4], f = etat[5], g = etat[6], h = etat[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = h + (ROTATION(e, 6) ^ ROTATION(e, 11) ^ ROTATION(e, 25)) + ((e & f) ^ (~e & g))
+                      + constantes_sha256[i] + w[i];
+        uint32_t t2 = (ROTATION(a, 2) ^ ROTATION(a, 13) ^ ROTATION(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    etat[0] += a;
+    etat[1] += b;
+    etat[2] += c;
+    etat[3] += d;
+    etat[4] += e;
+    etat[5] += f;
+    etat[6] += g;
+    etat[7] += h;
+}
+
+/**
+ * Calcule l'empreinte SHA-256 d'une zone mémoire
+ * @param donnees Les données
+ * @param taille Nombre d'octets
+ * @param empreinte Reçoit les TAILLE_SHA256 octets de l'empreinte
+ */
+void calculer_sha256(const void* donnees, size_t taille, uint8_t* empreinte) {
+    uint32_t etat[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    const uint8_t* octets = donnees;
+    size_t reste = taille;
+    for (; reste >= 64; reste -= 64, octets += 64) {
+        compresser_bloc_sha256(etat, octets);
+    }
+
+    // Dernier bloc : un bit à 1, des zéros, puis la longueur en bits
+    uint8_t fin[128] = {0};
+    memcpy(fin, octets, reste);
+    fin[reste] = 0x80;
+    size_t longueur_fin = reste < 56 ? 64 : 128;
+    uint64_t bits = (uint64_t)taille * 8;
+    for (int i = 0; i < 8; i++) {
+        fin[longueur_fin - 1 - i] = (uint8_t)(bits >> (8 * i));
+    }
+    compresser_bloc_sha256(etat, fin);
+    if (longueur_fin == 128) {
+        compresser_bloc_sha256(etat, fin + 64);
+    }
+
+    for (int i = 0; i < 8; i++) {
+        empreinte[4 * i] = (uint8_t)(etat[i] >> 24);
+        empreinte[4 * i + 1] = (uint8_t)(etat[i] >> 16);
+        empreinte[4 * i + 2] = (uint8_t)(etat[i] >> 8);
+        empreinte[4 * i + 3] = (uint8_t)etat[i];
+    }
+}
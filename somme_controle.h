@@ -0,0 +1,26 @@
+/**
+ * @file somme_controle.h
+ * @brief Sommes de contrôle CRC32C des blocs de la partition
+ *
+ * Le CRC32C (polynôme de Castagnoli) est calculé par l'instruction crc32
+ * de SSE4.2 quand le processeur la propose (détecté à l'exécution), sinon
+ * par huit tables qui traitent les données 8 octets à la fois.
+ *
+ * Le SHA-256 donne aux morceaux du dépôt de sauvegardes (voir depot.h)
+ * une adresse fondée sur leur contenu, sans collision à craindre.
+ */
+
+#ifndef SOMME_CONTROLE_H
+#define SOMME_CONTROLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+uint32_t calculer_crc32c(const void* donnees, size_t taille);
+const char* nom_calcul_crc32c(void);
+
+#define TAILLE_SHA256 32                  // Octets d'une empreinte SHA-256
+
+void calculer_sha256(const void* donnees, size_t taille, uint8_t* empreinte);
+
+#endif // SOMME_CONTROLE_H
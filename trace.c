@@ -0,0 +1,252 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "trace.h"
+#include "file_system.h"
+
+/**
+ * Pourcentage d'implication :
+ * GOBALOUKICHENIN Bala : 33%
+ * DEHOUCHE Lisa : 33%
+ * GABITA William : 33%
+ *
+ * Enregistrement des accès aux blocs dans un fichier de trace
+ */
+
+#define LOT_ECRITURE 1024                 // Événements recopiés par appel à write
+
+/**
+ * @brief Case du tampon circulaire. 'sequence' vaut la position de la case
+ * quand elle est libre, la position + 1 quand elle contient un événement.
+ */
+typedef struct {
+    uint64_t sequence;
+    EvenementTrace evenement;
+} CaseTrace;
+
+/**
+ * @brief Enregistrement en cours
+ */
+struct Trace {
+    char chemin[MAX_CHEMIN];
+    int descripteur;
+    uint64_t origine_ns;                  // horloge_ns() au début de l'enregistrement
+    pthread_t ecrivain;
+
+    uint64_t tete;                        // Prochaine position réservée par un producteur
+    uint64_t queue;                       // Prochaine position lue par l'écrivain
+    int arret;                            // Demande d'arrêt de l'écrivain
+    int erreur_ecriture;                  // L'écrivain n'a pas pu écrire dans le fichier
+
+    uint64_t nb_ecrits;                   // Événements écrits dans le fichier
+    uint64_t nb_perdus;                   // Événements perdus (tampon plein)
+    CaseTrace cases[CAPACITE_TRACE];
+};
+
+/* Numéro du thread appelant dans les traces (0 : pas encore attribué) */
+static __thread uint16_t numero_fil;
+static uint16_t dernier_fil;
+
+/**
+ * Ajoute un événement à la trace sans attendre. Plusieurs threads peuvent
+ * appeler cette fonction en même temps ; si le tampon est plein,
+ * l'événement est compté comme perdu.
+ * @param t La trace
+ * @param type Lecture ou écriture
+ * @param bloc Le bloc accédé
+ * @param contexte L'opération en cours dans le thread appelant
+ */
+void tracer_evenement(Trace* t, TypeAcces type, int bloc, ContexteOperation contexte) {
+    if (numero_fil == 0) {
+        numero_fil = __atomic_add_fetch(&dernier_fil, 1, __ATOMIC_RELAXED);
+    }
+
+    uint64_t position = __atomic_load_n(&t->tete, __ATOMIC_RELAXED);
+    CaseTrace* c;
+    for (;;) {
+        c = &t->cases[position & (CAPACITE_TRACE - 1)];
+        uint64_t sequence = __atomic_load_n(&c->sequence, __ATOMIC_ACQUIRE);
+        if (sequence == position) {
+            // Case libre : la réserver
+            if (__atomic_compare_exchange_n(&t->tete, &position, position + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (sequence < position) {
+            // L'écrivain n'a pas encore vidé cette case : tampon plein
+            __atomic_add_fetch(&t->nb_perdus, 1, __ATOMIC_RELAXED);
+            return;
+        } else {
+            // Un autre producteur a pris la case entre-temps
+            position = __atomic_load_n(&t->tete, __ATOMIC_RELAXED);
+        }
+    }
+
+    c->evenement.horodatage_ns = horloge_ns() - t->origine_ns;
+    c->evenement.numero_operation = contexte.numero;
+    c->evenement.bloc = bloc;
+    c->evenement.type = type;
+    c->evenement.operation = contexte.operation;
+    c->evenement.fil = numero_fil;
+    c->evenement.reserve = 0;
+    __atomic_store_n(&c->sequence, position + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Écrit un tampon entier dans un fichier
+ * @return 0 si succès, -1 si erreur
+ */
+static int ecrire_tout(int descripteur, const void* donnees, size_t taille) {
+    const char* p = donnees;
+    while (taille > 0) {
+        ssize_t n = write(descripteur, p, taille);
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        taille -= n;
+    }
+    return 0;
+}
+
+/**
+ * Recopie dans le fichier les événements publiés du tampon
+ * @param t La trace
+ * @return Le nombre d'événements recopiés
+ */
+static int vider_tampon(Trace* t) {
+    EvenementTrace lot[LOT_ECRITURE];
+    int nb = 0;
+
+    while (nb < LOT_ECRITURE) {
+        CaseTrace* c = &t->cases[t->queue & (CAPACITE_TRACE - 1)];
+        if (__atomic_load_n(&c->sequence, __ATOMIC_ACQUIRE) != t->queue + 1) {
+            break;
+        }
+        lot[nb++] = c->evenement;
+        // Libérer la case pour le tour suivant du tampon
+        __atomic_store_n(&c->sequence, t->queue + CAPACITE_TRACE, __ATOMIC_RELEASE);
+        t->queue++;
+    }
+    if (nb > 0 && !t->erreur_ecriture) {
+        if (ecrire_tout(t->descripteur, lot, nb * sizeof(EvenementTrace)) == 0) {
+            t->nb_ecrits += nb;
+        } else {
+            t->erreur_ecriture = 1;
+        }
+    }
+    return nb;
+}
+
+/**
+ * Boucle du thread écrivain : vide le tampon jusqu'à la demande d'arrêt,
+ * puis une dernière fois
+ */
+static void* ecrire_trace(void* argument) {
+    Trace* t = argument;
+    struct timespec pause = { 0, 1000000 };
+
+    while (!__atomic_load_n(&t->arret, __ATOMIC_ACQUIRE)) {
+        if (vider_tampon(t) == 0) {
+            nanosleep(&pause, NULL);
+        }
+    }
+    while (vider_tampon(t) > 0);
+    return NULL;
+}
+
+/**
+ * Crée un fichier de trace et lance son thread écrivain
+ * @param chemin Le fichier de trace (système hôte), remplacé s'il existe
+ * @param taille_bloc La taille d'un bloc de la partition tracée
+ * @param nb_blocs Le nombre de blocs de la partition tracée
+ * @return La trace, ou NULL si erreur
+ */
+Trace* demarrer_trace(const char* chemin, uint32_t taille_bloc, uint32_t nb_blocs) {
+    if (strlen(chemin) >= MAX_CHEMIN) {
+        erreur("Chemin de trace trop long");
+        return NULL;
+    }
+    Trace* t = calloc(1, sizeof(Trace));
+    if (!t) {
+        erreur("Mémoire insuffisante");
+        return NULL;
+    }
+    strcpy(t->chemin, chemin);
+    for (uint64_t i = 0; i < CAPACITE_TRACE; i++) {
+        t->cases[i].sequence = i;
+    }
+
+    t->descripteur = open(chemin, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (t->descripteur == -1) {
+        erreur("Impossible de créer le fichier de trace");
+        free(t);
+        return NULL;
+    }
+
+    EnteteTrace entete = { 0 };
+    memcpy(entete.signature, SIGNATURE_TRACE, sizeof(SIGNATURE_TRACE));
+    entete.version = VERSION_TRACE;
+    entete.taille_bloc = taille_bloc;
+    entete.nb_blocs = nb_blocs;
+    entete.taille_evenement = sizeof(EvenementTrace);
+    entete.date = time(NULL);
+    if (ecrire_tout(t->descripteur, &entete, sizeof(entete)) != 0) {
+        erreur("Erreur d'écriture du fichier de trace");
+        close(t->descripteur);
+        free(t);
+        return NULL;
+    }
+
+    t->origine_ns = horloge_ns();
+    if (pthread_create(&t->ecrivain, NULL, ecrire_trace, t) != 0) {
+        erreur("Impossible de lancer l'écriture de la trace");
+        close(t->descripteur);
+        free(t);
+        return NULL;
+    }
+    return t;
+}
+
+/**
+ * Arrête l'enregistrement : attend que l'écrivain ait vidé le tampon, ferme
+ * le fichier et libère la trace. Plus aucun thread ne doit y déposer
+ * d'événement.
+ * @param t La trace
+ * @param nb_evenements Reçoit le nombre d'événements écrits (peut être NULL)
+ * @param nb_perdus Reçoit le nombre d'événements perdus (peut être NULL)
+ * @return 0 si succès, -1 si le fichier n'a pas pu être écrit entièrement
+ */
+int arreter_trace(Trace* t, uint64_t* nb_evenements, uint64_t* nb_perdus) {
+    __atomic_store_n(&t->arret, 1, __ATOMIC_RELEASE);
+    pthread_join(t->ecrivain, NULL);
+
+    int resultat = t->erreur_ecriture ? -1 : 0;
+    if (close(t->descripteur) != 0) {
+        resultat = -1;
+    }
+    if (resultat != 0) {
+        erreur("Erreur d'écriture du fichier de trace");
+    }
+    if (nb_evenements) {
+        *nb_evenements = t->nb_ecrits;
+    }
+    if (nb_perdus) {
+        *nb_perdus = t->nb_perdus;
+    }
+    free(t);
+    return resultat;
+}
+
+/**
+ * Donne le fichier d'une trace en cours
+ * @param t La trace
+ * @return Le chemin du fichier
+ */
+const char* chemin_trace(const Trace* t) {
+    return t->chemin;
+}
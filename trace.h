@@ -0,0 +1,64 @@
+/**
+ * @file trace.h
+ * @brief Enregistrement des accès aux blocs dans un fichier de trace
+ *
+ * Pendant l'enregistrement, chaque appel à lire_bloc / ecrire_bloc produit
+ * un événement (horodatage, lecture ou écriture, bloc, opération qui l'a
+ * provoqué). Les threads déposent leurs événements sans verrou dans un
+ * tampon circulaire ; un thread écrivain les recopie dans le fichier. Si
+ * le tampon est plein, l'événement est perdu (et compté) plutôt que de
+ * ralentir l'opération.
+ *
+ * Format du fichier : un EnteteTrace puis des EvenementTrace, dans l'ordre
+ * de la machine. L'outil rejeu_fs rejoue une trace sur une copie de
+ * partition.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include "metriques.h"
+
+#define SIGNATURE_TRACE "FSTRACE"         // Signature des fichiers de trace
+#define VERSION_TRACE 1
+#define CAPACITE_TRACE (1 << 16)          // Événements du tampon circulaire (puissance de 2)
+#define TRACE_HORS_OPERATION 0xFF         // Accès fait en dehors de toute opération mesurée
+
+/**
+ * @brief En-tête d'un fichier de trace
+ */
+typedef struct {
+    char signature[8];                    // SIGNATURE_TRACE
+    uint32_t version;                     // VERSION_TRACE
+    uint32_t taille_bloc;                 // Taille d'un bloc de la partition tracée
+    uint32_t nb_blocs;                    // Nombre de blocs de la partition tracée
+    uint32_t taille_evenement;            // sizeof(EvenementTrace)
+    int64_t date;                         // Date du début de l'enregistrement
+} EnteteTrace;
+
+/**
+ * @brief Accès à un bloc
+ */
+typedef struct {
+    uint64_t horodatage_ns;               // Depuis le début de l'enregistrement
+    uint32_t numero_operation;            // Appel de l'opération (0 : hors opération)
+    int32_t bloc;                         // Bloc accédé
+    uint8_t type;                         // TypeAcces (lecture ou écriture)
+    uint8_t operation;                    // OperationMesuree, ou TRACE_HORS_OPERATION
+    uint16_t fil;                         // Numéro du thread qui a fait l'accès
+    uint32_t reserve;
+} EvenementTrace;
+
+_Static_assert(sizeof(EvenementTrace) == 24, "Un événement de trace doit faire 24 octets");
+
+
+/* Enregistrement */
+Trace* demarrer_trace(const char* chemin, uint32_t taille_bloc, uint32_t nb_blocs);
+void tracer_evenement(Trace* t, TypeAcces type, int bloc, ContexteOperation contexte);
+int arreter_trace(Trace* t, uint64_t* nb_evenements, uint64_t* nb_perdus);
+const char* chemin_trace(const Trace* t);
+
+#endif // TRACE_H
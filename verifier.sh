@@ -0,0 +1,139 @@
+#!/bin/sh
+#
+# Pourcentage d'implication :
+# GOBALOUKICHENIN Bala : 33%
+# DEHOUCHE Lisa : 33%
+# GABITA William : 33%
+#
+# Vérifications de bout en bout, par des scripts de commandes (option -f)
+# exécutés sur une partition neuve. Chaque scénario prépare des fichiers,
+# relève leur contenu, les transforme (dedup, defrag, liens...) puis exige
+# que le contenu soit inchangé et que fsck, puis la vérification hors
+# ligne (-k), ne trouvent aucun problème.
+#
+# Usage : ./verifier.sh [programme]   (make verifier)
+
+PROGRAMME=${1:-./gestionnairefs}
+DOSSIER=$(mktemp -d)
+trap 'rm -rf "$DOSSIER"' EXIT
+PARTITION="$DOSSIER/partition.bin"
+NB_ECHECS=0
+
+# Commandes touch/write d'un fichier de <lignes> lignes de 66 octets
+# fichier <nom> <caractère> <lignes> [compresse]
+fichier() {
+    echo "touch $1"
+    [ "${4:-}" = compresse ] && echo "chattr +c $1"
+    echo "write $1"
+    awk -v c="$2" -v n="$3" 'BEGIN {
+        for (i = 0; i < 60; i++) motif = motif c
+        for (i = 0; i < n; i++) printf "%s%05d\n", motif, i * 7919 % 100000
+        print ""
+    }'
+}
+
+# Contenu des fichiers donnés, lus par cat
+contenus() {
+    for f in "$@"; do
+        "$PROGRAMME" -p "$PARTITION" -c "cat $f" 2>&1
+    done
+}
+
+# verifier <nom> <preparation> <transformation> <fichiers...>
+verifier() {
+    nom=$1
+    preparation=$2
+    transformation=$3
+    shift 3
+    rm -f "$PARTITION"
+    raison=""
+    if ! "$PROGRAMME" -e -p "$PARTITION" -f "$preparation" > "$DOSSIER/sortie" 2>&1; then
+        raison="échec de la préparation"
+    else
+        contenus "$@" > "$DOSSIER/avant"
+        if grep -q "Erreur" "$DOSSIER/avant"; then
+            raison="fichiers illisibles après la préparation"
+        elif ! "$PROGRAMME" -e -p "$PARTITION" -f "$transformation" > "$DOSSIER/sortie" 2>&1; then
+            raison="échec de la transformation"
+        elif ! grep -q "Vérification complète : aucun problème" "$DOSSIER/sortie"; then
+            raison="fsck signale des problèmes"
+        elif ! "$PROGRAMME" -k "$PARTITION" > /dev/null 2>&1; then
+            raison="la vérification hors ligne signale des problèmes"
+        else
+            contenus "$@" > "$DOSSIER/apres"
+            cmp -s "$DOSSIER/avant" "$DOSSIER/apres" || raison="contenu modifié"
+        fi
+    fi
+    if [ -z "$raison" ]; then
+        echo "OK      $nom"
+    else
+        echo "ÉCHEC   $nom : $raison"
+        grep -E "Erreur|problème|échec|Bloc|Inode" "$DOSSIER/sortie" | head -10 | sed 's/^/        /'
+        NB_ECHECS=$((NB_ECHECS + 1))
+    fi
+}
+
+# Blocs partagés par dedup puis déplacés par defrag : fichiers avec bloc
+# indirect, copies identiques, fichier compressé et sa copie, et un trou
+# laissé par une suppression
+{
+    fichier grand a 700
+    echo "cp grand grand2"
+    fichier compresse c 3000 compresse
+    echo "cp compresse compresse2"
+    fichier grand3 b 700
+    fichier petit p 20
+    echo "rm petit"
+    echo "sync"
+} > "$DOSSIER/dedup_preparation"
+printf 'dedup\ndefrag\nfsck\n' > "$DOSSIER/dedup_transformation"
+verifier "dedup puis defrag" "$DOSSIER/dedup_preparation" "$DOSSIER/dedup_transformation" \
+    grand grand2 grand3 compresse compresse2
+
+# Fichiers compressés fragmentés par des suppressions, puis défragmentés
+{
+    fichier c1 x 2000 compresse
+    fichier trou1 t 300
+    fichier c2 y 4000 compresse
+    fichier trou2 u 300
+    fichier c3 z 800 compresse
+    fichier brut r 900
+    echo "rm trou1"
+    echo "rm trou2"
+    echo "sync"
+} > "$DOSSIER/compression_preparation"
+printf 'defrag\nfsck\n' > "$DOSSIER/compression_transformation"
+verifier "compression puis defrag" "$DOSSIER/compression_preparation" "$DOSSIER/compression_transformation" \
+    c1 c2 c3 brut
+
+# Liens physiques et références : chaque suppression d'un nom ne rend
+# les blocs qu'avec le dernier ; les blocs partagés par dedup gardent
+# leurs références quand une copie disparaît
+{
+    fichier source s 700
+    echo "ln source lien1"
+    echo "ln source lien2"
+    echo "cp source copie"
+    fichier autre o 500
+    echo "cp autre autre2"
+    echo "sync"
+} > "$DOSSIER/liens_preparation"
+{
+    echo "dedup"
+    echo "rm source"
+    echo "rm lien1"
+    echo "rm autre2"
+    echo "ln lien2 lien3"
+    echo "rm lien3"
+    echo "ln autre autre3"
+    echo "rm autre3"
+    echo "fsck"
+} > "$DOSSIER/liens_transformation"
+verifier "liens et références" "$DOSSIER/liens_preparation" "$DOSSIER/liens_transformation" \
+    lien2 copie autre
+
+if [ "$NB_ECHECS" -gt 0 ]; then
+    echo "$NB_ECHECS vérification(s) en échec"
+    exit 1
+fi
+echo "Toutes les vérifications sont passées"